@@ -0,0 +1,62 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+struct Vector2 {
+    float x, y;
+};
+
+struct Vector3 {
+    float x, y, z;
+};
+
+struct Vertex {
+    Vector3 position;
+    Vector2 texCoord;
+    Vector3 normal;
+};
+
+// Triangles as three indices each into vertices, which are all different.
+struct IndexedMesh {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// Turns the three-vertices-per-triangle list LoadOBJ returns into an indexed mesh, merging
+// vertices that are identical in position, texCoord and normal. Vertices that only share a
+// position (a UV or normal seam) stay apart.
+inline IndexedMesh weldVertices(const std::vector<Vertex>& triangles) {
+    struct Hash {
+        size_t operator()(const Vertex& v) const {
+            unsigned int words[sizeof(Vertex) / 4];
+            memcpy(words, &v, sizeof(words));
+            size_t hash = 2166136261u;
+            for (unsigned int word : words)
+                hash = (hash ^ word) * 16777619u;
+            return hash;
+        }
+    };
+    struct Equal {
+        bool operator()(const Vertex& a, const Vertex& b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+    };
+
+    IndexedMesh mesh;
+    std::unordered_map<Vertex, unsigned int, Hash, Equal> index;
+    const size_t count = triangles.size() - triangles.size() % 3;
+    index.reserve(count);
+    mesh.indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        auto found = index.insert(std::make_pair(triangles[i], (unsigned int)mesh.vertices.size()));
+        if (found.second)
+            mesh.vertices.push_back(triangles[i]);
+        mesh.indices.push_back(found.first->second);
+    }
+    return mesh;
+}
+
+#endif
@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////
+// @file MeshOptimize.h
+// @brief Reorders an indexed triangle list so the GPU does less work drawing it.
+//
+// Nothing changes in what is drawn, only the order of the triangles and of the vertices:
+//	1. OptimizeCache puts triangles that share vertices next to each other (Forsyth's linear
+//	   speed algorithm), so a vertex is mostly still in the post-transform cache when it is
+//	   used again and the vertex shader runs fewer times.
+//	2. OptimizeOverdraw cuts that order into the runs it is made of and draws the runs facing
+//	   outward first, so more of the hidden pixels fail the depth test before shading. Runs
+//	   stay whole, so the cache order is kept, unless that costs more than a threshold.
+//	3. OptimizeVertexFetch renumbers the vertices in the order they are first used, so fetching
+//	   them reads memory front to back. Returns the renumbering to apply to vertex data.
+//
+// Cost is measured with a FIFO cache of CacheSize vertices, as ACMR (vertices transformed
+// per triangle, 0.5 at best for large meshes, 3 at worst) and ATVR (vertices transformed per
+// vertex, 1 at best).
+//
+// Indices may be any integer type, e.g. GLshort for a Shape or unsigned int for an OBJ.
+//
+//	MeshOptimize::Report report = MeshOptimize::Optimize(indices.data(), indices.size(), vertexCount, positions.data(), 3, &remap);
+//	MeshOptimize::Remap(positions, 3, remap);	// And every other per vertex array.
+//	report.Print(cout, "mesh");
+///////////////////////////////////////////////////////////////////////
+
+namespace MeshOptimize
+{
+	const int CacheSize = 16;			// FIFO entries used to measure an order.
+	const int ScoringCacheSize = 32;	// LRU entries OptimizeCache orders for.
+
+	struct CacheStats
+	{
+		float acmr = 0.0f;				// Vertices transformed per triangle.
+		float atvr = 0.0f;				// Vertices transformed per vertex used.
+	};
+
+	// Simulates drawing indices through a FIFO post-transform cache of cacheSize vertices.
+	template <typename Index>
+	CacheStats AnalyzeCache(const Index* indices, size_t indexCount, size_t vertexCount, int cacheSize = CacheSize)
+	{
+		CacheStats stats;
+		const size_t triangles = indexCount / 3;
+		if (triangles == 0)
+			return stats;
+		// A vertex is in the cache if it went in less than cacheSize misses ago.
+		std::vector<size_t> stamp(vertexCount, 0);
+		std::vector<char> used(vertexCount, 0);
+		size_t misses = 0, usedCount = 0;
+		for (size_t i = 0; i < triangles * 3; i++)
+		{
+			const size_t v = (size_t)indices[i];
+			if (stamp[v] == 0 || misses - stamp[v] >= (size_t)cacheSize)
+				stamp[v] = ++misses;
+			if (!used[v])
+			{
+				used[v] = 1;
+				usedCount++;
+			}
+		}
+		stats.acmr = (float)misses / triangles;
+		stats.atvr = (float)misses / std::max(usedCount, (size_t)1);
+		return stats;
+	}
+
+	namespace Detail
+	{
+		// Forsyth's vertex score: high for vertices just used, and for vertices with few
+		// triangles left, so that lone triangles get finished instead of left behind.
+		inline float VertexScore(int cachePosition, unsigned remaining)
+		{
+			if (remaining == 0)
+				return -1.0f;
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				if (cachePosition < 3)
+					score = 0.75f; // The last triangle's vertices: same score, so no preference for an edge.
+				else
+					score = std::pow(1.0f - (float)(cachePosition - 3) / (ScoringCacheSize - 3), 1.5f);
+			}
+			return score + 2.0f / std::sqrt((float)remaining);
+		}
+
+		// For each vertex, the triangles using it: first[v] to first[v + 1] in triangles.
+		template <typename Index>
+		void Adjacency(const Index* indices, size_t triangleCount, size_t vertexCount, std::vector<unsigned>& first, std::vector<unsigned>& triangles)
+		{
+			first.assign(vertexCount + 1, 0);
+			for (size_t i = 0; i < triangleCount * 3; i++)
+				first[(size_t)indices[i] + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				first[v + 1] += first[v];
+			std::vector<unsigned> fill(first.begin(), first.end() - 1);
+			triangles.resize(triangleCount * 3);
+			for (size_t i = 0; i < triangleCount * 3; i++)
+				triangles[fill[(size_t)indices[i]]++] = (unsigned)(i / 3);
+		}
+	}
+
+	// Reorders the triangles in place for the post-transform cache.
+	template <typename Index>
+	void OptimizeCache(Index* indices, size_t indexCount, size_t vertexCount)
+	{
+		using namespace Detail;
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+			return;
+		std::vector<unsigned> first, adjacent;
+		Adjacency(indices, triangleCount, vertexCount, first, adjacent);
+
+		std::vector<unsigned> remaining(vertexCount);
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount), triangleScore(triangleCount, 0.0f);
+		std::vector<char> emitted(triangleCount, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			remaining[v] = first[v + 1] - first[v];
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+		}
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				triangleScore[t] += vertexScore[(size_t)indices[t * 3 + k]];
+
+		std::vector<Index> order(triangleCount * 3);
+		std::vector<unsigned> cache, next;
+		cache.reserve(ScoringCacheSize + 3);
+		size_t cursor = 0;		// Triangles before it are all emitted, for when the cache has none left.
+		size_t best = 0;
+		for (size_t step = 0; step < triangleCount; step++)
+		{
+			Index corners[3];
+			for (int k = 0; k < 3; k++)
+				corners[k] = indices[best * 3 + k];
+			emitted[best] = 1;
+			for (int k = 0; k < 3; k++)
+				order[step * 3 + k] = corners[k];
+
+			// The triangle's vertices go to the front of the cache, the rest move back.
+			next.clear();
+			for (int k = 0; k < 3; k++)
+			{
+				const unsigned v = (unsigned)(size_t)corners[k];
+				if (std::find(next.begin(), next.end(), v) == next.end())
+					next.push_back(v);
+				// One triangle less to draw with v.
+				for (unsigned i = first[v]; i < first[v + 1]; i++)
+					if (adjacent[i] == best)
+					{
+						std::swap(adjacent[i], adjacent[first[v] + remaining[v] - 1]);
+						remaining[v]--;
+						break;
+					}
+			}
+			for (unsigned v : cache)
+				if (std::find(next.begin(), next.end(), v) == next.end())
+					next.push_back(v);
+			for (size_t i = ScoringCacheSize; i < next.size(); i++)
+				cachePosition[next[i]] = -1;
+			if (next.size() > (size_t)ScoringCacheSize)
+				next.resize(ScoringCacheSize);
+			cache.swap(next);
+
+			// Rescore what is in the cache and pick the best triangle around it.
+			for (size_t i = 0; i < cache.size(); i++)
+				cachePosition[cache[i]] = (int)i;
+			float bestScore = -1.0f;
+			for (unsigned v : next)
+				if (cachePosition[v] < 0)
+				{
+					const float score = VertexScore(-1, remaining[v]);
+					for (unsigned i = first[v]; i < first[v] + remaining[v]; i++)
+						triangleScore[adjacent[i]] += score - vertexScore[v];
+					vertexScore[v] = score;
+				}
+			for (unsigned v : cache)
+			{
+				const float score = VertexScore(cachePosition[v], remaining[v]);
+				for (unsigned i = first[v]; i < first[v] + remaining[v]; i++)
+					triangleScore[adjacent[i]] += score - vertexScore[v];
+				vertexScore[v] = score;
+			}
+			for (unsigned v : cache)
+				for (unsigned i = first[v]; i < first[v] + remaining[v]; i++)
+					if (triangleScore[adjacent[i]] > bestScore)
+					{
+						bestScore = triangleScore[adjacent[i]];
+						best = adjacent[i];
+					}
+			if (bestScore < 0.0f && step + 1 < triangleCount)
+			{
+				// Nothing left around the cache: carry on from the first triangle not yet drawn.
+				while (emitted[cursor])
+					cursor++;
+				best = cursor;
+			}
+		}
+		std::copy(order.begin(), order.end(), indices);
+	}
+
+	// Sorts the runs of OptimizeCache's order so that those facing away from the middle of the
+	// mesh, which tend to be in front, are drawn first. positions has stride floats per vertex
+	// with x, y, z first. Keeps the original order if the new one's ACMR is more than threshold
+	// times as high.
+	template <typename Index>
+	void OptimizeOverdraw(Index* indices, size_t indexCount, size_t vertexCount, const float* positions, size_t stride, float threshold = 1.05f)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+			return;
+		const CacheStats before = AnalyzeCache(indices, indexCount, vertexCount);
+
+		// Runs start where the cache had to reload all three vertices of a triangle, which is
+		// where the cache order jumped, and also where a run is already as good as the average
+		// and the next triangle reloads two vertices, so that big runs can be sorted too.
+		std::vector<size_t> starts(1, 0);
+		std::vector<size_t> stamp(vertexCount, 0);
+		size_t misses = 0, runMisses = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			int triangleMisses = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				const size_t v = (size_t)indices[t * 3 + k];
+				if (stamp[v] == 0 || misses - stamp[v] >= (size_t)CacheSize)
+				{
+					stamp[v] = ++misses;
+					triangleMisses++;
+				}
+			}
+			const size_t run = t - starts.back();
+			if (t > 0 && (triangleMisses == 3 || (triangleMisses == 2 && run > 0 && (float)runMisses / run <= before.acmr * threshold)))
+			{
+				starts.push_back(t);
+				runMisses = 0;
+			}
+			runMisses += triangleMisses;
+		}
+		starts.push_back(triangleCount);
+		const size_t runs = starts.size() - 1;
+		if (runs < 2)
+			return;
+
+		// Middle of the mesh and, per run, its middle and which way it faces, both by area.
+		struct Run
+		{
+			size_t begin, end;
+			float key;
+		};
+		auto position = [&](size_t i, int axis) { return positions[(size_t)indices[i] * stride + axis]; };
+		float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+		float meshArea = 0.0f;
+		std::vector<float> runCenter(runs * 3, 0.0f), runNormal(runs * 3, 0.0f), runArea(runs, 0.0f);
+		for (size_t r = 0; r < runs; r++)
+			for (size_t t = starts[r]; t < starts[r + 1]; t++)
+			{
+				float e1[3], e2[3], n[3];
+				for (int a = 0; a < 3; a++)
+				{
+					e1[a] = position(t * 3 + 1, a) - position(t * 3, a);
+					e2[a] = position(t * 3 + 2, a) - position(t * 3, a);
+				}
+				n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+				n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+				n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+				const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int a = 0; a < 3; a++)
+				{
+					const float center = (position(t * 3, a) + position(t * 3 + 1, a) + position(t * 3 + 2, a)) / 3.0f;
+					runCenter[r * 3 + a] += center * area;
+					runNormal[r * 3 + a] += n[a];
+					meshCenter[a] += center * area;
+				}
+				runArea[r] += area;
+				meshArea += area;
+			}
+		if (meshArea <= 0.0f)
+			return;
+		std::vector<Run> order(runs);
+		for (size_t r = 0; r < runs; r++)
+		{
+			float key = 0.0f;
+			if (runArea[r] > 0.0f)
+				for (int a = 0; a < 3; a++)
+					key += (runCenter[r * 3 + a] / runArea[r] - meshCenter[a] / meshArea) * runNormal[r * 3 + a] / runArea[r];
+			order[r] = { starts[r], starts[r + 1], key };
+		}
+		std::stable_sort(order.begin(), order.end(), [](const Run& a, const Run& b) { return a.key > b.key; });
+
+		std::vector<Index> sorted;
+		sorted.reserve(triangleCount * 3);
+		for (const Run& run : order)
+			sorted.insert(sorted.end(), indices + run.begin * 3, indices + run.end * 3);
+		if (AnalyzeCache(sorted.data(), sorted.size(), vertexCount).acmr <= before.acmr * threshold)
+			std::copy(sorted.begin(), sorted.end(), indices);
+	}
+
+	// Renumbers the vertices in the order indices first use them and returns remap, remap[old] =
+	// new. Vertices no triangle uses go last, in their old order.
+	template <typename Index>
+	std::vector<unsigned> OptimizeVertexFetch(Index* indices, size_t indexCount, size_t vertexCount)
+	{
+		const unsigned unset = ~0u;
+		std::vector<unsigned> remap(vertexCount, unset);
+		unsigned next = 0;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			unsigned& to = remap[(size_t)indices[i]];
+			if (to == unset)
+				to = next++;
+			indices[i] = (Index)to;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+			if (remap[v] == unset)
+				remap[v] = next++;
+		return remap;
+	}
+
+	// Moves each vertex's components values in data to where remap says.
+	template <typename T>
+	void Remap(std::vector<T>& data, size_t components, const std::vector<unsigned>& remap)
+	{
+		if (data.size() != remap.size() * components)
+			return;
+		std::vector<T> moved(data.size());
+		for (size_t v = 0; v < remap.size(); v++)
+			std::copy(data.begin() + v * components, data.begin() + (v + 1) * components, moved.begin() + (size_t)remap[v] * components);
+		data.swap(moved);
+	}
+
+	struct Report
+	{
+		size_t triangles = 0, vertices = 0;
+		CacheStats before, after;
+
+		void Print(std::ostream& out, const char* name) const
+		{
+			out << name << ": " << triangles << " triangles, " << vertices << " vertices, ACMR "
+				<< before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+		}
+	};
+
+	// All three in order. When remap is given, vertices are renumbered too and remap says how to
+	// move the vertex data (see Remap); without it only the triangle order changes. A triangle
+	// order that was already better, as small hand made shapes can be, is kept.
+	template <typename Index>
+	Report Optimize(Index* indices, size_t indexCount, size_t vertexCount, const float* positions, size_t stride, std::vector<unsigned>* remap = nullptr)
+	{
+		Report report;
+		report.triangles = indexCount / 3;
+		report.vertices = vertexCount;
+		report.before = AnalyzeCache(indices, indexCount, vertexCount);
+		const std::vector<Index> original(indices, indices + indexCount);
+		OptimizeCache(indices, indexCount, vertexCount);
+		OptimizeOverdraw(indices, indexCount, vertexCount, positions, stride);
+		if (AnalyzeCache(indices, indexCount, vertexCount).acmr > report.before.acmr)
+			std::copy(original.begin(), original.end(), indices);
+		if (remap)
+			*remap = OptimizeVertexFetch(indices, indexCount, vertexCount);
+		report.after = AnalyzeCache(indices, indexCount, vertexCount);
+		return report;
+	}
+
+	// Runs AnalyzeCache on orders whose misses can be counted by hand and prints each result.
+	inline bool CheckAnalyzeCache(std::ostream& out)
+	{
+		struct Case
+		{
+			const char* name;
+			unsigned indices[6];
+			int cacheSize;
+			float acmr, atvr;
+		};
+		const Case cases[] =
+		{
+			{ "0 1 2, 0 1 2", { 0, 1, 2, 0, 1, 2 }, 3, 1.5f, 1.0f },
+			{ "0 1 2, 0 1 2", { 0, 1, 2, 0, 1, 2 }, 2, 3.0f, 2.0f },
+			{ "0 1 2, 0 1 2", { 0, 1, 2, 0, 1, 2 }, 1, 3.0f, 2.0f },
+			{ "0 1 2, 2 1 0", { 0, 1, 2, 2, 1, 0 }, 3, 1.5f, 1.0f },
+			{ "0 1 2, 2 1 0", { 0, 1, 2, 2, 1, 0 }, 2, 2.0f, 4.0f / 3.0f },
+			{ "0 1 2, 2 1 0", { 0, 1, 2, 2, 1, 0 }, 1, 2.5f, 5.0f / 3.0f },
+			{ "0 1 2, 1 3 2", { 0, 1, 2, 1, 3, 2 }, 3, 2.0f, 1.0f },
+			{ "0 1 2, 3 4 5", { 0, 1, 2, 3, 4, 5 }, 16, 3.0f, 1.0f },
+		};
+		bool ok = true;
+		for (const Case& c : cases)
+		{
+			const CacheStats stats = AnalyzeCache(c.indices, 6, 6, c.cacheSize);
+			const bool right = std::fabs(stats.acmr - c.acmr) < 1e-6f && std::fabs(stats.atvr - c.atvr) < 1e-6f;
+			out << c.name << " through " << c.cacheSize << " entries: ACMR " << stats.acmr << " (expected " << c.acmr
+				<< "), ATVR " << stats.atvr << " (expected " << c.atvr << ")" << (right ? "" : "  FAILED") << std::endl;
+			ok = ok && right;
+		}
+		return ok;
+	}
+}
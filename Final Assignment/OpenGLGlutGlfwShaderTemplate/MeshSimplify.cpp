@@ -0,0 +1,489 @@
+#include "MeshSimplify.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+    const int Dimensions = 8;           // Position, UV and normal.
+    const double BorderWeight = 10.0;   // How strongly an open edge holds its place, per squared length.
+
+    struct Collapse {
+        unsigned int from, to;
+        double cost, distance;
+        bool border;
+    };
+
+    unsigned long long edgeKey(unsigned int a, unsigned int b) {
+        return a < b ? (unsigned long long)a << 32 | b : (unsigned long long)b << 32 | a;
+    }
+
+    double dot(const double* a, const double* b, int n) {
+        double sum = 0.0;
+        for (int i = 0; i < n; i++)
+            sum += a[i] * b[i];
+        return sum;
+    }
+
+    void cross(const double* a, const double* b, double* out) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+}
+
+size_t MeshSimplifier::at(int row, int column) {
+    if (row > column)
+        std::swap(row, column);
+    return row * Dimensions - row * (row - 1) / 2 + (column - row);
+}
+
+MeshSimplifier::MeshSimplifier(const IndexedMesh& mesh, const SimplifyOptions& options)
+    : options(options), current(mesh.indices) {
+    const size_t count = mesh.vertices.size();
+
+    // Work in a unit sphere around the mesh so that errors and weights don't depend on its size.
+    Vector3 low = { 0, 0, 0 }, high = { 0, 0, 0 };
+    for (size_t i = 0; i < count; i++) {
+        const Vector3& p = mesh.vertices[i].position;
+        if (i == 0)
+            low = high = p;
+        low = { std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z) };
+        high = { std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z) };
+    }
+    center = { (low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f };
+    radius = 0.0f;
+    for (const Vertex& v : mesh.vertices) {
+        const float dx = v.position.x - center.x, dy = v.position.y - center.y, dz = v.position.z - center.z;
+        radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+    if (radius <= 0.0f)
+        radius = 1.0f;
+
+    attributes.resize(count * Dimensions);
+    std::unordered_map<unsigned long long, unsigned int> positions;
+    position.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const Vertex& v = mesh.vertices[i];
+        double* x = &attributes[i * Dimensions];
+        x[0] = (v.position.x - center.x) / radius;
+        x[1] = (v.position.y - center.y) / radius;
+        x[2] = (v.position.z - center.z) / radius;
+        x[3] = v.texCoord.x * options.uvWeight;
+        x[4] = v.texCoord.y * options.uvWeight;
+        x[5] = v.normal.x * options.normalWeight;
+        x[6] = v.normal.y * options.normalWeight;
+        x[7] = v.normal.z * options.normalWeight;
+
+        unsigned int bits[3];
+        memcpy(bits, &v.position, sizeof(bits));
+        const unsigned long long key = ((unsigned long long)bits[0] * 73856093u) ^ ((unsigned long long)bits[1] * 19349663u << 16) ^ ((unsigned long long)bits[2] * 83492791u << 32);
+        // Colliding keys for different positions just aren't merged: compare before trusting one.
+        auto found = positions.insert(std::make_pair(key, (unsigned int)i));
+        const Vector3& first = mesh.vertices[found.first->second].position;
+        position[i] = memcmp(&first, &v.position, sizeof(Vector3)) == 0 ? found.first->second : (unsigned int)i;
+    }
+
+    // What may move: not a vertex on a UV or normal seam (its twin would have to move with it),
+    // nor one on an edge of more than two triangles. One on an open edge only along that edge.
+    std::unordered_map<unsigned long long, int> edgeUses;
+    for (size_t i = 0; i + 2 < current.size(); i += 3)
+        for (int k = 0; k < 3; k++)
+            edgeUses[edgeKey(position[current[i + k]], position[current[i + (k + 1) % 3]])]++;
+    std::vector<int> borderEdges(count, 0), groupSize(count, 0);
+    kinds.assign(count, Manifold);
+    for (size_t i = 0; i < count; i++)
+        groupSize[position[i]]++;
+    for (const auto& edge : edgeUses) {
+        const unsigned int a = (unsigned int)(edge.first >> 32), b = (unsigned int)edge.first;
+        if (edge.second > 2)
+            kinds[a] = kinds[b] = Locked;
+        else if (edge.second == 1) {
+            borderEdges[a]++;
+            borderEdges[b]++;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        const unsigned int p = position[i];
+        if (groupSize[p] > 1 || kinds[p] == Locked || (borderEdges[p] > 0 && (options.lockBorder || borderEdges[p] != 2)))
+            kinds[i] = Locked;
+        else if (borderEdges[p] > 0)
+            kinds[i] = Border;
+    }
+
+    quadrics.assign(count, Quadric());
+    for (Quadric& q : quadrics)
+        memset(&q, 0, sizeof(q));
+    planes.assign(count, PlaneQuadric());
+    for (PlaneQuadric& q : planes)
+        memset(&q, 0, sizeof(q));
+    for (size_t i = 0; i + 2 < current.size(); i += 3) {
+        addTriangleQuadric(current[i], current[i + 1], current[i + 2]);
+        for (int k = 0; k < 3; k++) {
+            const unsigned int a = current[i + k], b = current[i + (k + 1) % 3];
+            if (edgeUses[edgeKey(position[a], position[b])] == 1)
+                addBorderQuadric(a, b, current[i + (k + 2) % 3]);
+        }
+    }
+}
+
+void MeshSimplifier::addTriangleQuadric(unsigned int v0, unsigned int v1, unsigned int v2) {
+    // The squared distance from x to the triangle's plane in 8 dimensions is
+    // x.A.x + 2 b.x + c with A = I - e1 e1 - e2 e2, e1 and e2 spanning the plane.
+    const double* p = &attributes[v0 * Dimensions];
+    const double* q = &attributes[v1 * Dimensions];
+    const double* r = &attributes[v2 * Dimensions];
+    double e1[Dimensions], e2[Dimensions];
+    for (int i = 0; i < Dimensions; i++) {
+        e1[i] = q[i] - p[i];
+        e2[i] = r[i] - p[i];
+    }
+    double normal[3];
+    cross(e1, e2, normal);
+    const double area = 0.5 * std::sqrt(dot(normal, normal, 3));
+    const double length1 = std::sqrt(dot(e1, e1, Dimensions));
+    if (area <= 0.0 || length1 <= 0.0)
+        return;
+    for (int i = 0; i < Dimensions; i++)
+        e1[i] /= length1;
+    const double along = dot(e2, e1, Dimensions);
+    for (int i = 0; i < Dimensions; i++)
+        e2[i] -= along * e1[i];
+    const double length2 = std::sqrt(dot(e2, e2, Dimensions));
+    if (length2 <= 0.0)
+        return;
+    for (int i = 0; i < Dimensions; i++)
+        e2[i] /= length2;
+
+    Quadric t;
+    const double pe1 = dot(p, e1, Dimensions), pe2 = dot(p, e2, Dimensions);
+    for (int i = 0; i < Dimensions; i++) {
+        for (int j = i; j < Dimensions; j++)
+            t.a[at(i, j)] = (i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j];
+        t.b[i] = pe1 * e1[i] + pe2 * e2[i] - p[i];
+    }
+    t.c = dot(p, p, Dimensions) - pe1 * pe1 - pe2 * pe2;
+
+    // Weighted by area, so that errors are an average over the surface merged into a vertex.
+    for (unsigned int v : { v0, v1, v2 }) {
+        Quadric& to = quadrics[v];
+        for (int i = 0; i < 36; i++)
+            to.a[i] += t.a[i] * area;
+        for (int i = 0; i < Dimensions; i++)
+            to.b[i] += t.b[i] * area;
+        to.c += t.c * area;
+        to.weight += area;
+    }
+
+    // And the plane in 3 dimensions alone, for how far the surface moves: x.n n.x + 2 d n.x + d d.
+    double n[3];
+    for (int i = 0; i < 3; i++)
+        n[i] = normal[i] / (2.0 * area);
+    const double d = -dot(n, p, 3);
+    for (unsigned int v : { v0, v1, v2 }) {
+        PlaneQuadric& to = planes[v];
+        for (int i = 0, k = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++)
+                to.a[k++] += n[i] * n[j] * area;
+            to.b[i] += d * n[i] * area;
+        }
+        to.c += d * d * area;
+        to.weight += area;
+    }
+}
+
+void MeshSimplifier::addBorderQuadric(unsigned int v0, unsigned int v1, unsigned int opposite) {
+    // A plane through the open edge at right angles to its triangle keeps the edge from moving sideways.
+    const double* p = &attributes[v0 * Dimensions];
+    const double* q = &attributes[v1 * Dimensions];
+    const double* r = &attributes[opposite * Dimensions];
+    double edge[3], other[3], normal[3], plane[3];
+    for (int i = 0; i < 3; i++) {
+        edge[i] = q[i] - p[i];
+        other[i] = r[i] - p[i];
+    }
+    cross(edge, other, normal);
+    cross(edge, normal, plane);
+    const double length = std::sqrt(dot(plane, plane, 3)), edgeLength2 = dot(edge, edge, 3);
+    if (length <= 0.0)
+        return;
+    for (int i = 0; i < 3; i++)
+        plane[i] /= length;
+    const double d = dot(plane, p, 3), weight = BorderWeight * edgeLength2;
+    for (unsigned int v : { v0, v1 }) {
+        Quadric& to = quadrics[v];
+        for (int i = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++)
+                to.a[at(i, j)] += plane[i] * plane[j] * weight;
+            to.b[i] -= d * plane[i] * weight;
+        }
+        to.c += d * d * weight;
+        to.weight += weight;
+    }
+}
+
+double MeshSimplifier::cost(const Quadric& q, unsigned int v) const {
+    const double* x = &attributes[v * Dimensions];
+    double sum = q.c;
+    for (int i = 0; i < Dimensions; i++) {
+        sum += 2.0 * q.b[i] * x[i] + q.a[at(i, i)] * x[i] * x[i];
+        for (int j = i + 1; j < Dimensions; j++)
+            sum += 2.0 * q.a[at(i, j)] * x[i] * x[j];
+    }
+    return std::max(sum, 0.0) / std::max(q.weight, 1e-12);
+}
+
+double MeshSimplifier::distance(const PlaneQuadric& q, unsigned int v) const {
+    const double* x = &attributes[v * Dimensions];
+    const double sum = q.a[0] * x[0] * x[0] + q.a[3] * x[1] * x[1] + q.a[5] * x[2] * x[2]
+        + 2.0 * (q.a[1] * x[0] * x[1] + q.a[2] * x[0] * x[2] + q.a[4] * x[1] * x[2])
+        + 2.0 * dot(q.b, x, 3) + q.c;
+    return std::max(sum, 0.0) / std::max(q.weight, 1e-12);
+}
+
+bool MeshSimplifier::flips(unsigned int from, unsigned int to, const std::vector<unsigned int>& around) const {
+    const double* target = &attributes[to * Dimensions];
+    for (unsigned int t : around) {
+        const unsigned int* triangle = &current[t * 3];
+        if (position[triangle[0]] == position[to] || position[triangle[1]] == position[to] || position[triangle[2]] == position[to])
+            continue;   // Goes away with the collapse.
+        const double* p[3];
+        const double* moved[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = &attributes[triangle[k] * Dimensions];
+            moved[k] = position[triangle[k]] == position[from] ? target : p[k];
+        }
+        double a[3], b[3], before[3], after[3];
+        for (int i = 0; i < 3; i++) {
+            a[i] = p[1][i] - p[0][i];
+            b[i] = p[2][i] - p[0][i];
+        }
+        cross(a, b, before);
+        for (int i = 0; i < 3; i++) {
+            a[i] = moved[1][i] - moved[0][i];
+            b[i] = moved[2][i] - moved[0][i];
+        }
+        cross(a, b, after);
+        if (dot(before, after, 3) < 0.25 * std::sqrt(dot(before, before, 3) * dot(after, after, 3)))
+            return true;
+    }
+    return false;
+}
+
+bool MeshSimplifier::onePass(size_t targetTriangles, double targetDistance) {
+    const size_t triangles = current.size() / 3, count = position.size();
+
+    // Triangles around each position.
+    std::vector<unsigned int> first(count + 1, 0), around(current.size());
+    for (unsigned int v : current)
+        first[position[v] + 1]++;
+    for (size_t i = 0; i < count; i++)
+        first[i + 1] += first[i];
+    std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < current.size(); i++)
+        around[fill[position[current[i]]]++] = (unsigned int)(i / 3);
+
+    std::unordered_map<unsigned long long, int> edgeUses;
+    edgeUses.reserve(current.size());
+    for (size_t i = 0; i < current.size(); i += 3)
+        for (int k = 0; k < 3; k++)
+            edgeUses[edgeKey(position[current[i + k]], position[current[i + (k + 1) % 3]])]++;
+
+    // Every edge once, the cheaper way round.
+    std::vector<Collapse> collapses;
+    collapses.reserve(current.size());
+    for (size_t i = 0; i < current.size(); i += 3)
+        for (int k = 0; k < 3; k++) {
+            const unsigned int a = current[i + k], b = current[i + (k + 1) % 3];
+            const bool border = edgeUses[edgeKey(position[a], position[b])] == 1;
+            if (!border && position[a] > position[b])
+                continue;   // Seen from the other triangle.
+            Collapse best = { 0, 0, -1.0, 0.0, border };
+            for (int way = 0; way < 2; way++) {
+                const unsigned int from = way ? b : a, to = way ? a : b;
+                if (kinds[from] == Locked || (kinds[from] == Border && !border))
+                    continue;
+                Quadric sum = quadrics[from];
+                const Quadric& other = quadrics[to];
+                for (int j = 0; j < 36; j++)
+                    sum.a[j] += other.a[j];
+                for (int j = 0; j < Dimensions; j++)
+                    sum.b[j] += other.b[j];
+                sum.c += other.c;
+                sum.weight += other.weight;
+                const double c = cost(sum, to);
+                if (best.cost < 0.0 || c < best.cost) {
+                    PlaneQuadric surface = planes[from];
+                    const PlaneQuadric& otherSurface = planes[to];
+                    for (int j = 0; j < 6; j++)
+                        surface.a[j] += otherSurface.a[j];
+                    for (int j = 0; j < 3; j++)
+                        surface.b[j] += otherSurface.b[j];
+                    surface.c += otherSurface.c;
+                    surface.weight += otherSurface.weight;
+                    best = { from, to, c, distance(surface, to), border };
+                }
+            }
+            if (best.cost >= 0.0 && best.distance <= targetDistance)
+                collapses.push_back(best);
+        }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+    // Collapse cheapest first, but nothing next to a collapse already made this pass, so that the
+    // triangles every check looks at are still the ones in current.
+    std::vector<unsigned int> remap(count);
+    for (size_t i = 0; i < count; i++)
+        remap[i] = (unsigned int)i;
+    std::vector<char> touched(count, 0);
+    std::vector<unsigned int> neighbours, others, aroundFrom;
+    size_t removed = 0;
+    for (const Collapse& c : collapses) {
+        if (triangles - removed <= targetTriangles)
+            break;
+        const unsigned int from = position[c.from], to = position[c.to];
+        if (touched[from] || touched[to])
+            continue;
+        aroundFrom.assign(around.begin() + first[from], around.begin() + first[from + 1]);
+
+        // Only the one or two triangles on the edge may share a neighbour of both ends, or the
+        // surface would fold onto itself.
+        neighbours.clear();
+        others.clear();
+        size_t onEdge = 0;
+        for (unsigned int t : aroundFrom) {
+            bool hasTo = false;
+            for (int k = 0; k < 3; k++) {
+                neighbours.push_back(position[current[t * 3 + k]]);
+                hasTo |= position[current[t * 3 + k]] == to;
+            }
+            onEdge += hasTo ? 1 : 0;
+        }
+        for (unsigned int i = first[to]; i < first[to + 1]; i++)
+            for (int k = 0; k < 3; k++)
+                others.push_back(position[current[around[i] * 3 + k]]);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        std::sort(others.begin(), others.end());
+        others.erase(std::unique(others.begin(), others.end()), others.end());
+        size_t shared = 0;
+        for (size_t i = 0, j = 0; i < neighbours.size() && j < others.size();) {
+            if (neighbours[i] < others[j])
+                i++;
+            else if (others[j] < neighbours[i])
+                j++;
+            else {
+                shared += neighbours[i] != from && neighbours[i] != to ? 1 : 0;
+                i++;
+                j++;
+            }
+        }
+        if (shared != onEdge || flips(c.from, c.to, aroundFrom))
+            continue;
+
+        remap[c.from] = c.to;
+        Quadric& q = quadrics[c.to];
+        const Quadric& merged = quadrics[c.from];
+        for (int j = 0; j < 36; j++)
+            q.a[j] += merged.a[j];
+        for (int j = 0; j < Dimensions; j++)
+            q.b[j] += merged.b[j];
+        q.c += merged.c;
+        q.weight += merged.weight;
+        PlaneQuadric& surface = planes[c.to];
+        const PlaneQuadric& mergedSurface = planes[c.from];
+        for (int j = 0; j < 6; j++)
+            surface.a[j] += mergedSurface.a[j];
+        for (int j = 0; j < 3; j++)
+            surface.b[j] += mergedSurface.b[j];
+        surface.c += mergedSurface.c;
+        surface.weight += mergedSurface.weight;
+        largestDistance = std::max(largestDistance, c.distance);
+        for (unsigned int n : neighbours)
+            touched[n] = 1;
+        touched[to] = 1;
+        removed += onEdge;
+    }
+    if (removed == 0)
+        return false;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < current.size(); i += 3) {
+        const unsigned int a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+        if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c])
+            continue;
+        current[kept++] = a;
+        current[kept++] = b;
+        current[kept++] = c;
+    }
+    current.resize(kept);
+    largestError = (float)std::sqrt(largestDistance);
+    return true;
+}
+
+bool MeshSimplifier::simplify(size_t targetTriangles, float targetError) {
+    const double targetDistance = (double)targetError * targetError;
+    bool progress = false;
+    while (current.size() / 3 > targetTriangles && onePass(targetTriangles, targetDistance))
+        progress = true;
+    return progress;
+}
+
+std::vector<unsigned int> simplifyMesh(const IndexedMesh& mesh, const SimplifyOptions& options, float* error) {
+    MeshSimplifier simplifier(mesh, options);
+    simplifier.simplify(options.targetTriangles, options.targetError);
+    if (error)
+        *error = simplifier.error();
+    return simplifier.indices();
+}
+
+LODChain buildLODChain(const IndexedMesh& mesh, int maxLevels, float ratio, float maxError) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    LODChain chain;
+    chain.indices = mesh.indices;
+    chain.levels.push_back({ 0, (unsigned int)mesh.indices.size(), 0.0f });
+
+    MeshSimplifier simplifier(mesh);
+    chain.center = simplifier.meshCenter();
+    chain.radius = simplifier.meshRadius();
+    while ((int)chain.levels.size() < maxLevels) {
+        const MeshLOD& last = chain.levels.back();
+        simplifier.simplify((size_t)(last.indexCount / 3 * ratio), maxError);
+        const std::vector<unsigned int>& indices = simplifier.indices();
+        // Stop once a level would save less than a tenth of the one before.
+        if (indices.empty() || indices.size() > last.indexCount * 9 / 10)
+            break;
+        chain.levels.push_back({ (unsigned int)chain.indices.size(), (unsigned int)indices.size(), simplifier.error() });
+        chain.indices.insert(chain.indices.end(), indices.begin(), indices.end());
+    }
+    chain.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return chain;
+}
+
+int selectLOD(const LODChain& chain, float projectedRadius, int current, float threshold, float hysteresis) {
+    const float pixels = chain.radius > 0.0f ? projectedRadius / chain.radius : 0.0f;   // Per unit of error.
+    const int levels = (int)chain.levels.size();
+    current = std::min(std::max(current, 0), levels - 1);
+    int best = 0;
+    for (int i = 1; i < levels; i++)
+        if (chain.levels[i].error * pixels <= threshold)
+            best = i;
+    if (best <= current)
+        return best;
+    int coarser = current;
+    for (int i = current + 1; i <= best; i++)
+        if (chain.levels[i].error * pixels <= threshold * (1.0f - hysteresis))
+            coarser = i;
+    return coarser;
+}
+
+void printLODReport(std::ostream& out, const char* name, const LODChain& chain) {
+    const unsigned int full = chain.levels.empty() ? 0 : chain.levels[0].indexCount / 3;
+    out << name << ": " << chain.levels.size() << " levels in " << chain.milliseconds << " ms" << std::endl;
+    for (size_t i = 0; i < chain.levels.size(); i++) {
+        const MeshLOD& level = chain.levels[i];
+        const unsigned int triangles = level.indexCount / 3;
+        out << "  LOD " << i << ": " << triangles << " triangles ("
+            << (full ? 100.0 * triangles / full : 0.0) << "% of " << full << "), error "
+            << level.error << " (" << (chain.radius > 0.0f ? 100.0f * level.error / chain.radius : 0.0f) << "% of radius)" << std::endl;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include "Mesh.h"
+#include <ostream>
+#include <vector>
+
+// Quadric error mesh simplification (Garland and Heckbert) and levels of detail built with it.
+// Nothing here needs OpenGL, so it runs headless: see main's --lod-report.
+//
+// Edges are collapsed cheapest first, one end onto the other, so every level keeps using the
+// mesh's own vertices and only needs its own indices. The cost of a collapse, which picks the
+// order, is how far it moves the surface, its UVs and its normals from the triangles already merged
+// into both ends. The error, which stops it and picks levels, is the surface's part of that alone:
+// the root mean square distance of the kept vertex from the planes of those triangles.
+
+struct SimplifyOptions {
+    size_t targetTriangles = 0;     // Stop at or below this many triangles...
+    float targetError = 0.01f;      // ...or before the surface would move further than this, as a fraction of the mesh's radius.
+    float uvWeight = 0.5f;          // How much a change of one in UV or normal counts against moving the surface
+    float normalWeight = 0.5f;      // by the mesh's radius.
+    bool lockBorder = false;        // Keep open edges where they are, otherwise their vertices may slide along them.
+};
+
+class MeshSimplifier {
+public:
+    explicit MeshSimplifier(const IndexedMesh& mesh, const SimplifyOptions& options = SimplifyOptions());
+
+    // Collapses edges until options' target triangles or error is reached, carrying on from the
+    // last call: a call with a lower target continues where the previous one stopped.
+    // Returns false once no edge can be collapsed any more.
+    bool simplify(size_t targetTriangles, float targetError);
+
+    const std::vector<unsigned int>& indices() const { return current; }
+    // The largest distance any collapse so far moved the surface, in the mesh's units.
+    float error() const { return largestError * radius; }
+    float meshRadius() const { return radius; }
+    Vector3 meshCenter() const { return center; }
+
+private:
+    struct Quadric {
+        double a[36];   // Upper triangle of the symmetric 8x8 matrix.
+        double b[8];
+        double c;
+        double weight;
+    };
+    struct PlaneQuadric {
+        double a[6];    // Upper triangle of the symmetric 3x3 matrix, positions only.
+        double b[3];
+        double c;
+        double weight;
+    };
+    enum Kind { Manifold, Border, Locked };
+
+    void addTriangleQuadric(unsigned int v0, unsigned int v1, unsigned int v2);
+    void addBorderQuadric(unsigned int v0, unsigned int v1, unsigned int opposite);
+    double cost(const Quadric& q, unsigned int v) const;
+    double distance(const PlaneQuadric& q, unsigned int v) const;
+    bool flips(unsigned int from, unsigned int to, const std::vector<unsigned int>& around) const;
+    bool onePass(size_t targetTriangles, double targetDistance);
+    static size_t at(int row, int column);
+
+    SimplifyOptions options;
+    Vector3 center;
+    float radius;
+    std::vector<double> attributes;          // 8 per vertex: position, UV, normal, scaled.
+    std::vector<unsigned int> position;      // The first vertex at each vertex's position.
+    std::vector<Kind> kinds;
+    std::vector<Quadric> quadrics;
+    std::vector<PlaneQuadric> planes;        // The same triangles' planes without UV or normal.
+    std::vector<unsigned int> current;
+    double largestDistance = 0.0;            // Squared, in the unit sphere.
+    float largestError = 0.0f;
+};
+
+// Simplifies mesh once, see SimplifyOptions. Returns the new indices into mesh.vertices.
+std::vector<unsigned int> simplifyMesh(const IndexedMesh& mesh, const SimplifyOptions& options, float* error = nullptr);
+
+// One level of detail: indexCount indices from firstIndex of the chain's indices.
+struct MeshLOD {
+    unsigned int firstIndex, indexCount;
+    float error;                    // How far its surface may be from the full mesh's, in the mesh's units.
+};
+
+// Levels of a mesh, finest (the mesh itself) first, all indexing the same vertices.
+struct LODChain {
+    std::vector<unsigned int> indices;
+    std::vector<MeshLOD> levels;
+    Vector3 center;
+    float radius = 0.0f;
+    double milliseconds = 0.0;      // How long building them took.
+};
+
+// Each level has about ratio times the triangles of the one before, until maxLevels levels or
+// a level's surface would be further than maxError (a fraction of the radius) from the mesh's.
+LODChain buildLODChain(const IndexedMesh& mesh, int maxLevels = 5, float ratio = 0.5f, float maxError = 0.05f);
+
+// The coarsest level whose error covers at most threshold pixels when the mesh's radius covers
+// projectedRadius pixels. To avoid flickering between two levels, a coarser level than current is
+// only taken once its error is below threshold * (1 - hysteresis).
+int selectLOD(const LODChain& chain, float projectedRadius, int current, float threshold = 1.0f, float hysteresis = 0.25f);
+
+// Triangles, reduction and error of every level, one line each.
+void printLODReport(std::ostream& out, const char* name, const LODChain& chain);
+
+#endif
@@ -0,0 +1,354 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+glm::vec3 toVec3(const Vector3& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+// Bounding sphere around the box of the meshlet's vertices, and the cone of its face normals.
+void computeBounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const unsigned int* indices,
+    const std::vector<unsigned int>& meshletVertices) {
+    glm::vec3 low = toVec3(vertices[meshletVertices[0]].position), high = low;
+    for (unsigned int v : meshletVertices) {
+        low = glm::min(low, toVec3(vertices[v].position));
+        high = glm::max(high, toVec3(vertices[v].position));
+    }
+    meshlet.center = (low + high) * 0.5f;
+    float radius = 0.0f;
+    for (unsigned int v : meshletVertices)
+        radius = std::max(radius, glm::length(toVec3(vertices[v].position) - meshlet.center));
+    meshlet.radius = radius;
+
+    // The winding decides which side faces the camera, so the normals come from it and not from the vertices.
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 sum(0.0f);
+    for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+        const unsigned int* triangle = indices + t * 3;
+        const glm::vec3 a = toVec3(vertices[triangle[0]].position);
+        const glm::vec3 n = glm::cross(toVec3(vertices[triangle[1]].position) - a, toVec3(vertices[triangle[2]].position) - a);
+        const float length = glm::length(n);
+        if (length > 0.0f) {
+            normals.push_back(n / length);
+            sum += normals.back();
+        }
+    }
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCos = -1.0f;
+    const float length = glm::length(sum);
+    if (length > 1e-6f) {
+        meshlet.coneAxis = sum / length;
+        meshlet.coneCos = 1.0f;
+        for (const glm::vec3& n : normals)
+            meshlet.coneCos = std::min(meshlet.coneCos, glm::dot(n, meshlet.coneAxis));
+    }
+    meshlet.coneSin = std::sqrt(std::max(0.0f, 1.0f - meshlet.coneCos * meshlet.coneCos));
+}
+
+}
+
+MeshletMesh buildMeshlets(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount,
+    size_t maxVertices, size_t maxTriangles) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    MeshletMesh result;
+    const size_t triangleCount = indexCount / 3, vertexCount = vertices.size();
+    if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0)
+        return result;
+
+    // The triangles around each vertex, first[v] to first[v + 1] in around.
+    std::vector<unsigned int> first(vertexCount + 1, 0), around(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        first[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        first[v + 1] += first[v];
+    std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        around[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    std::vector<char> used(triangleCount, 0);
+    std::vector<unsigned int> live(vertexCount);        // Triangles around a vertex not in a meshlet yet.
+    for (size_t v = 0; v < vertexCount; v++)
+        live[v] = first[v + 1] - first[v];
+    std::vector<unsigned int> seen(triangleCount, 0);   // The meshlet, plus one, that last made a triangle a candidate.
+    std::vector<int> local(vertexCount, -1);            // A vertex's place in the current meshlet.
+    std::vector<unsigned int> meshletVertices, meshletTriangles, candidates;
+    glm::vec3 sum(0.0f);
+    result.indices.reserve(triangleCount * 3);
+
+    auto centroid = [&](unsigned int t) {
+        return (toVec3(vertices[indices[t * 3]].position) + toVec3(vertices[indices[t * 3 + 1]].position)
+            + toVec3(vertices[indices[t * 3 + 2]].position)) / 3.0f;
+    };
+    auto newVertices = [&](unsigned int t) {
+        const unsigned int* triangle = indices + t * 3;
+        size_t count = 0;
+        for (int k = 0; k < 3; k++)
+            if (local[triangle[k]] < 0 && (k == 0 || triangle[k] != triangle[0]) && (k < 2 || triangle[2] != triangle[1]))
+                count++;
+        return count;
+    };
+    // Triangles at vertices with few others left go first, so none are left alone between meshlets.
+    auto liveAround = [&](unsigned int t) {
+        return live[indices[t * 3]] + live[indices[t * 3 + 1]] + live[indices[t * 3 + 2]];
+    };
+    auto add = [&](unsigned int t) {
+        used[t] = 1;
+        meshletTriangles.push_back(t);
+        for (int k = 0; k < 3; k++)
+            live[indices[t * 3 + k]]--;
+        for (int k = 0; k < 3; k++) {
+            const unsigned int v = indices[t * 3 + k];
+            if (local[v] >= 0)
+                continue;
+            local[v] = (int)meshletVertices.size();
+            meshletVertices.push_back(v);
+            sum += toVec3(vertices[v].position);
+            for (unsigned int i = first[v]; i < first[v + 1]; i++) {
+                const unsigned int next = around[i];
+                if (!used[next] && seen[next] != result.meshlets.size() + 1) {
+                    seen[next] = (unsigned int)result.meshlets.size() + 1;
+                    candidates.push_back(next);
+                }
+            }
+        }
+    };
+
+    // The next meshlet starts next to the last one where it can, and at the first triangle left otherwise.
+    std::vector<unsigned int> border;
+    size_t cursor = 0;
+    for (;;) {
+        unsigned int seed = 0, seedLive = ~0u;
+        for (unsigned int t : border) {
+            if (!used[t] && liveAround(t) < seedLive) {
+                seed = t;
+                seedLive = liveAround(t);
+            }
+        }
+        if (seedLive == ~0u) {
+            while (cursor < triangleCount && used[cursor])
+                cursor++;
+            if (cursor == triangleCount)
+                break;
+            seed = (unsigned int)cursor;
+        }
+        add(seed);
+
+        while (meshletTriangles.size() < maxTriangles) {
+            // The neighbour that adds the fewest vertices, then the one with the fewest triangles
+            // left around it, then the one closest to the middle.
+            const glm::vec3 middle = sum / (float)meshletVertices.size();
+            unsigned int best = 0, bestLive = 0;
+            size_t bestNew = 4, keep = 0;
+            float bestDistance = 0.0f;
+            for (unsigned int t : candidates) {
+                if (used[t])
+                    continue;
+                const size_t added = newVertices(t);
+                if (meshletVertices.size() + added > maxVertices)
+                    continue;   // It only gets fuller, so this one never fits.
+                candidates[keep++] = t;
+                if (added > bestNew)
+                    continue;
+                const unsigned int remaining = liveAround(t);
+                const glm::vec3 offset = centroid(t) - middle;
+                const float distance = glm::dot(offset, offset);
+                if (added < bestNew || remaining < bestLive || (remaining == bestLive && distance < bestDistance)) {
+                    best = t;
+                    bestNew = added;
+                    bestLive = remaining;
+                    bestDistance = distance;
+                }
+            }
+            candidates.resize(keep);
+            if (bestNew == 4)
+                break;
+            add(best);
+        }
+
+        Meshlet meshlet;
+        meshlet.firstIndex = (unsigned int)result.indices.size();
+        meshlet.triangleCount = (unsigned int)meshletTriangles.size();
+        meshlet.vertexCount = (unsigned int)meshletVertices.size();
+        for (unsigned int t : meshletTriangles)
+            result.indices.insert(result.indices.end(), indices + t * 3, indices + t * 3 + 3);
+        computeBounds(meshlet, vertices, &result.indices[meshlet.firstIndex], meshletVertices);
+        result.meshlets.push_back(meshlet);
+
+        for (unsigned int v : meshletVertices)
+            local[v] = -1;
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        border.swap(candidates);
+        candidates.clear();
+        sum = glm::vec3(0.0f);
+    }
+
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+void printMeshletReport(std::ostream& out, const char* name, const MeshletMesh& meshlets) {
+    size_t vertices = 0, triangles = 0, cones = 0;
+    for (const Meshlet& meshlet : meshlets.meshlets) {
+        vertices += meshlet.vertexCount;
+        triangles += meshlet.triangleCount;
+        if (meshlet.coneCos > 0.0f)
+            cones++;
+    }
+    const double count = meshlets.meshlets.empty() ? 1.0 : (double)meshlets.meshlets.size();
+    out << name << ": " << meshlets.meshlets.size() << " meshlets of " << vertices / count << " vertices and "
+        << triangles / count << " triangles on average, " << 100.0 * cones / count
+        << "% can face away, built in " << meshlets.milliseconds << " ms" << std::endl;
+}
+
+void OcclusionBuffer::begin(int width, int height, const glm::mat4& viewProjection) {
+    columns = std::max(width, 1);
+    rows = std::max(height, 1);
+    this->viewProjection = viewProjection;
+    depth.assign((size_t)columns * rows, 1.0f);
+}
+
+void OcclusionBuffer::addOccluder(const glm::mat4& model, const Vertex* vertices, const unsigned int* indices, size_t indexCount) {
+    const glm::mat4 transform = viewProjection * model;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        glm::vec3 screen[3];
+        bool behind = false;
+        for (int k = 0; k < 3; k++) {
+            const Vector3& p = vertices[indices[i + k]].position;
+            const glm::vec4 clip = transform * glm::vec4(p.x, p.y, p.z, 1.0f);
+            if (clip.w < 1e-4f) {
+                behind = true;  // Crosses the camera plane: leaving it out only hides less.
+                break;
+            }
+            screen[k] = glm::vec3((clip.x / clip.w * 0.5f + 0.5f) * columns, (clip.y / clip.w * 0.5f + 0.5f) * rows,
+                clip.z / clip.w * 0.5f + 0.5f);
+        }
+        if (behind)
+            continue;
+
+        const glm::vec3 &a = screen[0], &b = screen[1], &c = screen[2];
+        const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (std::fabs(area) < 1e-8f)
+            continue;
+        const int x0 = std::max(0, (int)std::ceil(std::min({ a.x, b.x, c.x }) - 0.5f));
+        const int x1 = std::min(columns - 1, (int)std::floor(std::max({ a.x, b.x, c.x }) - 0.5f));
+        const int y0 = std::max(0, (int)std::ceil(std::min({ a.y, b.y, c.y }) - 0.5f));
+        const int y1 = std::min(rows - 1, (int)std::floor(std::max({ a.y, b.y, c.y }) - 0.5f));
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                const float px = x + 0.5f, py = y + 0.5f;
+                const float wa = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) / area;
+                const float wb = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) / area;
+                const float wc = 1.0f - wa - wb;
+                if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+                    continue;
+                const float z = wa * a.z + wb * b.z + wc * c.z;
+                float& stored = depth[(size_t)y * columns + x];
+                if (z >= 0.0f && z < stored)
+                    stored = z;
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::occluded(const glm::vec3& center, float radius) const {
+    if (depth.empty())
+        return false;
+    // The corners of the box around the sphere bound it on screen and in depth.
+    float xMin = 1e30f, xMax = -1e30f, yMin = 1e30f, yMax = -1e30f, nearest = 1.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        const glm::vec3 offset(corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius);
+        const glm::vec4 clip = viewProjection * glm::vec4(center + offset, 1.0f);
+        if (clip.w < 1e-4f)
+            return false;
+        const float x = (clip.x / clip.w * 0.5f + 0.5f) * columns, y = (clip.y / clip.w * 0.5f + 0.5f) * rows;
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+        yMin = std::min(yMin, y);
+        yMax = std::max(yMax, y);
+        nearest = std::min(nearest, clip.z / clip.w * 0.5f + 0.5f);
+    }
+    if (nearest < 0.0f)
+        return false;
+    const int x0 = std::max(0, (int)std::floor(xMin) - 1), x1 = std::min(columns - 1, (int)std::floor(xMax) + 1);
+    const int y0 = std::max(0, (int)std::floor(yMin) - 1), y1 = std::min(rows - 1, (int)std::floor(yMax) + 1);
+    if (x0 > x1 || y0 > y1)
+        return false;
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            if (depth[(size_t)y * columns + x] >= nearest)
+                return false;
+    return true;
+}
+
+void CullStats::print(std::ostream& out) const {
+    const double count = meshlets ? (double)meshlets : 1.0;
+    out << meshlets << " meshlets: " << (int)(100.0 * frustum / count) << "% off screen, "
+        << (int)(100.0 * backface / count) << "% facing away, " << (int)(100.0 * occluded / count) << "% occluded, "
+        << drawn << " drawn (" << trianglesDrawn << " of " << triangles << " triangles)";
+}
+
+unsigned int cullMeshlets(const MeshletMesh& mesh, const glm::mat4& model, const glm::mat4& viewProjection,
+    const glm::vec3& cameraPos, const OcclusionBuffer* occlusion,
+    std::vector<DrawElementsIndirectCommand>& commands, CullStats& stats) {
+    // The frustum's planes in the model's own space (Gribb and Hartmann), so the bounds need no transforming.
+    const glm::mat4 transform = viewProjection * model;
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4 row(transform[0][i], transform[1][i], transform[2][i], transform[3][i]);
+        const glm::vec4 w(transform[0][3], transform[1][3], transform[2][3], transform[3][3]);
+        planes[i * 2] = w + row;
+        planes[i * 2 + 1] = w - row;
+    }
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+    const glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(cameraPos, 1.0f));
+    const float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+    const size_t before = commands.size();
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        stats.meshlets++;
+        stats.triangles += meshlet.triangleCount;
+
+        bool outside = false;
+        for (const glm::vec4& plane : planes)
+            outside = outside || glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius;
+        if (outside) {
+            stats.frustum++;
+            continue;
+        }
+
+        // Every triangle faces away when each normal n in the cone has dot(n, p - eye) > 0 for every
+        // point p of the sphere, which holds when the cone's edge nearest the camera still does.
+        if (meshlet.coneCos > 0.0f) {
+            const glm::vec3 toMeshlet = meshlet.center - eye;
+            const float distance = glm::length(toMeshlet);
+            if (distance > meshlet.radius) {
+                const float cosine = glm::dot(toMeshlet, meshlet.coneAxis) / distance;
+                const float sine = std::sqrt(std::max(0.0f, 1.0f - cosine * cosine));
+                if (distance * (cosine * meshlet.coneCos - sine * meshlet.coneSin) > meshlet.radius) {
+                    stats.backface++;
+                    continue;
+                }
+            }
+        }
+
+        if (occlusion && occlusion->occluded(glm::vec3(model * glm::vec4(meshlet.center, 1.0f)), meshlet.radius * scale)) {
+            stats.occluded++;
+            continue;
+        }
+
+        stats.drawn++;
+        stats.trianglesDrawn += meshlet.triangleCount;
+        // Neighbouring meshlets that both pass are one command.
+        if (commands.size() > before && commands.back().firstIndex + commands.back().count == meshlet.firstIndex)
+            commands.back().count += meshlet.triangleCount * 3;
+        else
+            commands.push_back({ meshlet.triangleCount * 3, 1, meshlet.firstIndex, 0, 0 });
+    }
+    return (unsigned int)(commands.size() - before);
+}
@@ -0,0 +1,81 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "Mesh.h"
+#include <glm/glm.hpp>
+#include <ostream>
+#include <vector>
+
+// Meshlets: a mesh cut into small clusters of neighbouring triangles, each with bounds that let
+// the CPU skip it before it is drawn. A cluster is off screen when its bounding sphere is outside
+// the frustum, and faces away when every normal in its cone points away from the camera. The
+// clusters that pass are drawn with one glMultiDrawElementsIndirect per mesh.
+//
+// Skipping clusters that face away is only right for closed meshes, where the back faces are
+// hidden behind the front ones anyway, which is what the OBJ models are.
+
+// The command glMultiDrawElementsIndirect reads, five GLuints.
+struct DrawElementsIndirectCommand {
+    unsigned int count, instanceCount, firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+struct Meshlet {
+    unsigned int firstIndex, triangleCount, vertexCount;
+    glm::vec3 center;           // Bounding sphere.
+    float radius;
+    glm::vec3 coneAxis;         // Every triangle normal is within the cone around coneAxis...
+    float coneCos, coneSin;     // ...with this half angle. coneCos <= 0 is a cone that can't be culled.
+};
+
+struct MeshletMesh {
+    std::vector<unsigned int> indices;      // Triangles of each meshlet in turn.
+    std::vector<Meshlet> meshlets;
+    double milliseconds = 0.0;              // How long building them took.
+};
+
+// Clusters of at most maxVertices vertices and maxTriangles triangles. Each starts next to the
+// one before and grows by the neighbouring triangle that adds the fewest vertices, then the one
+// with the fewest triangles left around it, so no triangle is left on its own, then the closest,
+// so it stays round and flat. 64 and 124 are the sizes mesh shaders favour; a meshlet drawn by
+// glMultiDrawElementsIndirect is just as happy with them.
+MeshletMesh buildMeshlets(const std::vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount,
+    size_t maxVertices = 64, size_t maxTriangles = 124);
+
+// Meshlets, the average vertices and triangles in one and how many have a cone that can be culled.
+void printMeshletReport(std::ostream& out, const char* name, const MeshletMesh& meshlets);
+
+// A small software depth buffer to test meshlets against, filled each frame with a few large
+// occluders. Depth is written at pixel centres and spheres are tested one pixel wider all round,
+// so an occluder's edge never hides what shows past it.
+class OcclusionBuffer {
+public:
+    void begin(int width, int height, const glm::mat4& viewProjection);
+    void addOccluder(const glm::mat4& model, const Vertex* vertices, const unsigned int* indices, size_t indexCount);
+    // Whether the sphere (in world space) is behind the occluders everywhere it covers.
+    bool occluded(const glm::vec3& center, float radius) const;
+
+    int width() const { return columns; }
+    int height() const { return rows; }
+
+private:
+    int columns = 0, rows = 0;
+    glm::mat4 viewProjection;
+    std::vector<float> depth;
+};
+
+struct CullStats {
+    unsigned int meshlets = 0, frustum = 0, backface = 0, occluded = 0, drawn = 0;
+    unsigned int triangles = 0, trianglesDrawn = 0;
+
+    void print(std::ostream& out) const;
+};
+
+// Tests every meshlet of mesh drawn with model against the camera, and occlusion if given, and
+// appends a command for each one left to commands. Returns how many it appended.
+unsigned int cullMeshlets(const MeshletMesh& mesh, const glm::mat4& model, const glm::mat4& viewProjection,
+    const glm::vec3& cameraPos, const OcclusionBuffer* occlusion,
+    std::vector<DrawElementsIndirectCommand>& commands, CullStats& stats);
+
+#endif
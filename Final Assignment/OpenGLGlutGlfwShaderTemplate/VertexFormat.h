@@ -0,0 +1,376 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+// Vertex formats described at compile time. A format is a list of attributes, each with its shader
+// location, how many floats it takes from the mesh and how it is stored on the GPU:
+//
+//	typedef VertexFormat<
+//		VertexAttribute<0, 3>,							// Position: 3 floats.
+//		VertexAttribute<1, 3, GLubyte, true>,			// Color: 3 bytes, 0-255 read as 0-1.
+//		VertexAttribute<2, 2, HalfFloat>,				// UV: 2 half floats.
+//		VertexAttribute<3, 3, Int2_10_10_10, true>		// Normal: 10 bits per axis in one int.
+//	> CompactVertex;
+//
+// A unit normal can also be stored as VertexAttribute<3, 3, Octahedral, true>: two 16 bit
+// components, which the shader turns back into a vec3 itself, see Octahedral.
+//
+// The attributes are interleaved in list order, each starting on a 4 byte boundary. From the list
+// the format works out its Stride() and Offset()s, Setup() makes the glVertexAttribPointer calls
+// for the bound GL_ARRAY_BUFFER and Pack() converts float streams into that layout. Shaders keep
+// their float inputs (vec2, vec3...) whatever the stored type.
+
+// 16 bit float, GL_HALF_FLOAT.
+struct HalfFloat
+{
+	GLushort bits;
+};
+
+// x, y and z in 10 bits and w in 2 bits of one int, GL_INT_2_10_10_10_REV. Missing components are 0.
+struct Int2_10_10_10
+{
+	GLuint bits;
+};
+
+// A unit vector folded onto an octahedron and that unfolded onto a square, two GL_SHORTs read as
+// -1..1. That keeps it within 0.005 degrees, where 10:10:10 in the same 32 bits is within 0.1. The
+// shader reads a vec2 e and decodes it with
+//
+//	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+//	if (n.z < 0.0)
+//		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+//	n = normalize(n);
+struct Octahedral
+{
+	GLshort x, y;
+};
+
+namespace VertexPack
+{
+	// Rounds half away from zero after clamping to [low, high].
+	inline long Round(GLfloat value, GLfloat low, GLfloat high)
+	{
+		value = value < low ? low : (value > high ? high : value);
+		return (long)(value < 0 ? value - 0.5f : value + 0.5f);
+	}
+
+	// Nearest half float, ties to even. Too large gives infinity, as a GPU conversion would.
+	inline GLushort ToHalf(GLfloat value)
+	{
+		GLuint f;
+		memcpy(&f, &value, sizeof(f));
+		const GLushort sign = (GLushort)((f >> 16) & 0x8000);
+		f &= 0x7fffffff;
+		if (f > 0x7f800000)
+			return sign | 0x7e00;			// NaN.
+		if (f >= 0x477ff000)
+			return sign | 0x7c00;			// 65520 and up round to infinity.
+		if (f < 0x38800000)					// Below 2^-14: a subnormal half, mantissa * 2^-24.
+		{
+			const int shift = 126 - (int)(f >> 23);
+			if (shift > 24)
+				return sign;
+			const GLuint mantissa = (f & 0x7fffff) | 0x800000;
+			GLuint half = mantissa >> shift;
+			const GLuint rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1)))
+				half++;
+			return sign | (GLushort)half;
+		}
+		// Rebias the exponent from 127 to 15 and round the mantissa from 23 to 10 bits.
+		return sign | (GLushort)((f + 0xfff + ((f >> 13) & 1) - 0x38000000) >> 13);
+	}
+
+	// The half float bits back to a float, to measure what ToHalf lost.
+	inline GLfloat FromHalf(GLushort half)
+	{
+		const GLuint sign = (GLuint)(half & 0x8000) << 16, exponent = (half >> 10) & 0x1f, mantissa = half & 0x3ff;
+		GLuint f;
+		if (exponent == 0x1f)
+			f = sign | 0x7f800000 | (mantissa << 13);
+		else if (exponent == 0)
+		{
+			const GLfloat value = mantissa * (1.0f / 16777216.0f);	// Subnormal: mantissa * 2^-24.
+			return sign ? -value : value;
+		}
+		else
+			f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		GLfloat value;
+		memcpy(&value, &f, sizeof(value));
+		return value;
+	}
+
+	// The octahedral square coordinates of unit vector n, each -1..1, see Octahedral.
+	inline void ToOctahedral(const GLfloat* n, GLfloat* square)
+	{
+		const GLfloat sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+		if (sum == 0.0f)
+		{
+			square[0] = square[1] = 0.0f;
+			return;
+		}
+		const GLfloat x = n[0] / sum, y = n[1] / sum;
+		if (n[2] >= 0.0f)
+		{
+			square[0] = x;
+			square[1] = y;
+		}
+		else
+		{
+			square[0] = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			square[1] = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		}
+	}
+
+	// What the shader decodes from square, a unit vector.
+	inline void FromOctahedral(const GLfloat* square, GLfloat* n)
+	{
+		n[0] = square[0];
+		n[1] = square[1];
+		n[2] = 1.0f - fabsf(square[0]) - fabsf(square[1]);
+		if (n[2] < 0.0f)
+		{
+			const GLfloat x = n[0];
+			n[0] = (1.0f - fabsf(n[1])) * (x >= 0.0f ? 1.0f : -1.0f);
+			n[1] = (1.0f - fabsf(x)) * (n[1] >= 0.0f ? 1.0f : -1.0f);
+		}
+		const GLfloat length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (int c = 0; c < 3; c++)
+			n[c] /= length;
+	}
+
+	// How each stored type is described to GL and filled from floats. Normalized integers use the
+	// GL 4.2 rule: signed ones map -1..1 to -max..max, unsigned ones 0..1 to 0..max.
+	template <typename T> struct Component;
+
+	template <> struct Component<GLfloat>
+	{
+		static constexpr GLenum Type() { return GL_FLOAT; }
+		static GLfloat Pack(GLfloat value, bool) { return value; }
+	};
+
+	template <> struct Component<HalfFloat>
+	{
+		static constexpr GLenum Type() { return GL_HALF_FLOAT; }
+		static HalfFloat Pack(GLfloat value, bool) { return { ToHalf(value) }; }
+	};
+
+	template <typename T, GLenum GLType, long Low, long High>
+	struct IntegerComponent
+	{
+		static constexpr GLenum Type() { return GLType; }
+		static T Pack(GLfloat value, bool normalized)
+		{
+			if (normalized)
+				return (T)Round(value * High, Low < 0 ? -(GLfloat)High : 0.0f, (GLfloat)High);
+			return (T)Round(value, (GLfloat)Low, (GLfloat)High);
+		}
+	};
+
+	template <> struct Component<GLbyte> : IntegerComponent<GLbyte, GL_BYTE, -128, 127> {};
+	template <> struct Component<GLubyte> : IntegerComponent<GLubyte, GL_UNSIGNED_BYTE, 0, 255> {};
+	template <> struct Component<GLshort> : IntegerComponent<GLshort, GL_SHORT, -32768, 32767> {};
+	template <> struct Component<GLushort> : IntegerComponent<GLushort, GL_UNSIGNED_SHORT, 0, 65535> {};
+
+	constexpr GLsizei Align4(GLsizei bytes) { return (bytes + 3) & ~3; }
+}
+
+// One attribute of a VertexFormat: Count floats per vertex from the mesh, stored as Count Ts at
+// shader location Location. Normalized integers are read by the shader as -1..1 or 0..1.
+template <GLuint Location, int Count, typename T = GLfloat, bool Normalized = false>
+struct VertexAttribute
+{
+	static_assert(Count >= 1 && Count <= 4, "GL attributes have 1 to 4 components");
+
+	static constexpr GLuint location = Location;
+	static constexpr int count = Count;
+	static constexpr GLint size = Count;
+	static constexpr GLsizei bytes = (GLsizei)sizeof(T) * Count;
+	static constexpr GLenum Type() { return VertexPack::Component<T>::Type(); }
+	static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+
+	static void Pack(const GLfloat* from, unsigned char* to)
+	{
+		for (int c = 0; c < Count; c++)
+		{
+			const T value = VertexPack::Component<T>::Pack(from[c], Normalized);
+			memcpy(to + c * sizeof(T), &value, sizeof(T));
+		}
+	}
+};
+
+template <GLuint Location, int Count, bool Normalized>
+struct VertexAttribute<Location, Count, Int2_10_10_10, Normalized>
+{
+	static_assert(Count >= 1 && Count <= 4, "GL attributes have 1 to 4 components");
+
+	static constexpr GLuint location = Location;
+	static constexpr int count = Count;
+	static constexpr GLint size = 4;		// GL only takes all four, the shader can still read a vec3.
+	static constexpr GLsizei bytes = 4;
+	static constexpr GLenum Type() { return GL_INT_2_10_10_10_REV; }
+	static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+
+	static void Pack(const GLfloat* from, unsigned char* to)
+	{
+		GLuint bits = 0;
+		for (int c = 0; c < Count; c++)
+		{
+			const long high = c < 3 ? 511 : 1;
+			const long value = Normalized ? VertexPack::Round(from[c] * high, -(GLfloat)high, (GLfloat)high)
+				: VertexPack::Round(from[c], -(GLfloat)high - 1, (GLfloat)high);
+			bits |= ((GLuint)value & (c < 3 ? 0x3ffu : 0x3u)) << (c * 10);
+		}
+		memcpy(to, &bits, sizeof(bits));
+	}
+};
+
+template <GLuint Location, int Count, bool Normalized>
+struct VertexAttribute<Location, Count, Octahedral, Normalized>
+{
+	static_assert(Count == 3 && Normalized, "Octahedral stores a unit vec3 as two normalized shorts");
+
+	static constexpr GLuint location = Location;
+	static constexpr int count = 3;
+	static constexpr GLint size = 2;
+	static constexpr GLsizei bytes = 4;
+	static constexpr GLenum Type() { return GL_SHORT; }
+	static constexpr GLboolean normalized = GL_TRUE;
+
+	static void Pack(const GLfloat* from, unsigned char* to)
+	{
+		GLfloat square[2];
+		VertexPack::ToOctahedral(from, square);
+		const GLshort value[2] = { VertexPack::Component<GLshort>::Pack(square[0], true), VertexPack::Component<GLshort>::Pack(square[1], true) };
+		memcpy(to, value, sizeof(value));
+	}
+};
+
+// Where Pack() reads one attribute from: vertices of stride floats each (0 for the attribute's own
+// count, i.e. tightly packed). Vertices past the end of the source, or a null data, are packed as 0.
+struct AttributeSource
+{
+	const GLfloat* data;
+	size_t vertices;
+	size_t stride;
+};
+
+template <typename... Attributes>
+struct VertexFormat
+{
+	static_assert(sizeof...(Attributes) > 0, "a vertex format needs at least one attribute");
+
+	static constexpr int attributes = sizeof...(Attributes);
+
+	// Byte offset of attribute i from the start of the vertex, Offset(attributes) is the stride.
+	static constexpr GLsizei Offset(int i)
+	{
+		const GLsizei bytes[] = { Attributes::bytes... };
+		GLsizei offset = 0;
+		for (int a = 0; a < i; a++)
+			offset += VertexPack::Align4(bytes[a]);
+		return offset;
+	}
+
+	static constexpr GLsizei Stride() { return Offset(attributes); }
+
+	// Points and enables every attribute at the bound GL_ARRAY_BUFFER, whose vertices start at byte base.
+	static void Setup(size_t base = 0)
+	{
+		SetupAttributes(base, std::index_sequence_for<Attributes...>());
+	}
+
+	// Interleaves vertices vertices into to, which must hold Stride() * vertices bytes.
+	// sources has one entry per attribute, in list order. Padding bytes are set to 0.
+	static void Pack(void* to, size_t vertices, const AttributeSource* sources)
+	{
+		unsigned char* out = (unsigned char*)to;
+		if (HasPadding())
+			memset(out, 0, Stride() * vertices);
+		PackAttributes(out, vertices, sources, std::index_sequence_for<Attributes...>());
+	}
+
+private:
+	static constexpr bool HasPadding()
+	{
+		const GLsizei bytes[] = { Attributes::bytes... };
+		GLsizei total = 0;
+		for (int a = 0; a < attributes; a++)
+			total += bytes[a];
+		return total != Stride();
+	}
+
+	template <size_t... I>
+	static void SetupAttributes(size_t base, std::index_sequence<I...>)
+	{
+		const int expand[] = { (SetupAttribute<Attributes>(base + Offset((int)I)), 0)... };
+		(void)expand;
+	}
+
+	template <typename A>
+	static void SetupAttribute(size_t offset)
+	{
+		glVertexAttribPointer(A::location, A::size, A::Type(), A::normalized, Stride(), (const void*)offset);
+		glEnableVertexAttribArray(A::location);
+	}
+
+	template <size_t... I>
+	static void PackAttributes(unsigned char* out, size_t vertices, const AttributeSource* sources, std::index_sequence<I...>)
+	{
+		const int expand[] = { (PackAttribute<Attributes>(out + Offset((int)I), vertices, sources[I]), 0)... };
+		(void)expand;
+	}
+
+	template <typename A>
+	static void PackAttribute(unsigned char* out, size_t vertices, const AttributeSource& source)
+	{
+		const GLfloat zero[4] = {};
+		const size_t stride = source.stride ? source.stride : A::count;
+		const size_t available = source.data ? source.vertices : 0;
+		for (size_t v = 0; v < vertices; v++, out += Stride())
+			A::Pack(v < available ? source.data + v * stride : zero, out);
+	}
+};
+
+// The layout Shape has always used: float position, color, uv and normal at locations 0 to 3.
+typedef VertexFormat<
+	VertexAttribute<0, 3>,
+	VertexAttribute<1, 3>,
+	VertexAttribute<2, 2>,
+	VertexAttribute<3, 3>
+> ShapeVertex;
+
+// Same locations in 24 bytes instead of 44, for meshes that don't need float precision past the position.
+typedef VertexFormat<
+	VertexAttribute<0, 3>,
+	VertexAttribute<1, 3, GLubyte, true>,
+	VertexAttribute<2, 2, HalfFloat>,
+	VertexAttribute<3, 3, Int2_10_10_10, true>
+> CompactShapeVertex;
+
+// 20 bytes: the position as 0..1 of the shape's bounds in 16 bits per axis, see VertexQuantize.h,
+// and the normal Octahedral. The shaders undo both with their positionScale, positionOffset and
+// octahedralNormals uniforms, which Shape sets while it draws.
+typedef VertexFormat<
+	VertexAttribute<0, 3, GLushort, true>,
+	VertexAttribute<1, 3, GLubyte, true>,
+	VertexAttribute<2, 2, HalfFloat>,
+	VertexAttribute<3, 3, Octahedral, true>
+> QuantizedShapeVertex;
+
+// Whether a format wants positions as 0..1 of the mesh's bounds rather than as they are.
+template <typename Format> struct QuantizedPositions { static constexpr bool value = false; };
+template <> struct QuantizedPositions<QuantizedShapeVertex> { static constexpr bool value = true; };
+
+// The layouts are checked when this header is compiled, no GL context needed.
+static_assert(ShapeVertex::Stride() == 44, "ShapeVertex is 11 floats");
+static_assert(ShapeVertex::Offset(1) == 12 && ShapeVertex::Offset(2) == 24 && ShapeVertex::Offset(3) == 32,
+	"ShapeVertex attributes follow each other");
+static_assert(CompactShapeVertex::Stride() == 24, "CompactShapeVertex pads its 3 color bytes to 4");
+static_assert(CompactShapeVertex::Offset(1) == 12 && CompactShapeVertex::Offset(2) == 16 && CompactShapeVertex::Offset(3) == 20,
+	"CompactShapeVertex attributes start on 4 byte boundaries");
+static_assert(QuantizedShapeVertex::Stride() == 20, "QuantizedShapeVertex pads its 3 shorts and 3 color bytes to 8 and 4");
@@ -8,28 +8,61 @@
 #include <fstream>
 #include <sstream>
 #include <array>
+#include <algorithm>
+#include <cstring>
 #include "prepShader.h"
+#include "VertexFormat.h"
+#include "VertexQuantize.h"
+#include "Mesh.h"
+#include "MeshSimplify.h"
+#include "MeshOptimize.h"
+#include "MeshStrip.h"
+#include "Meshlet.h"
+#include <chrono>
 #include <map>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-struct Vector2 {
-    float x, y;
+// How the model and digit shaders read a Vertex: position, normal, uv at locations 0, 1, 2, in
+// 16 bytes instead of sizeof(Vertex). The position is 0..1 of the mesh's bounds in 16 bits per
+// axis, which vertex_shader.glsl maps back with positionScale and positionOffset, the normal is
+// Octahedral, decoded when octahedralNormals is set, and the uv is in half floats.
+typedef VertexFormat<
+    VertexAttribute<0, 3, GLushort, true>,
+    VertexAttribute<1, 3, Octahedral, true>,
+    VertexAttribute<2, 2, HalfFloat>
+> QuantizedVertexFormat;
+static_assert(QuantizedVertexFormat::Stride() == 16, "QuantizedVertexFormat is 3 shorts padded to 8, 2 shorts and 2 halves");
+
+// Ground: position and normal.
+typedef VertexFormat<VertexAttribute<0, 3>, VertexAttribute<1, 3>> GroundVertexFormat;
+static_assert(GroundVertexFormat::Stride() == 6 * sizeof(float), "GroundVertexFormat is 6 floats");
+
+// Where a level of detail is in CookedMesh::drawIndices and how to draw it.
+struct DrawRange {
+    GLenum mode;                            // GL_TRIANGLES, or GL_TRIANGLE_STRIP with RestartIndex between strips.
+    unsigned int firstIndex, indexCount;
 };
 
-struct Vector3 {
-    float x, y, z;
+const unsigned int RestartIndex = 0xFFFFFFFFu;
+
+// A loaded OBJ, welded, and its levels of detail: one vertex buffer and every level's indices.
+struct CookedMesh {
+    IndexedMesh mesh;
+    LODChain lods;
+    std::vector<unsigned int> drawIndices;  // Each level as strips or as triangles, what the element buffer holds.
+    std::vector<DrawRange> draws;           // One per level.
+    MeshOptimize::Report optimization;      // Of the full mesh, the finest level.
+    MeshStrip::Strips<unsigned int> strips; // Likewise, without its indices.
+    MeshletMesh meshlets;                   // Of the finest level. Their indices are at the end of drawIndices.
+    VertexQuantize::Dequantization dequantization;  // Of the vertices as QuantizedVertexFormat.
+    VertexQuantize::Report quantization;
 };
 
-struct Vertex {
-    Vector3 position;
-    Vector2 texCoord;
-    Vector3 normal;
-};
-
-std::vector<Vertex> modelVertices;
+CookedMesh modelMesh;
+int modelLOD = 0;
 
 GLuint vao, vbo, ebo, texture;
 GLuint ground_vao, ground_vbo, ground_ebo;
@@ -38,6 +71,16 @@ GLuint textureID;
 std::map<int, GLuint> digitVAOs;
 
 GLint width, height, bitDepth;
+int windowWidth = 1024, windowHeight = 768;
+
+// The finest level of each mesh is drawn by meshlets, those the camera can't see left out:
+// 'm' switches it off and on, 'o' adds testing the digits against the ground and the model.
+bool meshletCulling = true, occlusionCulling = false;
+const int OcclusionWidth = 160;             // Pixels across the occlusion buffer.
+GLuint indirectBuffer;
+std::vector<DrawElementsIndirectCommand> drawCommands;  // Every mesh's this frame, uploaded at once.
+OcclusionBuffer occlusion;
+CullStats cullStats;
 
 GLuint numberProgram;
 
@@ -158,43 +201,232 @@ std::vector<Vertex> LoadOBJ(const char* filename) {
     return vertices;
 }
 
-std::map<int, std::vector<Vertex>> digitModels;
+// Everything done to a mesh between loading and drawing: welding, levels of detail, then each
+// level's triangles reordered for the vertex cache and overdraw, and the vertices put in the
+// order the full mesh first uses them. Then each level is made strips where that saves indices,
+// the full mesh is cut into meshlets and last the vertices' quantization is measured.
+CookedMesh cookMesh(const std::vector<Vertex>& triangles) {
+    CookedMesh cooked;
+    cooked.mesh = weldVertices(triangles);
+    cooked.lods = buildLODChain(cooked.mesh);
+
+    std::vector<Vertex>& vertices = cooked.mesh.vertices;
+    std::vector<unsigned int>& indices = cooked.lods.indices;
+    if (indices.empty())
+        return cooked;
+    const float* positions = &vertices[0].position.x;
+    const size_t stride = sizeof(Vertex) / sizeof(float);
+    for (size_t i = 0; i < cooked.lods.levels.size(); i++) {
+        const MeshLOD& level = cooked.lods.levels[i];
+        const MeshOptimize::Report report = MeshOptimize::Optimize(&indices[level.firstIndex], level.indexCount, vertices.size(), positions, stride);
+        if (i == 0)
+            cooked.optimization = report;
+    }
+    // The coarser levels use a subset of the full mesh's vertices, so its order serves them all.
+    const std::vector<unsigned> remap = MeshOptimize::OptimizeVertexFetch(indices.data(), indices.size(), vertices.size());
+    MeshOptimize::Remap(vertices, 1, remap);
+    const MeshLOD& full = cooked.lods.levels[0];
+    cooked.mesh.indices.assign(indices.begin() + full.firstIndex, indices.begin() + full.firstIndex + full.indexCount);
+    cooked.optimization.after = MeshOptimize::AnalyzeCache(cooked.mesh.indices.data(), cooked.mesh.indices.size(), vertices.size());
+
+    for (size_t i = 0; i < cooked.lods.levels.size(); i++) {
+        const MeshLOD& level = cooked.lods.levels[i];
+        MeshStrip::Strips<unsigned int> strips = MeshStrip::Stripify(&indices[level.firstIndex], level.indexCount, vertices.size(), RestartIndex);
+        cooked.draws.push_back({ strips.strips ? (GLenum)GL_TRIANGLE_STRIP : (GLenum)GL_TRIANGLES,
+            (unsigned int)cooked.drawIndices.size(), (unsigned int)strips.indices.size() });
+        cooked.drawIndices.insert(cooked.drawIndices.end(), strips.indices.begin(), strips.indices.end());
+        if (i == 0) {
+            cooked.strips = strips;
+            cooked.strips.indices.clear();
+        }
+    }
+
+    cooked.meshlets = buildMeshlets(vertices, cooked.mesh.indices.data(), cooked.mesh.indices.size());
+    for (Meshlet& meshlet : cooked.meshlets.meshlets)
+        meshlet.firstIndex += (unsigned int)cooked.drawIndices.size();
+    cooked.drawIndices.insert(cooked.drawIndices.end(), cooked.meshlets.indices.begin(), cooked.meshlets.indices.end());
+    cooked.meshlets.indices.clear();
+
+    // Remap moved the vertices, so positions no longer points at them.
+    cooked.dequantization = VertexQuantize::Bounds(&vertices[0].position.x, vertices.size(), stride);
+    cooked.quantization = VertexQuantize::Measure(&vertices[0].position.x, stride, &vertices[0].normal.x, stride,
+        &vertices[0].texCoord.x, stride, vertices.size(), cooked.dequantization, sizeof(Vertex), QuantizedVertexFormat::Stride());
+    // The quantized triangles are where the GPU draws them, so the meshlets' bounds must hold those too.
+    for (Meshlet& meshlet : cooked.meshlets.meshlets)
+        meshlet.radius += cooked.quantization.positionBound;
+    return cooked;
+}
+
+// How many pixels the radius of a mesh at distance covers on screen, with the 60 degree field of view of reshape.
+float projectedRadius(const LODChain& lods, float distance) {
+    const float pixelsPerUnit = windowHeight * 0.5f / (glm::tan(glm::radians(30.0f)) * std::max(distance, 0.1f));
+    return lods.radius * pixelsPerUnit;
+}
+
+// The vertices of a cooked mesh in QuantizedVertexFormat.
+std::vector<unsigned char> packVertices(const CookedMesh& cooked) {
+    const std::vector<Vertex>& vertices = cooked.mesh.vertices;
+    const size_t stride = sizeof(Vertex) / sizeof(float);
+    const std::vector<float> positions = vertices.empty() ? std::vector<float>()
+        : VertexQuantize::Normalize(&vertices[0].position.x, vertices.size(), stride, cooked.dequantization);
+    const AttributeSource sources[] = {
+        { positions.data(), vertices.size(), 3 },
+        { vertices.empty() ? nullptr : &vertices[0].normal.x, vertices.size(), stride },
+        { vertices.empty() ? nullptr : &vertices[0].texCoord.x, vertices.size(), stride }
+    };
+    std::vector<unsigned char> packed(QuantizedVertexFormat::Stride() * vertices.size());
+    QuantizedVertexFormat::Pack(packed.data(), vertices.size(), sources);
+    return packed;
+}
+
+// Tells program how the mesh about to be drawn was quantized.
+void setDequantization(GLuint program, const CookedMesh& cooked) {
+    glUniform3fv(glGetUniformLocation(program, "positionScale"), 1, cooked.dequantization.scale);
+    glUniform3fv(glGetUniformLocation(program, "positionOffset"), 1, cooked.dequantization.offset);
+    glUniform1i(glGetUniformLocation(program, "octahedralNormals"), 1);
+}
+
+// Primitive restart is enabled with RestartIndex in init.
+void drawLOD(const CookedMesh& cooked, int level) {
+    const DrawRange& draw = cooked.draws[level];
+    glDrawElements(draw.mode, draw.indexCount, GL_UNSIGNED_INT, (const void*)(draw.firstIndex * sizeof(unsigned int)));
+}
+
+// One mesh's commands in drawCommands, when it is drawn by meshlets.
+struct MeshletDraw {
+    bool meshlets;
+    unsigned int firstCommand, commandCount;
+};
+
+// Culls the meshlets of a mesh drawn at its finest level into drawCommands. Coarser levels are
+// drawn whole, as they have few triangles left to save.
+MeshletDraw cullMesh(const CookedMesh& cooked, int level, const glm::mat4& transform, const glm::mat4& viewProjection,
+    const OcclusionBuffer* occluders) {
+    MeshletDraw draw = { false, (unsigned int)drawCommands.size(), 0 };
+    if (!meshletCulling || level != 0 || cooked.meshlets.meshlets.empty())
+        return draw;
+    draw.meshlets = true;
+    draw.commandCount = cullMeshlets(cooked.meshlets, transform, viewProjection, cameraPos, occluders, drawCommands, cullStats);
+    return draw;
+}
+
+// drawCommands must be in indirectBuffer, bound to GL_DRAW_INDIRECT_BUFFER.
+void drawMesh(const CookedMesh& cooked, int level, const MeshletDraw& draw) {
+    if (!draw.meshlets)
+        drawLOD(cooked, level);
+    else if (draw.commandCount > 0)
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (const void*)(draw.firstCommand * sizeof(DrawElementsIndirectCommand)), draw.commandCount, 0);
+}
+
+std::map<int, CookedMesh> digitModels;
+std::vector<int> digitLODs;    // The level each of the piDigits is drawn at.
+std::vector<MeshletDraw> digitDraws;
 
 void loadDigitModels() {
     for (int i = 0; i <= 9; i++) {
         std::string filename = "models/" + std::to_string(i) + ".obj";
 
-        digitModels[i] = LoadOBJ(filename.c_str());
+        digitModels[i] = cookMesh(LoadOBJ(filename.c_str()));
 
-        if (digitModels[i].empty()) {
+        if (digitModels[i].mesh.vertices.empty()) {
             std::cerr << "Error: Failed to load model for digit " << i << " (" << filename << ")" << std::endl;
         }
         else {
             std::cout << "Loaded model for digit " << i << " with "
-                << digitModels[i].size() << " vertices." << std::endl;
+                << digitModels[i].mesh.vertices.size() << " vertices and "
+                << digitModels[i].lods.levels.size() << " levels of detail." << std::endl;
+            digitModels[i].optimization.Print(std::cout, filename.c_str());
+            digitModels[i].strips.Print(std::cout, filename.c_str());
+            printMeshletReport(std::cout, filename.c_str(), digitModels[i].meshlets);
+            digitModels[i].quantization.Print(std::cout, filename.c_str());
+        }
+    }
+}
+
+// Cooks model.obj and the digits without a window and prints how much each level of detail
+// saves against its error, the vertex cache use before and after reordering, the meshlets and
+// what quantizing the vertices costs.
+int lodReport() {
+    const CookedMesh model = cookMesh(LoadOBJ("model.obj"));
+    if (!model.lods.indices.empty()) {
+        printLODReport(std::cout, "model.obj", model.lods);
+        model.optimization.Print(std::cout, "model.obj");
+        model.strips.Print(std::cout, "model.obj");
+        printMeshletReport(std::cout, "model.obj", model.meshlets);
+        model.quantization.Print(std::cout, "model.obj");
+    }
+    for (int i = 0; i <= 9; i++) {
+        std::string filename = "models/" + std::to_string(i) + ".obj";
+        const CookedMesh digit = cookMesh(LoadOBJ(filename.c_str()));
+        if (!digit.lods.indices.empty()) {
+            printLODReport(std::cout, filename.c_str(), digit.lods);
+            digit.optimization.Print(std::cout, filename.c_str());
+            digit.strips.Print(std::cout, filename.c_str());
+            printMeshletReport(std::cout, filename.c_str(), digit.meshlets);
+            digit.quantization.Print(std::cout, filename.c_str());
+        }
+    }
+    return 0;
+}
+
+// Reorders and strips grids of quads by quads, in the serpentine order of the course's Grid
+// shape, and prints the index savings and how long each step took.
+int stripBenchmark() {
+    for (int quads = 128; quads <= 1024; quads *= 2) {
+        const unsigned int row = quads + 1;
+        std::vector<float> positions;
+        positions.reserve(row * row * 3);
+        for (unsigned int z = 0; z < row; z++) {
+            for (unsigned int x = 0; x < row; x++) {
+                positions.push_back((float)x);
+                positions.push_back(0.0f);
+                positions.push_back((float)z);
+            }
         }
+        std::vector<unsigned int> indices;
+        indices.reserve(quads * quads * 6);
+        for (int z = 0; z < quads; z++) {
+            for (int i = 0; i < quads; i++) {
+                const unsigned int x = z % 2 == 0 ? i : quads - 1 - i;
+                const unsigned int corner = z * row + x;
+                const unsigned int quad[] = { corner, corner + 1, corner + row + 1, corner + row + 1, corner + row, corner };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const MeshOptimize::Report report = MeshOptimize::Optimize(indices.data(), indices.size(), row * row, positions.data(), 3);
+        const auto optimized = std::chrono::high_resolution_clock::now();
+        const MeshStrip::Strips<unsigned int> strips = MeshStrip::Stripify(indices.data(), indices.size(), row * row, RestartIndex);
+        const auto stripped = std::chrono::high_resolution_clock::now();
+
+        const std::string name = "Grid " + std::to_string(quads) + "x" + std::to_string(quads);
+        report.Print(std::cout, name.c_str());
+        strips.Print(std::cout, name.c_str());
+        std::cout << "  reordering " << std::chrono::duration<double, std::milli>(optimized - start).count() << " ms, strips "
+            << std::chrono::duration<double, std::milli>(stripped - optimized).count() << " ms" << std::endl;
     }
+    return 0;
 }
 
 void loadDigitVAOs() {
     for (int i = 0; i <= 9; i++) {
-        GLuint vao, vbo;
+        GLuint vao, vbo, ebo;
         glGenVertexArrays(1, &vao);
         glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
 
         glBindVertexArray(vao);
 
+        const std::vector<unsigned char> packed = packVertices(digitModels[i]);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, digitModels[i].size() * sizeof(Vertex), &digitModels[i][0], GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-        glEnableVertexAttribArray(0);
+        glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.empty() ? nullptr : packed.data(), GL_STATIC_DRAW);
+        QuantizedVertexFormat::Setup();
 
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-        glEnableVertexAttribArray(1);
-
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-        glEnableVertexAttribArray(2);
+        const std::vector<unsigned int>& indices = digitModels[i].drawIndices;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.empty() ? nullptr : indices.data(), GL_STATIC_DRAW);
 
         glBindVertexArray(0);
         digitVAOs[i] = vao;
@@ -235,7 +467,14 @@ void initNumberShader() {
 }
 
 int main(int argc, char** argv) {
-    glutInitContextVersion(3, 3);
+    if (argc > 1 && strcmp(argv[1], "--lod-report") == 0)
+        return lodReport();
+    if (argc > 1 && strcmp(argv[1], "--strip-bench") == 0)
+        return stripBenchmark();
+    if (argc > 1 && strcmp(argv[1], "--cache-check") == 0)
+        return MeshOptimize::CheckAnalyzeCache(std::cout) ? 0 : 1;
+
+    glutInitContextVersion(4, 3);   // For glMultiDrawElementsIndirect.
     glutInitContextProfile(GLUT_CORE_PROFILE);
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
@@ -267,6 +506,8 @@ void init() {
     initNumberShader();
     loadDigitModels();
     loadDigitVAOs();
+    digitLODs.assign(piDigits.size(), 0);
+    digitDraws.resize(piDigits.size());
 
     program = glCreateProgram();
     glAttachShader(program, vertexShaderId);
@@ -297,36 +538,104 @@ void init() {
     glUseProgram(groundProgram);
 
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(RestartIndex);
+    glGenBuffers(1, &indirectBuffer);
 
-    modelVertices = LoadOBJ("model.obj");
-    if (modelVertices.empty()) {
+    modelMesh = cookMesh(LoadOBJ("model.obj"));
+    if (modelMesh.mesh.vertices.empty()) {
         std::cerr << "Error: Model could not be loaded. Check your OBJ file." << std::endl;
         exit(EXIT_FAILURE);
     }
+    modelMesh.optimization.Print(std::cout, "model.obj");
+    modelMesh.strips.Print(std::cout, "model.obj");
+    printMeshletReport(std::cout, "model.obj", modelMesh.meshlets);
+    modelMesh.quantization.Print(std::cout, "model.obj");
 
     setupBuffers();
     loadTexture("texture.jpg");
 }
 
+// Where the i-th of the piDigits is at time: on a rising spiral around the model, turning.
+glm::mat4 digitTransform(size_t i, float time) {
+    const float radius = 5.0f;
+    float theta = i * 0.5f + time;
+    float r = radius + i * 0.5f;
+    float x = r * cos(theta);
+    float y = 0.1f * i;
+    float z = r * sin(theta);
+
+    glm::mat4 digitModel = glm::mat4(1.0f);
+    digitModel = glm::translate(digitModel, glm::vec3(x, y, z));
+    return glm::rotate(digitModel, time, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// The ground of setupBuffers, for the occlusion buffer.
+const Vertex groundCorners[] = {
+    { { -10.0f, 0.0f, -10.0f }, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    { {  10.0f, 0.0f, -10.0f }, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    { {  10.0f, 0.0f,  10.0f }, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    { { -10.0f, 0.0f,  10.0f }, { 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } }
+};
+const unsigned int groundTriangles[] = { 0, 1, 2, 2, 3, 0 };
+
 void display() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
 
     float time = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
-    float radius = 5.0f;
     glm::vec3 pointLightPos = glm::vec3(5.0f * cos(time), 3.0f, 5.0f * sin(time));
     glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
-    glUseProgram(program);
     view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    const glm::mat4 viewProjection = projection * view;
+
+    // Culling first, so this frame's commands go to the GPU in one upload. The ground and the
+    // model's meshlets that are left are the occluders the digits are tested against.
+    drawCommands.clear();
+    cullStats = CullStats();
+    const glm::vec3 modelCenter(modelMesh.lods.center.x, modelMesh.lods.center.y, modelMesh.lods.center.z);
+    modelLOD = selectLOD(modelMesh.lods, projectedRadius(modelMesh.lods, glm::length(modelCenter - cameraPos)), modelLOD);
+    const MeshletDraw modelDraw = cullMesh(modelMesh, modelLOD, glm::mat4(1.0f), viewProjection, nullptr);
+    if (occlusionCulling && meshletCulling) {
+        occlusion.begin(OcclusionWidth, OcclusionWidth * windowHeight / std::max(windowWidth, 1), viewProjection);
+        occlusion.addOccluder(glm::mat4(1.0f), groundCorners, groundTriangles, 6);
+        for (unsigned int i = 0; i < modelDraw.commandCount; i++) {
+            const DrawElementsIndirectCommand& command = drawCommands[modelDraw.firstCommand + i];
+            occlusion.addOccluder(glm::mat4(1.0f), modelMesh.mesh.vertices.data(), &modelMesh.drawIndices[command.firstIndex], command.count);
+        }
+    }
+    for (size_t i = 0; i < piDigits.size(); i++) {
+        const CookedMesh& cooked = digitModels[piDigits[i]];
+        if (cooked.lods.indices.empty())
+            continue;
+        const glm::mat4 transform = digitTransform(i, time);
+        const glm::vec3 center = glm::vec3(transform * glm::vec4(cooked.lods.center.x, cooked.lods.center.y, cooked.lods.center.z, 1.0f));
+        digitLODs[i] = selectLOD(cooked.lods, projectedRadius(cooked.lods, glm::length(center - cameraPos)), digitLODs[i]);
+        digitDraws[i] = cullMesh(cooked, digitLODs[i], transform, viewProjection, occlusionCulling ? &occlusion : nullptr);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, drawCommands.size() * sizeof(DrawElementsIndirectCommand),
+        drawCommands.empty() ? nullptr : drawCommands.data(), GL_STREAM_DRAW);
+    if (meshletCulling) {
+        std::ostringstream title;
+        title << "Final Assignment - ";
+        cullStats.print(title);
+        if (occlusionCulling)
+            title << " [occlusion]";
+        glutSetWindowTitle(title.str().c_str());
+    }
+
+    glUseProgram(program);
     glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
     glBindTexture(GL_TEXTURE_2D, texture);
 
     model = glm::mat4(1.0f);
     glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    setDequantization(program, modelMesh);
     glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, modelVertices.size());
+    drawMesh(modelMesh, modelLOD, modelDraw);
     glBindVertexArray(0);
 
     glUniform3fv(glGetUniformLocation(program, "lightPos"), 1, glm::value_ptr(pointLightPos));
@@ -357,24 +666,19 @@ void display() {
 
     for (size_t i = 0; i < piDigits.size(); i++) {
         int digit = piDigits[i];
-
-        float theta = i * 0.5f + time;
-        float r = radius + i * 0.5f;
-        float x = r * cos(theta);
-        float y = 0.1f * i;
-        float z = r * sin(theta);
-
-        glm::mat4 digitModel = glm::mat4(1.0f);
-        digitModel = glm::translate(digitModel, glm::vec3(x, y, z));
-        digitModel = glm::rotate(digitModel, time, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 digitModel = digitTransform(i, time);
 
         glUniformMatrix4fv(glGetUniformLocation(numberProgram, "model"), 1, GL_FALSE, glm::value_ptr(digitModel));
         glUniformMatrix4fv(glGetUniformLocation(numberProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
         glUniformMatrix4fv(glGetUniformLocation(numberProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
         glUniform3fv(glGetUniformLocation(numberProgram, "objectColor"), 1, glm::value_ptr(digitColors[digit]));
 
+        if (digitModels[digit].lods.indices.empty())
+            continue;
+
+        setDequantization(numberProgram, digitModels[digit]);
         glBindVertexArray(digitVAOs[digit]);
-        glDrawArrays(GL_TRIANGLES, 0, digitModels[digit].size());
+        drawMesh(digitModels[digit], digitLODs[i], digitDraws[i]);
         glBindVertexArray(0);
     }
 
@@ -383,6 +687,8 @@ void display() {
 
 void reshape(int width, int height) {
     glViewport(0, 0, width, height);
+    windowWidth = width;
+    windowHeight = height;
     projection = glm::perspective(glm::radians(60.0f), (float)width / height, 0.1f, 100.0f);
 }
 
@@ -406,6 +712,14 @@ void keyboard(unsigned char key, int x, int y) {
     case 'd':
         cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraSpeed;
         break;
+    case 'm':
+        meshletCulling = !meshletCulling;
+        if (!meshletCulling)
+            glutSetWindowTitle("Final Assignment");
+        break;
+    case 'o':
+        occlusionCulling = !occlusionCulling;
+        break;
     }
     glutPostRedisplay();
 }
@@ -451,26 +765,24 @@ void motion(int x, int y) {
 }
 
 void setupBuffers() {
+    const std::vector<Vertex>& modelVertices = modelMesh.mesh.vertices;
     if (modelVertices.empty()) {
         std::cerr << "Error: No vertices available for buffer setup." << std::endl;
         return;
     }
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
 
     glBindVertexArray(vao);
 
+    const std::vector<unsigned char> packed = packVertices(modelMesh);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, modelVertices.size() * sizeof(Vertex), &modelVertices[0], GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+    QuantizedVertexFormat::Setup();
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, modelMesh.drawIndices.size() * sizeof(unsigned int), &modelMesh.drawIndices[0], GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 
@@ -500,11 +812,7 @@ void setupBuffers() {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ground_ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(groundIndices), groundIndices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    GroundVertexFormat::Setup();
 
     glBindVertexArray(0);
 }
@@ -10,9 +10,23 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// How the mesh's vertices are quantized, see QuantizedVertexFormat in main.cpp.
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+uniform bool octahedralNormals = false;
+
+// The unit vector an Octahedral normal was folded from.
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
 void main() {
-    FragPos = vec3(model * vec4(position, 1.0));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    vec3 vertexNormal = octahedralNormals ? octahedralDecode(normal.xy) : normal;
+    FragPos = vec3(model * vec4(position * positionScale + positionOffset, 1.0));
+    Normal = mat3(transpose(inverse(model))) * vertexNormal;
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -9,8 +9,10 @@ using namespace std;
 
 #include "stdlib.h"
 #include "time.h"
+#include <string>
 #include "vgl.h"
 #include "LoadShaders.h"
+#include "targa.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 
@@ -94,6 +96,22 @@ void idle()
 int main(int argc, char** argv)
 {
 	glutInit(&argc, argv);
+	// --targa-bench [files] times the .tga/.bmp decoder against stb_image, on the Week14 bitmaps by default.
+	if (argc > 1 && string(argv[1]) == "--targa-bench")
+	{
+		static const char* media[] = {
+			"../../Week14/Media/bodyMetal.bmp", "../../Week14/Media/canLabel.bmp", "../../Week14/Media/canLabelSpecularMap.bmp",
+			"../../Week14/Media/canTop.bmp", "../../Week14/Media/cray2.bmp", "../../Week14/Media/earth.bmp",
+			"../../Week14/Media/grass.bmp", "../../Week14/Media/launch.bmp", "../../Week14/Media/nightSky.bmp",
+			"../../Week14/Media/number1.bmp", "../../Week14/Media/propellerMetal.bmp", "../../Week14/Media/sky.bmp",
+			"../../Week14/Media/specMapOff.bmp", "../../Week14/Media/specMapOn.bmp", "../../Week14/Media/star.bmp",
+			"../../Week14/Media/sugary.bmp", "../../Week14/Media/trees.bmp" };
+		if (argc > 2)
+			vtarga::benchmark(argv + 2, argc - 2, "targa_benchmark.tga");
+		else
+			vtarga::benchmark(media, sizeof(media) / sizeof(media[0]), "targa_benchmark.tga");
+		return 0;
+	}
 	glutInitDisplayMode(GLUT_RGBA);
 	glutInitWindowSize(512, 512);
 	glutCreateWindow("Hello World");
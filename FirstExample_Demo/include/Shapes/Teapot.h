@@ -44,26 +44,26 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -0.84, 2.4, 1.5 },
     { -1.5, 2.4, 0.84 },
     { -1.5, 2.4, 0.0 },
-    { -1.4, 2.4, 0.784 },
-    { -0.784, 2.4, 1.4 },
-    { 0.0, 2.4, 1.4 },
-    { -1.3375, 2.53125, 0.749 },
-    { -0.749, 2.53125, 1.3375 },
-    { 0.0, 2.53125, 1.3375 },
-    { -1.4375, 2.53125, 0.805 },
-    { -0.805, 2.53125, 1.4375 },
-    { 0.0, 2.53125, 1.4375 },
-    { -1.5, 2.4, 0.84 },
-    { -0.84, 2.4, 1.5 },
-    { 0.0, 2.4, 1.5 },
-    { 0.784, 2.4, 1.4 },
-    { 1.4, 2.4, 0.784 },
-    { 0.749, 2.53125, 1.3375 },
-    { 1.3375, 2.53125, 0.749 },
-    { 0.805, 2.53125, 1.4375 },
-    { 1.4375, 2.53125, 0.805 },
-    { 0.84, 2.4, 1.5 },
-    { 1.5, 2.4, 0.84 },
+    { -1.4, 2.4, -0.784 },
+    { -0.784, 2.4, -1.4 },
+    { 0.0, 2.4, -1.4 },
+    { -1.3375, 2.53125, -0.749 },
+    { -0.749, 2.53125, -1.3375 },
+    { 0.0, 2.53125, -1.3375 },
+    { -1.4375, 2.53125, -0.805 },
+    { -0.805, 2.53125, -1.4375 },
+    { 0.0, 2.53125, -1.4375 },
+    { -1.5, 2.4, -0.84 },
+    { -0.84, 2.4, -1.5 },
+    { 0.0, 2.4, -1.5 },
+    { 0.784, 2.4, -1.4 },
+    { 1.4, 2.4, -0.784 },
+    { 0.749, 2.53125, -1.3375 },
+    { 1.3375, 2.53125, -0.749 },
+    { 0.805, 2.53125, -1.4375 },
+    { 1.4375, 2.53125, -0.805 },
+    { 0.84, 2.4, -1.5 },
+    { 1.5, 2.4, -0.84 },
     { 1.75, 1.875, 0.0 },
     { 1.75, 1.875, 0.98 },
     { 0.98, 1.875, 1.75 },
@@ -85,21 +85,21 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -1.12, 0.9, 2.0 },
     { -2.0, 0.9, 1.12 },
     { -2.0, 0.9, 0.0 },
-    { -1.75, 1.875, 0.98 },
-    { -0.98, 1.875, 1.75 },
-    { 0.0, 1.875, 1.75 },
-    { -2.0, 1.35, 1.12 },
-    { -1.12, 1.35, 2.0 },
-    { 0.0, 1.35, 2.0 },
-    { -2.0, 0.9, 1.12 },
-    { -1.12, 0.9, 2.0 },
-    { 0.0, 0.9, 2.0 },
-    { 0.98, 1.875, 1.75 },
-    { 1.75, 1.875, 0.98 },
-    { 1.12, 1.35, 2.0 },
-    { 2.0, 1.35, 1.12 },
-    { 1.12, 0.9, 2.0 },
-    { 2.0, 0.9, 1.12 },
+    { -1.75, 1.875, -0.98 },
+    { -0.98, 1.875, -1.75 },
+    { 0.0, 1.875, -1.75 },
+    { -2.0, 1.35, -1.12 },
+    { -1.12, 1.35, -2.0 },
+    { 0.0, 1.35, -2.0 },
+    { -2.0, 0.9, -1.12 },
+    { -1.12, 0.9, -2.0 },
+    { 0.0, 0.9, -2.0 },
+    { 0.98, 1.875, -1.75 },
+    { 1.75, 1.875, -0.98 },
+    { 1.12, 1.35, -2.0 },
+    { 2.0, 1.35, -1.12 },
+    { 1.12, 0.9, -2.0 },
+    { 2.0, 0.9, -1.12 },
     { 2.0, 0.45, 0.0 },
     { 2.0, 0.45, 1.12 },
     { 1.12, 0.45, 2.0 },
@@ -121,21 +121,21 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -0.84, 0.15, 1.5 },
     { -1.5, 0.15, 0.84 },
     { -1.5, 0.15, 0.0 },
-    { -2.0, 0.45, 1.12 },
-    { -1.12, 0.45, 2.0 },
-    { 0.0, 0.45, 2.0 },
-    { -1.5, 0.225, 0.84 },
-    { -0.84, 0.225, 1.5 },
-    { 0.0, 0.225, 1.5 },
-    { -1.5, 0.15, 0.84 },
-    { -0.84, 0.15, 1.5 },
-    { 0.0, 0.15, 1.5 },
-    { 1.12, 0.45, 2.0 },
-    { 2.0, 0.45, 1.12 },
-    { 0.84, 0.225, 1.5 },
-    { 1.5, 0.225, 0.84 },
-    { 0.84, 0.15, 1.5 },
-    { 1.5, 0.15, 0.84 },
+    { -2.0, 0.45, -1.12 },
+    { -1.12, 0.45, -2.0 },
+    { 0.0, 0.45, -2.0 },
+    { -1.5, 0.225, -0.84 },
+    { -0.84, 0.225, -1.5 },
+    { 0.0, 0.225, -1.5 },
+    { -1.5, 0.15, -0.84 },
+    { -0.84, 0.15, -1.5 },
+    { 0.0, 0.15, -1.5 },
+    { 1.12, 0.45, -2.0 },
+    { 2.0, 0.45, -1.12 },
+    { 0.84, 0.225, -1.5 },
+    { 1.5, 0.225, -0.84 },
+    { 0.84, 0.15, -1.5 },
+    { 1.5, 0.15, -0.84 },
     { -1.6, 2.025, 0.0 },
     { -1.6, 2.025, 0.3 },
     { -1.5, 2.25, 0.3 },
@@ -152,14 +152,14 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -2.7, 1.8, 0.3 },
     { -3.0, 1.8, 0.3 },
     { -3.0, 1.8, 0.0 },
-    { -1.5, 2.25, 0.3 },
-    { -1.6, 2.025, 0.3 },
-    { -2.5, 2.25, 0.3 },
-    { -2.3, 2.025, 0.3 },
-    { -3.0, 2.25, 0.3 },
-    { -2.7, 2.025, 0.3 },
-    { -3.0, 1.8, 0.3 },
-    { -2.7, 1.8, 0.3 },
+    { -1.5, 2.25, -0.3 },
+    { -1.6, 2.025, -0.3 },
+    { -2.5, 2.25, -0.3 },
+    { -2.3, 2.025, -0.3 },
+    { -3.0, 2.25, -0.3 },
+    { -2.7, 2.025, -0.3 },
+    { -3.0, 1.8, -0.3 },
+    { -2.7, 1.8, -0.3 },
     { -2.7, 1.575, 0.0 },
     { -2.7, 1.575, 0.3 },
     { -3.0, 1.35, 0.3 },
@@ -171,12 +171,12 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -2.0, 0.9, 0.3 },
     { -1.9, 0.6, 0.3 },
     { -1.9, 0.6, 0.0 },
-    { -3.0, 1.35, 0.3 },
-    { -2.7, 1.575, 0.3 },
-    { -2.65, 0.9375, 0.3 },
-    { -2.5, 1.125, 0.3 },
-    { -1.9, 0.6, 0.3 },
-    { -2.0, 0.9, 0.3 },
+    { -3.0, 1.35, -0.3 },
+    { -2.7, 1.575, -0.3 },
+    { -2.65, 0.9375, -0.3 },
+    { -2.5, 1.125, -0.3 },
+    { -1.9, 0.6, -0.3 },
+    { -2.0, 0.9, -0.3 },
     { 1.7, 1.425, 0.0 },
     { 1.7, 1.425, 0.66 },
     { 1.7, 0.6, 0.66 },
@@ -193,14 +193,14 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { 2.7, 2.4, 0.25 },
     { 3.3, 2.4, 0.25 },
     { 3.3, 2.4, 0.0 },
-    { 1.7, 0.6, 0.66 },
-    { 1.7, 1.425, 0.66 },
-    { 3.1, 0.825, 0.66 },
-    { 2.6, 1.425, 0.66 },
-    { 2.4, 2.025, 0.25 },
-    { 2.3, 2.1, 0.25 },
-    { 3.3, 2.4, 0.25 },
-    { 2.7, 2.4, 0.25 },
+    { 1.7, 0.6, -0.66 },
+    { 1.7, 1.425, -0.66 },
+    { 3.1, 0.825, -0.66 },
+    { 2.6, 1.425, -0.66 },
+    { 2.4, 2.025, -0.25 },
+    { 2.3, 2.1, -0.25 },
+    { 3.3, 2.4, -0.25 },
+    { 2.7, 2.4, -0.25 },
     { 2.8, 2.475, 0.0 },
     { 2.8, 2.475, 0.25 },
     { 3.525, 2.49375, 0.25 },
@@ -213,12 +213,12 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { 2.8, 2.4, 0.15 },
     { 3.2, 2.4, 0.15 },
     { 3.2, 2.4, 0.0 },
-    { 3.525, 2.49375, 0.25 },
-    { 2.8, 2.475, 0.25 },
-    { 3.45, 2.5125, 0.15 },
-    { 2.9, 2.475, 0.15 },
-    { 3.2, 2.4, 0.15 },
-    { 2.8, 2.4, 0.15 },
+    { 3.525, 2.49375, -0.25 },
+    { 2.8, 2.475, -0.25 },
+    { 3.45, 2.5125, -0.15 },
+    { 2.9, 2.475, -0.15 },
+    { 3.2, 2.4, -0.15 },
+    { 2.8, 2.4, -0.15 },
     { 0.0, 3.15, 0.0 },
     { 0.0, 3.15, 0.002 },
     { 0.002, 3.15, 0.0 },
@@ -239,16 +239,16 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -0.2, 2.7, 0.112 },
     { -0.2, 2.7, 0.0 },
     { 0.0, 3.15, 0.002 },
-    { -0.8, 3.15, 0.45 },
-    { -0.45, 3.15, 0.8 },
-    { 0.0, 3.15, 0.8 },
-    { -0.2, 2.7, 0.112 },
-    { -0.112, 2.7, 0.2 },
-    { 0.0, 2.7, 0.2 },
-    { 0.45, 3.15, 0.8 },
-    { 0.8, 3.15, 0.45 },
-    { 0.112, 2.7, 0.2 },
-    { 0.2, 2.7, 0.112 },
+    { -0.8, 3.15, -0.45 },
+    { -0.45, 3.15, -0.8 },
+    { 0.0, 3.15, -0.8 },
+    { -0.2, 2.7, -0.112 },
+    { -0.112, 2.7, -0.2 },
+    { 0.0, 2.7, -0.2 },
+    { 0.45, 3.15, -0.8 },
+    { 0.8, 3.15, -0.45 },
+    { 0.112, 2.7, -0.2 },
+    { 0.2, 2.7, -0.112 },
     { 0.4, 2.55, 0.0 },
     { 0.4, 2.55, 0.224 },
     { 0.224, 2.55, 0.4 },
@@ -270,21 +270,21 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -0.728, 2.4, 1.3 },
     { -1.3, 2.4, 0.728 },
     { -1.3, 2.4, 0.0 },
-    { -0.4, 2.55, 0.224 },
-    { -0.224, 2.55, 0.4 },
-    { 0.0, 2.55, 0.4 },
-    { -1.3, 2.55, 0.728 },
-    { -0.728, 2.55, 1.3 },
-    { 0.0, 2.55, 1.3 },
-    { -1.3, 2.4, 0.728 },
-    { -0.728, 2.4, 1.3 },
-    { 0.0, 2.4, 1.3 },
-    { 0.224, 2.55, 0.4 },
-    { 0.4, 2.55, 0.224 },
-    { 0.728, 2.55, 1.3 },
-    { 1.3, 2.55, 0.728 },
-    { 0.728, 2.4, 1.3 },
-    { 1.3, 2.4, 0.728 },
+    { -0.4, 2.55, -0.224 },
+    { -0.224, 2.55, -0.4 },
+    { 0.0, 2.55, -0.4 },
+    { -1.3, 2.55, -0.728 },
+    { -0.728, 2.55, -1.3 },
+    { 0.0, 2.55, -1.3 },
+    { -1.3, 2.4, -0.728 },
+    { -0.728, 2.4, -1.3 },
+    { 0.0, 2.4, -1.3 },
+    { 0.224, 2.55, -0.4 },
+    { 0.4, 2.55, -0.224 },
+    { 0.728, 2.55, -1.3 },
+    { 1.3, 2.55, -0.728 },
+    { 0.728, 2.4, -1.3 },
+    { 1.3, 2.4, -0.728 },
     { 0.0, 0.0, 0.0 },
     { 1.5, 0.15, 0.0 },
     { 1.5, 0.15, 0.84 },
@@ -307,21 +307,21 @@ GLdouble TeapotVertices[NumTeapotVertices][3] = {
     { -0.798, 0.0, 1.425 },
     { -1.425, 0.0, 0.798 },
     { -1.425, 0.0, 0.0 },
-    { -1.5, 0.15, 0.84 },
-    { -0.84, 0.15, 1.5 },
-    { 0.0, 0.15, 1.5 },
-    { -1.5, 0.075, 0.84 },
-    { -0.84, 0.075, 1.5 },
-    { 0.0, 0.075, 1.5 },
-    { -1.425, 0.0, 0.798 },
-    { -0.798, 0.0, 1.425 },
-    { 0.0, 0.0, 1.425 },
-    { 0.84, 0.15, 1.5 },
-    { 1.5, 0.15, 0.84 },
-    { 0.84, 0.075, 1.5 },
-    { 1.5, 0.075, 0.84 },
-    { 0.798, 0.0, 1.425 },
-    { 1.425, 0.0, 0.798 }
+    { -1.5, 0.15, -0.84 },
+    { -0.84, 0.15, -1.5 },
+    { 0.0, 0.15, -1.5 },
+    { -1.5, 0.075, -0.84 },
+    { -0.84, 0.075, -1.5 },
+    { 0.0, 0.075, -1.5 },
+    { -1.425, 0.0, -0.798 },
+    { -0.798, 0.0, -1.425 },
+    { 0.0, 0.0, -1.425 },
+    { 0.84, 0.15, -1.5 },
+    { 1.5, 0.15, -0.84 },
+    { 0.84, 0.075, -1.5 },
+    { 1.5, 0.075, -0.84 },
+    { 0.798, 0.0, -1.425 },
+    { 1.425, 0.0, -0.798 }
  };
 
 //
@@ -0,0 +1,43 @@
+#ifndef __TARGA_H__
+#define __TARGA_H__
+
+#include "vgl.h"
+#include <stddef.h>
+
+namespace vtarga
+{
+
+// What the decoder found in a file header. Pixels are always delivered in the
+// file's own byte order (BGR / BGRA), so format can go straight to glTexImage2D
+// and the driver copies instead of swizzling.
+struct image_info
+{
+    int             width;
+    int             height;
+    int             bytes_per_pixel;    // 1, 2, 3 or 4
+    GLenum          format;             // GL_RED, GL_RG, GL_BGR or GL_BGRA
+    bool            has_alpha;
+    bool            rle;                // Run length encoded TGA (image types 9, 10, 11)
+};
+
+// Reads only the header of a .tga or .bmp file.
+bool query_image(const char * filename, image_info &info);
+
+// Decodes a .tga (raw or RLE) or 24/32-bit .bmp straight into dst with no
+// intermediate allocation. dst may be a mapped pixel buffer. Rows are written
+// bottom-up as OpenGL expects, dst_pitch bytes apart (0 = tightly packed).
+// Returns false on unsupported or truncated files, or if dst_size is too small.
+bool load_image_into(const char * filename, unsigned char * dst, size_t dst_size, size_t dst_pitch, image_info &info);
+
+// Convenience wrappers that allocate with new[]. Free with delete [].
+unsigned char * load_targa(const char * filename, GLenum &format, int &width, int &height);
+unsigned char * load_bmp(const char * filename, GLenum &format, int &width, int &height);
+
+// Decodes each file with both this decoder and stb_image, plus an RLE .tga copy
+// of it written to scratch_file, and prints MB/s of decoded pixels for each.
+// Lives in targa_benchmark.cpp, which brings in stb_image.
+void benchmark(const char * const * filenames, int count, const char * scratch_file);
+
+}
+
+#endif /* __TARGA_H__ */
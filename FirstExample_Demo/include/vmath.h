@@ -4,11 +4,22 @@
 
 #define _USE_MATH_DEFINES  1 // Include constants defined in math.h
 #include <math.h>
+#include <type_traits>
+#include <utility>
+
+// Expression nodes are many tiny functions; forcing them inline keeps the fused loops flat at -O2
+#if defined(_MSC_VER)
+#define VMATH_INLINE __forceinline
+#elif defined(__GNUC__)
+#define VMATH_INLINE inline __attribute__((always_inline))
+#else
+#define VMATH_INLINE inline
+#endif
 
 namespace vmath
 {
 
-template <typename T> 
+template <typename T>
 inline T radians(T angleInRadians)
 {
 	return angleInRadians * static_cast<T>(180.0/M_PI);
@@ -21,10 +32,96 @@ public:
     inline ensure() { switch (false) { case false: case cond: break; } }
 };
 
+// Expression templates
+//
+// Arithmetic on vectors and matrices doesn't compute anything by itself. a * b + c * d returns a
+// small tree of nodes pointing at a, b, c and d, and the single loop over the elements runs when
+// that tree is assigned to or used to construct a vecN or matNM, so no temporary vectors are made
+// and the code is the same as the hand-written loop. Everything is constexpr, so vectors and
+// matrices (including whole expressions) can be built at compile time.
+//
+// Nodes refer to the vectors and matrices in them, so use an expression in the statement that
+// makes it (or store it in a vecN / matNM) instead of keeping it in an auto variable.
+// Products (matrix * matrix, matrix * vector, cross) read whole rows or columns, so they are
+// worked out on the spot and assigning one to a matrix or vector it reads from is safe.
+
 template <typename T, const int len> class vecN;
+template <typename T, const int w, const int h> class matNM;
+
+namespace detail
+{
+    // Non-deduced context, so vec3 * 2 converts 2 to float instead of failing to deduce T
+    template <typename T> struct identity { typedef T type; };
+
+    // How a node keeps an operand: vectors and matrices by reference, other nodes by value
+    template <typename E, typename Terminal> struct operand
+    {
+        typedef typename std::conditional<std::is_base_of<Terminal, E>::value, const Terminal&, const E>::type type;
+    };
+
+    // How a product keeps an operand: vectors and matrices by reference, other nodes evaluated
+    template <typename E, typename Terminal> struct evaluated
+    {
+        typedef typename std::conditional<std::is_base_of<Terminal, E>::value, const Terminal&, const Terminal>::type type;
+    };
+
+    struct add { template <typename T> static VMATH_INLINE constexpr T apply(const T& a, const T& b) { return a + b; } };
+    struct sub { template <typename T> static VMATH_INLINE constexpr T apply(const T& a, const T& b) { return a - b; } };
+    struct mul { template <typename T> static VMATH_INLINE constexpr T apply(const T& a, const T& b) { return a * b; } };
+    struct div { template <typename T> static VMATH_INLINE constexpr T apply(const T& a, const T& b) { return a / b; } };
+
+    // Constructor tags
+    struct elements {};
+    struct columns {};
+}
+
+// Anything with len values of type T: vecN itself and the nodes of vector expressions
+template <typename E, typename T, const int len>
+class vecExpr
+{
+public:
+    VMATH_INLINE constexpr const E& self() const { return static_cast<const E&>(*this); }
+    VMATH_INLINE constexpr T operator[](int n) const { return self()[n]; }
+
+    static constexpr int size(void) { return len; }
+};
 
 template <typename T, const int len>
-class vecN
+class vecScalar : public vecExpr<vecScalar<T,len>,T,len>
+{
+public:
+    explicit constexpr vecScalar(T s) : s(s) {}
+    VMATH_INLINE constexpr T operator[](int) const { return s; }
+
+private:
+    T s;
+};
+
+template <typename A, typename B, typename Op, typename T, const int len>
+class vecBinary : public vecExpr<vecBinary<A,B,Op,T,len>,T,len>
+{
+public:
+    constexpr vecBinary(const A& a, const B& b) : a(a), b(b) {}
+    VMATH_INLINE constexpr T operator[](int n) const { return Op::apply(T(a[n]), T(b[n])); }
+
+private:
+    typename detail::operand<A, vecN<T,len> >::type a;
+    typename detail::operand<B, vecN<T,len> >::type b;
+};
+
+template <typename A, typename T, const int len>
+class vecNegate : public vecExpr<vecNegate<A,T,len>,T,len>
+{
+public:
+    explicit constexpr vecNegate(const A& a) : a(a) {}
+    VMATH_INLINE constexpr T operator[](int n) const { return -a[n]; }
+
+private:
+    typename detail::operand<A, vecN<T,len> >::type a;
+};
+
+template <typename T, const int len>
+class vecN : public vecExpr<vecN<T,len>,T,len>
 {
 public:
     typedef class vecN<T,len> my_type;
@@ -35,143 +132,153 @@ public:
         // Uninitialized variable
     }
 
-    // Copy constructor
-    inline vecN(const vecN& that)
-    {
-        assign(that);
-    }
+    // Copy construction and assignment are the implicit ones
 
     // Construction from scalar
-    inline vecN(T s)
+    constexpr vecN(T s) : vecN(vecScalar<T,len>(s))
     {
-        int n;
-        for (n = 0; n < len; n++)
-        {
-            data[n] = s;
-        }
     }
 
-    // Assignment operator
-    inline vecN& operator=(const vecN& that)
+    // Construction from an expression, evaluated in one pass
+    template <typename E>
+    VMATH_INLINE constexpr vecN(const vecExpr<E,T,len>& that) : vecN(that.self(), std::make_integer_sequence<int,len>())
     {
-        assign(that);
-        return *this;
     }
 
-    inline vecN operator+(const vecN& that) const
+    // Assignment from an expression, evaluated in one pass. Safe when the expression reads *this,
+    // every node only reads the same element it writes.
+    template <typename E>
+    constexpr vecN& operator=(const vecExpr<E,T,len>& that)
     {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] + that.data[n];
-        return result;
+        for (int n = 0; n < len; n++)
+            data[n] = that[n];
+        return *this;
     }
 
-    inline vecN& operator+=(const vecN& that)
+    template <typename E>
+    constexpr vecN& operator+=(const vecExpr<E,T,len>& that)
     {
-        return (*this = *this + that);
+        for (int n = 0; n < len; n++)
+            data[n] += that[n];
+        return *this;
     }
 
-    inline vecN operator-() const
+    template <typename E>
+    constexpr vecN& operator-=(const vecExpr<E,T,len>& that)
     {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = -data[n];
-        return result;
+        for (int n = 0; n < len; n++)
+            data[n] -= that[n];
+        return *this;
     }
 
-    inline vecN operator-(const vecN& that) const
+    template <typename E>
+    constexpr vecN& operator*=(const vecExpr<E,T,len>& that)
     {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] - that.data[n];
-        return result;
+        for (int n = 0; n < len; n++)
+            data[n] *= that[n];
+        return *this;
     }
 
-    inline vecN& operator-=(const vecN& that)
+    constexpr vecN& operator*=(const T& that)
     {
-        return (*this = *this - that);
+        for (int n = 0; n < len; n++)
+            data[n] *= that;
+        return *this;
     }
 
-    inline vecN operator*(const vecN& that) const
+    template <typename E>
+    constexpr vecN& operator/=(const vecExpr<E,T,len>& that)
     {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] * that.data[n];
-        return result;
+        for (int n = 0; n < len; n++)
+            data[n] /= that[n];
+        return *this;
     }
 
-    inline vecN& operator*=(const vecN& that)
+    constexpr vecN& operator/=(const T& that)
     {
-        return (*this = *this * that);
+        for (int n = 0; n < len; n++)
+            data[n] /= that;
+        return *this;
     }
 
-    inline vecN operator*(const T& that) const
-    {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] * that;
-        return result;
-    }
+    constexpr T& operator[](int n) { return data[n]; }
+    constexpr const T& operator[](int n) const { return data[n]; }
 
-    inline vecN& operator*=(const T& that)
-    {
-        assign(*this * that);
+    static constexpr int size(void) { return len; }
 
-        return *this;
-    }
+    inline operator const T* () const { return &data[0]; }
 
-    inline vecN operator/(const vecN& that) const
-    {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] * that.data[n];
-        return result;
-    }
+protected:
+    T data[len];
 
-    inline vecN& operator/=(const vecN& that)
+    // For the Tvec constructors, exactly len values
+    template <typename... A>
+    constexpr vecN(detail::elements, A... a) : data{ a... }
     {
-        assign(*this * that);
-
-        return *this;
     }
 
-    inline vecN operator/(const T& that) const
+private:
+    template <typename E, int... I>
+    VMATH_INLINE constexpr vecN(const E& e, std::integer_sequence<int,I...>) : data{ e[I]... }
     {
-        my_type result;
-        int n;
-        for (n = 0; n < len; n++)
-            result.data[n] = data[n] / that;
-        return result;
     }
+};
 
-    inline vecN& operator/(const T& that)
-    {
-        assign(*this / that);
-    }
+// Element-wise arithmetic. Also for matrix * vector and vector * matrix, see the end of the file.
 
-    inline T& operator[](int n) { return data[n]; }
-    inline const T& operator[](int n) const { return data[n]; }
+template <typename T, const int len, typename A, typename B>
+static constexpr vecBinary<A,B,detail::add,T,len> operator+(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
+{
+    return vecBinary<A,B,detail::add,T,len>(a.self(), b.self());
+}
 
-    inline static int size(void) { return len; }
+template <typename T, const int len, typename A, typename B>
+static constexpr vecBinary<A,B,detail::sub,T,len> operator-(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
+{
+    return vecBinary<A,B,detail::sub,T,len>(a.self(), b.self());
+}
 
-    inline operator const T* () const { return &data[0]; }
+template <typename T, const int len, typename A, typename B>
+static constexpr vecBinary<A,B,detail::mul,T,len> operator*(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
+{
+    return vecBinary<A,B,detail::mul,T,len>(a.self(), b.self());
+}
 
-protected:
-    T data[len];
+template <typename T, const int len, typename A, typename B>
+static constexpr vecBinary<A,B,detail::div,T,len> operator/(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
+{
+    return vecBinary<A,B,detail::div,T,len>(a.self(), b.self());
+}
 
-    inline void assign(const vecN& that)
-    {
-        int n;
-        for (n = 0; n < len; n++)
-            data[n] = that.data[n];
-    }
-};
+template <typename T, const int len, typename A>
+static constexpr vecNegate<A,T,len> operator-(const vecExpr<A,T,len>& a)
+{
+    return vecNegate<A,T,len>(a.self());
+}
+
+template <typename T, const int len, typename A>
+static constexpr vecBinary<A,vecScalar<T,len>,detail::mul,T,len> operator*(const vecExpr<A,T,len>& v, const typename detail::identity<T>::type& x)
+{
+    return vecBinary<A,vecScalar<T,len>,detail::mul,T,len>(v.self(), vecScalar<T,len>(x));
+}
+
+template <typename T, const int len, typename B>
+static constexpr vecBinary<vecScalar<T,len>,B,detail::mul,T,len> operator*(const typename detail::identity<T>::type& x, const vecExpr<B,T,len>& v)
+{
+    return vecBinary<vecScalar<T,len>,B,detail::mul,T,len>(vecScalar<T,len>(x), v.self());
+}
+
+template <typename T, const int len, typename A>
+static constexpr vecBinary<A,vecScalar<T,len>,detail::div,T,len> operator/(const vecExpr<A,T,len>& v, const typename detail::identity<T>::type& x)
+{
+    return vecBinary<A,vecScalar<T,len>,detail::div,T,len>(v.self(), vecScalar<T,len>(x));
+}
+
+template <typename T, const int len, typename B>
+static constexpr vecBinary<vecScalar<T,len>,B,detail::div,T,len> operator/(const typename detail::identity<T>::type& x, const vecExpr<B,T,len>& v)
+{
+    return vecBinary<vecScalar<T,len>,B,detail::div,T,len>(vecScalar<T,len>(x), v.self());
+}
 
 template <typename T>
 class Tvec2 : public vecN<T,2>
@@ -181,14 +288,14 @@ public:
 
     // Uninitialized variable
     inline Tvec2() {}
-    // Copy constructor
-    inline Tvec2(const base& v) : base(v) {}
+
+    // From any vector or expression of two values
+    template <typename E>
+    constexpr Tvec2(const vecExpr<E,T,2>& v) : base(v) {}
 
     // vec2(x, y);
-    inline Tvec2(T x, T y)
+    constexpr Tvec2(T x, T y) : base(detail::elements(), x, y)
     {
-        base::data[0] = x;
-        base::data[1] = y;
     }
 };
 
@@ -201,31 +308,23 @@ public:
     // Uninitialized variable
     inline Tvec3() {}
 
-    // Copy constructor
-    inline Tvec3(const base& v) : base(v) {}
+    // From any vector or expression of three values
+    template <typename E>
+    constexpr Tvec3(const vecExpr<E,T,3>& v) : base(v) {}
 
     // vec3(x, y, z);
-    inline Tvec3(T x, T y, T z)
+    constexpr Tvec3(T x, T y, T z) : base(detail::elements(), x, y, z)
     {
-        base::data[0] = x;
-        base::data[1] = y;
-        base::data[2] = z;
     }
 
     // vec3(v, z);
-    inline Tvec3(const Tvec2<T>& v, T z)
+    constexpr Tvec3(const Tvec2<T>& v, T z) : base(detail::elements(), v[0], v[1], z)
     {
-        base::data[0] = v[0];
-        base::data[1] = v[1];
-        base::data[2] = z;
     }
 
     // vec3(x, v)
-    inline Tvec3(T x, const Tvec2<T>& v)
+    constexpr Tvec3(T x, const Tvec2<T>& v) : base(detail::elements(), x, v[0], v[1])
     {
-        base::data[0] = x;
-        base::data[1] = v[0];
-        base::data[2] = v[1];
     }
 };
 
@@ -238,70 +337,43 @@ public:
     // Uninitialized variable
     inline Tvec4() {}
 
-    // Copy constructor
-    inline Tvec4(const base& v) : base(v) {}
+    // From any vector or expression of four values
+    template <typename E>
+    constexpr Tvec4(const vecExpr<E,T,4>& v) : base(v) {}
 
     // vec4(x, y, z, w);
-    inline Tvec4(T x, T y, T z, T w)
+    constexpr Tvec4(T x, T y, T z, T w) : base(detail::elements(), x, y, z, w)
     {
-        base::data[0] = x;
-        base::data[1] = y;
-        base::data[2] = z;
-        base::data[3] = w;
     }
 
     // vec4(v, z, w);
-    inline Tvec4(const Tvec2<T>& v, T z, T w)
+    constexpr Tvec4(const Tvec2<T>& v, T z, T w) : base(detail::elements(), v[0], v[1], z, w)
     {
-        base::data[0] = v[0];
-        base::data[1] = v[1];
-        base::data[2] = z;
-        base::data[3] = w;
     }
 
     // vec4(x, v, w);
-    inline Tvec4(T x, const Tvec2<T>& v, T w)
+    constexpr Tvec4(T x, const Tvec2<T>& v, T w) : base(detail::elements(), x, v[0], v[1], w)
     {
-        base::data[0] = x;
-        base::data[1] = v[0];
-        base::data[2] = v[1];
-        base::data[3] = w;
     }
 
     // vec4(x, y, v);
-    inline Tvec4(T x, T y, const Tvec2<T>& v)
+    constexpr Tvec4(T x, T y, const Tvec2<T>& v) : base(detail::elements(), x, y, v[0], v[1])
     {
-        base::data[0] = x;
-        base::data[1] = y;
-        base::data[2] = v[0];
-        base::data[3] = v[1];
     }
 
     // vec4(v1, v2);
-    inline Tvec4(const Tvec2<T>& u, const Tvec2<T>& v)
+    constexpr Tvec4(const Tvec2<T>& u, const Tvec2<T>& v) : base(detail::elements(), u[0], u[1], v[0], v[1])
     {
-        base::data[0] = u[0];
-        base::data[1] = u[1];
-        base::data[2] = v[0];
-        base::data[3] = v[1];
     }
 
     // vec4(v, w);
-    inline Tvec4(const Tvec3<T>& v, T w)
+    constexpr Tvec4(const Tvec3<T>& v, T w) : base(detail::elements(), v[0], v[1], v[2], w)
     {
-        base::data[0] = v[0];
-        base::data[1] = v[1];
-        base::data[2] = v[2];
-        base::data[3] = w;
     }
 
     // vec4(x, v);
-    inline Tvec4(T x, const Tvec3<T>& v)
+    constexpr Tvec4(T x, const Tvec3<T>& v) : base(detail::elements(), x, v[0], v[1], v[2])
     {
-        base::data[0] = x;
-        base::data[1] = v[0];
-        base::data[2] = v[1];
-        base::data[3] = v[2];
     }
 };
 
@@ -320,56 +392,33 @@ typedef Tvec4<int> ivec4;
 typedef Tvec4<unsigned int> uvec4;
 typedef Tvec4<double> dvec4;
 
-template <typename T, int n>
-static inline const vecN<T,n> operator * (T x, const vecN<T,n>& v)
-{
-    return v * x;
-}
-
-template <typename T>
-static inline const Tvec2<T> operator / (T x, const Tvec2<T>& v)
-{
-    return Tvec2<T>(x / v[0], x / v[1]);
-}
-
-template <typename T>
-static inline const Tvec3<T> operator / (T x, const Tvec3<T>& v)
-{
-    return Tvec3<T>(x / v[0], x / v[1], x / v[2]);
-}
-
-template <typename T>
-static inline const Tvec4<T> operator / (T x, const Tvec4<T>& v)
+template <typename T, int len, typename A, typename B>
+static inline constexpr T dot(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
 {
-    return Tvec4<T>(x / v[0], x / v[1], x / v[2], x / v[3]);
-}
-
-template <typename T, int len>
-static inline T dot(const vecN<T,len>& a, const vecN<T,len>& b)
-{
-    int n;
     T total = T(0);
-    for (n = 0; n < len; n++)
+    for (int n = 0; n < len; n++)
     {
         total += a[n] * b[n];
     }
     return total;
 }
 
-template <typename T>
-static inline vecN<T,3> cross(const vecN<T,3>& a, const vecN<T,3>& b)
+template <typename T, typename A, typename B>
+static inline constexpr vecN<T,3> cross(const vecExpr<A,T,3>& ea, const vecExpr<B,T,3>& eb)
 {
+    typename detail::evaluated<A, vecN<T,3> >::type a = ea.self();
+    typename detail::evaluated<B, vecN<T,3> >::type b = eb.self();
     return Tvec3<T>(a[1] * b[2] - b[1] * a[2],
                     a[2] * b[0] - b[2] * a[0],
                     a[0] * b[1] - b[0] * a[1]);
 }
 
-template <typename T, int len>
-static inline T length(const vecN<T,len>& v)
+template <typename T, int len, typename A>
+static inline T length(const vecExpr<A,T,len>& v)
 {
     T result(0);
 
-    for (int i = 0; i < v.size(); ++i)
+    for (int i = 0; i < len; ++i)
     {
         result += v[i] * v[i];
     }
@@ -377,20 +426,122 @@ static inline T length(const vecN<T,len>& v)
     return (T)sqrt(result);
 }
 
-template <typename T, int len>
-static inline vecN<T,len> normalize(const vecN<T,len>& v)
+template <typename T, int len, typename A>
+static inline vecN<T,len> normalize(const vecExpr<A,T,len>& ev)
 {
+    typename detail::evaluated<A, vecN<T,len> >::type v = ev.self();
     return v / length(v);
 }
 
-template <typename T, int len>
-static inline T distance(const vecN<T,len>& a, const vecN<T,len>& b)
+template <typename T, int len, typename A, typename B>
+static inline T distance(const vecExpr<A,T,len>& a, const vecExpr<B,T,len>& b)
 {
     return length(b - a);
 }
 
+// Anything with w columns of h values of type T: matNM itself and the nodes of matrix expressions
+template <typename E, typename T, const int w, const int h>
+class matExpr
+{
+public:
+    VMATH_INLINE constexpr const E& self() const { return static_cast<const E&>(*this); }
+    // Element in column col and row row
+    VMATH_INLINE constexpr T at(int col, int row) const { return self().at(col, row); }
+
+    static constexpr int width(void) { return w; }
+    static constexpr int height(void) { return h; }
+};
+
 template <typename T, const int w, const int h>
-class matNM
+class matScalar : public matExpr<matScalar<T,w,h>,T,w,h>
+{
+public:
+    explicit constexpr matScalar(T s) : s(s) {}
+    VMATH_INLINE constexpr T at(int, int) const { return s; }
+
+private:
+    T s;
+};
+
+template <typename T, const int n>
+class matIdentity : public matExpr<matIdentity<T,n>,T,n,n>
+{
+public:
+    VMATH_INLINE constexpr T at(int col, int row) const { return col == row ? T(1) : T(0); }
+};
+
+template <typename A, typename B, typename Op, typename T, const int w, const int h>
+class matBinary : public matExpr<matBinary<A,B,Op,T,w,h>,T,w,h>
+{
+public:
+    constexpr matBinary(const A& a, const B& b) : a(a), b(b) {}
+    VMATH_INLINE constexpr T at(int col, int row) const { return Op::apply(T(a.at(col, row)), T(b.at(col, row))); }
+
+private:
+    typename detail::operand<A, matNM<T,w,h> >::type a;
+    typename detail::operand<B, matNM<T,w,h> >::type b;
+};
+
+// Transpose of a, which has h columns of w values
+template <typename A, typename T, const int w, const int h>
+class matTranspose : public matExpr<matTranspose<A,T,w,h>,T,w,h>
+{
+public:
+    explicit constexpr matTranspose(const A& a) : a(a) {}
+    VMATH_INLINE constexpr T at(int col, int row) const { return a.at(row, col); }
+
+private:
+    typename detail::operand<A, matNM<T,h,w> >::type a;
+};
+
+// a (n columns of h values) times b (w columns of n values). Every element needs a whole row of a
+// and column of b, so the product is worked out once, when the node is made, as w sums of the
+// columns of a (which vectorizes) and the rest of the expression reads the result.
+template <typename A, typename B, typename T, const int n, const int w, const int h>
+class matProduct : public matExpr<matProduct<A,B,T,n,w,h>,T,w,h>
+{
+public:
+    constexpr matProduct(const A& a, const B& b) : result(multiply(a, b)) {}
+
+    VMATH_INLINE constexpr T at(int col, int row) const { return result[col][row]; }
+
+private:
+    matNM<T,w,h> result;
+
+    static constexpr matNM<T,w,h> multiply(const matNM<T,n,h>& a, const matNM<T,w,n>& b)
+    {
+        matNM<T,w,h> result(T(0));
+
+        for (int j = 0; j < w; j++)
+        {
+            for (int k = 0; k < n; k++)
+            {
+                for (int i = 0; i < h; i++)
+                {
+                    result[j][i] += a[k][i] * b[j][k];
+                }
+            }
+        }
+
+        return result;
+    }
+};
+
+// Column col of a matrix expression, used to evaluate one column at a time
+template <typename E, typename T, const int h>
+class matColumn : public vecExpr<matColumn<E,T,h>,T,h>
+{
+public:
+    constexpr matColumn(const E& m, int col) : m(m), col(col) {}
+    VMATH_INLINE constexpr T operator[](int row) const { return m.at(col, row); }
+
+private:
+    const E& m;
+    int col;
+};
+
+template <typename T, const int w, const int h>
+class matNM : public matExpr<matNM<T,w,h>,T,w,h>
 {
 public:
     typedef class matNM<T,w,h> my_type;
@@ -402,148 +553,136 @@ public:
         // Uninitialized variable
     }
 
-    // Copy constructor
-    inline matNM(const matNM& that)
-    {
-        assign(that);
-    }
+    // Copy construction and assignment are the implicit ones
 
     // Construction from element type
     // explicit to prevent assignment from T
-    explicit inline matNM(T f)
+    explicit constexpr matNM(T f) : matNM(vector_type(f))
     {
-        for (int n = 0; n < w; n++)
-        {
-            data[n] = f;
-        }
     }
 
-    // Construction from vector
-    inline matNM(const vector_type& v)
+    // Construction from vector, every column is v
+    constexpr matNM(const vector_type& v) : matNM(v, std::make_integer_sequence<int,w>())
     {
-        for (int n = 0; n < w; n++)
-        {
-            data[n] = v;
-        }
     }
 
-    // Assignment operator
-    inline matNM& operator=(const my_type& that)
+    // Construction from an expression, evaluated column by column
+    template <typename E>
+    VMATH_INLINE constexpr matNM(const matExpr<E,T,w,h>& that) : matNM(that, std::make_integer_sequence<int,w>())
     {
-        assign(that);
-        return *this;
     }
 
-    inline matNM operator+(const my_type& that) const
+    // Assignment from an expression. Goes through a temporary because a product in it may read
+    // this matrix; for anything else the compiler writes straight into data.
+    template <typename E>
+    constexpr matNM& operator=(const matExpr<E,T,w,h>& that)
     {
-        my_type result;
-        int n;
-        for (n = 0; n < w; n++)
-            result.data[n] = data[n] + that.data[n];
-        return result;
+        return *this = my_type(that);
     }
 
-    inline my_type& operator+=(const my_type& that)
+    template <typename E>
+    constexpr my_type& operator+=(const matExpr<E,T,w,h>& that)
     {
         return (*this = *this + that);
     }
 
-    inline my_type operator-(const my_type& that) const
-    {
-        my_type result;
-        int n;
-        for (n = 0; n < w; n++)
-            result.data[n] = data[n] - that.data[n];
-        return result;
-    }
-
-    inline my_type& operator-=(const my_type& that)
+    template <typename E>
+    constexpr my_type& operator-=(const matExpr<E,T,w,h>& that)
     {
         return (*this = *this - that);
     }
 
-    // Matrix multiply.
-    // TODO: This only works for square matrices. Need more template skill to make a non-square version.
-    inline my_type operator*(const my_type& that) const
-    {
-        ensure<w == h>();
-
-        my_type result(0);
-
-        for (int j = 0; j < w; j++)
-        {
-            for (int i = 0; i < h; i++)
-            {
-                T sum(0);
-
-                for (int n = 0; n < w; n++)
-                {
-                    sum += data[n][i] * that[j][n];
-                }
-
-                result[j][i] = sum;
-            }
-        }
-
-        return result;
-    }
-
-    inline my_type& operator*=(const my_type& that)
+    // Square matrices only, the product of non-square ones has a different size
+    template <typename E>
+    constexpr my_type& operator*=(const matExpr<E,T,w,h>& that)
     {
+        static_assert(w == h, "operator*= needs a square matrix");
         return (*this = *this * that);
     }
 
-    inline vector_type& operator[](int n) { return data[n]; }
-    inline const vector_type& operator[](int n) const { return data[n]; }
+    VMATH_INLINE constexpr T at(int col, int row) const { return data[col][row]; }
+
+    constexpr vector_type& operator[](int n) { return data[n]; }
+    constexpr const vector_type& operator[](int n) const { return data[n]; }
     inline operator T*() { return &data[0][0]; }
     inline operator const T*() const { return &data[0][0]; }
 
-    inline matNM<T,h,w> transpose(void) const
+    constexpr matNM<T,h,w> transpose(void) const
     {
-        matNM<T,h,w> result;
-        int x, y;
-
-        for (y = 0; y < w; y++)
-        {
-            for (x = 0; x < h; x++)
-            {
-                result[x][y] = data[y][x];
-            }
-        }
-
-        return result;
+        return matNM<T,h,w>(matTranspose<my_type,T,h,w>(*this));
     }
 
-    static inline my_type identity()
+    static constexpr my_type identity()
     {
-        ensure<w == h>();
-
-        my_type result(0);
+        static_assert(w == h, "identity() needs a square matrix");
 
-        for (int i = 0; i < w; i++)
-        {
-            result[i][i] = 1;
-        }
-
-        return result;
+        return my_type(matIdentity<T,w>());
     }
 
-    static inline int width(void) { return w; }
-    static inline int height(void) { return h; }
+    static constexpr int width(void) { return w; }
+    static constexpr int height(void) { return h; }
 
 protected:
     // Column primary data (essentially, array of vectors)
     vecN<T,h> data[w];
 
-    // Assignment function - called from assignment operator and copy constructor.
-    inline void assign(const matNM& that)
+    // For the Tmat constructors, exactly w columns
+    template <typename... C>
+    constexpr matNM(detail::columns, const C&... c) : data{ c... }
+    {
+    }
+
+private:
+    template <int... I>
+    constexpr matNM(const vector_type& v, std::integer_sequence<int,I...>) : data{ ((void)I, v)... }
+    {
+    }
+
+    template <typename E, int... I>
+    VMATH_INLINE constexpr matNM(const matExpr<E,T,w,h>& that, std::integer_sequence<int,I...>)
+        : data{ vector_type(matColumn<E,T,h>(that.self(), I))... }
     {
-        int n;
-        for (n = 0; n < w; n++)
-            data[n] = that.data[n];
     }
 };
 
+template <typename T, const int w, const int h, typename A, typename B>
+static constexpr matBinary<A,B,detail::add,T,w,h> operator+(const matExpr<A,T,w,h>& a, const matExpr<B,T,w,h>& b)
+{
+    return matBinary<A,B,detail::add,T,w,h>(a.self(), b.self());
+}
+
+template <typename T, const int w, const int h, typename A, typename B>
+static constexpr matBinary<A,B,detail::sub,T,w,h> operator-(const matExpr<A,T,w,h>& a, const matExpr<B,T,w,h>& b)
+{
+    return matBinary<A,B,detail::sub,T,w,h>(a.self(), b.self());
+}
+
+template <typename T, const int w, const int h, typename A>
+static constexpr matBinary<A,matScalar<T,w,h>,detail::mul,T,w,h> operator*(const matExpr<A,T,w,h>& m, const typename detail::identity<T>::type& x)
+{
+    return matBinary<A,matScalar<T,w,h>,detail::mul,T,w,h>(m.self(), matScalar<T,w,h>(x));
+}
+
+template <typename T, const int w, const int h, typename B>
+static constexpr matBinary<matScalar<T,w,h>,B,detail::mul,T,w,h> operator*(const typename detail::identity<T>::type& x, const matExpr<B,T,w,h>& m)
+{
+    return matBinary<matScalar<T,w,h>,B,detail::mul,T,w,h>(matScalar<T,w,h>(x), m.self());
+}
+
+template <typename T, const int w, const int h, typename A>
+static constexpr matBinary<A,matScalar<T,w,h>,detail::div,T,w,h> operator/(const matExpr<A,T,w,h>& m, const typename detail::identity<T>::type& x)
+{
+    return matBinary<A,matScalar<T,w,h>,detail::div,T,w,h>(m.self(), matScalar<T,w,h>(x));
+}
+
+// Matrix multiply, any sizes where a has as many columns as b has rows:
+// (n columns of h) * (w columns of n) = (w columns of h)
+template <typename T, const int n, const int w, const int h, typename A, typename B>
+static constexpr matProduct<A,B,T,n,w,h> operator*(const matExpr<A,T,n,h>& a, const matExpr<B,T,w,n>& b)
+{
+    return matProduct<A,B,T,n,w,h>(a.self(), b.self());
+}
+
 /*
 template <typename T, const int N>
 class TmatN : public matNM<T,N,N>
@@ -583,18 +722,16 @@ public:
     typedef Tmat4<T> my_type;
 
     inline Tmat4() {}
-    inline Tmat4(const my_type& that) : base(that) {}
-    inline Tmat4(const base& that) : base(that) {}
-    inline Tmat4(const vecN<T,4>& v) : base(v) {}
-    inline Tmat4(const vecN<T,4>& v0,
-                 const vecN<T,4>& v1,
-                 const vecN<T,4>& v2,
-                 const vecN<T,4>& v3)
-    {
-        base::data[0] = v0;
-        base::data[1] = v1;
-        base::data[2] = v2;
-        base::data[3] = v3;
+    // From any 4x4 matrix or expression
+    template <typename E>
+    constexpr Tmat4(const matExpr<E,T,4,4>& that) : base(that.self()) {}
+    constexpr Tmat4(const vecN<T,4>& v) : base(v) {}
+    constexpr Tmat4(const vecN<T,4>& v0,
+                    const vecN<T,4>& v1,
+                    const vecN<T,4>& v2,
+                    const vecN<T,4>& v3)
+        : base(detail::columns(), v0, v1, v2, v3)
+    {
     }
 };
 
@@ -635,6 +772,21 @@ static inline mat4 perspective(float fovy /* in degrees */, float aspect, float
 	return frustum(-right, right, -top, top, n, f);
 }
 
+template <typename T>
+static inline constexpr Tmat4<T> translate(T x, T y, T z)
+{
+    return Tmat4<T>(Tvec4<T>(1.0f, 0.0f, 0.0f, 0.0f),
+                    Tvec4<T>(0.0f, 1.0f, 0.0f, 0.0f),
+                    Tvec4<T>(0.0f, 0.0f, 1.0f, 0.0f),
+                    Tvec4<T>(x, y, z, 1.0f));
+}
+
+template <typename T>
+static inline constexpr Tmat4<T> translate(const vecN<T,3>& v)
+{
+    return translate(v[0], v[1], v[2]);
+}
+
 template <typename T>
 static inline Tmat4<T> lookat(vecN<T,3> eye, vecN<T,3> center, vecN<T,3> up)
 {
@@ -651,22 +803,7 @@ static inline Tmat4<T> lookat(vecN<T,3> eye, vecN<T,3> center, vecN<T,3> up)
 }
 
 template <typename T>
-static inline Tmat4<T> translate(T x, T y, T z)
-{
-    return Tmat4<T>(Tvec4<T>(1.0f, 0.0f, 0.0f, 0.0f),
-                    Tvec4<T>(0.0f, 1.0f, 0.0f, 0.0f),
-                    Tvec4<T>(0.0f, 0.0f, 1.0f, 0.0f),
-                    Tvec4<T>(x, y, z, 1.0f));
-}
-
-template <typename T>
-static inline Tmat4<T> translate(const vecN<T,3>& v)
-{
-    return translate(v[0], v[1], v[2]);
-}
-
-template <typename T>
-static inline Tmat4<T> scale(T x, T y, T z)
+static inline constexpr Tmat4<T> scale(T x, T y, T z)
 {
     return Tmat4<T>(Tvec4<T>(x, 0.0f, 0.0f, 0.0f),
                     Tvec4<T>(0.0f, y, 0.0f, 0.0f),
@@ -675,13 +812,13 @@ static inline Tmat4<T> scale(T x, T y, T z)
 }
 
 template <typename T>
-static inline Tmat4<T> scale(const Tvec4<T>& v)
+static inline constexpr Tmat4<T> scale(const Tvec4<T>& v)
 {
     return scale(v[0], v[1], v[2]);
 }
 
 template <typename T>
-static inline Tmat4<T> scale(T x)
+static inline constexpr Tmat4<T> scale(T x)
 {
     return Tmat4<T>(Tvec4<T>(x, 0.0f, 0.0f, 0.0f),
                     Tvec4<T>(0.0f, x, 0.0f, 0.0f),
@@ -721,7 +858,7 @@ static inline Tmat4<T> rotate(T angle, const vecN<T,3>& v)
 #endif
 
 template <typename T>
-static inline T min(T a, T b)
+static inline constexpr T min(T a, T b)
 {
     return a < b ? a : b;
 }
@@ -731,32 +868,30 @@ static inline T min(T a, T b)
 #endif
 
 template <typename T>
-static inline T max(T a, T b)
+static inline constexpr T max(T a, T b)
 {
     return a >= b ? a : b;
 }
 
-template <typename T, const int N>
-static inline vecN<T,N> min(const vecN<T,N>& x, const vecN<T,N>& y)
+template <typename T, const int N, typename A, typename B>
+static inline constexpr vecN<T,N> min(const vecExpr<A,T,N>& x, const vecExpr<B,T,N>& y)
 {
-    vecN<T,N> t;
-    int n;
+    vecN<T,N> t(T(0));
 
-    for (n = 0; n < N; n++)
+    for (int n = 0; n < N; n++)
     {
-        t[n] = min(x[n], y[n]);
+        t[n] = min<T>(x[n], y[n]);
     }
 
     return t;
 }
 
-template <typename T, const int N>
-static inline vecN<T,N> max(const vecN<T,N>& x, const vecN<T,N>& y)
+template <typename T, const int N, typename A, typename B>
+static inline constexpr vecN<T,N> max(const vecExpr<A,T,N>& x, const vecExpr<B,T,N>& y)
 {
-    vecN<T,N> t;
-    int n;
+    vecN<T,N> t(T(0));
 
-    for (n = 0; n < N; n++)
+    for (int n = 0; n < N; n++)
     {
         t[n] = max<T>(x[n], y[n]);
     }
@@ -764,48 +899,57 @@ static inline vecN<T,N> max(const vecN<T,N>& x, const vecN<T,N>& y)
     return t;
 }
 
-template <typename T, const int N>
-static inline vecN<T,N> clamp(const vecN<T,N>& x, const vecN<T,N>& minVal, const vecN<T,N>& maxVal)
+template <typename T, const int N, typename A, typename B, typename C>
+static inline constexpr vecN<T,N> clamp(const vecExpr<A,T,N>& x, const vecExpr<B,T,N>& minVal, const vecExpr<C,T,N>& maxVal)
 {
     return min<T>(max<T>(x, minVal), maxVal);
 }
 
-template <typename T, const int N>
-static inline vecN<T,N> smoothstep(const vecN<T,N>& edge0, const vecN<T,N>& edge1, const vecN<T,N>& x)
+template <typename T, const int N, typename A, typename B, typename C>
+static inline constexpr vecN<T,N> smoothstep(const vecExpr<A,T,N>& edge0, const vecExpr<B,T,N>& edge1, const vecExpr<C,T,N>& x)
 {
-    vecN<T,N> t;
-    t = clamp((x - edge0) / (edge1 - edge0), vecN<T,N>(T(0)), vecN<T,N>(T(1)));
+    const vecN<T,N> t = clamp((x - edge0) / (edge1 - edge0), vecN<T,N>(T(0)), vecN<T,N>(T(1)));
     return t * t * (vecN<T,N>(T(3)) - vecN<T,N>(T(2)) * t);
 }
 
-template <typename T, const int N, const int M>
-static inline matNM<T,N,M> matrixCompMult(const matNM<T,N,M>& x, const matNM<T,N,M>& y)
+template <typename T, const int N, const int M, typename A, typename B>
+static inline constexpr matNM<T,N,M> matrixCompMult(const matExpr<A,T,N,M>& x, const matExpr<B,T,N,M>& y)
+{
+    return matBinary<A,B,detail::mul,T,N,M>(x.self(), y.self());
+}
+
+// Row vector times matrix: element n is the dot product of vec and column n
+template <typename T, const int N, const int M, typename A, typename B>
+static inline constexpr vecN<T,N> operator*(const vecExpr<A,T,M>& evec, const matExpr<B,T,N,M>& emat)
 {
-    matNM<T,N,M> result;
-    int i, j;
+    typename detail::evaluated<A, vecN<T,M> >::type vec = evec.self();
+    typename detail::evaluated<B, matNM<T,N,M> >::type mat = emat.self();
+    vecN<T,N> result(T(0));
 
-    for (j = 0; j < M; ++j)
+    for (int m = 0; m < M; m++)
     {
-        for (i = 0; i < N; ++i)
+        for (int n = 0; n < N; n++)
         {
-            result[i][j] = x[i][j] * y[i][j];
+            result[n] += vec[m] * mat[n][m];
         }
     }
 
     return result;
 }
 
-template <typename T, const int N, const int M>
-static inline vecN<T,N> operator*(const vecN<T,M>& vec, const matNM<T,N,M>& mat)
+// Matrix times column vector, the usual way to transform a point: the sum of column n times vec[n]
+template <typename T, const int N, const int M, typename A, typename B>
+static inline constexpr vecN<T,M> operator*(const matExpr<A,T,N,M>& emat, const vecExpr<B,T,N>& evec)
 {
-    int n, m;
-    vecN<T,N> result(T(0));
+    typename detail::evaluated<A, matNM<T,N,M> >::type mat = emat.self();
+    typename detail::evaluated<B, vecN<T,N> >::type vec = evec.self();
+    vecN<T,M> result(T(0));
 
-    for (m = 0; m < M; m++)
+    for (int n = 0; n < N; n++)
     {
-        for (n = 0; n < N; n++)
+        for (int m = 0; m < M; m++)
         {
-            result[n] += vec[m] * mat[n][m];
+            result[m] += mat[n][m] * vec[n];
         }
     }
 
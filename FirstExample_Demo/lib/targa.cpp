@@ -1,5 +1,21 @@
 #include <stdio.h>
+#include <string.h>
 #include "vgl.h"
+#include "targa.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TARGA_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace vtarga
 {
@@ -38,6 +54,37 @@ struct targa_header
 #pragma pack (pop)
 #endif
 
+// The header is 18 bytes on disk. Only MSVC packs the struct above, so read it
+// field by field instead of relying on the struct layout.
+static const size_t targa_header_size = 18;
+
+static unsigned short read_u16(const unsigned char * p)
+{
+    return (unsigned short)(p[0] | (p[1] << 8));
+}
+
+static unsigned int read_u32(const unsigned char * p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void read_targa_header(const unsigned char * p, targa_header &header)
+{
+    header.id_length = p[0];
+    header.cmap_type = p[1];
+    header.image_type = p[2];
+    header.cmap_spec.cmap_table_offset = read_u16(p + 3);
+    header.cmap_spec.cmap_entry_count = read_u16(p + 5);
+    header.cmap_spec.cmap_entry_size = p[7];
+    header.image_spec.x_origin = read_u16(p + 8);
+    header.image_spec.y_origin = read_u16(p + 10);
+    header.image_spec.width = read_u16(p + 12);
+    header.image_spec.height = read_u16(p + 14);
+    header.image_spec.bits_per_pixel = p[16];
+    header.image_spec.alpha_depth = p[17] & 0x0F;
+    header.image_spec.image_origin = (p[17] >> 4) & 0x03;
+}
+
 static bool is_compressed_targa(const targa_header &header)
 {
     return (header.image_type & 0x08) != 0;
@@ -60,17 +107,10 @@ static bool get_targa_format_type_and_size(const targa_header &header, GLenum &f
             size = 1;
             return true;
         case 16:
-            switch (header.image_spec.alpha_depth)
-            {
-                case 0:
-                    format = GL_RG8;
-                    break;
-                case 8:
-                    format = GL_RG;
-                    break;
-                default:
-                    return false;
-            }
+            // Only grayscale + alpha. 16-bit color (A1R5G5B5) isn't supported.
+            if ((header.image_type & 0x07) != 3)
+                return false;
+            format = GL_RG;
             size = 2;
             return true;
         case 24:
@@ -86,15 +126,8 @@ static bool get_targa_format_type_and_size(const targa_header &header, GLenum &f
             size = 3;
             return true;
         case 32:
-            switch (header.image_spec.alpha_depth)
-            {
-                case 8:
-                    format = GL_ABGR_EXT;
-                    break;
-                default:
-                    // 32-bit image without alpha.
-                    return false;
-            }
+            // Stored as B, G, R, A in memory. Some writers leave alpha_depth at 0.
+            format = GL_BGRA;
             size = 4;
             return true;
         default:
@@ -102,40 +135,371 @@ static bool get_targa_format_type_and_size(const targa_header &header, GLenum &f
     }
 }
 
-unsigned char * load_targa(const char * filename, GLenum &format, int &width, int &height)
+// Read only view of a whole file. Avoids the fread copy into a temporary buffer.
+struct mapped_file
 {
-    targa_header header;
-    FILE * f;
+    const unsigned char *   data;
+    size_t                  size;
+#ifdef _WIN32
+    HANDLE                  file;
+    HANDLE                  mapping;
+#else
+    int                     fd;
+#endif
 
-    f = fopen(filename, "rb");
+    explicit mapped_file(const char * filename)
+        : data(0), size(0)
+    {
+#ifdef _WIN32
+        mapping = 0;
+        file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+            return;
+        data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data)
+            size = (size_t)file_size.QuadPart;
+#else
+        fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+            return;
+        void * p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+            return;
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+        data = (const unsigned char *)p;
+        size = (size_t)st.st_size;
+#endif
+    }
 
-    if (!f)
-        return 0;
+    ~mapped_file()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (data)
+            munmap((void *)data, size);
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+private:
+    mapped_file(const mapped_file &);
+    mapped_file & operator=(const mapped_file &);
+};
+
+// Fills count pixels of size bytes with one value. A 48 byte pattern holds a whole
+// number of 1, 2, 3 and 4 byte pixels, so the loop just cycles through 16 byte stores.
+static void fill_pixels(unsigned char * dst, const unsigned char * pixel, int size, size_t count)
+{
+    size_t bytes = count * size;
+    if (size == 1)
+    {
+        memset(dst, pixel[0], bytes);
+        return;
+    }
 
-    fread(&header, sizeof(header), 1, f);
+    unsigned char pattern[48];
+    for (int i = 0; i < 48; i++)
+        pattern[i] = pixel[i % size];
 
-    width = header.image_spec.width;
-    height = header.image_spec.height;
+    size_t n = 0;
+#ifdef TARGA_SSE2
+    const __m128i p0 = _mm_loadu_si128((const __m128i *)pattern);
+    const __m128i p1 = _mm_loadu_si128((const __m128i *)(pattern + 16));
+    const __m128i p2 = _mm_loadu_si128((const __m128i *)(pattern + 32));
+    for (; n + 48 <= bytes; n += 48)
+    {
+        _mm_storeu_si128((__m128i *)(dst + n), p0);
+        _mm_storeu_si128((__m128i *)(dst + n + 16), p1);
+        _mm_storeu_si128((__m128i *)(dst + n + 32), p2);
+    }
+#else
+    for (; n + 48 <= bytes; n += 48)
+        memcpy(dst + n, pattern, 48);
+#endif
+    memcpy(dst + n, pattern, bytes - n);
+}
+
+// Walks the destination row by row so RLE packets that run past the end of a
+// row (allowed by the spec, and common) land in the right place.
+struct row_writer
+{
+    unsigned char *     base;
+    size_t              pitch;
+    int                 width;
+    int                 height;
+    int                 size;
+    bool                top_down;   // Source rows arrive top first, so write them bottom-up.
+    int                 row;
+    int                 x;
+
+    unsigned char * current()
+    {
+        int y = top_down ? height - 1 - row : row;
+        return base + y * pitch + (size_t)x * size;
+    }
+
+    void advance(int count)
+    {
+        x += count;
+        if (x == width)
+        {
+            x = 0;
+            row++;
+        }
+    }
+
+    bool done() const { return row >= height; }
+
+    // How many pixels fit before the end of the current row.
+    int room() const { return width - x; }
+};
+
+static bool decode_targa_rle(const unsigned char * src, const unsigned char * end, row_writer &out)
+{
+    while (!out.done())
+    {
+        if (src >= end)
+            return false;
+        unsigned char packet = *src++;
+        int count = (packet & 0x7F) + 1;
+
+        if (packet & 0x80)
+        {
+            // Run packet: one pixel repeated.
+            if (end - src < out.size)
+                return false;
+            while (count > 0 && !out.done())
+            {
+                int n = count < out.room() ? count : out.room();
+                fill_pixels(out.current(), src, out.size, n);
+                out.advance(n);
+                count -= n;
+            }
+            src += out.size;
+        }
+        else
+        {
+            // Raw packet: count literal pixels.
+            if ((size_t)(end - src) < (size_t)count * out.size)
+                return false;
+            while (count > 0 && !out.done())
+            {
+                int n = count < out.room() ? count : out.room();
+                memcpy(out.current(), src, (size_t)n * out.size);
+                out.advance(n);
+                src += (size_t)n * out.size;
+                count -= n;
+            }
+        }
+    }
+    return true;
+}
+
+static bool parse_targa(const unsigned char * data, size_t size, targa_header &header, image_info &info)
+{
+    if (size < targa_header_size)
+        return false;
+    read_targa_header(data, header);
+
+    // 2 = true color, 3 = grayscale, +8 for RLE.
+    int kind = header.image_type & 0x07;
+    if (kind != 2 && kind != 3)
+        return false;
 
     GLenum type;
-    int size;
+    if (!get_targa_format_type_and_size(header, info.format, type, info.bytes_per_pixel))
+        return false;
+
+    info.width = header.image_spec.width;
+    info.height = header.image_spec.height;
+    info.has_alpha = info.bytes_per_pixel == 2 || (info.bytes_per_pixel == 4 && header.image_spec.alpha_depth != 0);
+    info.rle = is_compressed_targa(header);
+    return info.width > 0 && info.height > 0;
+}
+
+static bool decode_targa(const unsigned char * data, size_t size, unsigned char * dst, size_t dst_pitch, image_info &info)
+{
+    targa_header header;
+    if (!parse_targa(data, size, header, info))
+        return false;
+
+    const unsigned char * src = data + targa_header_size + header.id_length;
+    const unsigned char * end = data + size;
+    if (src > end)
+        return false;
 
-    get_targa_format_type_and_size(header, format, type, size);
+    row_writer out = { dst, dst_pitch, info.width, info.height, info.bytes_per_pixel,
+                       (header.image_spec.image_origin & 0x02) != 0, 0, 0 };
 
-    unsigned char * data = new unsigned char [width * height * size];
+    if (info.rle)
+        return decode_targa_rle(src, end, out);
 
-    if (is_compressed_targa(header))
+    size_t row_bytes = (size_t)info.width * info.bytes_per_pixel;
+    if ((size_t)(end - src) < row_bytes * info.height)
+        return false;
+    for (; !out.done(); src += row_bytes)
     {
-        // TODO: Handle compressed targa files
+        memcpy(out.current(), src, row_bytes);
+        out.advance(info.width);
     }
-    else
+    return true;
+}
+
+static bool parse_bmp(const unsigned char * data, size_t size, image_info &info, size_t &pixel_offset, bool &top_down)
+{
+    // BITMAPFILEHEADER (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes).
+    if (size < 54 || data[0] != 'B' || data[1] != 'M')
+        return false;
+
+    pixel_offset = read_u32(data + 10);
+    unsigned int header_size = read_u32(data + 14);
+    int width = (int)read_u32(data + 18);
+    int height = (int)read_u32(data + 22);
+    unsigned short bit_count = read_u16(data + 28);
+    unsigned int compression = read_u32(data + 30);
+
+    if (header_size < 40 || width <= 0 || height == 0)
+        return false;
+    if (bit_count != 24 && bit_count != 32)
+        return false;
+
+    // BI_RGB, or BI_BITFIELDS with the standard BGRA masks (which is just BI_RGB spelled out).
+    if (compression == 3)
+    {
+        if (bit_count != 32 || size < 66 ||
+            read_u32(data + 54) != 0x00FF0000 || read_u32(data + 58) != 0x0000FF00 || read_u32(data + 62) != 0x000000FF)
+            return false;
+    }
+    else if (compression != 0)
+    {
+        return false;
+    }
+
+    top_down = height < 0;
+    info.width = width;
+    info.height = top_down ? -height : height;
+    info.bytes_per_pixel = bit_count / 8;
+    info.format = bit_count == 32 ? GL_BGRA : GL_BGR;
+    info.has_alpha = bit_count == 32 && header_size >= 56 && size >= 70 && read_u32(data + 66) != 0;
+    info.rle = false;
+    return true;
+}
+
+static bool decode_bmp(const unsigned char * data, size_t size, unsigned char * dst, size_t dst_pitch, image_info &info)
+{
+    size_t pixel_offset;
+    bool top_down;
+    if (!parse_bmp(data, size, info, pixel_offset, top_down))
+        return false;
+
+    // Rows are padded to 4 bytes on disk.
+    size_t row_bytes = (size_t)info.width * info.bytes_per_pixel;
+    size_t src_pitch = (row_bytes + 3) & ~(size_t)3;
+    if (pixel_offset > size || (size - pixel_offset) < src_pitch * (info.height - 1) + row_bytes)
+        return false;
+
+    const unsigned char * src = data + pixel_offset;
+    for (int row = 0; row < info.height; row++, src += src_pitch)
     {
-        fread(data, width * height, size, f);
+        int y = top_down ? info.height - 1 - row : row;
+        memcpy(dst + y * dst_pitch, src, row_bytes);
     }
+    return true;
+}
 
-    fclose(f);
+static bool is_bmp(const unsigned char * data, size_t size)
+{
+    return size >= 2 && data[0] == 'B' && data[1] == 'M';
+}
 
+static bool query_mapped(const mapped_file &file, image_info &info)
+{
+    if (!file.data)
+        return false;
+
+    if (is_bmp(file.data, file.size))
+    {
+        size_t pixel_offset;
+        bool top_down;
+        return parse_bmp(file.data, file.size, info, pixel_offset, top_down);
+    }
+
+    targa_header header;
+    return parse_targa(file.data, file.size, header, info);
+}
+
+static bool decode_mapped(const mapped_file &file, unsigned char * dst, size_t dst_size, size_t dst_pitch, image_info &info)
+{
+    if (!query_mapped(file, info))
+        return false;
+
+    size_t row_bytes = (size_t)info.width * info.bytes_per_pixel;
+    if (dst_pitch == 0)
+        dst_pitch = row_bytes;
+    if (dst_pitch < row_bytes || dst_size < dst_pitch * (info.height - 1) + row_bytes)
+        return false;
+
+    return is_bmp(file.data, file.size) ? decode_bmp(file.data, file.size, dst, dst_pitch, info)
+                                        : decode_targa(file.data, file.size, dst, dst_pitch, info);
+}
+
+bool query_image(const char * filename, image_info &info)
+{
+    mapped_file file(filename);
+    return query_mapped(file, info);
+}
+
+bool load_image_into(const char * filename, unsigned char * dst, size_t dst_size, size_t dst_pitch, image_info &info)
+{
+    mapped_file file(filename);
+    return decode_mapped(file, dst, dst_size, dst_pitch, info);
+}
+
+static unsigned char * load_allocated(const char * filename, GLenum &format, int &width, int &height)
+{
+    mapped_file file(filename);
+    image_info info;
+    if (!query_mapped(file, info))
+        return 0;
+
+    size_t bytes = (size_t)info.width * info.height * info.bytes_per_pixel;
+    unsigned char * data = new unsigned char [bytes];
+    if (!decode_mapped(file, data, bytes, 0, info))
+    {
+        delete [] data;
+        return 0;
+    }
+
+    format = info.format;
+    width = info.width;
+    height = info.height;
     return data;
 }
 
+unsigned char * load_targa(const char * filename, GLenum &format, int &width, int &height)
+{
+    return load_allocated(filename, format, width, height);
+}
+
+unsigned char * load_bmp(const char * filename, GLenum &format, int &width, int &height)
+{
+    return load_allocated(filename, format, width, height);
+}
+
 }
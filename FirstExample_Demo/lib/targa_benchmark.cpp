@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "vgl.h"
+#include "targa.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace vtarga
+{
+
+typedef std::chrono::high_resolution_clock benchmark_clock;
+
+// Runs decode until at least a fifth of a second has gone by, then returns the
+// average seconds per call, or a negative number if decode failed.
+template<class Decode>
+static double time_decode(Decode decode)
+{
+    int runs = 0;
+    double seconds = 0.0;
+    benchmark_clock::time_point start = benchmark_clock::now();
+    do
+    {
+        if (!decode())
+            return -1.0;
+        runs++;
+        seconds = std::chrono::duration<double>(benchmark_clock::now() - start).count();
+    } while (seconds < 0.2 || runs < 3);
+    return seconds / runs;
+}
+
+// Writes pixels (bottom-up, BGR or BGRA) as an RLE .tga, packets never crossing a row.
+static bool write_rle_targa(const char * filename, const unsigned char * pixels, const image_info &info)
+{
+    FILE * file = fopen(filename, "wb");
+    if (!file)
+        return false;
+
+    const int size = info.bytes_per_pixel;
+    unsigned char header[18] = { 0 };
+    header[2] = size == 1 ? 11 : 10;
+    header[12] = (unsigned char)(info.width & 0xFF);
+    header[13] = (unsigned char)(info.width >> 8);
+    header[14] = (unsigned char)(info.height & 0xFF);
+    header[15] = (unsigned char)(info.height >> 8);
+    header[16] = (unsigned char)(size * 8);
+    header[17] = size == 4 ? 8 : 0;
+    fwrite(header, 1, sizeof(header), file);
+
+    std::vector<unsigned char> packets;
+    for (int y = 0; y < info.height; y++)
+    {
+        const unsigned char * row = pixels + (size_t)y * info.width * size;
+        int x = 0;
+        while (x < info.width)
+        {
+            // A run of at least two equal pixels, otherwise literals up to the next run.
+            int run = 1;
+            while (x + run < info.width && run < 128 && !memcmp(row + (size_t)(x + run) * size, row + (size_t)x * size, size))
+                run++;
+            if (run > 1)
+            {
+                packets.push_back((unsigned char)(0x80 | (run - 1)));
+                packets.insert(packets.end(), row + (size_t)x * size, row + (size_t)(x + 1) * size);
+                x += run;
+                continue;
+            }
+            int literal = 1;
+            while (x + literal < info.width && literal < 128 &&
+                   (x + literal + 1 >= info.width ||
+                    memcmp(row + (size_t)(x + literal) * size, row + (size_t)(x + literal + 1) * size, size)))
+                literal++;
+            packets.push_back((unsigned char)(literal - 1));
+            packets.insert(packets.end(), row + (size_t)x * size, row + (size_t)(x + literal) * size);
+            x += literal;
+        }
+    }
+    bool written = fwrite(packets.data(), 1, packets.size(), file) == packets.size();
+    return fclose(file) == 0 && written;
+}
+
+// stb_image hands back RGB(A) top row first unless told otherwise; flipping is
+// asked for up front, so only the red and blue bytes need swapping to compare.
+static bool same_pixels(const unsigned char * ours, const unsigned char * stb, const image_info &info)
+{
+    const int size = info.bytes_per_pixel;
+    const size_t count = (size_t)info.width * info.height;
+    for (size_t i = 0; i < count; i++, ours += size, stb += size)
+    {
+        if (size >= 3 && (ours[0] != stb[2] || ours[1] != stb[1] || ours[2] != stb[0] || (size == 4 && ours[3] != stb[3])))
+            return false;
+        if (size < 3 && memcmp(ours, stb, size))
+            return false;
+    }
+    return true;
+}
+
+// One file, both decoders. Adds the decoded bytes and seconds to the totals.
+static void benchmark_file(const char * filename, const char * label, double totals[3])
+{
+    image_info info;
+    if (!query_image(filename, info))
+    {
+        printf("%-28s not a .tga or .bmp this decoder reads, skipped\n", label);
+        return;
+    }
+    const size_t bytes = (size_t)info.width * info.height * info.bytes_per_pixel;
+    std::vector<unsigned char> pixels(bytes);
+
+    double ours = time_decode([&]() { return load_image_into(filename, pixels.data(), bytes, 0, info); });
+    std::vector<unsigned char> theirs;
+    double stb = time_decode([&]()
+    {
+        int width, height, channels;
+        unsigned char * data = stbi_load(filename, &width, &height, &channels, info.bytes_per_pixel);
+        if (!data)
+            return false;
+        theirs.assign(data, data + bytes);
+        stbi_image_free(data);
+        return width == info.width && height == info.height;
+    });
+    if (ours < 0.0 || stb < 0.0)
+    {
+        printf("%-28s %s failed to decode it\n", label, ours < 0.0 ? "vtarga" : "stb_image");
+        return;
+    }
+
+    const double megabytes = bytes / (1024.0 * 1024.0);
+    printf("%-28s %5d x %-5d %d bpp  vtarga %8.1f MB/s  stb_image %8.1f MB/s  %5.2fx  %s\n",
+           label, info.width, info.height, info.bytes_per_pixel * 8, megabytes / ours, megabytes / stb, stb / ours,
+           same_pixels(pixels.data(), theirs.data(), info) ? "same pixels" : "PIXELS DIFFER");
+    totals[0] += megabytes;
+    totals[1] += ours;
+    totals[2] += stb;
+}
+
+void benchmark(const char * const * filenames, int count, const char * scratch_file)
+{
+    stbi_set_flip_vertically_on_load(1);
+    double files[3] = { 0.0, 0.0, 0.0 }, rle[3] = { 0.0, 0.0, 0.0 };
+    for (int i = 0; i < count; i++)
+    {
+        const char * name = strrchr(filenames[i], '/');
+        name = name ? name + 1 : filenames[i];
+        benchmark_file(filenames[i], name, files);
+
+        // The same pixels again as an RLE .tga, the path a .bmp never takes.
+        image_info info;
+        if (!query_image(filenames[i], info))
+            continue;
+        std::vector<unsigned char> pixels((size_t)info.width * info.height * info.bytes_per_pixel);
+        if (!load_image_into(filenames[i], pixels.data(), pixels.size(), 0, info) || !write_rle_targa(scratch_file, pixels.data(), info))
+            continue;
+        benchmark_file(scratch_file, "  as RLE .tga", rle);
+    }
+    remove(scratch_file);
+
+    if (files[1] > 0.0)
+        printf("Files as they are: vtarga %.1f MB/s, stb_image %.1f MB/s\n", files[0] / files[1], files[0] / files[2]);
+    if (rle[1] > 0.0)
+        printf("As RLE .tga:       vtarga %.1f MB/s, stb_image %.1f MB/s\n", rle[0] / rle[1], rle[0] / rle[2]);
+}
+
+}
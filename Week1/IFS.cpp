@@ -0,0 +1,485 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include "IFS.h"
+#include "WorkerPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IFS_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(IFS_SSE2) && (defined(__SSE4_1__) || defined(__AVX__))
+#define IFS_SSE41 1
+#include <smmintrin.h>
+#endif
+
+using namespace std;
+
+//! Chains stepping side by side, i.e. two 4 wide registers.
+static const int IFS_CHAINS = 8;
+//! Points each chain writes. Longer chains spend less on burn-in, shorter ones split work finer.
+static const int IFS_CHAIN_LENGTH = 1024;
+//! Steps a chain takes before writing, so chains that start at the same point have spread out.
+static const int IFS_BURN_IN = 16;
+//! The step pair is the low bits of the hash counter, the chain the high bits.
+static const int IFS_STEP_BITS = 11;
+static const size_t GROUP_POINTS = (size_t)IFS_CHAINS * IFS_CHAIN_LENGTH;
+//! Groups handed to a thread at a time.
+static const size_t GROUPS_PER_JOB = 4;
+
+//---------------------------------------------------------------------
+//
+// 4 wide float / int / mask types, the chain update below is written once against these.
+//
+#if defined(IFS_SSE2)
+struct F4 { __m128 v; };
+struct I4 { __m128i v; };
+struct M4 { __m128 v; };
+
+static inline F4 Set(float a) { return { _mm_set1_ps(a) }; }
+static inline I4 SetI(uint32_t a) { return { _mm_set1_epi32((int)a) }; }
+static inline I4 LanesI(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return { _mm_setr_epi32((int)a, (int)b, (int)c, (int)d) }; }
+static inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline M4 GreaterEqual(F4 a, F4 b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+//! Bitwise, for flipping coefficients: a ^ (m & b).
+static inline F4 XorMasked(F4 a, M4 m, F4 b) { return { _mm_xor_ps(a.v, _mm_and_ps(m.v, b.v)) }; }
+static inline F4 Xor(F4 a, F4 b) { return { _mm_xor_ps(a.v, b.v) }; }
+static inline F4 ToFloat(I4 a) { return { _mm_cvtepi32_ps(a.v) }; }
+static inline I4 operator+(I4 a, I4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+static inline I4 operator^(I4 a, I4 b) { return { _mm_xor_si128(a.v, b.v) }; }
+static inline I4 operator&(I4 a, I4 b) { return { _mm_and_si128(a.v, b.v) }; }
+static inline I4 operator>>(I4 a, int n) { return { _mm_srli_epi32(a.v, n) }; }
+static inline I4 operator*(I4 a, I4 b)
+{
+#if defined(IFS_SSE41)
+    return { _mm_mullo_epi32(a.v, b.v) };
+#else
+    // SSE2 only multiplies lanes 0 and 2, do the odd lanes shifted down and interleave.
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+    return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+#endif
+}
+static inline void Store(F4 a, float* dst) { _mm_storeu_ps(dst, a.v); }
+#else
+struct F4 { float v[4]; };
+struct I4 { uint32_t v[4]; };
+struct M4 { bool v[4]; };
+
+#define IFS_LANES(expr) for (int k = 0; k < 4; k++) r.v[k] = expr; return r
+static inline F4 Set(float a) { return { { a, a, a, a } }; }
+static inline I4 SetI(uint32_t a) { return { { a, a, a, a } }; }
+static inline I4 LanesI(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return { { a, b, c, d } }; }
+static inline F4 operator+(F4 a, F4 b) { F4 r; IFS_LANES(a.v[k] + b.v[k]); }
+static inline F4 operator*(F4 a, F4 b) { F4 r; IFS_LANES(a.v[k] * b.v[k]); }
+static inline M4 GreaterEqual(F4 a, F4 b) { M4 r; IFS_LANES(a.v[k] >= b.v[k]); }
+static inline float XorBits(float a, float b)
+{
+    uint32_t x, y;
+    memcpy(&x, &a, 4);
+    memcpy(&y, &b, 4);
+    x ^= y;
+    memcpy(&a, &x, 4);
+    return a;
+}
+static inline F4 XorMasked(F4 a, M4 m, F4 b) { F4 r; IFS_LANES(m.v[k] ? XorBits(a.v[k], b.v[k]) : a.v[k]); }
+static inline F4 Xor(F4 a, F4 b) { F4 r; IFS_LANES(XorBits(a.v[k], b.v[k])); }
+static inline F4 ToFloat(I4 a) { F4 r; IFS_LANES((float)(int32_t)a.v[k]); }
+static inline I4 operator+(I4 a, I4 b) { I4 r; IFS_LANES(a.v[k] + b.v[k]); }
+static inline I4 operator^(I4 a, I4 b) { I4 r; IFS_LANES(a.v[k] ^ b.v[k]); }
+static inline I4 operator&(I4 a, I4 b) { I4 r; IFS_LANES(a.v[k] & b.v[k]); }
+static inline I4 operator>>(I4 a, int n) { I4 r; IFS_LANES(a.v[k] >> n); }
+static inline I4 operator*(I4 a, I4 b) { I4 r; IFS_LANES(a.v[k] * b.v[k]); }
+static inline void Store(F4 a, float* dst) { memcpy(dst, a.v, 16); }
+#undef IFS_LANES
+#endif
+
+//! Counter based random numbers: one integer hash of (chain, step pair) mixed with the seed, nothing carried
+//! between steps. Each hash picks the maps of two steps, 16 bits each.
+static inline I4 Hash(I4 counter, I4 key)
+{
+    I4 h = counter ^ key;
+    h = h ^ (h >> 16);
+    h = h * SetI(0x7feb352du);
+    h = h ^ (h >> 15);
+    h = h * SetI(0x846ca68bu);
+    return h ^ (h >> 16);
+}
+
+static uint32_t HashSeed(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    return x ^ (x >> 16);
+}
+
+//---------------------------------------------------------------------
+//
+// Tables
+//
+IFSTable IFSCorners(const float (*corners)[3], const float (*colors)[3], int count, float ratio)
+{
+    IFSTable table;
+    for (int i = 0; i < count; i++)
+    {
+        IFSMap map = {};
+        for (int r = 0; r < 3; r++)
+        {
+            map.m[r][r] = 1.0f - ratio;
+            map.t[r] = ratio * corners[i][r];
+            map.color[r] = colors ? colors[i][r] : 1.0f;
+        }
+        map.weight = 1.0f;
+        table.maps.push_back(map);
+    }
+    return table;
+}
+
+IFSTable IFSSierpinski()
+{
+    const float corners[3][3] = { { -1.0f, -1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, -1.0f, 0.0f } };
+    const float colors[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+    return IFSCorners(corners, colors, 3);
+}
+
+IFSTable IFSTetrahedron()
+{
+    const float corners[4][3] = { { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.0f, 0.5f, 0.0f }, { 0.0f, -0.5f, 0.5f } };
+    const float colors[4][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f } };
+    return IFSCorners(corners, colors, 4);
+}
+
+IFSTable IFSBarnsleyFern()
+{
+    // Barnsley's coefficients, the fern spans x -2.2 to 2.7 and y 0 to 10.
+    const float coef[4][7] = {
+        { 0.00f, 0.00f, 0.00f, 0.16f, 0.0f, 0.00f, 0.01f },
+        { 0.85f, 0.04f, -0.04f, 0.85f, 0.0f, 1.60f, 0.85f },
+        { 0.20f, -0.26f, 0.23f, 0.22f, 0.0f, 1.60f, 0.07f },
+        { -0.15f, 0.28f, 0.26f, 0.24f, 0.0f, 0.44f, 0.07f }
+    };
+    const float colors[4][3] = { { 0.4f, 0.3f, 0.1f }, { 0.2f, 0.8f, 0.2f }, { 0.1f, 0.6f, 0.1f }, { 0.3f, 0.7f, 0.1f } };
+    // Map to [-1, 1] with p -> s * (p - c). A uniform scale commutes with the linear part,
+    // so only the translation changes: t' = s * t + (I - m) * (-s * c).
+    const float s = 0.19f, cx = 0.24f, cy = 5.0f;
+    IFSTable table;
+    for (int i = 0; i < 4; i++)
+    {
+        IFSMap map = {};
+        map.m[0][0] = coef[i][0]; map.m[0][1] = coef[i][1];
+        map.m[1][0] = coef[i][2]; map.m[1][1] = coef[i][3];
+        const float bx = -s * cx, by = -s * cy;
+        map.t[0] = s * coef[i][4] + bx - (map.m[0][0] * bx + map.m[0][1] * by);
+        map.t[1] = s * coef[i][5] + by - (map.m[1][0] * bx + map.m[1][1] * by);
+        map.weight = coef[i][6];
+        memcpy(map.color, colors[i], sizeof(map.color));
+        table.maps.push_back(map);
+    }
+    return table;
+}
+
+IFSOutput IFSOutput::Interleaved(float* dst, int positionComponents, bool color)
+{
+    IFSOutput out;
+    out.x = dst;
+    out.y = dst + 1;
+    out.z = positionComponents > 2 ? dst + 2 : nullptr;
+    if (color)
+    {
+        out.r = dst + positionComponents;
+        out.g = dst + positionComponents + 1;
+        out.b = dst + positionComponents + 2;
+    }
+    out.stride = positionComponents + (color ? 3 : 0);
+    return out;
+}
+
+//---------------------------------------------------------------------
+//
+// Generation
+//
+namespace
+{
+// Map coefficients in the order the chain update reads them.
+enum { C_M00, C_M01, C_M02, C_M10, C_M11, C_M12, C_M20, C_M21, C_M22, C_TX, C_TY, C_TZ, C_R, C_G, C_B, C_COUNT };
+
+struct Prepared
+{
+    int count;
+    float threshold[IFS_MAX_MAPS];   // Map k is picked when threshold[k - 1] <= u < threshold[k].
+    float coef[IFS_MAX_MAPS][C_COUNT];
+    float start[3];
+    bool flat;                       // Every map keeps z at 0 and ignores it.
+    uint32_t key;
+};
+}
+
+static bool Prepare(const IFSTable& table, unsigned seed, Prepared& p)
+{
+    p.count = (int)table.maps.size();
+    if (p.count == 0 || p.count > IFS_MAX_MAPS)
+        return false;
+    float total = 0.0f;
+    for (const IFSMap& map : table.maps)
+        total += max(map.weight, 0.0f);
+    if (!(total > 0.0f))
+        return false;
+
+    float sum = 0.0f;
+    int heaviest = 0;
+    p.flat = true;
+    for (int k = 0; k < p.count; k++)
+    {
+        const IFSMap& map = table.maps[k];
+        sum += max(map.weight, 0.0f);
+        p.threshold[k] = k == p.count - 1 ? 2.0f : sum / total;
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 3; c++)
+                p.coef[k][C_M00 + r * 3 + c] = map.m[r][c];
+            p.coef[k][C_TX + r] = map.t[r];
+            p.coef[k][C_R + r] = map.color[r];
+        }
+        p.flat = p.flat && map.m[0][2] == 0.0f && map.m[1][2] == 0.0f && map.t[2] == 0.0f &&
+                 map.m[2][0] == 0.0f && map.m[2][1] == 0.0f && map.m[2][2] == 0.0f;
+        if (map.weight > table.maps[heaviest].weight)
+            heaviest = k;
+    }
+
+    // Chains start at the fixed point of the most likely map, which lies on the attractor,
+    // so even the burn-in never wanders off it. Solve (I - m) p = t with Cramer's rule.
+    const IFSMap& map = table.maps[heaviest];
+    float a[3][3];
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            a[r][c] = (r == c ? 1.0f : 0.0f) - map.m[r][c];
+    float det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+                a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+                a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+    for (int i = 0; i < 3; i++)
+    {
+        if (fabs(det) < 1e-12f)
+        {
+            p.start[i] = 0.0f;
+            continue;
+        }
+        float b[3][3];
+        memcpy(b, a, sizeof(b));
+        for (int r = 0; r < 3; r++)
+            b[r][i] = map.t[r];
+        p.start[i] = (b[0][0] * (b[1][1] * b[2][2] - b[1][2] * b[2][1]) -
+                      b[0][1] * (b[1][0] * b[2][2] - b[1][2] * b[2][0]) +
+                      b[0][2] * (b[1][0] * b[2][1] - b[1][1] * b[2][0])) / det;
+    }
+    if (p.flat)
+        p.start[2] = 0.0f;
+
+    p.key = HashSeed(seed * 0x9e3779b9u + 0x632be5abu);
+    return true;
+}
+
+/// @brief Points [from, to) of one step into interleaved memory, one point after the other in address
+/// order, which is what a write combined (mapped) buffer wants.
+template <int N>
+static inline void WriteDense(float* dst, const float (*values)[IFS_CHAINS], const int* component, size_t from, size_t to)
+{
+    for (size_t lane = from; lane < to; lane++)
+        for (int i = 0; i < N; i++)
+            dst[lane * N + i] = values[component[i]][lane];
+}
+
+/// @brief Steps the 8 chains of one group and writes the points with group relative index in [lo, hi).
+/// FLAT skips the z row, which halves the work for 2D tables.
+template <bool FLAT>
+static void RunGroup(const Prepared& p, const F4 (*coef)[C_COUNT], size_t group, size_t lo, size_t hi, const IFSOutput& out)
+{
+    const size_t base = group * GROUP_POINTS;
+    const uint32_t chain = (uint32_t)(group * IFS_CHAINS);
+    const I4 key = SetI(p.key);
+    I4 counter[2] = {
+        LanesI(chain << IFS_STEP_BITS, (chain + 1) << IFS_STEP_BITS, (chain + 2) << IFS_STEP_BITS, (chain + 3) << IFS_STEP_BITS),
+        LanesI((chain + 4) << IFS_STEP_BITS, (chain + 5) << IFS_STEP_BITS, (chain + 6) << IFS_STEP_BITS, (chain + 7) << IFS_STEP_BITS)
+    };
+    F4 x[2] = { Set(p.start[0]), Set(p.start[0]) };
+    F4 y[2] = { Set(p.start[1]), Set(p.start[1]) };
+    F4 z[2] = { Set(p.start[2]), Set(p.start[2]) };
+    F4 threshold[IFS_MAX_MAPS];
+    for (int k = 0; k < p.count; k++)
+        threshold[k] = Set(p.threshold[k]);
+
+    // Only the components that are asked for.
+    const size_t stride = out.stride;
+    float* const all[6] = { out.x, out.y, out.z, out.r, out.g, out.b };
+    float* dst[6];
+    int component[6], outputs = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        if (all[i])
+        {
+            dst[outputs] = all[i];
+            component[outputs++] = i;
+        }
+    }
+    // Interleaved output with nothing in between the components is written as one run.
+    int dense = outputs == (int)stride ? outputs : 0;
+    for (int i = 1; i < outputs; i++)
+        if (dst[i] != dst[0] + i)
+            dense = 0;
+
+    const int steps = IFS_BURN_IN + (int)((hi - 1) / IFS_CHAINS) + 1;
+    I4 bits[2];
+    for (int step = 0; step < steps; step++)
+    {
+        F4 color[2][3];
+        for (int h = 0; h < 2; h++)
+        {
+            F4 u;
+            if ((step & 1) == 0)
+            {
+                bits[h] = Hash(counter[h], key);
+                counter[h] = counter[h] + SetI(1);
+                u = ToFloat(bits[h] >> 16) * Set(1.0f / 65536.0f);
+            }
+            else
+                u = ToFloat(bits[h] & SetI(0xFFFF)) * Set(1.0f / 65536.0f);
+
+            // Pick the map per lane. coef[k] holds the bits that turn map k - 1 into map k,
+            // so flipping them wherever u has passed threshold k - 1 leaves each lane with its map.
+            F4 c[C_COUNT];
+            c[C_M00] = coef[0][C_M00]; c[C_M01] = coef[0][C_M01]; c[C_TX] = coef[0][C_TX];
+            c[C_M10] = coef[0][C_M10]; c[C_M11] = coef[0][C_M11]; c[C_TY] = coef[0][C_TY];
+            c[C_R] = coef[0][C_R]; c[C_G] = coef[0][C_G]; c[C_B] = coef[0][C_B];
+            if (!FLAT)
+            {
+                c[C_M02] = coef[0][C_M02]; c[C_M12] = coef[0][C_M12];
+                c[C_M20] = coef[0][C_M20]; c[C_M21] = coef[0][C_M21]; c[C_M22] = coef[0][C_M22]; c[C_TZ] = coef[0][C_TZ];
+            }
+            for (int k = 1; k < p.count; k++)
+            {
+                // Spelled out rather than looped so the coefficients stay in registers.
+                const M4 passed = GreaterEqual(u, threshold[k - 1]);
+                const F4* flip = coef[k];
+                c[C_M00] = XorMasked(c[C_M00], passed, flip[C_M00]);
+                c[C_M01] = XorMasked(c[C_M01], passed, flip[C_M01]);
+                c[C_TX] = XorMasked(c[C_TX], passed, flip[C_TX]);
+                c[C_M10] = XorMasked(c[C_M10], passed, flip[C_M10]);
+                c[C_M11] = XorMasked(c[C_M11], passed, flip[C_M11]);
+                c[C_TY] = XorMasked(c[C_TY], passed, flip[C_TY]);
+                c[C_R] = XorMasked(c[C_R], passed, flip[C_R]);
+                c[C_G] = XorMasked(c[C_G], passed, flip[C_G]);
+                c[C_B] = XorMasked(c[C_B], passed, flip[C_B]);
+                if (!FLAT)
+                {
+                    c[C_M02] = XorMasked(c[C_M02], passed, flip[C_M02]);
+                    c[C_M12] = XorMasked(c[C_M12], passed, flip[C_M12]);
+                    c[C_M20] = XorMasked(c[C_M20], passed, flip[C_M20]);
+                    c[C_M21] = XorMasked(c[C_M21], passed, flip[C_M21]);
+                    c[C_M22] = XorMasked(c[C_M22], passed, flip[C_M22]);
+                    c[C_TZ] = XorMasked(c[C_TZ], passed, flip[C_TZ]);
+                }
+            }
+
+            if (FLAT)
+            {
+                F4 nx = c[C_M00] * x[h] + c[C_M01] * y[h] + c[C_TX];
+                F4 ny = c[C_M10] * x[h] + c[C_M11] * y[h] + c[C_TY];
+                x[h] = nx;
+                y[h] = ny;
+            }
+            else
+            {
+                F4 nx = c[C_M00] * x[h] + c[C_M01] * y[h] + c[C_M02] * z[h] + c[C_TX];
+                F4 ny = c[C_M10] * x[h] + c[C_M11] * y[h] + c[C_M12] * z[h] + c[C_TY];
+                F4 nz = c[C_M20] * x[h] + c[C_M21] * y[h] + c[C_M22] * z[h] + c[C_TZ];
+                x[h] = nx;
+                y[h] = ny;
+                z[h] = nz;
+            }
+            color[h][0] = c[C_R];
+            color[h][1] = c[C_G];
+            color[h][2] = c[C_B];
+        }
+        if (step < IFS_BURN_IN)
+            continue;
+
+        // Point index within the group is step * 8 + chain.
+        const size_t first = (size_t)(step - IFS_BURN_IN) * IFS_CHAINS;
+        const size_t from = max(first, lo) - first, to = min(first + IFS_CHAINS, hi) - first;
+        if (from >= to)
+            continue;
+        float values[6][IFS_CHAINS];
+        for (int h = 0; h < 2; h++)
+        {
+            Store(x[h], values[0] + h * 4);
+            Store(y[h], values[1] + h * 4);
+            Store(z[h], values[2] + h * 4);
+            Store(color[h][0], values[3] + h * 4);
+            Store(color[h][1], values[4] + h * 4);
+            Store(color[h][2], values[5] + h * 4);
+        }
+        const size_t offset = (base + first) * stride;
+        switch (dense)
+        {
+        case 2: WriteDense<2>(dst[0] + offset, values, component, from, to); break;
+        case 3: WriteDense<3>(dst[0] + offset, values, component, from, to); break;
+        case 5: WriteDense<5>(dst[0] + offset, values, component, from, to); break;
+        case 6: WriteDense<6>(dst[0] + offset, values, component, from, to); break;
+        default:
+            for (int i = 0; i < outputs; i++)
+                for (size_t lane = from; lane < to; lane++)
+                    dst[i][offset + lane * stride] = values[component[i]][lane];
+        }
+    }
+}
+
+bool GenerateIFS(const IFSTable& table, unsigned seed, size_t first, size_t count, const IFSOutput& out, int threads)
+{
+    Prepared p;
+    if (!Prepare(table, seed, p))
+        return false;
+    if (count == 0)
+        return true;
+
+    // Map 0 as is, then the difference in bits from each map to the next.
+    F4 coef[IFS_MAX_MAPS][C_COUNT];
+    for (int k = 0; k < p.count; k++)
+        for (int j = 0; j < C_COUNT; j++)
+            coef[k][j] = k == 0 ? Set(p.coef[0][j]) : Xor(Set(p.coef[k][j]), Set(p.coef[k - 1][j]));
+
+    const size_t end = first + count;
+    const size_t firstGroup = first / GROUP_POINTS, lastGroup = (end - 1) / GROUP_POINTS;
+    const size_t groups = lastGroup - firstGroup + 1;
+    const int jobs = (int)((groups + GROUPS_PER_JOB - 1) / GROUPS_PER_JOB);
+    function<void(int)> job = [&](int index) {
+        size_t g0 = firstGroup + (size_t)index * GROUPS_PER_JOB;
+        size_t g1 = min(g0 + GROUPS_PER_JOB, lastGroup + 1);
+        for (size_t g = g0; g < g1; g++)
+        {
+            size_t lo = g == firstGroup ? first - g * GROUP_POINTS : 0;
+            size_t hi = g == lastGroup ? end - g * GROUP_POINTS : GROUP_POINTS;
+            if (p.flat)
+                RunGroup<true>(p, coef, g, lo, hi, out);
+            else
+                RunGroup<false>(p, coef, g, lo, hi, out);
+        }
+    };
+
+    WorkerPool::Shared().Run(jobs, job, threads <= 0 ? -1 : threads - 1);
+    return true;
+}
+
+const char* IFSPath()
+{
+#if defined(IFS_SSE41)
+    return "SSE4.1";
+#elif defined(IFS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
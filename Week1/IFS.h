@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/// @file IFS.h
+/// @brief Chaos game point generator for iterated function systems (Sierpinski triangle and
+/// tetrahedron, Barnsley fern, or any table of affine maps).
+/// Instead of one long chain where every point waits for the previous one, points come from many
+/// short independent chains: 8 chains step side by side (two SSE2 registers), groups of 8 chains
+/// are spread over all cores, and the map picked at each step is a hash of (seed, chain, step).
+/// Point i is therefore the same for a given table and seed no matter how many threads or which
+/// code path produced it, and any range of points can be generated on its own.
+
+//! Most maps a table can have.
+const int IFS_MAX_MAPS = 16;
+
+/// @brief One affine map p' = m * p + t.
+struct IFSMap
+{
+    float m[3][3];      // Rows give x', y' and z'.
+    float t[3];
+    float weight;       // Relative chance of picking this map.
+    float color[3];     // Color of the points this map produces.
+};
+
+struct IFSTable
+{
+    std::vector<IFSMap> maps;
+};
+
+//! For each corner, p' = p + ratio * (corner - p): the classic "move halfway to a random vertex".
+IFSTable IFSCorners(const float (*corners)[3], const float (*colors)[3], int count, float ratio = 0.5f);
+//! Triangle (-1, -1), (0, 1), (1, -1) in red, green and blue.
+IFSTable IFSSierpinski();
+//! Tetrahedron of the Week 2 demos, one color per corner.
+IFSTable IFSTetrahedron();
+//! Barnsley's fern scaled to fit [-1, 1] in x and y.
+IFSTable IFSBarnsleyFern();
+
+/// @brief Where generated points go. Point i writes x[i * stride], y[i * stride] and so on;
+/// a null pointer skips that component. stride is in floats.
+/// @note: x = dst, y = dst + 1, ... with stride 6 is an interleaved x y z r g b buffer,
+/// separate arrays with stride 1 are a structure of arrays.
+struct IFSOutput
+{
+    float* x = nullptr;
+    float* y = nullptr;
+    float* z = nullptr;
+    float* r = nullptr;
+    float* g = nullptr;
+    float* b = nullptr;
+    size_t stride = 1;
+
+    //! Interleaved positions (2 or 3 floats) optionally followed by r g b.
+    static IFSOutput Interleaved(float* dst, int positionComponents, bool color);
+};
+
+/// @brief Writes points [first, first + count) to out, using threads threads (0 = all cores).
+/// out may point into a mapped buffer: every point is written exactly once and nothing is read back.
+/// Returns false if the table is empty, has more than IFS_MAX_MAPS maps or no positive weight.
+bool GenerateIFS(const IFSTable& table, unsigned seed, size_t first, size_t count, const IFSOutput& out, int threads = 0);
+
+//! Name of the code path compiled in ("SSE4.1", "SSE2" or "scalar").
+const char* IFSPath();
@@ -25,6 +25,7 @@ using namespace std;
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "IFS.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include <array>
@@ -65,11 +66,11 @@ void init(void)
 	glEnableVertexAttribArray(0);
 
 
-	// Select an arbitrary initial point inside of the triangle
-		vertices[0][0] = 0.25; 
-		vertices[0][1] = 0.50;
-		vertices1[0][0] = 0.25;
-		vertices1[0][1] = 0.50;
+	//// Select an arbitrary initial point inside of the triangle
+	//	vertices[0][0] = 0.25; 
+	//	vertices[0][1] = 0.50;
+	//	vertices1[0][0] = 0.25;
+	//	vertices1[0][1] = 0.50;
 
 	//// Specifiy the vertices for a triangle
 	//GLfloat points[3][2] = {
@@ -88,16 +89,23 @@ void init(void)
 	//}
 
 	//using glm and array - this does exactly the samething as above
-	std::array<glm::vec2, 3> points1 ={ glm::vec2(-1.0, -1.0), glm::vec2(0.0, 1.0), glm::vec2(1.0, -1.0) };
+	//std::array<glm::vec2, 3> points1 ={ glm::vec2(-1.0, -1.0), glm::vec2(0.0, 1.0), glm::vec2(1.0, -1.0) };
 
-	//// compute and store N-1 new points
-	for (int i = 1; i < NumVertices; ++i) {
-		int j = (int)(rand() % 3);   // pick a vertex at random
-		vertices1[i] = (vertices1[i - 1] + points1[j]) / 2.0f;
-		
-		vertices[i][0] = vertices1[i][0];
-		vertices[i][1] = vertices1[i][1];
-	}
+	////// compute and store N-1 new points
+	//for (int i = 1; i < NumVertices; ++i) {
+	//	int j = (int)(rand() % 3);   // pick a vertex at random
+	//	vertices1[i] = (vertices1[i - 1] + points1[j]) / 2.0f;
+	//	
+	//	vertices[i][0] = vertices1[i][0];
+	//	vertices[i][1] = vertices1[i][1];
+	//}
+
+	//Each point above waits for the one before it. GenerateIFS plays the same game on many short
+	//chains at once, on all cores, and writes the points straight into the buffer object.
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), NULL, GL_STATIC_DRAW);
+	GLfloat* mapped = (GLfloat*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+	GenerateIFS(IFSSierpinski(), (unsigned)time(NULL), 0, NumVertices, IFSOutput::Interleaved(mapped, 2, false));
+	glUnmapBuffer(GL_ARRAY_BUFFER);
 
 }
 
@@ -116,8 +124,7 @@ display(void)
 	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
 
 
-	//Pushing the coordinates of the vertices into the buffer
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	//The coordinates of the vertices were pushed into the buffer once, in init
 
 	//Ordering the GPU to start the pipeline
 	glDrawArrays(GL_POINTS, 0, NumVertices);
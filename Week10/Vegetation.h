@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include "glm\glm.hpp"
+
+/// @file Vegetation.h
+/// @brief Hundreds of thousands of trees scattered over a field and drawn with two draw calls.
+/// Trees are scattered with a Poisson-disk sampler, so no two are closer than a given spacing and
+/// they neither clump nor line up, and are bucketed into square cells. Each frame the cells outside
+/// the view are skipped, the near ones are drawn as geometry (three crossed quads, which keep their
+/// shape when walked around) and the far ones as single camera-facing quads (impostors), which is a
+/// third of the triangles and all a tree a few pixels high needs. Both use the same instance buffer;
+/// the visible cells become commands of one glMultiDrawArraysIndirect per kind.
+/// The instance buffer is filled a few cells a frame as they first come into view, so neither
+/// scattering nor turning around costs a big upload.
+
+//! Points in [0, width) x [0, depth), none closer than radius to another (Bridson's algorithm,
+//! attempts tries around each point before it is given up on).
+std::vector<glm::vec2> PoissonDiskSample(float width, float depth, float radius, unsigned seed, int attempts = 30);
+
+//! The spacing that fills area with about count Poisson-disk points.
+float PoissonDiskRadius(float area, size_t count);
+
+/// @brief One tree, as the vertex shader reads it (locations 3 and 4, one per instance).
+struct VegetationInstance
+{
+    GLfloat x, y, z, scale;
+    GLfloat rotation;           // Around y, in radians.
+    GLfloat variant;            // Which tree of the texture, 0 or 1.
+};
+
+/// @brief The command glMultiDrawArraysIndirect reads, four GLuints.
+struct DrawArraysIndirectCommand
+{
+    GLuint count, instanceCount, first, baseInstance;
+};
+
+struct VegetationDesc
+{
+    float minX = -40.0f, minZ = -40.0f;     // The field.
+    float width = 80.0f, depth = 80.0f;
+    size_t count = 200000;                  // Roughly, the sampler decides the exact number.
+    float height = 1.5f;                    // Of an average tree, each is 0.7 - 1.3 of it.
+    float cellSize = 4.0f;
+    float nearDistance = 20.0f;             // Cells closer than this are drawn as geometry.
+    int uploadsPerFrame = 16;               // Cells copied into the instance buffer per frame.
+    unsigned seed = 1;
+};
+
+/// @brief Per frame numbers, see Vegetation::Stats.
+struct VegetationStats
+{
+    size_t instances = 0;
+    int cells = 0, visibleCells = 0, pendingCells = 0;  // Pending: visible, not uploaded yet.
+    size_t nearInstances = 0, farInstances = 0;
+    size_t triangles = 0;
+    int nearCommands = 0, farCommands = 0;
+    int uploadedCells = 0;                  // This frame.
+    double scatterMilliseconds = 0.0;
+    double cullMilliseconds = 0.0;
+    double frameMilliseconds = 0.0;         // Whole frame, as measured by the caller.
+
+    void Print(std::ostream& out) const;
+};
+
+class Vegetation
+{
+public:
+    Vegetation() {}
+    ~Vegetation();
+
+    //! Scatters the trees on the CPU, no GL calls, so the benchmark can run without a window.
+    void Scatter(const VegetationDesc& desc);
+    //! Shaders, texture (white is keyed out to transparent) and buffers. Call once GL is up.
+    bool Init(const std::string& textureFile);
+
+    //! Culls cells and builds the draw commands. CPU only.
+    void Cull(const glm::mat4& viewProjection, const glm::vec3& eye);
+    //! Uploads up to uploadsPerFrame newly visible cells, then draws. Leaves program 0 bound.
+    void Draw(const glm::mat4& viewProjection, const glm::vec3& eye);
+
+    const VegetationStats& Stats() const { return m_stats; }
+    VegetationStats& Stats() { return m_stats; }
+
+    //! Cull time against instance count for a camera flying over the field, printed to out.
+    static void Benchmark(std::ostream& out);
+
+private:
+    struct Cell
+    {
+        GLuint first = 0, count = 0;        // Range of m_instances.
+        glm::vec3 min, max;                 // Bounds of its trees.
+        bool resident = false;
+    };
+
+    VegetationDesc m_desc;
+    int m_columns = 0, m_rows = 0;
+    std::vector<VegetationInstance> m_instances;    // Sorted by cell.
+    std::vector<Cell> m_cells;
+    std::vector<int> m_pending;                     // Visible cells not in the buffer yet, nearest first.
+    std::vector<DrawArraysIndirectCommand> m_nearCommands, m_farCommands;
+    VegetationStats m_stats;
+
+    GLuint m_program = 0, m_texture = 0;
+    GLuint m_vao = 0, m_meshVbo = 0, m_instanceVbo = 0, m_indirect = 0;
+    size_t m_bufferInstances = 0;                   // What m_instanceVbo was made for.
+    GLint m_viewProjectionID = -1, m_eyeID = -1, m_billboardID = -1;
+};
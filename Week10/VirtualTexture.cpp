@@ -0,0 +1,800 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "VirtualTexture.h"
+#include "stb_image.h"
+using namespace std;
+
+// Page data can go past 2 GB for big terrains, so seek with 64 bit offsets.
+#ifdef _MSC_VER
+#define VT_SEEK _fseeki64
+#define VT_TELL _ftelli64
+#else
+#define VT_SEEK fseeko
+#define VT_TELL ftello
+#endif
+
+static bool IsPowerOfTwo(int64_t n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+//! Why a texture can't be stored as a .vtex file, or nullptr if it can.
+static const char* LayoutProblem(int64_t width, int64_t height, int64_t pageSize, int64_t border)
+{
+    if (pageSize <= 0 || width % pageSize != 0 || height % pageSize != 0 ||
+        !IsPowerOfTwo(width / pageSize) || !IsPowerOfTwo(height / pageSize))
+        return "its size must be the page size times a power of two";
+    if (width / pageSize > 256 || height / pageSize > 256)
+        return "it has more than 256 pages per side, the feedback format can't address them";
+    if (pageSize > 16384)
+        return "its pages are larger than any atlas could hold";
+    if (border < 0 || border > pageSize)
+        return "its border is wider than a page";
+    return nullptr;
+}
+
+//! Down to the level whose short side is one page, so no level is smaller than a page.
+static int LevelCount(int width, int height, int pageSize)
+{
+    int levels = 1;
+    while ((min(width, height) >> levels) >= pageSize)
+        levels++;
+    return levels;
+}
+
+uint64_t VTLayout::PageOffset(VTPageKey key) const
+{
+    uint64_t index = 0;
+    int level = PageLevel(key);
+    for (int l = 0; l < level; l++)
+        index += (uint64_t)PagesX(l) * PagesY(l);
+    index += (uint64_t)PageY(key) * PagesX(level) + PageX(key);
+    return sizeof(VTFileHeader) + index * PageBytes();
+}
+
+//---------------------------------------------------------------------
+//
+// .vtex builder
+//
+bool BuildVirtualTextureFile(const unsigned char* rgba, int width, int height, int pageSize, int border, const std::string& path)
+{
+    if (const char* problem = LayoutProblem(width, height, pageSize, border))
+    {
+        cout << "Can't build a " << width << "x" << height << " virtual texture of " << pageSize << " texel pages: " << problem << endl;
+        return false;
+    }
+
+    VTLayout layout;
+    layout.width = width;
+    layout.height = height;
+    layout.pageSize = pageSize;
+    layout.border = border;
+    layout.levels = LevelCount(width, height, pageSize);
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+
+    VTFileHeader header;
+    memcpy(header.magic, "VTX1", 4);
+    header.width = width;
+    header.height = height;
+    header.pageSize = pageSize;
+    header.border = border;
+    header.levels = layout.levels;
+    fwrite(&header, sizeof(header), 1, f);
+
+    vector<unsigned char> image(rgba, rgba + (size_t)width * height * 4);
+    vector<unsigned char> page(layout.PageBytes());
+    const int slot = layout.SlotSize();
+    int lw = width, lh = height;
+
+    for (int level = 0; level < layout.levels; level++)
+    {
+        for (int py = 0; py < layout.PagesY(level); py++)
+        {
+            for (int px = 0; px < layout.PagesX(level); px++)
+            {
+                // Clamp to the image edge for the border texels on the outside of the texture.
+                for (int j = 0; j < slot; j++)
+                {
+                    int sy = min(max(py * pageSize - border + j, 0), lh - 1);
+                    for (int i = 0; i < slot; i++)
+                    {
+                        int sx = min(max(px * pageSize - border + i, 0), lw - 1);
+                        memcpy(&page[((size_t)j * slot + i) * 4], &image[((size_t)sy * lw + sx) * 4], 4);
+                    }
+                }
+                fwrite(&page[0], 1, page.size(), f);
+            }
+        }
+
+        // 2x2 box filter down to the next level.
+        if (level + 1 < layout.levels)
+        {
+            int nw = lw / 2, nh = lh / 2;
+            vector<unsigned char> next((size_t)nw * nh * 4);
+            for (int y = 0; y < nh; y++)
+                for (int x = 0; x < nw; x++)
+                    for (int c = 0; c < 4; c++)
+                    {
+                        int sum = image[((size_t)(2 * y) * lw + 2 * x) * 4 + c] + image[((size_t)(2 * y) * lw + 2 * x + 1) * 4 + c] +
+                                  image[((size_t)(2 * y + 1) * lw + 2 * x) * 4 + c] + image[((size_t)(2 * y + 1) * lw + 2 * x + 1) * 4 + c];
+                        next[((size_t)y * nw + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                    }
+            image.swap(next);
+            lw = nw;
+            lh = nh;
+        }
+    }
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+bool BuildVirtualTextureFile(const std::string& imagePath, int pageSize, int border, const std::string& path)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* image = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
+    if (!image)
+    {
+        cout << "Unable to load file!" << stbi_failure_reason() << endl;
+        return false;
+    }
+    bool ok = BuildVirtualTextureFile(image, width, height, pageSize, border, path);
+    stbi_image_free(image);
+    return ok;
+}
+
+//---------------------------------------------------------------------
+//
+// VTFileReader
+//
+VTFileReader::~VTFileReader()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+bool VTFileReader::Open(const std::string& path)
+{
+    m_file = fopen(path.c_str(), "rb");
+    if (!m_file)
+        return false;
+
+    // Held to what BuildVirtualTextureFile writes, so a damaged file can't divide by a page size
+    // of zero later or send page offsets past its end.
+    VTFileHeader header;
+    const char* problem = nullptr;
+    if (fread(&header, sizeof(header), 1, m_file) != 1 || memcmp(header.magic, "VTX1", 4) != 0)
+        problem = "it isn't a .vtex file";
+    else
+        problem = LayoutProblem(header.width, header.height, header.pageSize, header.border);
+    if (!problem && header.levels != (uint32_t)LevelCount(header.width, header.height, header.pageSize))
+        problem = "its level count doesn't match its size";
+    if (!problem)
+    {
+        m_layout.width = header.width;
+        m_layout.height = header.height;
+        m_layout.pageSize = header.pageSize;
+        m_layout.border = header.border;
+        m_layout.levels = header.levels;
+        const int last = m_layout.levels - 1;
+        const uint64_t size = m_layout.PageOffset(MakePageKey(last, m_layout.PagesX(last) - 1, m_layout.PagesY(last) - 1)) + m_layout.PageBytes();
+        if (VT_SEEK(m_file, 0, SEEK_END) != 0 || VT_TELL(m_file) < (int64_t)size)
+            problem = "it is shorter than its pages";
+    }
+    if (problem)
+    {
+        cout << "Can't open virtual texture " << path << ": " << problem << endl;
+        fclose(m_file);
+        m_file = nullptr;
+        m_layout = VTLayout();
+        return false;
+    }
+    return true;
+}
+
+bool VTFileReader::ReadPage(VTPageKey key, unsigned char* dst)
+{
+    if (!m_file || !m_layout.Contains(key))
+        return false;
+    if (VT_SEEK(m_file, (int64_t)m_layout.PageOffset(key), SEEK_SET) != 0)
+        return false;
+    return fread(dst, 1, m_layout.PageBytes(), m_file) == m_layout.PageBytes();
+}
+
+//---------------------------------------------------------------------
+//
+// VTFeedbackAnalyzer
+//
+void VTFeedbackAnalyzer::Analyze(const unsigned char* feedback, size_t texelCount, const VTLayout& layout, std::vector<VTRequest>& requests)
+{
+    m_counts.clear();
+
+    // Neighbouring pixels nearly always ask for the same page, so skip the hash for runs.
+    VTPageKey last = 0;
+    int* lastCount = nullptr;
+    for (size_t i = 0; i < texelCount; i++)
+    {
+        const unsigned char* t = feedback + i * 4;
+        if (t[3] == 0)
+            continue;
+        VTPageKey key = MakePageKey(t[2], t[0], t[1]);
+        if (lastCount && key == last)
+        {
+            (*lastCount)++;
+            continue;
+        }
+        if (!layout.Contains(key))
+            continue;
+        lastCount = &m_counts[key];
+        (*lastCount)++;
+        last = key;
+    }
+
+    // Ancestors inherit the hits of their children, so coarse fallbacks rank above any single fine page.
+    requests.clear();
+    for (auto& entry : m_counts)
+        requests.push_back({ entry.first, entry.second });
+    size_t direct = requests.size();
+    for (size_t i = 0; i < direct; i++)
+    {
+        VTPageKey key = requests[i].key;
+        int level = PageLevel(key);
+        for (int l = level + 1; l < layout.levels; l++)
+        {
+            int shift = l - level;
+            m_counts[MakePageKey(l, PageX(key) >> shift, PageY(key) >> shift)] += requests[i].hits;
+        }
+    }
+    requests.clear();
+    for (auto& entry : m_counts)
+        requests.push_back({ entry.first, entry.second });
+}
+
+//---------------------------------------------------------------------
+//
+// VTPageCache
+//
+VTPageCache::VTPageCache(int slotsX, int slotsY)
+{
+    m_slotsX = slotsX;
+    m_slotsY = slotsY;
+    for (int slot = slotsX * slotsY - 1; slot >= 0; slot--)
+        m_freeSlots.push_back(slot);
+}
+
+int VTPageCache::Find(VTPageKey key) const
+{
+    auto found = m_lookup.find(key);
+    return found == m_lookup.end() ? -1 : found->second->slot;
+}
+
+void VTPageCache::Touch(VTPageKey key, unsigned frame)
+{
+    auto found = m_lookup.find(key);
+    if (found == m_lookup.end())
+        return;
+    found->second->lastUsed = frame;
+    m_lru.splice(m_lru.begin(), m_lru, found->second);
+}
+
+void VTPageCache::Pin(VTPageKey key)
+{
+    auto found = m_lookup.find(key);
+    if (found != m_lookup.end())
+        found->second->pinned = true;
+}
+
+int VTPageCache::Insert(VTPageKey key, unsigned frame, VTPageKey& evicted, bool& didEvict)
+{
+    didEvict = false;
+    auto found = m_lookup.find(key);
+    if (found != m_lookup.end())
+    {
+        Touch(key, frame);
+        return found->second->slot;
+    }
+
+    int slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        // Oldest first. Pages seen this frame are on screen, replacing one would just thrash.
+        auto victim = m_lru.end();
+        for (auto it = m_lru.rbegin(); it != m_lru.rend(); ++it)
+        {
+            if (!it->pinned && it->lastUsed != frame)
+            {
+                victim = std::prev(it.base());
+                break;
+            }
+        }
+        if (victim == m_lru.end())
+            return -1;
+        slot = victim->slot;
+        evicted = victim->key;
+        didEvict = true;
+        m_lookup.erase(victim->key);
+        m_lru.erase(victim);
+    }
+
+    m_lru.push_front({ key, slot, frame, false });
+    m_lookup[key] = m_lru.begin();
+    return slot;
+}
+
+//---------------------------------------------------------------------
+//
+// VTPageLoader
+//
+VTPageLoader::~VTPageLoader()
+{
+    Stop();
+}
+
+bool VTPageLoader::Start(const std::string& path)
+{
+    if (!m_reader.Open(path))
+        return false;
+    m_quit = false;
+    m_thread = std::thread(&VTPageLoader::Run, this);
+    return true;
+}
+
+void VTPageLoader::Stop()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void VTPageLoader::Request(VTPageKey key)
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.push_back(key);
+    }
+    m_wake.notify_one();
+}
+
+void VTPageLoader::CancelPending()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_queue.clear();
+}
+
+void VTPageLoader::Collect(std::vector<VTLoadedPage>& out)
+{
+    lock_guard<mutex> lock(m_mutex);
+    for (auto& page : m_done)
+        out.push_back(std::move(page));
+    m_done.clear();
+}
+
+size_t VTPageLoader::Pending()
+{
+    lock_guard<mutex> lock(m_mutex);
+    return m_queue.size();
+}
+
+void VTPageLoader::Run()
+{
+    for (;;)
+    {
+        VTPageKey key;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+            if (m_quit)
+                return;
+            key = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        VTLoadedPage page;
+        page.key = key;
+        page.pixels.resize(m_reader.Layout().PageBytes());
+        if (!m_reader.ReadPage(key, &page.pixels[0]))
+            page.pixels.clear(); // Still reported, so the key stops being "in flight".
+
+        lock_guard<mutex> lock(m_mutex);
+        m_done.push_back(std::move(page));
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// VirtualTextureSystem
+//
+VirtualTextureSystem::VirtualTextureSystem(int slotsX, int slotsY, int maxLoadsPerFrame, int maxUploadsPerFrame)
+    : m_cache(slotsX, slotsY)
+{
+    m_maxLoads = maxLoadsPerFrame;
+    m_maxUploads = maxUploadsPerFrame;
+}
+
+bool VirtualTextureSystem::Open(const std::string& path, std::vector<VTUpload>& initialUploads)
+{
+    if (!m_loader.Start(path))
+    {
+        cout << "Unable to open virtual texture " << path << endl;
+        return false;
+    }
+
+    const VTLayout& layout = Layout();
+    int top = layout.levels - 1;
+    if (layout.PagesX(top) * layout.PagesY(top) > m_cache.Capacity())
+    {
+        cout << "Virtual texture atlas can't even hold the coarsest level." << endl;
+        return false;
+    }
+
+    m_pageTable.resize(layout.levels);
+    for (int level = 0; level < layout.levels; level++)
+        m_pageTable[level].assign((size_t)layout.PagesX(level) * layout.PagesY(level) * 4, 0);
+
+    // The coarsest level is tiny and is the fallback for everything, so read it right now and keep it.
+    VTFileReader reader;
+    if (!reader.Open(path))
+        return false;
+    for (int y = 0; y < layout.PagesY(top); y++)
+    {
+        for (int x = 0; x < layout.PagesX(top); x++)
+        {
+            VTUpload upload;
+            upload.page.key = MakePageKey(top, x, y);
+            upload.page.pixels.resize(layout.PageBytes());
+            if (!reader.ReadPage(upload.page.key, &upload.page.pixels[0]))
+                return false;
+            VTPageKey evicted;
+            bool didEvict;
+            int slot = m_cache.Insert(upload.page.key, m_frame, evicted, didEvict);
+            m_cache.Pin(upload.page.key);
+            upload.slotX = slot % m_cache.SlotsX();
+            upload.slotY = slot / m_cache.SlotsX();
+            initialUploads.push_back(std::move(upload));
+        }
+    }
+    RebuildPageTable();
+    return true;
+}
+
+void VirtualTextureSystem::Close()
+{
+    m_loader.Stop();
+}
+
+void VirtualTextureSystem::ProcessFeedback(const unsigned char* feedback, size_t texelCount)
+{
+    m_analyzer.Analyze(feedback, texelCount, Layout(), m_requests);
+    m_stats.requested = m_requests.size();
+
+    // Coarse pages first: they cover more of the screen and are the fallback for the rest.
+    sort(m_requests.begin(), m_requests.end(), [](const VTRequest& a, const VTRequest& b) {
+        if (PageLevel(a.key) != PageLevel(b.key))
+            return PageLevel(a.key) > PageLevel(b.key);
+        return a.hits > b.hits;
+    });
+
+    // Touch everything already resident before loading, so new pages can't evict what's on screen.
+    for (const VTRequest& request : m_requests)
+        m_cache.Touch(request.key, m_frame);
+
+    for (const VTRequest& request : m_requests)
+    {
+        if (m_stats.loadsIssued >= m_maxLoads)
+            break;
+        if (m_cache.Find(request.key) >= 0 || m_inFlight.count(request.key))
+            continue;
+        m_loader.Request(request.key);
+        m_inFlight[request.key] = true;
+        m_stats.loadsIssued++;
+    }
+    m_stats.inFlight = m_inFlight.size();
+}
+
+void VirtualTextureSystem::Update(std::vector<VTUpload>& uploads)
+{
+    m_loader.Collect(m_loaded);
+
+    sort(m_loaded.begin(), m_loaded.end(), [](const VTLoadedPage& a, const VTLoadedPage& b) {
+        return PageLevel(a.key) > PageLevel(b.key);
+    });
+
+    size_t placed = 0;
+    for (; placed < m_loaded.size() && m_stats.uploads < m_maxUploads; placed++)
+    {
+        VTLoadedPage& page = m_loaded[placed];
+        m_inFlight.erase(page.key);
+        if (!page.pixels.empty() && Place(page, uploads))
+            m_stats.uploads++;
+    }
+    m_loaded.erase(m_loaded.begin(), m_loaded.begin() + placed);
+
+    if (m_tableDirty)
+        RebuildPageTable();
+    m_stats.resident = m_cache.Resident();
+    m_stats.inFlight = m_inFlight.size();
+}
+
+bool VirtualTextureSystem::Place(VTLoadedPage& page, std::vector<VTUpload>& uploads)
+{
+    VTPageKey evicted;
+    bool didEvict;
+    int slot = m_cache.Insert(page.key, m_frame, evicted, didEvict);
+    if (slot < 0)
+        return false; // Everything is on screen. It will be asked for again next frame.
+    if (didEvict)
+        m_stats.evictions++;
+
+    VTUpload upload;
+    upload.slotX = slot % m_cache.SlotsX();
+    upload.slotY = slot / m_cache.SlotsX();
+    upload.page = std::move(page);
+    uploads.push_back(std::move(upload));
+    m_tableDirty = true;
+    return true;
+}
+
+void VirtualTextureSystem::RebuildPageTable()
+{
+    const VTLayout& layout = Layout();
+    // Coarse to fine: a missing page points at whatever its parent points at.
+    for (int level = layout.levels - 1; level >= 0; level--)
+    {
+        vector<unsigned char>& table = m_pageTable[level];
+        int pagesX = layout.PagesX(level);
+        for (int y = 0; y < layout.PagesY(level); y++)
+        {
+            for (int x = 0; x < pagesX; x++)
+            {
+                unsigned char* texel = &table[((size_t)y * pagesX + x) * 4];
+                int slot = m_cache.Find(MakePageKey(level, x, y));
+                if (slot >= 0)
+                {
+                    texel[0] = (unsigned char)(slot % m_cache.SlotsX());
+                    texel[1] = (unsigned char)(slot / m_cache.SlotsX());
+                    texel[2] = (unsigned char)level;
+                    texel[3] = 255;
+                }
+                else if (level + 1 < layout.levels)
+                {
+                    const unsigned char* parent = &m_pageTable[level + 1][((size_t)(y >> 1) * layout.PagesX(level + 1) + (x >> 1)) * 4];
+                    memcpy(texel, parent, 4);
+                }
+            }
+        }
+    }
+    m_tableDirty = true;
+}
+
+//---------------------------------------------------------------------
+//
+// Self check
+//
+//! One feedback texel asking for a page, in the format VTFeedbackAnalyzer reads.
+static void AddFeedback(vector<unsigned char>& feedback, VTPageKey key, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char texel[4] = { (unsigned char)PageX(key), (unsigned char)PageY(key), (unsigned char)PageLevel(key), 255 };
+        feedback.insert(feedback.end(), texel, texel + 4);
+    }
+}
+
+//! Runs frames of the same feedback until key is resident, at most a couple of seconds.
+static bool RunUntilResident(VirtualTextureSystem& system, const vector<unsigned char>& feedback, VTPageKey key, vector<VTUpload>& uploads)
+{
+    for (int frame = 0; frame < 2000; frame++)
+    {
+        system.BeginFrame();
+        system.ProcessFeedback(feedback.data(), feedback.size() / 4);
+        system.Update(uploads);
+        if (system.Cache().Find(key) >= 0 && system.Stats().inFlight == 0)
+            return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+
+bool VirtualTextureSystem::SelfCheck(std::ostream& out, const std::string& scratchPath)
+{
+    int failed = 0;
+    auto check = [&](bool ok, const char* what)
+    {
+        out << (ok ? "  ok      " : "  FAILED  ") << what << endl;
+        failed += ok ? 0 : 1;
+    };
+    out << "Virtual texture self check, scratch file " << scratchPath << endl;
+
+    // 512 x 256 texels in 64 texel pages: 8 x 4, 4 x 2 and 2 x 1 pages over three levels.
+    // Every texel of level 0 says where it is, so a page read back can be checked texel by texel.
+    const int width = 512, height = 256, pageSize = 64, border = 2;
+    vector<unsigned char> image((size_t)width * height * 4);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            unsigned char* texel = &image[((size_t)y * width + x) * 4];
+            texel[0] = (unsigned char)(x & 255);
+            texel[1] = (unsigned char)(y & 255);
+            texel[2] = (unsigned char)((x >> 8) * 16 + (y >> 8));
+            texel[3] = 255;
+        }
+    check(BuildVirtualTextureFile(image.data(), width, height, pageSize, border, scratchPath), "builds a .vtex file");
+
+    VTFileReader reader;
+    check(reader.Open(scratchPath), "opens it");
+    const VTLayout layout = reader.Layout();
+    check(layout.levels == 3 && layout.PagesX(0) == 8 && layout.PagesY(0) == 4 && layout.PagesX(2) == 2 && layout.PagesY(2) == 1,
+          "three levels of 8 x 4, 4 x 2 and 2 x 1 pages");
+    vector<unsigned char> page(layout.PageBytes());
+    bool pageMatches = reader.ReadPage(MakePageKey(0, 5, 3), page.data());
+    const int slot = layout.SlotSize();
+    for (int j = 0; j < slot && pageMatches; j++)
+        for (int i = 0; i < slot && pageMatches; i++)
+        {
+            const int x = min(max(5 * pageSize - border + i, 0), width - 1), y = min(max(3 * pageSize - border + j, 0), height - 1);
+            pageMatches = memcmp(&page[((size_t)j * slot + i) * 4], &image[((size_t)y * width + x) * 4], 4) == 0;
+        }
+    check(pageMatches, "reads page (5, 3) of level 0 back with its border");
+    check(!reader.ReadPage(MakePageKey(0, 8, 0), page.data()) && !reader.ReadPage(MakePageKey(3, 0, 0), page.data()),
+          "refuses pages outside the texture");
+
+    // Damaged copies of the file, which Open has to turn down instead of trusting their header.
+    {
+        vector<unsigned char> bytes;
+        if (FILE* f = fopen(scratchPath.c_str(), "rb"))
+        {
+            VT_SEEK(f, 0, SEEK_END);
+            bytes.resize((size_t)VT_TELL(f));
+            VT_SEEK(f, 0, SEEK_SET);
+            bytes.resize(fread(bytes.data(), 1, bytes.size(), f));
+            fclose(f);
+        }
+        VTFileHeader header = {};
+        if (bytes.size() >= sizeof(header))
+            memcpy(&header, bytes.data(), sizeof(header));
+        const string damagedPath = scratchPath + ".bad";
+        auto opens = [&](const VTFileHeader& damagedHeader, size_t size)
+        {
+            vector<unsigned char> copy(bytes.begin(), bytes.begin() + min(size, bytes.size()));
+            if (copy.size() >= sizeof(damagedHeader))
+                memcpy(copy.data(), &damagedHeader, sizeof(damagedHeader));
+            FILE* f = fopen(damagedPath.c_str(), "wb");
+            if (!f)
+                return true;
+            fwrite(copy.data(), 1, copy.size(), f);
+            fclose(f);
+            VTFileReader damaged;
+            return damaged.Open(damagedPath);
+        };
+        VTFileHeader noPageSize = header, oddGrid = header, bigGrid = header, wrongLevels = header;
+        noPageSize.pageSize = 0;
+        oddGrid.width = 3 * pageSize;
+        bigGrid.width = 512 * pageSize;
+        wrongLevels.levels = 5;
+        check(opens(header, bytes.size()), "a copy of the file opens");
+        check(!opens(noPageSize, bytes.size()), "one with a page size of 0 doesn't");
+        check(!opens(oddGrid, bytes.size()) && !opens(bigGrid, bytes.size()), "nor one whose page grid isn't a power of two up to 256");
+        check(!opens(wrongLevels, bytes.size()), "nor one whose level count doesn't match its size");
+        check(!opens(header, bytes.size() - 1), "nor one a byte short of its pages");
+        remove(damagedPath.c_str());
+    }
+
+    // Feedback: 40 texels of one level 0 page in two runs, 10 of a level 1 page, background and a page that doesn't exist.
+    {
+        vector<unsigned char> feedback;
+        AddFeedback(feedback, MakePageKey(0, 5, 3), 25);
+        feedback.insert(feedback.end(), 20 * 4, 0);
+        AddFeedback(feedback, MakePageKey(1, 0, 0), 10);
+        AddFeedback(feedback, MakePageKey(0, 5, 3), 15);
+        AddFeedback(feedback, MakePageKey(0, 20, 0), 5);
+        VTFeedbackAnalyzer analyzer;
+        vector<VTRequest> requests;
+        analyzer.Analyze(feedback.data(), feedback.size() / 4, layout, requests);
+        unordered_map<VTPageKey, int> hits;
+        for (const VTRequest& request : requests)
+            hits[request.key] = request.hits;
+        check(requests.size() == 5 && hits[MakePageKey(0, 5, 3)] == 40 && hits[MakePageKey(1, 2, 1)] == 40 &&
+              hits[MakePageKey(2, 1, 0)] == 40 && hits[MakePageKey(1, 0, 0)] == 10 && hits[MakePageKey(2, 0, 0)] == 10,
+              "feedback counts pages, pulls in their ancestors and skips background and missing pages");
+    }
+
+    // LRU: two slots, pages used this frame and pinned pages are never evicted.
+    {
+        VTPageCache cache(2, 1);
+        VTPageKey evicted = 0;
+        bool didEvict = false;
+        const VTPageKey a = MakePageKey(0, 0, 0), b = MakePageKey(0, 1, 0), c = MakePageKey(0, 2, 0), d = MakePageKey(0, 3, 0);
+        const int slotA = cache.Insert(a, 1, evicted, didEvict);
+        cache.Insert(b, 1, evicted, didEvict);
+        check(cache.Insert(c, 1, evicted, didEvict) == -1 && !didEvict, "a full cache refuses a page while everything is on screen");
+        cache.Touch(b, 2);
+        check(cache.Insert(c, 2, evicted, didEvict) == slotA && didEvict && evicted == a && cache.Find(a) == -1,
+              "the least recently used page makes room");
+        cache.Pin(c);
+        check(cache.Insert(d, 3, evicted, didEvict) >= 0 && didEvict && evicted == b && cache.Find(c) >= 0, "pinned pages stay");
+        check(cache.Insert(a, 3, evicted, didEvict) == -1 && cache.Resident() == 2, "and nothing is evicted past them");
+    }
+
+    // The whole system: 8 slots, 2 pinned for the coarsest level, pages loaded on the background thread.
+    {
+        VirtualTextureSystem system(4, 2);
+        vector<VTUpload> uploads;
+        check(system.Open(scratchPath, uploads) && uploads.size() == 2, "opens with the coarsest level loaded and pinned");
+
+        const VTPageKey wanted = MakePageKey(0, 5, 3);
+        vector<unsigned char> feedback;
+        AddFeedback(feedback, wanted, 30);
+        uploads.clear();
+        check(RunUntilResident(system, feedback, wanted, uploads), "loads a page the feedback asks for");
+        check(system.Cache().Find(MakePageKey(1, 2, 1)) >= 0 && uploads.size() == 2 && PageLevel(uploads[0].page.key) == 1,
+              "and its parent, which is uploaded first");
+        bool uploadMatches = false;
+        for (const VTUpload& upload : uploads)
+            if (upload.page.key == wanted)
+                uploadMatches = reader.ReadPage(wanted, page.data()) && upload.page.pixels == page &&
+                                upload.slotY * 4 + upload.slotX == system.Cache().Find(wanted);
+        check(uploadMatches, "with the page's pixels, for the slot the cache gave it");
+
+        auto entry = [&](int level, int x, int y) { return &system.PageTable(level)[((size_t)y * layout.PagesX(level) + x) * 4]; };
+        const int slotWanted = system.Cache().Find(wanted);
+        check(entry(0, 5, 3)[0] == slotWanted % 4 && entry(0, 5, 3)[1] == slotWanted / 4 && entry(0, 5, 3)[2] == 0,
+              "the page table points at the page");
+        check(entry(0, 4, 3)[2] == 1 && entry(0, 0, 0)[2] == 2, "and falls back to the finest resident ancestor elsewhere");
+
+        // One page at a time across the whole of level 0: 32 pages through 6 free slots.
+        int evictions = 0;
+        bool allLoaded = true;
+        for (int y = 0; y < layout.PagesY(0); y++)
+            for (int x = 0; x < layout.PagesX(0); x++)
+            {
+                feedback.clear();
+                AddFeedback(feedback, MakePageKey(0, x, y), 30);
+                uploads.clear();
+                allLoaded = RunUntilResident(system, feedback, MakePageKey(0, x, y), uploads) && allLoaded;
+                evictions += system.Stats().evictions;
+            }
+        check(allLoaded, "loads every page of level 0 in turn");
+        check(evictions > 0 && system.Cache().Resident() == (size_t)system.Cache().Capacity(), "evicting old pages to do it");
+        check(system.Cache().Find(MakePageKey(2, 0, 0)) >= 0 && system.Cache().Find(MakePageKey(2, 1, 0)) >= 0,
+              "without ever evicting the coarsest level");
+
+        // Every entry names a resident page: itself or its finest resident ancestor.
+        bool consistent = true;
+        for (int level = 0; level < layout.levels; level++)
+            for (int y = 0; y < layout.PagesY(level); y++)
+                for (int x = 0; x < layout.PagesX(level); x++)
+                {
+                    int l = level;
+                    while (system.Cache().Find(MakePageKey(l, x >> (l - level), y >> (l - level))) < 0)
+                        l++;
+                    const int resident = system.Cache().Find(MakePageKey(l, x >> (l - level), y >> (l - level)));
+                    const unsigned char* texel = entry(level, x, y);
+                    consistent = consistent && texel[0] == resident % 4 && texel[1] == resident / 4 && texel[2] == l && texel[3] == 255;
+                }
+        check(consistent, "the page table agrees with the cache everywhere");
+        system.Close();
+    }
+    remove(scratchPath.c_str());
+
+    if (failed)
+        out << failed << " checks FAILED." << endl;
+    else
+        out << "All checks passed." << endl;
+    return failed == 0;
+}
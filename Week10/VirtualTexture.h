@@ -0,0 +1,246 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/// @file VirtualTexture.h
+/// @brief Sparse virtual texturing, CPU side. Nothing in here touches OpenGL, so feedback
+/// analysis, the page cache and the load scheduling can be driven from plain C++.
+/// A renderer draws the feedback pass in the format VTFeedbackAnalyzer reads, copies the pages
+/// Update hands back into its atlas and uploads PageTable whenever it is dirty.
+///
+/// A virtual texture is a big image cut into square pages for every mip level and stored
+/// page by page in a .vtex file. Only the pages the camera actually sees get loaded into a
+/// fixed size atlas of "slots" on the GPU; a small page table texture tells the shader which
+/// slot holds each page, falling back to a coarser page while the fine one is loading.
+
+//! Page coordinates packed into 32 bits: level in the top 8, y in the next 12, x in the low 12.
+typedef uint32_t VTPageKey;
+
+inline VTPageKey MakePageKey(int level, int x, int y)
+{
+    return ((VTPageKey)level << 24) | ((VTPageKey)(y & 0xFFF) << 12) | (VTPageKey)(x & 0xFFF);
+}
+inline int PageLevel(VTPageKey key) { return (int)(key >> 24); }
+inline int PageY(VTPageKey key) { return (int)((key >> 12) & 0xFFF); }
+inline int PageX(VTPageKey key) { return (int)(key & 0xFFF); }
+
+/// @brief Header of a .vtex file, followed by every page of level 0, then level 1, ...
+/// Each page is (pageSize + 2 * border)^2 RGBA8 texels, rows left to right, bottom to top.
+struct VTFileHeader
+{
+    char magic[4];      // "VTX1"
+    uint32_t width;     // Level 0 size in texels, pageSize times a power of two.
+    uint32_t height;
+    uint32_t pageSize;  // Useful texels per page side.
+    uint32_t border;    // Extra texels copied from the neighbours so bilinear filtering doesn't seam.
+    uint32_t levels;
+};
+
+/// @brief Page counts and file offsets derived from the header.
+struct VTLayout
+{
+    int width = 0, height = 0, pageSize = 0, border = 0, levels = 0;
+
+    int PagesX(int level) const { int n = (width / pageSize) >> level; return n > 0 ? n : 1; }
+    int PagesY(int level) const { int n = (height / pageSize) >> level; return n > 0 ? n : 1; }
+    //! Side of a stored page (and of an atlas slot), border included.
+    int SlotSize() const { return pageSize + 2 * border; }
+    size_t PageBytes() const { return (size_t)SlotSize() * SlotSize() * 4; }
+    bool Contains(VTPageKey key) const
+    {
+        int level = PageLevel(key);
+        return level < levels && PageX(key) < PagesX(level) && PageY(key) < PagesY(level);
+    }
+    uint64_t PageOffset(VTPageKey key) const;
+};
+
+/// @brief Cuts an RGBA8 image (bottom row first, as OpenGL wants it) into a .vtex file with a full
+/// mip chain down to the level whose short side is one page. width / pageSize and height / pageSize
+/// must be powers of two.
+bool BuildVirtualTextureFile(const unsigned char* rgba, int width, int height, int pageSize, int border, const std::string& path);
+//! Same, loading the source with stb_image.
+bool BuildVirtualTextureFile(const std::string& imagePath, int pageSize, int border, const std::string& path);
+
+/// @brief Random access page reads from a .vtex file.
+class VTFileReader
+{
+public:
+    ~VTFileReader();
+    //! Fails, saying why on cout, unless the header is one BuildVirtualTextureFile could have written and every page is in the file.
+    bool Open(const std::string& path);
+    const VTLayout& Layout() const { return m_layout; }
+    //! Reads one page into dst (Layout().PageBytes() bytes).
+    bool ReadPage(VTPageKey key, unsigned char* dst);
+
+private:
+    FILE* m_file = nullptr;
+    VTLayout m_layout;
+};
+
+/// @brief One needed page and how many feedback texels asked for it.
+struct VTRequest
+{
+    VTPageKey key;
+    int hits;
+};
+
+/// @brief Turns a feedback buffer into the list of pages the frame needs.
+/// The feedback pass writes one RGBA8 texel per pixel: R = page x, G = page y, B = mip level,
+/// A = 255 where the virtual texture was drawn and 0 elsewhere. Page x/y are therefore
+/// limited to 256 per side at level 0.
+/// Every requested page also pulls in its ancestors, so a coarser fallback is always
+/// on its way before the fine page.
+class VTFeedbackAnalyzer
+{
+public:
+    void Analyze(const unsigned char* feedback, size_t texelCount, const VTLayout& layout, std::vector<VTRequest>& requests);
+
+private:
+    std::unordered_map<VTPageKey, int> m_counts;
+};
+
+/// @brief Maps pages to slots of the physical atlas and evicts the least recently used.
+class VTPageCache
+{
+public:
+    VTPageCache(int slotsX, int slotsY);
+
+    int SlotsX() const { return m_slotsX; }
+    int SlotsY() const { return m_slotsY; }
+    int Capacity() const { return m_slotsX * m_slotsY; }
+    size_t Resident() const { return m_lookup.size(); }
+
+    //! Slot of a resident page or -1. Does not count as a use.
+    int Find(VTPageKey key) const;
+    //! Marks a resident page as used in this frame.
+    void Touch(VTPageKey key, unsigned frame);
+    //! Pinned pages (the coarsest level) never get evicted.
+    void Pin(VTPageKey key);
+    /// @brief Gives key a slot, evicting the least recently used page that wasn't used this frame.
+    /// @return the slot, or -1 if every slot is pinned or in use. evicted is set when a page was dropped.
+    int Insert(VTPageKey key, unsigned frame, VTPageKey& evicted, bool& didEvict);
+
+private:
+    struct Entry
+    {
+        VTPageKey key;
+        int slot;
+        unsigned lastUsed;
+        bool pinned;
+    };
+    int m_slotsX, m_slotsY;
+    std::vector<int> m_freeSlots;
+    std::list<Entry> m_lru; // Front = most recently used.
+    std::unordered_map<VTPageKey, std::list<Entry>::iterator> m_lookup;
+};
+
+/// @brief A page read from disk, waiting for upload.
+struct VTLoadedPage
+{
+    VTPageKey key;
+    std::vector<unsigned char> pixels;
+};
+
+/// @brief Reads pages on a background thread so the render loop never waits for the disk.
+class VTPageLoader
+{
+public:
+    VTPageLoader() {}
+    ~VTPageLoader();
+    bool Start(const std::string& path);
+    void Stop();
+    const VTLayout& Layout() const { return m_reader.Layout(); }
+
+    void Request(VTPageKey key);
+    //! Drops requests that haven't started yet, used when the view changes completely.
+    void CancelPending();
+    //! Moves finished pages into out.
+    void Collect(std::vector<VTLoadedPage>& out);
+    size_t Pending();
+
+private:
+    void Run();
+
+    VTFileReader m_reader;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<VTPageKey> m_queue;
+    std::vector<VTLoadedPage> m_done;
+    bool m_quit = false;
+};
+
+/// @brief Where a loaded page has to be copied in the atlas. Filled by VirtualTextureSystem::Update.
+struct VTUpload
+{
+    int slotX, slotY;
+    VTLoadedPage page;
+};
+
+struct VTStats
+{
+    size_t requested = 0;       // Unique pages in the last feedback, ancestors included.
+    size_t resident = 0;
+    size_t inFlight = 0;
+    int loadsIssued = 0;        // This frame.
+    int uploads = 0;            // This frame.
+    int evictions = 0;          // This frame.
+};
+
+/// @brief Ties it together: feedback in, load requests out, finished pages placed in the cache,
+/// and a CPU copy of the page table (one RGBA8 texel per page, per level) kept current.
+/// Page table texel = (slot x, slot y, level of the page actually stored there, 255).
+class VirtualTextureSystem
+{
+public:
+    VirtualTextureSystem(int slotsX, int slotsY, int maxLoadsPerFrame = 32, int maxUploadsPerFrame = 16);
+
+    //! Opens the file, loads and pins the coarsest level synchronously so there is always something to show.
+    bool Open(const std::string& path, std::vector<VTUpload>& initialUploads);
+    void Close();
+    const VTLayout& Layout() const { return m_loader.Layout(); }
+
+    void BeginFrame() { m_frame++; m_stats.loadsIssued = m_stats.uploads = m_stats.evictions = 0; }
+    //! Analyzes a feedback buffer and schedules loads, coarse levels and most seen pages first.
+    void ProcessFeedback(const unsigned char* feedback, size_t texelCount);
+    //! Places pages that finished loading. Copy each upload into its atlas slot afterwards.
+    void Update(std::vector<VTUpload>& uploads);
+
+    //! Page table texels of one level, PagesX(level) * PagesY(level) * 4 bytes.
+    const std::vector<unsigned char>& PageTable(int level) const { return m_pageTable[level]; }
+    bool PageTableDirty() const { return m_tableDirty; }
+    void ClearPageTableDirty() { m_tableDirty = false; }
+
+    const VTPageCache& Cache() const { return m_cache; }
+    const VTStats& Stats() const { return m_stats; }
+
+    /// @brief Runs synthetic feedback through page requests, LRU eviction and the background loader
+    /// on a small .vtex file written to scratchPath, with no GL. Prints each check to out.
+    /// @return true if every check passed.
+    static bool SelfCheck(std::ostream& out, const std::string& scratchPath);
+
+private:
+    bool Place(VTLoadedPage& page, std::vector<VTUpload>& uploads);
+    void RebuildPageTable();
+
+    VTPageLoader m_loader;
+    VTPageCache m_cache;
+    VTFeedbackAnalyzer m_analyzer;
+    std::vector<VTRequest> m_requests;
+    std::unordered_map<VTPageKey, bool> m_inFlight;
+    std::vector<std::vector<unsigned char>> m_pageTable;
+    std::vector<VTLoadedPage> m_loaded;
+    bool m_tableDirty = true;
+    unsigned m_frame = 0;
+    int m_maxLoads, m_maxUploads;
+    VTStats m_stats;
+};
@@ -4,6 +4,9 @@
  *  @note: Press the up and down arrow keys to move the viewpoint over the field.
  *  @note: Press the left and right arrow keys to cycle through the filters.
  *  @note: Press space to toggle between animation on and off.
+ *  @note: Press + and - to double and halve the number of trees, v to show or hide them.
+ *  @note: Run with --vegetation-bench to time culling against tree count without a window.
+ *  @note: Run with --vt-check to check the virtual texture's paging (feedback, LRU cache, loader) without a window.
  *  @author Hooman Salamat
  *  @bug No known bugs.
  */
@@ -21,6 +24,9 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <array>
+#include <algorithm>
+#include "Vegetation.h"
+#include "VirtualTexture.h"
 using namespace std;
 
 #define X_AXIS glm::vec3(1,0,0)
@@ -67,6 +73,12 @@ static float angle = 0.0; // Angle of rotation of texture coordinates.
 static int isAnimate = 0; // Animated?
 static int animationPeriod = 100; // Time interval between frames.
 
+// Trees scattered over the field, which is 80 x 80 once scaled.
+Vegetation vegetation;
+VegetationDesc vegetationDesc;
+bool showVegetation = true;
+int statsTime = 0;
+
 
 
 GLshort cube_indices[] = {
@@ -343,6 +355,10 @@ void init(void)
 
 	createBuffer();
 
+	vegetation.Scatter(vegetationDesc);
+	vegetation.Init("Media/trees.bmp");
+	vegetation.Stats().Print(cout);
+
 	// Enable depth test.
 	glEnable(GL_DEPTH_TEST);
 
@@ -420,6 +436,27 @@ void display(void)
 
 	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
 
+	if (showVegetation)
+	{
+		// writeData leaves depth testing off.
+		glEnable(GL_DEPTH_TEST);
+		const glm::vec3 eye(0.0f, 10.0f, 15.0f + d);
+		vegetation.Cull(projection * view, eye);
+		vegetation.Draw(projection * view, eye);
+		glUseProgram(program);
+
+		// Numbers once a second.
+		vegetation.Stats().frameMilliseconds = deltaTime;
+		if (currentTime - statsTime > 1000)
+		{
+			vegetation.Stats().Print(cout);
+			statsTime = currentTime;
+		}
+		// Keep drawing until every visible cell is in the instance buffer.
+		if (!isAnimate && vegetation.Stats().pendingCells > vegetation.Stats().uploadedCells)
+			glutPostRedisplay();
+	}
+
 	// Write data.
 	glDisable(GL_TEXTURE_2D);
 	glDisable(GL_DEPTH_TEST);
@@ -455,6 +492,17 @@ void keyInput(unsigned char key, int x, int y)
 			animate(1);
 		}
 		break;
+	case '+':
+	case '-':
+		vegetationDesc.count = key == '+' ? min(vegetationDesc.count * 2, (size_t)4000000) : max(vegetationDesc.count / 2, (size_t)1000);
+		vegetation.Scatter(vegetationDesc);
+		cout << "Scattered " << vegetation.Stats().instances << " trees in " << vegetation.Stats().scatterMilliseconds << " ms." << endl;
+		glutPostRedisplay();
+		break;
+	case 'v':
+		showVegetation = !showVegetation;
+		glutPostRedisplay();
+		break;
 	default:
 		break;
 	}
@@ -485,11 +533,19 @@ void printInteraction(void)
 	std::cout << "Press the up and down arrow keys to move the viewpoint over the field." << std::endl
 		<< "Press the left and right arrow keys to cycle through the filters." << std::endl;
 	std::cout << "Press space to toggle between animation on and off." << std::endl;
+	std::cout << "Press + and - to double and halve the number of trees, v to show or hide them." << std::endl;
 }
 
 // Main routine.
 int main(int argc, char** argv)
 {
+	if (argc > 1 && string(argv[1]) == "--vegetation-bench")
+	{
+		Vegetation::Benchmark(cout);
+		return 0;
+	}
+	if (argc > 1 && string(argv[1]) == "--vt-check")
+		return VirtualTextureSystem::SelfCheck(cout, "vtcheck.vtex") ? 0 : 1;
 	printInteraction();
 	glutInit(&argc, argv);
 
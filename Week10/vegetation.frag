@@ -0,0 +1,15 @@
+#version 430 core
+
+in vec2 texCoord;
+out vec4 frag_color;
+
+uniform sampler2D texture0;
+
+void main()
+{
+	vec4 texel = texture(texture0, texCoord);
+	// The background of the trees was keyed out to alpha 0 when the texture was loaded.
+	if (texel.a < 0.5f)
+		discard;
+	frag_color = texel;
+}
\ No newline at end of file
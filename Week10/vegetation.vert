@@ -0,0 +1,31 @@
+#version 430 core
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 2) in vec2 vertex_texture;
+layout(location = 3) in vec4 instance_position;	// xyz, scale.
+layout(location = 4) in vec2 instance_shape;	// Rotation around y, which tree of the texture.
+
+out vec2 texCoord;
+
+uniform mat4 viewProjection;
+uniform vec3 eyePosition;
+uniform int billboard;	// 1: turn the quad to face the eye, 0: rotate the crossed quads.
+
+void main()
+{
+	vec3 offset;
+	if (billboard == 1)
+	{
+		// Turned around y only, so far trees stay upright when looked down on.
+		vec2 toEye = eyePosition.xz - instance_position.xz;
+		vec3 right = length(toEye) > 0.0001f ? normalize(vec3(toEye.y, 0.0f, -toEye.x)) : vec3(1.0f, 0.0f, 0.0f);
+		offset = right * vertex_position.x + vec3(0.0f, vertex_position.y, 0.0f);
+	}
+	else
+	{
+		float c = cos(instance_shape.x), s = sin(instance_shape.x);
+		offset = vec3(c * vertex_position.x + s * vertex_position.z, vertex_position.y, -s * vertex_position.x + c * vertex_position.z);
+	}
+	texCoord = vec2((vertex_texture.x + instance_shape.y) * 0.5f, vertex_texture.y);
+	gl_Position = viewProjection * vec4(instance_position.xyz + offset * instance_position.w, 1.0f);
+}
\ No newline at end of file
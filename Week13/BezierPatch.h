@@ -0,0 +1,472 @@
+#pragma once
+
+#include "Shape.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BEZIER_PATCH_SSE2
+#endif
+
+///////////////////////////////////////////////////////////////////////
+// @file BezierPatch.h
+// @brief Tessellates bicubic Bezier patches, like the teapot in Teapot.h, into a Shape.
+//
+// Each patch gets as many segments along u and v as its control net needs to stay within a
+// Tolerance of the surface, in world units or in pixels on screen, so flat patches get a few
+// triangles and curved ones many. Where two patches with different counts meet, the shared edge
+// takes the larger count and each patch stitches its border to it, and the vertices on the edge
+// belong to both patches: there are no cracks and no T-junctions.
+//
+// Patches are evaluated four vertices at a time (SSE2 where available) from their power basis
+// form, worked out once per patch, with normals from the exact partial derivatives.
+//
+//	#include "Teapot.h"
+//	...
+//	BezierPatch::Mesh teapot = BezierPatch::Tessellate(TeapotVertices, TeapotIndices, NumTeapotPatches, BezierPatch::Tolerance());
+//	cout << teapot.PatchesPerMillisecond() << " patches per millisecond" << endl;
+//	g_teapot.Load(teapot);		// A BezierShape, buffer and draw it as any other Shape.
+///////////////////////////////////////////////////////////////////////
+
+namespace BezierPatch
+{
+	// How closely the triangles must follow the patches.
+	struct Tolerance
+	{
+		float error = 0.005f;			// Largest distance between a patch and its triangles.
+		bool screenSpace = false;		// error is in pixels, after projecting with mvp onto viewport.
+		glm::mat4 mvp = glm::mat4(1.0f);
+		glm::vec2 viewport = glm::vec2(1.0f);
+		int minLevel = 2;				// Segments along each side of a patch. The stitching needs 2.
+		int maxLevel = 64;
+		int maxVertices = 32767;		// Shape's indices are GLshort. error is raised until it fits.
+	};
+
+	// An indexed triangle mesh in Shape's layout, with how long it took to make.
+	struct Mesh
+	{
+		vector<GLshort> indices;
+		vector<GLfloat> vertices;
+		vector<GLfloat> uvs;			// The (u, v) of the patch each vertex was made on.
+		vector<GLfloat> normals;
+		int patches = 0;
+		double milliseconds = 0.0;
+
+		double PatchesPerMillisecond() const { return patches / std::max(milliseconds, 1e-6); }
+	};
+
+	// Four floats worked on at once, one vertex per lane.
+#ifdef BEZIER_PATCH_SSE2
+	typedef __m128 Lanes;
+	inline Lanes Load(const float* f) { return _mm_loadu_ps(f); }
+	inline Lanes Splat(float f) { return _mm_set1_ps(f); }
+	inline Lanes Madd(Lanes a, Lanes b, Lanes c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline void Store(float* f, Lanes a) { _mm_storeu_ps(f, a); }
+#else
+	struct Lanes { float f[4]; };
+	inline Lanes Load(const float* f) { return { { f[0], f[1], f[2], f[3] } }; }
+	inline Lanes Splat(float f) { return { { f, f, f, f } }; }
+	inline Lanes Madd(Lanes a, Lanes b, Lanes c)
+	{
+		for (int i = 0; i < 4; i++)
+			a.f[i] = a.f[i] * b.f[i] + c.f[i];
+		return a;
+	}
+	inline Lanes Mul(Lanes a, Lanes b)
+	{
+		for (int i = 0; i < 4; i++)
+			a.f[i] *= b.f[i];
+		return a;
+	}
+	inline void Store(float* f, Lanes a)
+	{
+		for (int i = 0; i < 4; i++)
+			f[i] = a.f[i];
+	}
+#endif
+
+	// A patch in power form: P(u, v) = sum of c[axis][a][b] * v^a * u^b. The control net times the
+	// Bernstein basis matrix on both sides, so evaluating is two rounds of Horner's rule.
+	struct Power
+	{
+		float c[3][4][4];
+	};
+
+	// net[a][b] is the control point in row a (along v) and column b (along u).
+	inline Power ToPower(const glm::dvec3 net[4][4])
+	{
+		// basis[k][i]: coefficient of t^k in the Bernstein polynomial B_i(t).
+		static const double basis[4][4] = { { 1, 0, 0, 0 }, { -3, 3, 0, 0 }, { 3, -6, 3, 0 }, { -1, 3, -3, 1 } };
+		Power power;
+		for (int axis = 0; axis < 3; axis++)
+			for (int a = 0; a < 4; a++)
+				for (int b = 0; b < 4; b++)
+				{
+					double sum = 0.0;
+					for (int i = 0; i < 4; i++)
+						for (int j = 0; j < 4; j++)
+							sum += basis[a][i] * net[i][j][axis] * basis[b][j];
+					power.c[axis][a][b] = (float)sum;
+				}
+		return power;
+	}
+
+	// Position and partial derivatives at the four (u[i], v[i]). Each output is [axis][lane].
+	inline void Evaluate(const Power& power, const float* u, const float* v, float position[3][4], float du[3][4], float dv[3][4])
+	{
+		const Lanes U = Load(u), V = Load(v), two = Splat(2.0f), three = Splat(3.0f);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// Each row is a cubic in u, the rows are the coefficients of a cubic in v.
+			Lanes row[4], rowDu[4];
+			for (int a = 0; a < 4; a++)
+			{
+				const float* c = power.c[axis][a];
+				row[a] = Madd(Madd(Madd(Splat(c[3]), U, Splat(c[2])), U, Splat(c[1])), U, Splat(c[0]));
+				rowDu[a] = Madd(Madd(Splat(3.0f * c[3]), U, Splat(2.0f * c[2])), U, Splat(c[1]));
+			}
+			Store(position[axis], Madd(Madd(Madd(row[3], V, row[2]), V, row[1]), V, row[0]));
+			Store(du[axis], Madd(Madd(Madd(rowDu[3], V, rowDu[2]), V, rowDu[1]), V, rowDu[0]));
+			Store(dv[axis], Madd(Madd(Mul(row[3], three), V, Mul(row[2], two)), V, row[1]));
+		}
+	}
+
+	// Segments needed along u (alongU) or v for no line across the patch to stray more than error from
+	// its chords. A cubic's chord error is at most h^2 / 8 times its second derivative, which is at most
+	// 6 times the largest second difference of its control points.
+	inline int Level(const glm::dvec3 net[4][4], bool alongU, const Tolerance& tolerance)
+	{
+		double largest = 0.0;
+		for (int line = 0; line < 4; line++)
+			for (int k = 0; k < 2; k++)
+			{
+				const glm::dvec3 p0 = alongU ? net[line][k] : net[k][line];
+				const glm::dvec3 p1 = alongU ? net[line][k + 1] : net[k + 1][line];
+				const glm::dvec3 p2 = alongU ? net[line][k + 2] : net[k + 2][line];
+				largest = std::max(largest, glm::length(p2 - 2.0 * p1 + p0));
+			}
+		const double segments = std::ceil(std::sqrt(0.75 * largest / std::max(tolerance.error, 1e-6f)));
+		return (int)std::min(std::max(segments, (double)tolerance.minLevel), (double)tolerance.maxLevel);
+	}
+
+	// The control net in pixels, or false if part of it is behind the eye and pixels don't apply.
+	inline bool ToScreen(const glm::dvec3 net[4][4], const Tolerance& tolerance, glm::dvec3 screen[4][4])
+	{
+		for (int a = 0; a < 4; a++)
+			for (int b = 0; b < 4; b++)
+			{
+				const glm::vec4 clip = tolerance.mvp * glm::vec4(glm::vec3(net[a][b]), 1.0f);
+				if (clip.w <= 1e-6f)
+					return false;
+				screen[a][b] = glm::dvec3(glm::vec2(clip) / clip.w * 0.5f * tolerance.viewport, 0.0);
+			}
+		return true;
+	}
+
+	// Connects an outer row of vertices to an inner one running the same way, the outer one below when
+	// looking along them, by always closing the triangle whose next step is furthest behind.
+	inline void Stitch(const vector<int>& outer, const vector<int>& inner, vector<int>& triangles)
+	{
+		const int m = (int)outer.size() - 1, k = (int)inner.size() - 1;
+		int o = 0, n = 0;
+		while (o < m || n < k)
+		{
+			if (n == k || (o < m && (o + 0.5f) / m < (n + 0.5f) / k))
+			{
+				triangles.insert(triangles.end(), { outer[o], outer[o + 1], inner[n] });
+				o++;
+			}
+			else
+			{
+				triangles.insert(triangles.end(), { outer[o], inner[n + 1], inner[n] });
+				n++;
+			}
+		}
+	}
+
+	// Tessellates patches, each 16 indices into controls in 4 rows of 4, with rows along u.
+	inline Mesh Tessellate(const GLdouble (*controls)[3], const GLint (*patches)[4][4], int numPatches, Tolerance tolerance)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		// An edge is the 4 control points along one side, kept in whichever direction sorts first
+		// so that the neighbours on both sides of it find the same one.
+		typedef std::array<double, 12> EdgeKey;
+		struct Edge
+		{
+			int level = 0;
+			bool degenerate = true;		// All 4 points equal, like at the teapot's lid and bottom.
+			vector<int> vertices;		// level + 1 of them, in key order.
+			int patches[2], sides[2];	// The first two patches along it.
+			int users = 0;
+		};
+		struct Plan
+		{
+			glm::dvec3 net[4][4];
+			Power power;
+			int nu, nv;
+			int edges[4];				// v = 0, u = 1, v = 1, u = 0, each running with u or v.
+			bool reversed[4];			// Against its key order.
+			bool flipped;				// Triangles and normals turned over to match its neighbours.
+			int innerBase;
+			vector<float> us, vs;		// The vertices this patch evaluates...
+			vector<int> owned;			// ...and where they go.
+		};
+		vector<Plan> plans(numPatches);
+		std::map<EdgeKey, int> edgeIds;
+		vector<Edge> edges;
+
+		for (int p = 0; p < numPatches; p++)
+		{
+			Plan& plan = plans[p];
+			for (int a = 0; a < 4; a++)
+				for (int b = 0; b < 4; b++)
+				{
+					const GLdouble* c = controls[patches[p][a][b]];
+					plan.net[a][b] = glm::dvec3(c[0], c[1], c[2]);
+				}
+			plan.power = ToPower(plan.net);
+			for (int side = 0; side < 4; side++)
+			{
+				EdgeKey key, back;
+				for (int k = 0; k < 4; k++)
+				{
+					const glm::dvec3 point = side == 0 ? plan.net[0][k] : side == 1 ? plan.net[k][3] : side == 2 ? plan.net[3][k] : plan.net[k][0];
+					for (int axis = 0; axis < 3; axis++)
+					{
+						key[3 * k + axis] = point[axis];
+						back[3 * (3 - k) + axis] = point[axis];
+					}
+				}
+				plan.reversed[side] = back < key;
+				auto found = edgeIds.insert(std::make_pair(plan.reversed[side] ? back : key, (int)edges.size()));
+				if (found.second)
+				{
+					edges.push_back(Edge());
+					edges.back().degenerate = std::equal(key.begin(), key.begin() + 9, key.begin() + 3);
+				}
+				plan.edges[side] = found.first->second;
+				Edge& edge = edges[plan.edges[side]];
+				if (edge.users < 2)
+				{
+					edge.patches[edge.users] = p;
+					edge.sides[edge.users++] = side;
+				}
+			}
+		}
+
+		// Turn over the patches that go round a shared edge the same way as their neighbour, so that each
+		// connected piece faces the same way as its first patch. The teapot's bottom is stored upside down.
+		vector<int> flipped(numPatches, -1);
+		auto around = [&](int p, int side) { return plans[p].reversed[side] != (side >= 2); };
+		for (int seed = 0; seed < numPatches; seed++)
+		{
+			if (flipped[seed] >= 0)
+				continue;
+			flipped[seed] = 0;
+			vector<int> pending(1, seed);
+			while (!pending.empty())
+			{
+				const int p = pending.back();
+				pending.pop_back();
+				for (int side = 0; side < 4; side++)
+				{
+					const Edge& edge = edges[plans[p].edges[side]];
+					if (edge.users < 2 || edge.degenerate)
+						continue;
+					const int k = edge.patches[0] == p && edge.sides[0] == side ? 1 : 0;
+					const int other = edge.patches[k];
+					if (flipped[other] >= 0)
+						continue;
+					flipped[other] = flipped[p] ^ (around(p, side) == around(other, edge.sides[k]) ? 1 : 0);
+					pending.push_back(other);
+				}
+			}
+		}
+		for (int p = 0; p < numPatches; p++)
+			plans[p].flipped = flipped[p] == 1;
+
+		// The levels, raising error until the vertices fit.
+		for (;;)
+		{
+			int vertices = 0;
+			for (Edge& edge : edges)
+				edge.level = 0;
+			for (Plan& plan : plans)
+			{
+				glm::dvec3 screen[4][4];
+				const bool pixels = tolerance.screenSpace && ToScreen(plan.net, tolerance, screen);
+				if (tolerance.screenSpace && !pixels)
+					plan.nu = plan.nv = tolerance.maxLevel;
+				else
+				{
+					plan.nu = Level(pixels ? screen : plan.net, true, tolerance);
+					plan.nv = Level(pixels ? screen : plan.net, false, tolerance);
+				}
+				for (int side = 0; side < 4; side++)
+				{
+					Edge& edge = edges[plan.edges[side]];
+					edge.level = std::max(edge.level, side % 2 == 0 ? plan.nu : plan.nv);
+				}
+				vertices += 4 + (plan.nu - 1) * (plan.nv - 1);
+			}
+			for (const Edge& edge : edges)
+				vertices += edge.degenerate ? 0 : edge.level - 1;
+			if (vertices <= tolerance.maxVertices || tolerance.error > 1e6f)
+				break;
+			tolerance.error *= 1.5f;
+		}
+
+		// Number the vertices, corners and edges first come first served. Corners are found by their
+		// control point, so every patch meeting there shares one vertex.
+		std::map<std::array<double, 3>, int> corners;
+		int count = 0;
+		for (int p = 0; p < numPatches; p++)
+		{
+			Plan& plan = plans[p];
+			auto own = [&](float u, float v)
+			{
+				plan.us.push_back(u);
+				plan.vs.push_back(v);
+				plan.owned.push_back(count);
+				return count++;
+			};
+			int corner[4];
+			const float cornerUv[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+			const glm::dvec3 cornerPoint[4] = { plan.net[0][0], plan.net[0][3], plan.net[3][3], plan.net[3][0] };
+			for (int c = 0; c < 4; c++)
+			{
+				auto found = corners.insert(std::make_pair(std::array<double, 3>{ { cornerPoint[c].x, cornerPoint[c].y, cornerPoint[c].z } }, count));
+				corner[c] = found.second ? own(cornerUv[c][0], cornerUv[c][1]) : found.first->second;
+			}
+			for (int side = 0; side < 4; side++)
+			{
+				Edge& edge = edges[plan.edges[side]];
+				if (!edge.vertices.empty())
+					continue;
+				// Sides 0 and 2 run with u from corner 0 and 3, sides 1 and 3 with v from corner 1 and 0.
+				const int from = side == 0 ? 0 : side == 1 ? 1 : side == 2 ? 3 : 0;
+				const int to = side == 0 ? 1 : side == 1 ? 2 : side == 2 ? 2 : 3;
+				edge.vertices.push_back(corner[from]);
+				for (int s = 1; s < edge.level; s++)
+				{
+					const float t = (float)s / edge.level;
+					if (edge.degenerate)
+						edge.vertices.push_back(corner[from]);
+					else
+						edge.vertices.push_back(own(side == 1 ? 1.0f : side == 3 ? 0.0f : t, side == 0 ? 0.0f : side == 2 ? 1.0f : t));
+				}
+				edge.vertices.push_back(corner[to]);
+				if (plan.reversed[side])
+					std::reverse(edge.vertices.begin(), edge.vertices.end());
+			}
+			plan.innerBase = count;
+			for (int j = 1; j < plan.nv; j++)
+				for (int i = 1; i < plan.nu; i++)
+					own((float)i / plan.nu, (float)j / plan.nv);
+		}
+
+		// Evaluate, each patch writing only the vertices it owns.
+		Mesh mesh;
+		mesh.patches = numPatches;
+		mesh.vertices.resize(3 * count);
+		mesh.uvs.resize(2 * count);
+		mesh.normals.resize(3 * count);
+		ParallelFor(numPatches, count >= 4096, [&](int first, int last)
+		{
+			for (int p = first; p < last; p++)
+			{
+				Plan& plan = plans[p];
+				const int owned = (int)plan.owned.size();
+				plan.us.resize((owned + 3) & ~3, 0.5f);
+				plan.vs.resize((owned + 3) & ~3, 0.5f);
+				for (int first4 = 0; first4 < owned; first4 += 4)
+				{
+					float position[3][4], du[3][4], dv[3][4];
+					Evaluate(plan.power, &plan.us[first4], &plan.vs[first4], position, du, dv);
+					for (int lane = 0; lane < 4 && first4 + lane < owned; lane++)
+					{
+						const int index = plan.owned[first4 + lane];
+						const float u = plan.us[first4 + lane], v = plan.vs[first4 + lane];
+						glm::vec3 normal = glm::cross(glm::vec3(du[0][lane], du[1][lane], du[2][lane]), glm::vec3(dv[0][lane], dv[1][lane], dv[2][lane]));
+						if (glm::dot(normal, normal) < 1e-12f)
+						{
+							// A side that shrinks to a point has no normal there, take the one just inside.
+							const float nudgedU[4] = { u + (0.5f - u) * 1e-3f, 0, 0, 0 }, nudgedV[4] = { v + (0.5f - v) * 1e-3f, 0, 0, 0 };
+							float unused[3][4], du2[3][4], dv2[3][4];
+							Evaluate(plan.power, nudgedU, nudgedV, unused, du2, dv2);
+							normal = glm::cross(glm::vec3(du2[0][0], du2[1][0], du2[2][0]), glm::vec3(dv2[0][0], dv2[1][0], dv2[2][0]));
+						}
+						normal = glm::normalize(plan.flipped ? -normal : normal);
+						for (int axis = 0; axis < 3; axis++)
+						{
+							mesh.vertices[3 * index + axis] = position[axis][lane];
+							mesh.normals[3 * index + axis] = normal[axis];
+						}
+						mesh.uvs[2 * index] = u;
+						mesh.uvs[2 * index + 1] = v;
+					}
+				}
+			}
+		});
+
+		// Triangles: a regular grid inside, a ring stitched to the edges around it. Counter-clockwise
+		// seen from where the normals point, triangles squashed flat at a point are left out.
+		vector<vector<int>> triangles(numPatches);
+		ParallelFor(numPatches, count >= 4096, [&](int first, int last)
+		{
+			for (int p = first; p < last; p++)
+			{
+				const Plan& plan = plans[p];
+				auto inner = [&](int i, int j) { return plan.innerBase + (j - 1) * (plan.nu - 1) + (i - 1); };
+				vector<int> raw;
+				for (int j = 1; j < plan.nv - 1; j++)
+					for (int i = 1; i < plan.nu - 1; i++)
+						raw.insert(raw.end(), { inner(i, j), inner(i + 1, j), inner(i + 1, j + 1), inner(i, j), inner(i + 1, j + 1), inner(i, j + 1) });
+				for (int side = 0; side < 4; side++)
+				{
+					vector<int> outer = edges[plan.edges[side]].vertices, ring;
+					// Around the patch: sides 0 and 1 with u and v, sides 2 and 3 against them.
+					if (plan.reversed[side] != (side >= 2))
+						std::reverse(outer.begin(), outer.end());
+					if (side == 0)
+						for (int i = 1; i < plan.nu; i++) ring.push_back(inner(i, 1));
+					else if (side == 1)
+						for (int j = 1; j < plan.nv; j++) ring.push_back(inner(plan.nu - 1, j));
+					else if (side == 2)
+						for (int i = plan.nu - 1; i >= 1; i--) ring.push_back(inner(i, plan.nv - 1));
+					else
+						for (int j = plan.nv - 1; j >= 1; j--) ring.push_back(inner(1, j));
+					Stitch(outer, ring, raw);
+				}
+				for (size_t t = 0; t < raw.size(); t += 3)
+					if (raw[t] != raw[t + 1] && raw[t + 1] != raw[t + 2] && raw[t] != raw[t + 2])
+						triangles[p].insert(triangles[p].end(), { raw[t], raw[t + (plan.flipped ? 2 : 1)], raw[t + (plan.flipped ? 1 : 2)] });
+			}
+		});
+		for (const vector<int>& patch : triangles)
+			for (int index : patch)
+				mesh.indices.push_back((GLshort)index);
+
+		mesh.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return mesh;
+	}
+}
+
+// A Shape made from a tessellated BezierPatch::Mesh, white until recolored.
+struct BezierShape : public Shape
+{
+	void Load(const BezierPatch::Mesh& mesh)
+	{
+		shape_indices = mesh.indices;
+		shape_vertices = mesh.vertices;
+		shape_uvs = mesh.uvs;
+		shape_normals = mesh.normals;
+		ColorShape(1.0f, 1.0f, 1.0f);
+	}
+};
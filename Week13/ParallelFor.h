@@ -0,0 +1,25 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Runs body(first, last) over [0, count) split between all cores, or on this thread when
+// worthThreads is false because the work is too small for threads to pay off.
+// Shared by BezierPatch.h and Subdivision.h.
+template <typename Body>
+void ParallelFor(int count, bool worthThreads, Body body)
+{
+	const int threads = worthThreads ? std::min((int)std::max(1u, std::thread::hardware_concurrency()), count) : 1;
+	if (threads <= 1)
+	{
+		body(0, count);
+		return;
+	}
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.emplace_back(body, (int)((long long)count * i / threads), (int)((long long)count * (i + 1) / threads));
+	body(0, count / threads);
+	for (std::thread& worker : workers)
+		worker.join();
+}
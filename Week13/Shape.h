@@ -3,10 +3,310 @@
 #include <GL/glew.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <array>
+#include <cfloat>
 #include <cmath>
+#include "VertexFormat.h"
+#include "VertexQuantize.h"
+#include "MeshOptimize.h"
+#include "MeshStrip.h"
 #define PI 3.14159265358979324
 using namespace std;
 
+// Where BufferShape reads a shape's data from, see Shape::Data().
+struct MeshView
+{
+	const GLshort* indices;
+	const GLfloat* vertices;
+	const GLfloat* colors;
+	const GLfloat* uvs;
+	const GLfloat* normals;
+	GLsizei indexCount, vertexFloats, colorFloats, uvFloats, normalFloats;
+};
+
+// Data of a shape made at compile time, see the Static shapes at the end of this file.
+// Plain arrays because std::array can't be written to in a constexpr function before C++17.
+template <int NumVertices, int NumIndices>
+struct MeshTable
+{
+	GLshort indices[NumIndices];
+	GLfloat vertices[NumVertices * 3];
+	GLfloat colors[NumVertices * 3];
+	GLfloat uvs[NumVertices * 2];
+	GLfloat normals[NumVertices * 3];
+
+	MeshView View() const
+	{
+		return { indices, vertices, colors, uvs, normals,
+			NumIndices, NumVertices * 3, NumVertices * 3, NumVertices * 2, NumVertices * 3 };
+	}
+};
+
+namespace MeshGen
+{
+	// <cmath> isn't constexpr, so sin, cos and sqrt are worked out in double and rounded to
+	// float, which gives the same value as sinf / cosf / sqrtf (within one ulp at worst).
+
+	// sin(x) and cos(x) for |x| <= PI / 4.
+	constexpr double SinSeries(double x)
+	{
+		double term = x, sum = x;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -x * x / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double CosSeries(double x)
+	{
+		double term = 1, sum = 1;
+		for (int n = 1; n < 12; n++)
+		{
+			term *= -x * x / ((2 * n - 1) * (2 * n));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// sin(angle), or cos(angle) with cosine set. angle = k * PI / 2 + x with |x| <= PI / 4, where
+	// PI / 2 is split in two parts so that x stays exact for the angles shapes use.
+	constexpr float SinCos(float angle, bool cosine)
+	{
+		const double halfPiHigh = 1.57079632673412561417e+00;
+		const double halfPiLow = 6.07710050650619224932e-11;
+		const long long k = (long long)(angle / (PI / 2) + (angle >= 0 ? 0.5 : -0.5));
+		const double x = (angle - k * halfPiHigh) - k * halfPiLow;
+		switch ((k + (cosine ? 1 : 0)) & 3)
+		{
+		case 0: return (float)SinSeries(x);
+		case 1: return (float)CosSeries(x);
+		case 2: return (float)-SinSeries(x);
+		default: return (float)-CosSeries(x);
+		}
+	}
+
+	constexpr float Sin(float angle) { return SinCos(angle, false); }
+	constexpr float Cos(float angle) { return SinCos(angle, true); }
+
+	constexpr float Sqrt(float value)
+	{
+		if (value <= 0)
+			return 0;
+		// Newton's method from above, stops when it can't get any closer.
+		double r = value > 1 ? value : 1;
+		for (;;)
+		{
+			const double next = 0.5 * (r + value / r);
+			if (next >= r)
+				break;
+			r = next;
+		}
+		return (float)r;
+	}
+
+	// Just what CalcAverageNormals needs from glm, with the same float operations in the same order.
+	struct Vec3
+	{
+		GLfloat x, y, z;
+	};
+
+	constexpr Vec3 Cross(Vec3 a, Vec3 b)
+	{
+		return { a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y };
+	}
+
+	constexpr Vec3 Normalize(Vec3 v)
+	{
+		const GLfloat inverse = 1.0f / Sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return { v.x * inverse, v.y * inverse, v.z * inverse };
+	}
+
+	// Fills a MeshTable in the same order the run time shapes push_back their vectors.
+	template <int NumVertices, int NumIndices>
+	struct Builder
+	{
+		MeshTable<NumVertices, NumIndices> table = {};
+		int vertexFloats = 0, uvFloats = 0, indexCount = 0;
+
+		constexpr void Vertex(GLfloat x, GLfloat y, GLfloat z)
+		{
+			table.vertices[vertexFloats++] = x;
+			table.vertices[vertexFloats++] = y;
+			table.vertices[vertexFloats++] = z;
+		}
+
+		constexpr void Uv(GLfloat u, GLfloat v)
+		{
+			table.uvs[uvFloats++] = u;
+			table.uvs[uvFloats++] = v;
+		}
+
+		constexpr void Triangle(int a, int b, int c)
+		{
+			table.indices[indexCount++] = (GLshort)a;
+			table.indices[indexCount++] = (GLshort)b;
+			table.indices[indexCount++] = (GLshort)c;
+		}
+
+		// Shape::ColorShape and Shape::CalcAverageNormals.
+		constexpr MeshTable<NumVertices, NumIndices> Finish(GLfloat r, GLfloat g, GLfloat b)
+		{
+			for (int i = 0; i < NumVertices * 3; i += 3)
+			{
+				table.colors[i] = r;
+				table.colors[i + 1] = g;
+				table.colors[i + 2] = b;
+			}
+			const GLfloat* v = table.vertices;
+			GLfloat* normals = table.normals;
+			for (int i = 0; i < NumIndices; i += 3)
+			{
+				const int in0 = table.indices[i] * 3;
+				const int in1 = table.indices[i + 1] * 3;
+				const int in2 = table.indices[i + 2] * 3;
+				const Vec3 v1 = { v[in1] - v[in0], v[in1 + 1] - v[in0 + 1], v[in1 + 2] - v[in0 + 2] };
+				const Vec3 v2 = { v[in2] - v[in0], v[in2 + 1] - v[in0 + 1], v[in2 + 2] - v[in0 + 2] };
+				const Vec3 normal = Normalize(Cross(v1, v2));
+				normals[in0] += normal.x;	normals[in0 + 1] += normal.y;	normals[in0 + 2] += normal.z;
+				normals[in1] += normal.x;	normals[in1 + 1] += normal.y;	normals[in1 + 2] += normal.z;
+				normals[in2] += normal.x;	normals[in2 + 1] += normal.y;	normals[in2 + 2] += normal.z;
+			}
+			for (int i = 0; i < NumVertices * 3; i += 3)
+			{
+				const Vec3 n = Normalize({ normals[i], normals[i + 1], normals[i + 2] });
+				normals[i] = n.x; normals[i + 1] = n.y; normals[i + 2] = n.z;
+			}
+			return table;
+		}
+	};
+
+	// Data shared by Cube / Cube2 and their Static versions.
+	constexpr GLshort CubeIndices[] = {
+		// Front.
+		0, 1, 2,
+		2, 3, 0,
+		// Right.
+		4, 5, 6,
+		6, 7, 4,
+		// Back.
+		8, 9, 10,
+		10, 11, 8,
+		// Left.
+		12, 13, 14,
+		14, 15, 12,
+		// Top.
+		16, 17, 18,
+		18, 19, 16,
+		// Bottom.
+		20, 21, 22,
+		22, 23, 20
+	};
+	constexpr GLfloat CubeVertices[] = {
+		// Front.
+		0.0f, 0.0f, 1.0f,		// 0.
+		1.0f, 0.0f, 1.0f,		// 1.
+		1.0f, 1.0f, 1.0f,		// 2.
+		0.0f, 1.0f, 1.0f,		// 3.
+		// Right.
+		1.0f, 0.0f, 1.0f,		// 1. 4
+		1.0f, 0.0f, 0.0f,		// 5. 5
+		1.0f, 1.0f, 0.0f,		// 6. 6
+		1.0f, 1.0f, 1.0f,		// 2. 7
+		// Back.
+		1.0f, 0.0f, 0.0f,		// 5. 8
+		0.0f, 0.0f, 0.0f,		// 4. 9
+		0.0f, 1.0f, 0.0f,		// 7. 10
+		1.0f, 1.0f, 0.0f,		// 6. 11
+		// Left.
+		0.0f, 0.0f, 0.0f,		// 4. 12
+		0.0f, 0.0f, 1.0f,		// 0. 13
+		0.0f, 1.0f, 1.0f,		// 3. 14
+		0.0f, 1.0f, 0.0f,		// 7. 15
+		// Top.
+		0.0f, 1.0f, 0.0f,		// 7. 16
+		0.0f, 1.0f, 1.0f,		// 3. 17
+		1.0f, 1.0f, 1.0f,		// 2. 18
+		1.0f, 1.0f, 0.0f,		// 6. 19
+		// Bottom.
+		0.0f, 0.0f, 0.0f,		// 4. 20
+		1.0f, 0.0f, 0.0f,		// 5. 21
+		1.0f, 0.0f, 1.0f,		// 1. 22
+		0.0f, 0.0f, 1.0f		// 0. 23
+	};
+	// Every face 0,0 to 1,1.
+	constexpr GLfloat CubeUvs[] = {
+		// Front.
+		0.0f, 0.0f, 	// 0.
+		1.0f, 0.0f, 	// 1.
+		1.0f, 1.0f, 	// 2.
+		0.0f, 1.0f,		// 3.
+		// Right.
+		0.0f, 0.0f, 	// 1.
+		1.0f, 0.0f, 	// 5.
+		1.0f, 1.0f, 	// 6.
+		0.0f, 1.0f,		// 2.
+		// Back.
+		0.0f, 0.0f, 	// 5.
+		1.0f, 0.0f, 	// 4.
+		1.0f, 1.0f,		// 7.
+		0.0f, 1.0f,		// 6.
+		// Left.
+		0.0f, 0.0f,		// 4.
+		1.0f, 0.0f,		// 0.
+		1.0f, 1.0f,		// 3.
+		0.0f, 1.0f,		// 7.
+		// Top.
+		0.0f, 0.0f,		// 7.
+		1.0f, 0.0f,		// 3.
+		1.0f, 1.0f,		// 2.
+		0.0f, 1.0f,		// 6.
+		// Bottom.
+		0.0f, 0.0f,		// 4.
+		1.0f, 0.0f,		// 5.
+		1.0f, 1.0f,		// 1.
+		0.0f, 1.0f		// 0.
+	};
+	// Cube2: each face repeats the texture as many times as the cube is long on that side.
+	constexpr std::array<GLfloat, 48> Cube2Uvs(GLfloat x, GLfloat y, GLfloat z)
+	{
+		return { {
+			// Front.
+			0.0f, 0.0f, 	// 0.
+			x, 0.0f, 	// 1.
+			x, y, 	// 2.
+			0, y,		// 3.
+			// Right.
+			0.0f, 0.0f, 	// 1.
+			z, 0.0f, 	// 5.
+			z,y, 	// 6.
+			0.0f, y,		// 2.
+			// Back.
+			0.0f, 0.0f, 	// 5.
+			x,0, 	// 4.
+			x,y,		// 7.
+			0.0f, y,		// 6.
+			// Left.
+			0.0f, 0.0f,		// 4.
+			z, 0.0f,		// 0.
+			z,y,		// 3.
+			0.0f, y,		// 7.
+			// Top.
+			0.0f, z,		// 7.
+			0,0,		// 3.
+			x, 0,		// 2.
+			x,z,		// 6.
+			// Bottom.
+			0.0f, 0.0f,		// 4.
+			x,0,		// 5.
+			x,z,		// 1.
+			0,z		// 0.
+		} };
+	}
+}
+
 struct Shape
 {
 protected:
@@ -15,7 +315,24 @@ protected:
 	vector<GLfloat> shape_colors;
 	vector<GLfloat> shape_uvs;
 	vector<GLfloat> shape_normals;
-	GLuint vao, ibo, points_vbo, colors_vbo, uv_vbo, normals_vbo;
+	GLuint vao, ibo, vbo;
+	// Set by BufferShape to the format the vertex buffer was packed in, so RecolorShape can rewrite
+	// just the colors in it.
+	void (*pack_vertices)(void*, size_t, const AttributeSource*) = nullptr;
+	void (*pack_one)(int, void*, size_t, const AttributeSource&) = nullptr;
+	GLsizei vertex_stride = 0;
+	// Set by the Static shapes to their compile-time table, the vectors above then stay empty.
+	MeshView table = {};
+	// What OptimizeShape did, nothing until it has run.
+	MeshOptimize::Report optimize_report;
+	// What StripShape did. When strips is set shape_indices are strips, not triangles.
+	MeshStrip::Strips<GLshort> strip_report;
+	static const GLshort RestartIndex = -1;	// 0xFFFF as GL_UNSIGNED_SHORT.
+	// Set by BufferShape when Format stores positions within the shape's bounds, which DrawShape
+	// then gives the shader to undo.
+	bool quantized = false;
+	VertexQuantize::Dequantization dequantization;
+	VertexQuantize::Report quantize_report;
 
 public:
 	~Shape()
@@ -31,9 +348,59 @@ public:
 		shape_normals.clear();
 		shape_normals.shrink_to_fit();
 	}
-	GLsizei NumIndices() { return shape_indices.size(); }
-	void BufferShape()
+	GLsizei NumIndices() { return Data().indexCount; }
+	// The compile-time table if there is one, else the vectors. Colors from RecolorShape always win.
+	MeshView Data() const
 	{
+		MeshView data = table;
+		if (!data.indices)
+		{
+			data.indices = shape_indices.data();
+			data.vertices = shape_vertices.data();
+			data.uvs = shape_uvs.data();
+			data.normals = shape_normals.data();
+			data.indexCount = (GLsizei)shape_indices.size();
+			data.vertexFloats = (GLsizei)shape_vertices.size();
+			data.uvFloats = (GLsizei)shape_uvs.size();
+			data.normalFloats = (GLsizei)shape_normals.size();
+		}
+		if (!shape_colors.empty())
+		{
+			data.colors = shape_colors.data();
+			data.colorFloats = (GLsizei)shape_colors.size();
+		}
+		return data;
+	}
+	// Uploads the shape in Format, ShapeVertex unless a more compact one is asked for, e.g.
+	// BufferShape<CompactShapeVertex>(), for which DrawShape and the shaders stay the same, or
+	// BufferShape<QuantizedShapeVertex>(), for which DrawShape sets the shaders' positionScale,
+	// positionOffset and octahedralNormals uniforms. Quantization() then tells what that cost.
+	// Runs OptimizeShape and StripShape first unless optimize is false, which a shape drawn as
+	// lines needs, e.g. a Grid drawn as GL_LINE_LOOP.
+	template <typename Format = ShapeVertex>
+	void BufferShape(bool optimize = true)
+	{
+		static_assert(Format::attributes == 4, "Shape packs position, color, uv and normal in that order");
+		if (optimize)
+		{
+			OptimizeShape();
+			StripShape();
+		}
+		const MeshView data = Data();
+		pack_vertices = &Format::Pack;
+		pack_one = &Format::PackOne;
+		vertex_stride = Format::Stride();
+		quantized = QuantizedPositions<Format>::value;
+		if (quantized)
+		{
+			const size_t count = data.vertexFloats / 3;
+			dequantization = VertexQuantize::Bounds(data.vertices, count, 3);
+			const GLfloat* normals = (size_t)data.normalFloats >= count * 3 ? data.normals : nullptr;
+			const GLfloat* uvs = (size_t)data.uvFloats >= count * 2 ? data.uvs : nullptr;
+			quantize_report = VertexQuantize::Measure(data.vertices, 3, normals, 3, uvs, 2, count, dequantization,
+				ShapeVertex::Stride(), Format::Stride());
+		}
+
 		vao = 0;
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
@@ -41,53 +408,95 @@ public:
 		ibo = 0;
 		glGenBuffers(1, &ibo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(shape_indices[0]) * shape_indices.size(), &shape_indices.front(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLshort) * data.indexCount, data.indices, GL_STATIC_DRAW);
 
-		points_vbo = 0;
-		glGenBuffers(1, &points_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices[0]) * shape_vertices.size(), &shape_vertices.front(), GL_STATIC_DRAW);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(shape_vertices[0]) * 3, 0);
-		glEnableVertexAttribArray(0);
-
-		colors_vbo = 0;
-		glGenBuffers(1, &colors_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors[0]) * shape_colors.size(), &shape_colors.front(), GL_STATIC_DRAW);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(1);
-
-		uv_vbo = 0;
-		glGenBuffers(1, &uv_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, uv_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(shape_uvs[0]) * shape_uvs.size(), &shape_uvs.front(), GL_STATIC_DRAW);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(2);
-
-		// Uncomment for DirectionalLight example.
-		normals_vbo = 0;
-		glGenBuffers(1, &normals_vbo);
-		glBindBuffer(GL_ARRAY_BUFFER, normals_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(shape_normals[0]) * shape_normals.size(), &shape_normals.front(), GL_STATIC_DRAW);
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(3);
+		// One interleaved buffer of position, color, uv and normal per vertex.
+		const vector<unsigned char> vertices = PackVertices(data);
+		vbo = 0;
+		glGenBuffers(1, &vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+		Format::Setup();
 
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 		glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
 	}
+	// Reorders the triangles for the vertex cache and overdraw and, when every stream has one
+	// entry per vertex, the vertices for fetching, see MeshOptimize.h. Only the order changes,
+	// so this is for triangles: lines drawn through the indices would join different points.
+	// Shapes from a compile-time table are left as they are.
+	const MeshOptimize::Report& OptimizeShape()
+	{
+		if (table.indices || shape_indices.empty() || optimize_report.triangles || strip_report.strips)
+			return optimize_report;
+		const size_t count = shape_vertices.size() / 3;
+		const bool streams = shape_uvs.size() == count * 2 && shape_normals.size() == count * 3
+			&& (shape_colors.empty() || shape_colors.size() == count * 3);
+		vector<unsigned> remap;
+		optimize_report = MeshOptimize::Optimize(shape_indices.data(), shape_indices.size(), count, shape_vertices.data(), 3, streams ? &remap : nullptr);
+		if (streams)
+		{
+			MeshOptimize::Remap(shape_vertices, 3, remap);
+			MeshOptimize::Remap(shape_colors, 3, remap);
+			MeshOptimize::Remap(shape_uvs, 2, remap);
+			MeshOptimize::Remap(shape_normals, 3, remap);
+		}
+		return optimize_report;
+	}
+	const MeshOptimize::Report& Optimization() const { return optimize_report; }
+	// Turns the triangles into strips joined by a primitive restart, see MeshStrip.h, if that
+	// saves indices. DrawShape(GL_TRIANGLES) then draws them as GL_TRIANGLE_STRIP, other modes
+	// would draw the strips' indices as they are.
+	const MeshStrip::Strips<GLshort>& StripShape()
+	{
+		if (table.indices || shape_indices.empty() || strip_report.triangles)
+			return strip_report;
+		strip_report = MeshStrip::Stripify(shape_indices.data(), shape_indices.size(), shape_vertices.size() / 3, RestartIndex);
+		shape_indices.swap(strip_report.indices);
+		strip_report.indices.clear();
+		strip_report.indices.shrink_to_fit();
+		return strip_report;
+	}
+	const MeshStrip::Strips<GLshort>& Strips() const { return strip_report; }
+	const VertexQuantize::Report& Quantization() const { return quantize_report; }
 	void RecolorShape(GLfloat r, GLfloat g, GLfloat b)
 	{
+		// The demos recolor every shape every frame, nearly always to the color it already has.
+		if (HasColor(r, g, b))
+			return;
 		ColorShape(r, g, b);
-		glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors[0]) * shape_colors.size(), &shape_colors.front(), GL_STATIC_DRAW);
+		if (!pack_one)
+			return; // Not buffered yet, BufferShape will pack the new colors.
+		// Only the color bytes of each vertex are written, positions, uvs and normals stay as they are.
+		const MeshView data = Data();
+		const size_t count = data.vertexFloats / 3;
+		const AttributeSource colors = { data.colors, (size_t)data.colorFloats / 3, 3 };
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		if (void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertex_stride * count, GL_MAP_WRITE_BIT))
+		{
+			pack_one(1, mapped, count, colors);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 	void DrawShape(GLchar c)
 	{
+		if (quantized)
+			SetDequantization(true);
 		glBindVertexArray(vao);
-		glDrawElements(c, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
+		if (strip_report.strips && c == GL_TRIANGLES)
+		{
+			glEnable(GL_PRIMITIVE_RESTART);
+			glPrimitiveRestartIndex((GLushort)RestartIndex);
+			glDrawElements(GL_TRIANGLE_STRIP, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
+			glDisable(GL_PRIMITIVE_RESTART);
+		}
+		else
+			glDrawElements(c, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
 		glBindVertexArray(0);
+		if (quantized)
+			SetDequantization(false);	// Back to floats for the next shape drawn with the program.
 	}
 	void CalcAverageNormals(vector<GLshort>& indices, unsigned indiceCount, vector<GLfloat>& vertices, unsigned verticeCount)
 	{
@@ -121,11 +530,50 @@ public:
 	}
 
 protected:
+	// Whether every vertex is already r, g, b.
+	bool HasColor(GLfloat r, GLfloat g, GLfloat b) const
+	{
+		const MeshView data = Data();
+		if (!data.colors || data.colorFloats != data.vertexFloats)
+			return false;
+		for (GLsizei i = 0; i < data.colorFloats; i += 3)
+			if (data.colors[i] != r || data.colors[i + 1] != g || data.colors[i + 2] != b)
+				return false;
+		return true;
+	}
+	// The shape's streams in the format BufferShape chose.
+	vector<unsigned char> PackVertices(const MeshView& data) const
+	{
+		const size_t count = data.vertexFloats / 3;
+		const vector<GLfloat> normalized = quantized ? VertexQuantize::Normalize(data.vertices, count, 3, dequantization) : vector<GLfloat>();
+		const AttributeSource sources[] = {
+			{ quantized ? normalized.data() : data.vertices, count, 3 },
+			{ data.colors, (size_t)data.colorFloats / 3, 3 },
+			{ data.uvs, (size_t)data.uvFloats / 2, 2 },
+			{ data.normals, (size_t)data.normalFloats / 3, 3 }
+		};
+		vector<unsigned char> vertices(vertex_stride * count);
+		pack_vertices(vertices.data(), count, sources);
+		return vertices;
+	}
+	// The uniforms of the current program that undo QuantizedShapeVertex, or that leave floats as
+	// they are. Programs without them ignore them.
+	void SetDequantization(bool on) const
+	{
+		static const VertexQuantize::Dequantization none;
+		const VertexQuantize::Dequantization& d = on ? dequantization : none;
+		GLint program = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+		glUniform3fv(glGetUniformLocation(program, "positionScale"), 1, d.scale);
+		glUniform3fv(glGetUniformLocation(program, "positionOffset"), 1, d.offset);
+		glUniform1i(glGetUniformLocation(program, "octahedralNormals"), on ? 1 : 0);
+	}
 	void ColorShape(GLfloat r, GLfloat g, GLfloat b)
 	{
 		shape_colors.clear();
 		shape_colors.shrink_to_fit();
-		for (int i = 0; i < shape_vertices.size(); i += 3)
+		const GLsizei vertexFloats = Data().vertexFloats;
+		for (int i = 0; i < vertexFloats; i += 3)
 		{
 			shape_colors.push_back(r);
 			shape_colors.push_back(g);
@@ -319,90 +767,9 @@ struct Cube : public Shape
 {
 	Cube(int scale = 1)
 	{
-		shape_indices = {
-			// Front.
-			0, 1, 2,
-			2, 3, 0,
-			// Right.
-			4, 5, 6,
-			6, 7, 4,
-			// Back.
-			8, 9, 10,
-			10, 11, 8,
-			// Left.
-			12, 13, 14,
-			14, 15, 12,
-			// Top.
-			16, 17, 18,
-			18, 19, 16,
-			// Bottom.
-			20, 21, 22,
-			22, 23, 20
-		};
-		shape_vertices = {
-			// Front.
-			0.0f, 0.0f, 1.0f,		// 0.
-			1.0f, 0.0f, 1.0f,		// 1.
-			1.0f, 1.0f, 1.0f,		// 2.
-			0.0f, 1.0f, 1.0f,		// 3.
-			// Right.
-			1.0f, 0.0f, 1.0f,		// 1. 4
-			1.0f, 0.0f, 0.0f,		// 5. 5
-			1.0f, 1.0f, 0.0f,		// 6. 6
-			1.0f, 1.0f, 1.0f,		// 2. 7
-			// Back.
-			1.0f, 0.0f, 0.0f,		// 5. 8
-			0.0f, 0.0f, 0.0f,		// 4. 9
-			0.0f, 1.0f, 0.0f,		// 7. 10
-			1.0f, 1.0f, 0.0f,		// 6. 11
-			// Left.
-			0.0f, 0.0f, 0.0f,		// 4. 12
-			0.0f, 0.0f, 1.0f,		// 0. 13
-			0.0f, 1.0f, 1.0f,		// 3. 14
-			0.0f, 1.0f, 0.0f,		// 7. 15
-			// Top.
-			0.0f, 1.0f, 0.0f,		// 7. 16
-			0.0f, 1.0f, 1.0f,		// 3. 17
-			1.0f, 1.0f, 1.0f,		// 2. 18
-			1.0f, 1.0f, 0.0f,		// 6. 19
-			// Bottom.
-			0.0f, 0.0f, 0.0f,		// 4. 20
-			1.0f, 0.0f, 0.0f,		// 5. 21
-			1.0f, 0.0f, 1.0f,		// 1. 22
-			0.0f, 0.0f, 1.0f		// 0. 23
-		};
-		shape_uvs = {
-			// Front.
-			0.0f, 0.0f, 	// 0.
-			1.0f, 0.0f, 	// 1.
-			1.0f, 1.0f, 	// 2.
-			0.0f, 1.0f,		// 3.
-			// Right.
-			0.0f, 0.0f, 	// 1.
-			1.0f, 0.0f, 	// 5.
-			1.0f, 1.0f, 	// 6.
-			0.0f, 1.0f,		// 2.
-			// Back.
-			0.0f, 0.0f, 	// 5.
-			1.0f, 0.0f, 	// 4.
-			1.0f, 1.0f,		// 7.
-			0.0f, 1.0f,		// 6.
-			// Left.
-			0.0f, 0.0f,		// 4.
-			1.0f, 0.0f,		// 0.
-			1.0f, 1.0f,		// 3.
-			0.0f, 1.0f,		// 7.
-			// Top.
-			0.0f, 0.0f,		// 7.
-			1.0f, 0.0f,		// 3.
-			1.0f, 1.0f,		// 2.
-			0.0f, 1.0f,		// 6.
-			// Bottom.
-			0.0f, 0.0f,		// 4.
-			1.0f, 0.0f,		// 5.
-			1.0f, 1.0f,		// 1.
-			0.0f, 1.0f		// 0.
-		};
+		shape_indices.assign(begin(MeshGen::CubeIndices), end(MeshGen::CubeIndices));
+		shape_vertices.assign(begin(MeshGen::CubeVertices), end(MeshGen::CubeVertices));
+		shape_uvs.assign(begin(MeshGen::CubeUvs), end(MeshGen::CubeUvs));
 		for (unsigned i = 0; i < shape_uvs.size(); i++)
 			shape_uvs[i] *= scale;
 		ColorShape(1.0f, 1.0f, 1.0f);
@@ -414,92 +781,10 @@ struct Cube2 : public Shape
 {
 	Cube2(GLfloat x = 1, GLfloat y = 1, GLfloat z = 1)
 	{
-		shape_indices = {
-			// Front.
-			0, 1, 2,
-			2, 3, 0,
-			// Right.
-			4, 5, 6,
-			6, 7, 4,
-			// Back.
-			8, 9, 10,
-			10, 11, 8,
-			// Left.
-			12, 13, 14,
-			14, 15, 12,
-			// Top.
-			16, 17, 18,
-			18, 19, 16,
-			// Bottom.
-			20, 21, 22,
-			22, 23, 20
-		};
-		shape_vertices = {
-			// Front.
-			0.0f, 0.0f, 1.0f,		// 0.
-			1.0f, 0.0f, 1.0f,		// 1.
-			1.0f, 1.0f, 1.0f,		// 2.
-			0.0f, 1.0f, 1.0f,		// 3.
-			// Right.
-			1.0f, 0.0f, 1.0f,		// 1. 4
-			1.0f, 0.0f, 0.0f,		// 5. 5
-			1.0f, 1.0f, 0.0f,		// 6. 6
-			1.0f, 1.0f, 1.0f,		// 2. 7
-			// Back.
-			1.0f, 0.0f, 0.0f,		// 5. 8
-			0.0f, 0.0f, 0.0f,		// 4. 9
-			0.0f, 1.0f, 0.0f,		// 7. 10
-			1.0f, 1.0f, 0.0f,		// 6. 11
-			// Left.
-			0.0f, 0.0f, 0.0f,		// 4. 12
-			0.0f, 0.0f, 1.0f,		// 0. 13
-			0.0f, 1.0f, 1.0f,		// 3. 14
-			0.0f, 1.0f, 0.0f,		// 7. 15
-			// Top.
-			0.0f, 1.0f, 0.0f,		// 7. 16
-			0.0f, 1.0f, 1.0f,		// 3. 17
-			1.0f, 1.0f, 1.0f,		// 2. 18
-			1.0f, 1.0f, 0.0f,		// 6. 19
-			// Bottom.
-			0.0f, 0.0f, 0.0f,		// 4. 20
-			1.0f, 0.0f, 0.0f,		// 5. 21
-			1.0f, 0.0f, 1.0f,		// 1. 22
-			0.0f, 0.0f, 1.0f		// 0. 23
-		};
-		shape_uvs = {
-			// Front.
-			0.0f, 0.0f, 	// 0.
-			x, 0.0f, 	// 1.
-			x, y, 	// 2.
-			0, y,		// 3.
-			// Right.
-			0.0f, 0.0f, 	// 1.
-			z, 0.0f, 	// 5.
-			z,y, 	// 6.
-			0.0f, y,		// 2.
-			// Back.
-			0.0f, 0.0f, 	// 5.
-			x,0, 	// 4.
-			x,y,		// 7.
-			0.0f, y,		// 6.
-			// Left.
-			0.0f, 0.0f,		// 4.
-			z, 0.0f,		// 0.
-			z,y,		// 3.
-			0.0f, y,		// 7.
-			// Top.
-			0.0f, z,		// 7.
-			0,0,		// 3.
-			x, 0,		// 2.
-			x,z,		// 6.
-			// Bottom.
-			0.0f, 0.0f,		// 4.
-			x,0,		// 5.
-			x,z,		// 1.
-			0,z		// 0.
-		};
-		/*for (unsigned i = 0; i < shape_uvs.size(); i++)
-			shape_uvs[i] *= scale;*/
+		shape_indices.assign(begin(MeshGen::CubeIndices), end(MeshGen::CubeIndices));
+		shape_vertices.assign(begin(MeshGen::CubeVertices), end(MeshGen::CubeVertices));
+		const std::array<GLfloat, 48> uvs = MeshGen::Cube2Uvs(x, y, z);
+		shape_uvs.assign(uvs.begin(), uvs.end());
 		ColorShape(1.0f, 1.0f, 1.0f);
 		CalcAverageNormals(shape_indices, shape_indices.size(), shape_vertices, shape_vertices.size());
 	}
@@ -636,4 +921,227 @@ struct Cone : public Shape
 		ColorShape(1.0f, 1.0f, 1.0f);
 		CalcAverageNormals(shape_indices, shape_indices.size(), shape_vertices, shape_vertices.size());
 	}
-};
\ No newline at end of file
+};
+
+// ---------------------------------------------------------------------------------
+// Static shapes
+// ---------------------------------------------------------------------------------
+// The shapes above with their parameters fixed at compile time, e.g. StaticPrism<8> or
+// StaticCone<32>. Their data is worked out by the compiler, the same numbers the run time
+// constructors produce, and kept in read-only tables that BufferShape uploads from directly,
+// so creating one costs nothing. Use the run time shapes for sizes only known while running.
+
+namespace MeshGen
+{
+	// Plane.
+	constexpr MeshTable<4, 6> Plane()
+	{
+		Builder<4, 6> mesh;
+		mesh.Triangle(0, 1, 2);
+		mesh.Triangle(2, 3, 0);
+		mesh.Vertex(0.0f, 0.0f, 0.0f);
+		mesh.Vertex(1.0f, 0.0f, 0.0f);
+		mesh.Vertex(1.0f, 1.0f, 0.0f);
+		mesh.Vertex(0.0f, 1.0f, 0.0f);
+		for (int i = 0; i < 4 * 3; i += 3)
+			mesh.Uv(mesh.table.vertices[i], mesh.table.vertices[i + 1]);
+		return mesh.Finish(1.0f, 1.0f, 1.0f);
+	}
+
+	// Cube(scale) or, with cube2, Cube2(x, y, z).
+	constexpr MeshTable<24, 36> Cube(bool cube2, GLfloat x, GLfloat y, GLfloat z)
+	{
+		Builder<24, 36> mesh;
+		for (int i = 0; i < 36; i += 3)
+			mesh.Triangle(CubeIndices[i], CubeIndices[i + 1], CubeIndices[i + 2]);
+		for (int i = 0; i < 24 * 3; i += 3)
+			mesh.Vertex(CubeVertices[i], CubeVertices[i + 1], CubeVertices[i + 2]);
+		const std::array<GLfloat, 48> uvs2 = Cube2Uvs(x, y, z);
+		for (int i = 0; i < 24 * 2; i += 2)
+		{
+			if (cube2)
+				mesh.Uv(uvs2[i], uvs2[i + 1]);
+			else
+				mesh.Uv(CubeUvs[i] * x, CubeUvs[i + 1] * x);
+		}
+		return mesh.Finish(1.0f, 1.0f, 1.0f);
+	}
+
+	// Prism(sides).
+	template <int Sides>
+	constexpr MeshTable<2 * (Sides + 1), 12 * Sides> Prism()
+	{
+		Builder<2 * (Sides + 1), 12 * Sides> mesh;
+		float theta = 0.0f;
+		// Top face.
+		mesh.Vertex(0.5f, 1.0f, 0.5f);
+		mesh.Uv(0, 0);
+		for (int i = 0; i < Sides; ++i)
+		{
+			mesh.Vertex(0.5f + 0.5f * Cos(theta), 1.0f, 0.5f + 0.5f * Sin(theta));
+			theta += 2 * PI / Sides;
+			mesh.Uv(0, 1);
+		}
+		// Bottom face.
+		mesh.Vertex(0.5f, 0.0f, 0.5f);
+		mesh.Uv(0, 0);
+		for (int i = 0; i < Sides; ++i)
+		{
+			mesh.Vertex(0.5f + 0.5f * Cos(theta), 0.0f, 0.5f + 0.5f * Sin(theta));
+			theta += 2 * PI / Sides;
+			mesh.Uv(1, 0);
+		}
+		// Indices now.
+		// Bottom face.
+		for (int i = Sides + 1; i < Sides * 2; i++)
+			mesh.Triangle(Sides + 1, i + 1, i + 2);
+		mesh.Triangle(Sides + 1, Sides * 2 + 1, Sides + 2);
+		// Middle faces.
+		for (int i = 1; i < Sides; i++)
+		{
+			mesh.Triangle(i, i + 1, Sides + i + 2);
+			mesh.Triangle(Sides + i + 2, Sides + i + 1, i);
+		}
+		mesh.Triangle(Sides, 1, Sides + 2);
+		mesh.Triangle(Sides + 2, Sides * 2 + 1, Sides);
+		// Top face.
+		for (int i = 1; i < Sides; i++)
+			mesh.Triangle(0, i + 1, i);
+		mesh.Triangle(0, 1, Sides);
+		return mesh.Finish(1.0f, 1.0f, 1.0f);
+	}
+
+	// Cone(sides).
+	template <int Sides>
+	constexpr MeshTable<Sides + 2, 6 * Sides> Cone()
+	{
+		Builder<Sides + 2, 6 * Sides> mesh;
+		float theta = 0.0f;
+		// Bottom face.
+		mesh.Vertex(0.5f, 0.0f, 0.5f);
+		for (int i = 0; i < Sides; ++i)
+		{
+			mesh.Vertex(0.5f + 0.5f * Cos(theta), 0.0f, 0.5f + 0.5f * Sin(theta));
+			theta += 2 * PI / Sides;
+		}
+		mesh.Vertex(0.5f, 1.0f, 0.5f);
+		// Indices now. Bottom face.
+		for (int i = 1; i < Sides; i++)
+			mesh.Triangle(0, i, i + 1);
+		mesh.Triangle(0, Sides, 1);
+		// Middle faces.
+		for (int i = 1; i < Sides; i++)
+			mesh.Triangle(i, Sides + 1, i + 1);
+		mesh.Triangle(Sides, Sides + 1, 1);
+		for (int i = 0; i < Sides + 2; i++)
+			mesh.Uv(0, 0); // No texture, so value doesn't matter.
+		return mesh.Finish(1.0f, 1.0f, 1.0f);
+	}
+}
+
+struct StaticPlane : public Shape
+{
+	StaticPlane() { table = Mesh().View(); }
+	static const MeshTable<4, 6>& Mesh()
+	{
+		static constexpr MeshTable<4, 6> mesh = MeshGen::Plane();
+		return mesh;
+	}
+};
+
+template <int Scale = 1>
+struct StaticCube : public Shape
+{
+	StaticCube() { table = Mesh().View(); }
+	static const MeshTable<24, 36>& Mesh()
+	{
+		static constexpr MeshTable<24, 36> mesh = MeshGen::Cube(false, Scale, Scale, Scale);
+		return mesh;
+	}
+};
+
+template <int X = 1, int Y = 1, int Z = 1>
+struct StaticCube2 : public Shape
+{
+	StaticCube2() { table = Mesh().View(); }
+	static const MeshTable<24, 36>& Mesh()
+	{
+		static constexpr MeshTable<24, 36> mesh = MeshGen::Cube(true, X, Y, Z);
+		return mesh;
+	}
+};
+
+template <int Sides>
+struct StaticPrism : public Shape
+{
+	StaticPrism() { table = Mesh().View(); }
+	static const MeshTable<2 * (Sides + 1), 12 * Sides>& Mesh()
+	{
+		static constexpr MeshTable<2 * (Sides + 1), 12 * Sides> mesh = MeshGen::Prism<Sides>();
+		return mesh;
+	}
+};
+
+template <int Sides>
+struct StaticCone : public Shape
+{
+	StaticCone() { table = Mesh().View(); }
+	static const MeshTable<Sides + 2, 6 * Sides>& Mesh()
+	{
+		static constexpr MeshTable<Sides + 2, 6 * Sides> mesh = MeshGen::Cone<Sides>();
+		return mesh;
+	}
+};
+
+// Builds every Static shape next to the run time shape it stands for and compares the two:
+// indices, colours and uvs must be the same, positions and normals within a few float ulps, as
+// the compiler's sin, cos and sqrt aren't quite the library's. A line per shape goes to out.
+inline bool CheckStaticShapes(ostream& out)
+{
+	// Largest difference between two arrays, in units of the last place of the larger value,
+	// or -1 if their lengths differ.
+	auto ulps = [](const GLfloat* a, GLsizei aCount, const GLfloat* b, GLsizei bCount)
+	{
+		if (aCount != bCount)
+			return -1.0f;
+		float worst = 0.0f;
+		for (GLsizei i = 0; i < aCount; i++)
+		{
+			const float scale = max(max(fabsf(a[i]), fabsf(b[i])), 1.0f);
+			worst = max(worst, fabsf(a[i] - b[i]) / (scale * FLT_EPSILON));
+		}
+		return worst;
+	};
+	auto compare = [&](const char* name, const Shape& built, const Shape& runtime)
+	{
+		const MeshView s = built.Data(), r = runtime.Data();
+		const bool indices = s.indexCount == r.indexCount && equal(s.indices, s.indices + s.indexCount, r.indices);
+		const float colors = ulps(s.colors, s.colorFloats, r.colors, r.colorFloats);
+		const float uvs = ulps(s.uvs, s.uvFloats, r.uvs, r.uvFloats);
+		const float vertices = ulps(s.vertices, s.vertexFloats, r.vertices, r.vertexFloats);
+		const float normals = ulps(s.normals, s.normalFloats, r.normals, r.normalFloats);
+		const bool ok = indices && colors == 0.0f && uvs == 0.0f && vertices >= 0.0f && vertices <= 4.0f
+			&& normals >= 0.0f && normals <= 4.0f;
+		out << name << ": " << s.indexCount << " indices " << (indices ? "same" : "DIFFER") << ", colours "
+			<< (colors == 0.0f ? "same" : "DIFFER") << ", uvs " << (uvs == 0.0f ? "same" : "DIFFER")
+			<< ", positions within " << vertices << " ulp, normals within " << normals << " ulp"
+			<< (ok ? "" : "  FAILED") << endl;
+		return ok;
+	};
+	bool ok = compare("Plane", StaticPlane(), Plane());
+	ok &= compare("Cube", StaticCube<>(), Cube());
+	ok &= compare("Cube(3)", StaticCube<3>(), Cube(3));
+	ok &= compare("Cube2", StaticCube2<>(), Cube2());
+	ok &= compare("Cube2(2, 2, 2)", StaticCube2<2, 2, 2>(), Cube2(2, 2, 2));
+	ok &= compare("Cube2(1, 2, 3)", StaticCube2<1, 2, 3>(), Cube2(1, 2, 3));
+	ok &= compare("Prism(3)", StaticPrism<3>(), Prism(3));
+	ok &= compare("Prism(7)", StaticPrism<7>(), Prism(7));
+	ok &= compare("Prism(8)", StaticPrism<8>(), Prism(8));
+	ok &= compare("Prism(32)", StaticPrism<32>(), Prism(32));
+	ok &= compare("Cone(3)", StaticCone<3>(), Cone(3));
+	ok &= compare("Cone(8)", StaticCone<8>(), Cone(8));
+	ok &= compare("Cone(32)", StaticCone<32>(), Cone(32));
+	ok &= compare("Cone(64)", StaticCone<64>(), Cone(64));
+	out << (ok ? "Static shapes match the run time ones." : "Static shapes DIFFER from the run time ones.") << endl;
+	return ok;
+}
@@ -0,0 +1,625 @@
+#pragma once
+
+#include "Shape.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <unordered_map>
+
+///////////////////////////////////////////////////////////////////////
+// @file Subdivision.h
+// @brief A half-edge mesh of any polygons, and Loop and Catmull-Clark subdivision of it.
+//
+// Sphere's divide_triangle can only push new vertices out onto the unit sphere. Here each level
+// works out the new vertices from the old ones' neighbours, so any closed or open model smooths
+// towards its limit surface: Loop for triangle meshes, Catmull-Clark for any polygons, which it
+// turns into quads.
+//
+// Edges may be given a sharpness. An edge of sharpness s is subdivided as a crease for the first
+// s levels, then blended into the smooth rule over the last fraction of one, as in Pixar's
+// semi-sharp creases. Border edges are creases for good. Where two creases meet at a vertex it
+// slides along them, and where three or more meet it stays put as a corner.
+//
+// UVs are face-varying, one per half-edge, and are subdivided linearly, so seams stay seams.
+// Within a level every vertex, edge and face is worked out on its own, split across all cores,
+// and the next level's adjacency is built the same way.
+//
+//	Subdivision::Mesh cage = Subdivision::Cube();
+//	Subdivision::SetCrease(cage, 4, 5, 2.0f);		// Vertices 4 and 5, sharp for two levels.
+//	Subdivision::Mesh smooth = Subdivision::Subdivide(cage, Subdivision::CatmullClark, 3);
+//	g_shape.Load(Subdivision::Export(smooth));		// A SubdivisionShape, buffer and draw it as any other Shape.
+//
+// Any Shape's triangles can be the cage too, with Subdivision::FromShape(shape.Data()).
+///////////////////////////////////////////////////////////////////////
+
+namespace Subdivision
+{
+	const float Infinite = 1e30f;		// Sharpness of a border edge, which never wears off.
+
+	enum Scheme { Loop, CatmullClark };
+
+	// Polygons as half-edges. Face f's half-edges are faceStart[f] to faceStart[f + 1] in order
+	// around it, and half-edge h runs from origin[h] to the origin of the next one.
+	struct Mesh
+	{
+		vector<glm::vec3> positions;
+		vector<glm::vec2> uvs;			// Per half-edge: the face's UV at its origin. Empty if none.
+		vector<int> faceStart;
+		vector<int> origin;
+		vector<int> face;				// The face of each half-edge...
+		vector<int> twin;				// ...the one running the other way along the same edge, -1 on a border...
+		vector<int> edge;				// ...and the edge it is on.
+		vector<int> edgeHalf;			// One half-edge of each edge.
+		vector<float> sharpness;		// Per edge, Infinite on a border.
+		vector<int> outStart, outgoing;	// The half-edges leaving vertex v are outgoing[outStart[v]] to outgoing[outStart[v + 1] - 1].
+		double milliseconds = 0.0;		// How long making this mesh took...
+		double buildMilliseconds = 0.0;	// ...of which building the adjacency.
+
+		int Vertices() const { return (int)positions.size(); }
+		int Faces() const { return faceStart.empty() ? 0 : (int)faceStart.size() - 1; }
+		int HalfEdges() const { return (int)origin.size(); }
+		int Edges() const { return (int)edgeHalf.size(); }
+		int Next(int h) const { return h + 1 < faceStart[face[h] + 1] ? h + 1 : faceStart[face[h]]; }
+		int Prev(int h) const { return h > faceStart[face[h]] ? h - 1 : faceStart[face[h] + 1] - 1; }
+		int Dest(int h) const { return origin[Next(h)]; }
+		bool Triangles() const { return HalfEdges() == Faces() * 3; }
+	};
+
+	// Below this many items a level's loops stay on one thread, see ParallelFor.
+	const int ParallelFrom = 16384;
+
+	// Fills in face, twin, edge, edgeHalf, sharpness and outgoing from positions, faceStart and
+	// origin. An edge used by more than two faces, or twice in the same direction, is taken as a
+	// border by every face on it. Sharpness starts at 0 inside and Infinite on borders.
+	inline void Build(Mesh& mesh)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		const int vertices = mesh.Vertices(), faces = mesh.Faces(), halfEdges = mesh.HalfEdges();
+		mesh.face.resize(halfEdges);
+		ParallelFor(faces, faces >= ParallelFrom, [&](int first, int last)
+		{
+			for (int f = first; f < last; f++)
+				for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; h++)
+					mesh.face[h] = f;
+		});
+
+		// Counting sort of the half-edges by origin.
+		mesh.outStart.assign(vertices + 1, 0);
+		for (int h = 0; h < halfEdges; h++)
+			mesh.outStart[mesh.origin[h] + 1]++;
+		for (int v = 0; v < vertices; v++)
+			mesh.outStart[v + 1] += mesh.outStart[v];
+		mesh.outgoing.resize(halfEdges);
+		{
+			vector<int> fill(mesh.outStart.begin(), mesh.outStart.end() - 1);
+			for (int h = 0; h < halfEdges; h++)
+				mesh.outgoing[fill[mesh.origin[h]]++] = h;
+		}
+
+		// The twin of a -> b is the only b -> a, if a -> b is the only one of its own.
+		mesh.twin.resize(halfEdges);
+		ParallelFor(halfEdges, halfEdges >= ParallelFrom, [&](int first, int last)
+		{
+			for (int h = first; h < last; h++)
+			{
+				const int a = mesh.origin[h], b = mesh.Dest(h);
+				int twin = -1, back = 0, same = 0;
+				for (int i = mesh.outStart[b]; i < mesh.outStart[b + 1]; i++)
+					if (mesh.Dest(mesh.outgoing[i]) == a)
+					{
+						twin = mesh.outgoing[i];
+						back++;
+					}
+				for (int i = mesh.outStart[a]; i < mesh.outStart[a + 1]; i++)
+					if (mesh.Dest(mesh.outgoing[i]) == b)
+						same++;
+				mesh.twin[h] = back == 1 && same == 1 ? twin : -1;
+			}
+		});
+
+		// Edges are numbered in the order of their first half-edge.
+		mesh.edge.resize(halfEdges);
+		mesh.edgeHalf.clear();
+		for (int h = 0; h < halfEdges; h++)
+			if (mesh.twin[h] < h)
+			{
+				mesh.edge[h] = (int)mesh.edgeHalf.size();
+				mesh.edgeHalf.push_back(h);
+			}
+		ParallelFor(halfEdges, halfEdges >= ParallelFrom, [&](int first, int last)
+		{
+			for (int h = first; h < last; h++)
+				if (mesh.twin[h] > h)
+					mesh.edge[h] = mesh.edge[mesh.twin[h]];
+		});
+		mesh.sharpness.resize(mesh.edgeHalf.size());
+		for (size_t e = 0; e < mesh.edgeHalf.size(); e++)
+			mesh.sharpness[e] = mesh.twin[mesh.edgeHalf[e]] < 0 ? Infinite : 0.0f;
+		mesh.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// A mesh of faces of faceSizes[f] corners each, listed in indices. uvs, if given, has one
+	// UV per entry of indices.
+	inline Mesh FromPolygons(const vector<glm::vec3>& positions, const vector<int>& faceSizes, const vector<int>& indices,
+		const vector<glm::vec2>& uvs = vector<glm::vec2>())
+	{
+		Mesh mesh;
+		mesh.positions = positions;
+		mesh.origin = indices;
+		if (uvs.size() == indices.size())
+			mesh.uvs = uvs;
+		mesh.faceStart.assign(1, 0);
+		for (int size : faceSizes)
+			mesh.faceStart.push_back(mesh.faceStart.back() + size);
+		Build(mesh);
+		return mesh;
+	}
+
+	// A mesh of the triangles of a Shape-like indexed list, whose vertices are three floats each.
+	// Vertices at the same position are welded into one, so a shape made of separate triangles,
+	// like Sphere, or with UV seams, still subdivides as one surface. uvs may be null.
+	template <typename Index>
+	Mesh FromTriangles(const GLfloat* vertices, size_t vertexCount, const Index* indices, size_t indexCount, const GLfloat* uvs = nullptr)
+	{
+		struct Hash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				size_t hash = 2166136261u;
+				for (int c = 0; c < 3; c++)
+				{
+					GLuint bits;
+					memcpy(&bits, &p[c], sizeof(bits));
+					hash = (hash ^ bits) * 16777619u;
+				}
+				return hash;
+			}
+		};
+		std::unordered_map<glm::vec3, int, Hash> welded;
+		vector<int> weld(vertexCount);
+		vector<glm::vec3> positions;
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			const glm::vec3 p(vertices[v * 3], vertices[v * 3 + 1], vertices[v * 3 + 2]);
+			weld[v] = welded.insert(std::make_pair(p, (int)positions.size())).first->second;
+			if (weld[v] == (int)positions.size())
+				positions.push_back(p);
+		}
+
+		vector<int> corners;
+		vector<glm::vec2> cornerUVs;
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const int a = weld[(size_t)indices[i]], b = weld[(size_t)indices[i + 1]], c = weld[(size_t)indices[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;	// Nothing to subdivide, and it would pinch the mesh.
+			corners.insert(corners.end(), { a, b, c });
+			if (uvs)
+				for (int k = 0; k < 3; k++)
+					cornerUVs.push_back(glm::vec2(uvs[(size_t)indices[i + k] * 2], uvs[(size_t)indices[i + k] * 2 + 1]));
+		}
+		return FromPolygons(positions, vector<int>(corners.size() / 3, 3), corners, cornerUVs);
+	}
+
+	// A mesh of a Shape's triangles, from its Data(). Not for a shape that has been made into strips.
+	inline Mesh FromShape(const MeshView& data)
+	{
+		return FromTriangles(data.vertices, (size_t)data.vertexFloats / 3, data.indices, (size_t)data.indexCount,
+			data.uvFloats ? data.uvs : nullptr);
+	}
+
+	// A unit cube of six quads around the origin, each with UVs 0..1.
+	inline Mesh Cube()
+	{
+		const vector<glm::vec3> positions = {
+			{ -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f },
+			{ -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }
+		};
+		const vector<int> indices = { 0, 1, 2, 3,  1, 5, 6, 2,  5, 4, 7, 6,  4, 0, 3, 7,  3, 2, 6, 7,  4, 5, 1, 0 };
+		vector<glm::vec2> uvs;
+		for (int f = 0; f < 6; f++)
+			uvs.insert(uvs.end(), { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } });
+		return FromPolygons(positions, vector<int>(6, 4), indices, uvs);
+	}
+
+	// Makes the edge between vertices a and b as sharp as sharpness. False if there is none.
+	inline bool SetCrease(Mesh& mesh, int a, int b, float sharpness)
+	{
+		for (int v : { a, b })
+			for (int i = mesh.outStart[v]; i < mesh.outStart[v + 1]; i++)
+			{
+				const int h = mesh.outgoing[i];
+				if (mesh.Dest(h) == (v == a ? b : a))
+				{
+					if (mesh.twin[h] >= 0)
+						mesh.sharpness[mesh.edge[h]] = sharpness;
+					return true;
+				}
+			}
+		return false;
+	}
+
+	namespace Detail
+	{
+		// What a vertex's edges say about it: how many, their far ends, and its creases.
+		struct Around
+		{
+			int edges = 0, faces = 0, creases = 0;
+			glm::vec3 neighbours = glm::vec3(0.0f), faceSum = glm::vec3(0.0f);
+			glm::vec3 creaseEnds[2];
+			float creaseSharpness = 0.0f;	// Sum over the creases, Infinite counted as 1.
+		};
+
+		// faceCenter, if given, also sums the face points around v.
+		inline Around Gather(const Mesh& mesh, int v, const vector<glm::vec3>* faceCenter)
+		{
+			Around around;
+			auto add = [&](int e, int other)
+			{
+				around.edges++;
+				const glm::vec3& end = mesh.positions[other];
+				around.neighbours += end;
+				const float s = mesh.sharpness[e];
+				if (s > 0.0f)
+				{
+					if (around.creases < 2)
+						around.creaseEnds[around.creases] = end;
+					around.creases++;
+					around.creaseSharpness += std::min(s, 1.0f);
+				}
+			};
+			for (int i = mesh.outStart[v]; i < mesh.outStart[v + 1]; i++)
+			{
+				const int h = mesh.outgoing[i];
+				add(mesh.edge[h], mesh.Dest(h));
+				const int incoming = mesh.Prev(h);
+				if (mesh.twin[incoming] < 0)
+					add(mesh.edge[incoming], mesh.origin[incoming]);	// A border edge no half-edge leaves v along.
+				if (faceCenter)
+					around.faceSum += (*faceCenter)[mesh.face[h]];
+				around.faces++;
+			}
+			return around;
+		}
+
+		// The vertex rule: smooth where fewer than two creases meet, sliding along two, fixed at
+		// three or more, blended back to smooth as the creases wear off.
+		inline glm::vec3 Blend(const Around& around, const glm::vec3& p, const glm::vec3& smooth, float creaseWeight)
+		{
+			if (around.creases < 2)
+				return smooth;
+			const glm::vec3 sharp = around.creases == 2
+				? p * (1.0f - 2.0f * creaseWeight) + (around.creaseEnds[0] + around.creaseEnds[1]) * creaseWeight
+				: p;
+			const float t = std::min(around.creaseSharpness / around.creases, 1.0f);
+			return smooth + (sharp - smooth) * t;
+		}
+
+		inline float ChildSharpness(float s)
+		{
+			return s >= Infinite ? Infinite : std::max(0.0f, s - 1.0f);
+		}
+
+		// Sharpness of the new mesh's edges: an edge from an old vertex to the point on an old
+		// edge is half of that edge and one level less sharp, the rest are new and smooth.
+		inline void InheritSharpness(const Mesh& parent, Mesh& child)
+		{
+			const int vertices = parent.Vertices(), edges = parent.Edges();
+			ParallelFor(child.Edges(), child.Edges() >= ParallelFrom, [&](int first, int last)
+			{
+				for (int e = first; e < last; e++)
+				{
+					const int h = child.edgeHalf[e];
+					if (child.twin[h] < 0)
+						continue;
+					int a = child.origin[h], b = child.Dest(h);
+					if (a > b)
+						std::swap(a, b);
+					child.sharpness[e] = a < vertices && b >= vertices && b < vertices + edges
+						? ChildSharpness(parent.sharpness[b - vertices]) : 0.0f;
+				}
+			});
+		}
+	}
+
+	// One level of Loop subdivision: each triangle into four, the new vertex on edge a-b with
+	// opposite corners c and d at 3/8 (a + b) + 1/8 (c + d), and each old vertex moved to
+	// (1 - n beta) of itself plus beta of each of its n neighbours (Warren's beta). The mesh must
+	// be triangles; anything else comes back as it is.
+	inline Mesh LoopStep(const Mesh& mesh)
+	{
+		if (!mesh.Triangles())
+			return mesh;
+		const auto start = std::chrono::high_resolution_clock::now();
+		const int vertices = mesh.Vertices(), edges = mesh.Edges(), faces = mesh.Faces();
+		Mesh child;
+		child.positions.resize(vertices + edges);
+
+		ParallelFor(vertices, vertices >= ParallelFrom, [&](int first, int last)
+		{
+			for (int v = first; v < last; v++)
+			{
+				const glm::vec3& p = mesh.positions[v];
+				const Detail::Around around = Detail::Gather(mesh, v, nullptr);
+				if (around.edges == 0)
+				{
+					child.positions[v] = p;
+					continue;
+				}
+				const float n = (float)around.edges, beta = around.edges == 3 ? 3.0f / 16.0f : 3.0f / (8.0f * n);
+				const glm::vec3 smooth = p * (1.0f - n * beta) + around.neighbours * beta;
+				child.positions[v] = Detail::Blend(around, p, smooth, 1.0f / 8.0f);
+			}
+		});
+		ParallelFor(edges, edges >= ParallelFrom, [&](int first, int last)
+		{
+			for (int e = first; e < last; e++)
+			{
+				const int h = mesh.edgeHalf[e], twin = mesh.twin[h];
+				const glm::vec3 middle = (mesh.positions[mesh.origin[h]] + mesh.positions[mesh.Dest(h)]) * 0.5f;
+				glm::vec3 point = middle;
+				if (twin >= 0)
+				{
+					const glm::vec3 smooth = middle * 0.75f
+						+ (mesh.positions[mesh.origin[mesh.Prev(h)]] + mesh.positions[mesh.origin[mesh.Prev(twin)]]) * 0.125f;
+					point = smooth + (middle - smooth) * std::min(mesh.sharpness[e], 1.0f);
+				}
+				child.positions[vertices + e] = point;
+			}
+		});
+
+		// Corners a, b, c with edge points ab, bc, ca make (a, ab, ca), (ab, b, bc), (ca, bc, c), (ab, bc, ca).
+		child.faceStart.resize(faces * 4 + 1);
+		child.origin.resize(faces * 12);
+		if (!mesh.uvs.empty())
+			child.uvs.resize(faces * 12);
+		ParallelFor(faces, faces >= ParallelFrom, [&](int first, int last)
+		{
+			for (int f = first; f < last; f++)
+			{
+				const int h = f * 3;
+				const int corner[3] = { mesh.origin[h], mesh.origin[h + 1], mesh.origin[h + 2] };
+				const int middle[3] = { vertices + mesh.edge[h], vertices + mesh.edge[h + 1], vertices + mesh.edge[h + 2] };
+				const int triangles[12] = {
+					corner[0], middle[0], middle[2],  middle[0], corner[1], middle[1],
+					middle[2], middle[1], corner[2],  middle[0], middle[1], middle[2] };
+				for (int k = 0; k < 4; k++)
+					child.faceStart[f * 4 + k] = f * 12 + k * 3;
+				std::copy(triangles, triangles + 12, child.origin.begin() + f * 12);
+				if (!mesh.uvs.empty())
+				{
+					const glm::vec2 uv[3] = { mesh.uvs[h], mesh.uvs[h + 1], mesh.uvs[h + 2] };
+					const glm::vec2 mid[3] = { (uv[0] + uv[1]) * 0.5f, (uv[1] + uv[2]) * 0.5f, (uv[2] + uv[0]) * 0.5f };
+					const glm::vec2 uvs[12] = { uv[0], mid[0], mid[2],  mid[0], uv[1], mid[1],  mid[2], mid[1], uv[2],  mid[0], mid[1], mid[2] };
+					std::copy(uvs, uvs + 12, child.uvs.begin() + f * 12);
+				}
+			}
+		});
+		child.faceStart[faces * 4] = faces * 12;
+
+		Build(child);
+		Detail::InheritSharpness(mesh, child);
+		child.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return child;
+	}
+
+	// One level of Catmull-Clark subdivision: a point in each face at its centre, one on each edge
+	// at the average of its ends and the two face points, and each old vertex moved to
+	// (F + 2R + (n - 3) P) / n, from the average F of its face points and R of its edges' middles.
+	// An n-sided face becomes n quads.
+	inline Mesh CatmullClarkStep(const Mesh& mesh)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		const int vertices = mesh.Vertices(), edges = mesh.Edges(), faces = mesh.Faces(), halfEdges = mesh.HalfEdges();
+		Mesh child;
+		child.positions.resize(vertices + edges + faces);
+		vector<glm::vec3> faceCenter(faces);
+
+		ParallelFor(faces, faces >= ParallelFrom, [&](int first, int last)
+		{
+			for (int f = first; f < last; f++)
+			{
+				glm::vec3 sum(0.0f);
+				for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; h++)
+					sum += mesh.positions[mesh.origin[h]];
+				faceCenter[f] = sum / (float)(mesh.faceStart[f + 1] - mesh.faceStart[f]);
+				child.positions[vertices + edges + f] = faceCenter[f];
+			}
+		});
+		ParallelFor(edges, edges >= ParallelFrom, [&](int first, int last)
+		{
+			for (int e = first; e < last; e++)
+			{
+				const int h = mesh.edgeHalf[e], twin = mesh.twin[h];
+				const glm::vec3 middle = (mesh.positions[mesh.origin[h]] + mesh.positions[mesh.Dest(h)]) * 0.5f;
+				glm::vec3 point = middle;
+				if (twin >= 0)
+				{
+					const glm::vec3 smooth = (middle * 2.0f + faceCenter[mesh.face[h]] + faceCenter[mesh.face[twin]]) * 0.25f;
+					point = smooth + (middle - smooth) * std::min(mesh.sharpness[e], 1.0f);
+				}
+				child.positions[vertices + e] = point;
+			}
+		});
+		ParallelFor(vertices, vertices >= ParallelFrom, [&](int first, int last)
+		{
+			for (int v = first; v < last; v++)
+			{
+				const glm::vec3& p = mesh.positions[v];
+				const Detail::Around around = Detail::Gather(mesh, v, &faceCenter);
+				glm::vec3 smooth = p;
+				if (around.edges > 0 && around.faces == around.edges)
+				{
+					const float n = (float)around.edges;
+					const glm::vec3 faceAverage = around.faceSum / n, edgeAverage = (p * n + around.neighbours) / (2.0f * n);
+					smooth = (faceAverage + edgeAverage * 2.0f + p * (n - 3.0f)) / n;
+				}
+				child.positions[v] = Detail::Blend(around, p, smooth, 1.0f / 8.0f);
+			}
+		});
+
+		// Corner i of a face, with the points on the edges either side of it and the face point, is quad h.
+		child.faceStart.resize(halfEdges + 1);
+		child.origin.resize(halfEdges * 4);
+		if (!mesh.uvs.empty())
+			child.uvs.resize(halfEdges * 4);
+		ParallelFor(faces, faces >= ParallelFrom, [&](int first, int last)
+		{
+			for (int f = first; f < last; f++)
+			{
+				glm::vec2 centerUV(0.0f);
+				if (!mesh.uvs.empty())
+				{
+					for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; h++)
+						centerUV += mesh.uvs[h];
+					centerUV /= (float)(mesh.faceStart[f + 1] - mesh.faceStart[f]);
+				}
+				for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; h++)
+				{
+					const int next = mesh.Next(h), prev = mesh.Prev(h);
+					child.faceStart[h] = h * 4;
+					const int quad[4] = { mesh.origin[h], vertices + mesh.edge[h], vertices + edges + f, vertices + mesh.edge[prev] };
+					std::copy(quad, quad + 4, child.origin.begin() + h * 4);
+					if (!mesh.uvs.empty())
+					{
+						const glm::vec2 uvs[4] = { mesh.uvs[h], (mesh.uvs[h] + mesh.uvs[next]) * 0.5f, centerUV, (mesh.uvs[h] + mesh.uvs[prev]) * 0.5f };
+						std::copy(uvs, uvs + 4, child.uvs.begin() + h * 4);
+					}
+				}
+			}
+		});
+		child.faceStart[halfEdges] = halfEdges * 4;
+
+		Build(child);
+		Detail::InheritSharpness(mesh, child);
+		child.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		return child;
+	}
+
+	// levels levels of scheme. Each level's time is in its mesh's milliseconds; onLevel, if given,
+	// sees every level as it is made.
+	template <typename OnLevel>
+	Mesh Subdivide(const Mesh& mesh, Scheme scheme, int levels, OnLevel onLevel)
+	{
+		Mesh result = mesh;
+		for (int level = 1; level <= levels; level++)
+		{
+			result = scheme == Loop ? LoopStep(result) : CatmullClarkStep(result);
+			onLevel(level, result);
+		}
+		return result;
+	}
+
+	inline Mesh Subdivide(const Mesh& mesh, Scheme scheme, int levels)
+	{
+		return Subdivide(mesh, scheme, levels, [](int, const Mesh&) {});
+	}
+
+	// The mesh in Shape's layout: triangles (polygons split as fans), one vertex per different
+	// position and UV, and normals averaged from the faces around each vertex.
+	struct Buffers
+	{
+		vector<GLuint> indices;
+		vector<GLfloat> vertices;
+		vector<GLfloat> uvs;
+		vector<GLfloat> normals;
+	};
+
+	inline Buffers Export(const Mesh& mesh)
+	{
+		const int vertices = mesh.Vertices(), faces = mesh.Faces(), halfEdges = mesh.HalfEdges();
+		// Newell's normal of each face, whose length is its area, so larger faces count for more.
+		vector<glm::vec3> faceNormal(faces), vertexNormal(vertices);
+		ParallelFor(faces, faces >= ParallelFrom, [&](int first, int last)
+		{
+			for (int f = first; f < last; f++)
+			{
+				glm::vec3 n(0.0f);
+				for (int h = mesh.faceStart[f]; h < mesh.faceStart[f + 1]; h++)
+				{
+					const glm::vec3& a = mesh.positions[mesh.origin[h]];
+					const glm::vec3& b = mesh.positions[mesh.Dest(h)];
+					n += glm::vec3((a.y - b.y) * (a.z + b.z), (a.z - b.z) * (a.x + b.x), (a.x - b.x) * (a.y + b.y));
+				}
+				faceNormal[f] = n * 0.5f;
+			}
+		});
+		ParallelFor(vertices, vertices >= ParallelFrom, [&](int first, int last)
+		{
+			for (int v = first; v < last; v++)
+			{
+				glm::vec3 n(0.0f);
+				for (int i = mesh.outStart[v]; i < mesh.outStart[v + 1]; i++)
+					n += faceNormal[mesh.face[mesh.outgoing[i]]];
+				const float length = glm::length(n);
+				vertexNormal[v] = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		});
+
+		// A vertex is split once for each different UV its corners have.
+		Buffers buffers;
+		vector<int> corner(halfEdges), firstOut(vertices, -1), nextOut;
+		vector<glm::vec2> outUV;
+		for (int h = 0; h < halfEdges; h++)
+		{
+			const int v = mesh.origin[h];
+			const glm::vec2 uv = mesh.uvs.empty() ? glm::vec2(0.0f) : mesh.uvs[h];
+			int out = firstOut[v];
+			while (out >= 0 && outUV[out] != uv)
+				out = nextOut[out];
+			if (out < 0)
+			{
+				out = (int)outUV.size();
+				outUV.push_back(uv);
+				nextOut.push_back(firstOut[v]);
+				firstOut[v] = out;
+				const glm::vec3& p = mesh.positions[v];
+				buffers.vertices.insert(buffers.vertices.end(), { p.x, p.y, p.z });
+				buffers.uvs.insert(buffers.uvs.end(), { uv.x, uv.y });
+				buffers.normals.insert(buffers.normals.end(), { vertexNormal[v].x, vertexNormal[v].y, vertexNormal[v].z });
+			}
+			corner[h] = out;
+		}
+		for (int f = 0; f < faces; f++)
+			for (int h = mesh.faceStart[f] + 1; h + 1 < mesh.faceStart[f + 1]; h++)
+				buffers.indices.insert(buffers.indices.end(), { (GLuint)corner[mesh.faceStart[f]], (GLuint)corner[h], (GLuint)corner[h + 1] });
+		return buffers;
+	}
+
+	// Subdivides a cube with Catmull-Clark and a tetrahedron with Loop until each passes a million
+	// faces, and prints how long every level and its adjacency took.
+	inline void Benchmark(std::ostream& out)
+	{
+		auto print = [&](const char* name)
+		{
+			return [&out, name](int level, const Mesh& mesh)
+			{
+				out << name << " level " << level << ": " << mesh.Faces() << " faces, " << mesh.Vertices() << " vertices in "
+					<< mesh.milliseconds << " ms (" << mesh.buildMilliseconds << " ms adjacency)" << std::endl;
+			};
+		};
+		Subdivide(Cube(), CatmullClark, 9, print("Catmull-Clark cube"));
+
+		const GLfloat tetrahedron[] = { 0.0f, 0.0f, -1.0f,  0.0f, 0.942809f, 0.333333f,  -0.816497f, -0.471405f, 0.333333f,  0.816497f, -0.471405f, 0.333333f };
+		const GLuint faces[] = { 0, 1, 2,  3, 2, 1,  0, 3, 1,  0, 2, 3 };
+		Subdivide(FromTriangles(tetrahedron, 4, faces, 12), Loop, 9, print("Loop tetrahedron"));
+	}
+}
+
+// A Shape made from a subdivided mesh, buffered and drawn like any other.
+struct SubdivisionShape : public Shape
+{
+	// False, leaving the shape as it was, if it has more vertices than GLshort indices reach.
+	bool Load(const Subdivision::Buffers& buffers)
+	{
+		if (buffers.vertices.size() / 3 > 32767)
+			return false;
+		shape_indices.assign(buffers.indices.begin(), buffers.indices.end());
+		shape_vertices = buffers.vertices;
+		shape_uvs = buffers.uvs;
+		shape_normals = buffers.normals;
+		ColorShape(1.0f, 1.0f, 1.0f);
+		return true;
+	}
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "VertexFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////
+// @file VertexQuantize.h
+// @brief Positions as 0..1 of a mesh's bounds, to store in 16 bits, and how much storing costs.
+//
+// A position stored as a normalized GL_UNSIGNED_SHORT covers only 0..1, so the mesh's positions
+// are first mapped into its bounding box, and the shader maps them back with the Dequantization:
+//
+//	uniform vec3 positionScale = vec3(1.0);
+//	uniform vec3 positionOffset = vec3(0.0);
+//	...
+//	vec3 position = vertex_position * positionScale + positionOffset;
+//
+// With 16 bits the error is at most half of 1/65535 of the box on each axis, e.g. 8 microns on
+// a 1 metre mesh. Measure tells what the error actually is for a mesh, and for its normals stored
+// Octahedral and its UVs as HalfFloat, the other two parts of a quantized vertex.
+//
+//	VertexQuantize::Dequantization dequantization = VertexQuantize::Bounds(positions, count, 3);
+//	vector<GLfloat> normalized = VertexQuantize::Normalize(positions, count, 3, dequantization);
+//	VertexQuantize::Measure(positions, 3, normals, 3, uvs, 2, count, dequantization, 44, 20).Print(cout, "mesh");
+///////////////////////////////////////////////////////////////////////
+
+namespace VertexQuantize
+{
+	// position = stored * scale + offset, per axis.
+	struct Dequantization
+	{
+		GLfloat scale[3] = { 1.0f, 1.0f, 1.0f };
+		GLfloat offset[3] = { 0.0f, 0.0f, 0.0f };
+	};
+
+	// The bounding box of count positions of stride floats each. A flat axis keeps a scale of 1.
+	inline Dequantization Bounds(const GLfloat* positions, size_t count, size_t stride)
+	{
+		Dequantization result;
+		if (count == 0)
+			return result;
+		for (int c = 0; c < 3; c++)
+		{
+			GLfloat low = positions[c], high = positions[c];
+			for (size_t v = 1; v < count; v++)
+			{
+				low = std::min(low, positions[v * stride + c]);
+				high = std::max(high, positions[v * stride + c]);
+			}
+			result.offset[c] = low;
+			result.scale[c] = high > low ? high - low : 1.0f;
+		}
+		return result;
+	}
+
+	// The positions mapped into 0..1, three floats each, ready to Pack as normalized shorts.
+	inline std::vector<GLfloat> Normalize(const GLfloat* positions, size_t count, size_t stride, const Dequantization& dequantization)
+	{
+		std::vector<GLfloat> normalized(count * 3);
+		for (size_t v = 0; v < count; v++)
+			for (int c = 0; c < 3; c++)
+				normalized[v * 3 + c] = (positions[v * stride + c] - dequantization.offset[c]) / dequantization.scale[c];
+		return normalized;
+	}
+
+	struct Report
+	{
+		size_t vertices = 0;
+		GLsizei bytesBefore = 0, bytesAfter = 0;	// A vertex takes.
+		GLfloat positionError = 0.0f;				// Furthest a position moved, in the mesh's units...
+		GLfloat positionBound = 0.0f;				// ...and the furthest it could.
+		GLfloat normalDegrees = 0.0f;				// Largest angle a normal turned by.
+		GLfloat uvError = 0.0f;						// Largest change of a UV component.
+
+		void Print(std::ostream& out, const char* name) const
+		{
+			out << name << ": " << vertices << " vertices quantized from " << bytesBefore << " to " << bytesAfter
+				<< " bytes each (" << (bytesBefore ? 100.0 - 100.0 * bytesAfter / bytesBefore : 0.0) << "% less), position error "
+				<< positionError << " (at most " << positionBound << "), normals within " << normalDegrees
+				<< " degrees, UVs within " << uvError << std::endl;
+		}
+	};
+
+	// Decodes what the GPU reads for each vertex as the shader would and compares it with the floats.
+	// normals and uvs may be null, for a mesh without them.
+	inline Report Measure(const GLfloat* positions, size_t positionStride, const GLfloat* normals, size_t normalStride,
+		const GLfloat* uvs, size_t uvStride, size_t count, const Dequantization& dequantization, GLsizei bytesBefore, GLsizei bytesAfter)
+	{
+		Report report;
+		report.vertices = count;
+		report.bytesBefore = bytesBefore;
+		report.bytesAfter = bytesAfter;
+		GLfloat bound = 0.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			const GLfloat half = dequantization.scale[c] * 0.5f / 65535.0f;
+			bound += half * half;
+		}
+		report.positionBound = sqrtf(bound);
+
+		for (size_t v = 0; v < count; v++)
+		{
+			GLfloat moved = 0.0f;
+			for (int c = 0; c < 3; c++)
+			{
+				const GLfloat original = positions[v * positionStride + c];
+				const GLfloat stored = VertexPack::Component<GLushort>::Pack((original - dequantization.offset[c]) / dequantization.scale[c], true);
+				const GLfloat difference = stored / 65535.0f * dequantization.scale[c] + dequantization.offset[c] - original;
+				moved += difference * difference;
+			}
+			report.positionError = std::max(report.positionError, sqrtf(moved));
+
+			if (normals)
+			{
+				const GLfloat* n = normals + v * normalStride;
+				const GLfloat length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 0.0f)
+				{
+					const GLfloat unit[3] = { n[0] / length, n[1] / length, n[2] / length };
+					GLfloat square[2], decoded[3];
+					VertexPack::ToOctahedral(unit, square);
+					for (int c = 0; c < 2; c++)
+						square[c] = std::max(VertexPack::Component<GLshort>::Pack(square[c], true) / 32767.0f, -1.0f);
+					VertexPack::FromOctahedral(square, decoded);
+					// atan2 of the cross and dot products, as acos can't tell angles this small from 0.
+					const GLfloat cosine = unit[0] * decoded[0] + unit[1] * decoded[1] + unit[2] * decoded[2];
+					const GLfloat cross[3] = { unit[1] * decoded[2] - unit[2] * decoded[1],
+						unit[2] * decoded[0] - unit[0] * decoded[2], unit[0] * decoded[1] - unit[1] * decoded[0] };
+					const GLfloat sine = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+					report.normalDegrees = std::max(report.normalDegrees, atan2f(sine, cosine) * 57.2957795f);
+				}
+			}
+			if (uvs)
+				for (int c = 0; c < 2; c++)
+				{
+					const GLfloat original = uvs[v * uvStride + c];
+					report.uvError = std::max(report.uvError, fabsf(VertexPack::FromHalf(VertexPack::ToHalf(original)) - original));
+				}
+		}
+		return report;
+	}
+}
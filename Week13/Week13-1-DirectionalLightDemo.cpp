@@ -4,6 +4,8 @@
  *  @note press WASD for tracking the camera or zooming in and out
  *  @note press arrow keys and page up and page down to move the light
  *  @note move mouse to yaw and pitch
+ *  @note run with --shape-check to compare the Static shapes with the run time ones without a window
+ *  @note run with --cache-check to test the vertex cache simulation on orders counted by hand
  *  @attention we are using directional vertex and fragment shaders!
  *  @author Hooman Salamat
  *  @bug No known bugs.
@@ -90,9 +92,9 @@ int lastX, lastY;
 
 // Geometry data.
 Grid g_grid(16);
-//Cube g_cube;
-Cube2 g_cube(2.0f,2.0f,2.0f);
-Prism g_prism(7);
+//StaticCube<> g_cube;
+StaticCube2<2, 2, 2> g_cube;
+StaticPrism<7> g_prism;
 Sphere g_sphere(5);
 
 void timer(int); // Prototype.
@@ -168,7 +170,7 @@ void setupLights()
 void setupVAOs()
 {
 	// All VAO/VBO data now in Shape.h! But we still need to do this AFTER OpenGL is initialized.
-	g_grid.BufferShape();
+	g_grid.BufferShape(false); // Drawn as a line loop, which follows the index order.
 	g_cube.BufferShape();
 	g_prism.BufferShape();
 	g_sphere.BufferShape();
@@ -523,6 +525,12 @@ void clean()
 //
 int main(int argc, char** argv)
 {
+	// Checks the compile-time shape tables against the run time constructors instead of opening the demo.
+	if (argc > 1 && string(argv[1]) == "--shape-check")
+		return CheckStaticShapes(cout) ? 0 : 1;
+	if (argc > 1 && string(argv[1]) == "--cache-check")
+		return MeshOptimize::CheckAnalyzeCache(cout) ? 0 : 1;
+
 	//Before we can open a window, theremust be interaction between the windowing systemand OpenGL.In GLUT, this interaction is initiated by the following function call :
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA | GLUT_MULTISAMPLE);
@@ -8,6 +8,9 @@
 #include <string>
 #include <iostream>
 #include "Shape.h"
+#include "BezierPatch.h"
+#include "Teapot.h"
+#include "Subdivision.h"
 #include "Light.h"
 #include "Texture.h"
 #define STB_IMAGE_IMPLEMENTATION
@@ -97,10 +100,12 @@ int lastX, lastY;
 
 // Geometry data.
 Grid g_grid(16); //16x16
-//Cube g_cube;
-Cube2 g_cube(2.0f, 2.0f, 2.0f);
-Prism g_prism(7);
+//StaticCube<> g_cube;
+StaticCube2<2, 2, 2> g_cube;
+StaticPrism<7> g_prism;
 Sphere g_sphere(5);
+BezierShape g_teapot;
+SubdivisionShape g_subdivided;
 
 void timer(int); // Prototype.
 
@@ -188,10 +193,32 @@ void setupLights()
 void setupVAOs()
 {
 	// All VAO/VBO data now in Shape.h! But we still need to do this AFTER OpenGL is initialized.
-	g_grid.BufferShape();
+	g_grid.BufferShape(false); // Drawn as a line loop, which follows the index order.
 	g_cube.BufferShape();
 	g_prism.BufferShape();
 	g_sphere.BufferShape();
+
+	// The teapot's 32 patches, within 0.005 units of the surface.
+	BezierPatch::Mesh teapot = BezierPatch::Tessellate(TeapotVertices, TeapotIndices, NumTeapotPatches, BezierPatch::Tolerance());
+	cout << "Teapot: " << teapot.indices.size() / 3 << " triangles in " << teapot.milliseconds << " ms, "
+		<< teapot.PatchesPerMillisecond() << " patches per millisecond." << endl;
+	g_teapot.Load(teapot);
+	g_teapot.BufferShape<QuantizedShapeVertex>();
+	g_teapot.Optimization().Print(cout, "Teapot");
+	g_teapot.Strips().Print(cout, "Teapot");
+	g_teapot.Quantization().Print(cout, "Teapot");
+
+	// A cube smoothed three times by Catmull-Clark, with its top edges sharp for the first two.
+	Subdivision::Mesh cage = Subdivision::Cube();
+	const int topEdges[4][2] = { { 3, 2 }, { 2, 6 }, { 6, 7 }, { 7, 3 } };
+	for (const auto& edge : topEdges)
+		Subdivision::SetCrease(cage, edge[0], edge[1], 2.0f);
+	double milliseconds = 0.0;
+	const Subdivision::Mesh smooth = Subdivision::Subdivide(cage, Subdivision::CatmullClark, 3,
+		[&](int, const Subdivision::Mesh& level) { milliseconds += level.milliseconds; });
+	cout << "Subdivided cube: " << smooth.Faces() << " quads in " << milliseconds << " ms for all 3 levels." << endl;
+	g_subdivided.Load(Subdivision::Export(smooth));
+	g_subdivided.BufferShape();
 }
 
 void setupShaders()
@@ -346,6 +373,20 @@ void display(void)
 	g_prism.DrawShape(GL_TRIANGLES);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	//// Teapot.
+	blankTexture->Bind(GL_TEXTURE0);
+	g_teapot.RecolorShape(1.0, 0.5, 0.0);
+	transformObject(glm::vec3(1.0f, 1.0f, 1.0f), X_AXIS, 0.0f, glm::vec3(12.0f, 0.0f, -3.0f));
+	g_teapot.DrawShape(GL_TRIANGLES);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	//// Subdivided cube.
+	blankTexture->Bind(GL_TEXTURE0);
+	g_subdivided.RecolorShape(0.5, 0.5, 1.0);
+	transformObject(glm::vec3(2.0f, 2.0f, 2.0f), X_AXIS, 0.0f, glm::vec3(16.0f, 1.0f, -3.0f));
+	g_subdivided.DrawShape(GL_TRIANGLES);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -545,6 +586,13 @@ void clean()
 //
 int main(int argc, char** argv)
 {
+	// Times subdivision up to a million faces instead of opening the demo.
+	if (argc > 1 && string(argv[1]) == "--subdivision-bench")
+	{
+		Subdivision::Benchmark(cout);
+		return 0;
+	}
+
 	//Before we can open a window, theremust be interaction between the windowing systemand OpenGL.In GLUT, this interaction is initiated by the following function call :
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA | GLUT_MULTISAMPLE);
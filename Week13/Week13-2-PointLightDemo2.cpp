@@ -101,8 +101,8 @@ int lastX, lastY;
 
 // Geometry data.
 Grid g_grid(16);
-Cube g_cube;
-Prism g_prism(7);
+StaticCube<> g_cube;
+StaticPrism<7> g_prism;
 Sphere g_sphere(6);
 
 void timer(int); // Prototype.
@@ -121,11 +121,11 @@ int lastX, lastY;
 
 // Geometry data.
 Grid g_grid(16); //16x16
-//Cube g_cube;
-Cube2 g_cube(2.0f, 2.0f, 2.0f);
-Prism g_prism(7);
+//StaticCube<> g_cube;
+StaticCube2<2, 2, 2> g_cube;
+StaticPrism<7> g_prism;
 Sphere g_sphere(5);
-Cone g_cone(7);
+StaticCone<7> g_cone;
 
 void timer(int); // Prototype.
 
@@ -223,7 +223,7 @@ void setupLights()
 void setupVAOs()
 {
 	// All VAO/VBO data now in Shape.h! But we still need to do this AFTER OpenGL is initialized.
-	g_grid.BufferShape();
+	g_grid.BufferShape(false); // Drawn as a line loop, which follows the index order.
 	g_cube.BufferShape();
 	g_prism.BufferShape();
 	g_sphere.BufferShape();
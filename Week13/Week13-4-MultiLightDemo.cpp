@@ -112,10 +112,10 @@ int lastX, lastY;
 
 // Geometry data.
 Grid g_grid(16);
-Cube g_cube;
-Prism g_prism(7);
+StaticCube<> g_cube;
+StaticPrism<7> g_prism;
 Sphere g_sphere(6);
-Cone g_cone(7);
+StaticCone<7> g_cone;
 
 void timer(int); // Prototype.
 Texture* pTexture = NULL;
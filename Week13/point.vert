@@ -14,13 +14,28 @@ out vec3 fragPos;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// How a Shape buffered as QuantizedShapeVertex stores its vertices, see Shape::SetDequantization.
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+uniform bool octahedralNormals = false;
+
+// The unit vector an Octahedral normal was folded from.
+vec3 OctahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(vertex_position, 1.0f);
+	vec3 position = vertex_position * positionScale + positionOffset;
+	vec3 vertexNormal = octahedralNormals ? OctahedralDecode(vertex_normal.xy) : vertex_normal;
+	gl_Position = projection * view * model * vec4(position, 1.0f);
 	color = vertex_color;
 	texCoord = vertex_texture;
-	// normal = vertex_normal;
-	normal = mat3(transpose(inverse(model))) * vertex_normal; // Only needed if there's non-uniform scaling.
-	fragPos = (model * vec4(vertex_position, 1.0f)).xyz;
+	// normal = vertexNormal;
+	normal = mat3(transpose(inverse(model))) * vertexNormal; // Only needed if there's non-uniform scaling.
+	fragPos = (model * vec4(position, 1.0f)).xyz;
 }
\ No newline at end of file
@@ -0,0 +1,572 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "Cloth.h"
+#include "Simd4.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+// Particles, or constraints of one colour, a job works on. Multiples of 4.
+static const int PARTICLE_BATCH = 1024;
+static const int CONSTRAINT_BATCH = 1024;
+
+//---------------------------------------------------------------------
+//
+// Cloth
+//
+Cloth::Cloth(int quads, const ClothSettings& settings) : Grid(quads), m_settings(settings), m_quads(quads)
+{
+    // Cache order for drawing. The particles follow the vertices, so it has to happen before they're numbered.
+    OptimizeShape();
+    m_count = (int)shape_vertices.size() / 3;
+    m_padded = (m_count + 1 + 3) & ~3;
+    const int spare = m_count;
+
+    m_grid.assign((size_t)(quads + 1) * (quads + 1), -1);
+    m_restX.assign(m_padded, 0.0f);
+    m_restY.assign(m_padded, 0.0f);
+    m_restZ.assign(m_padded, 0.0f);
+    m_w.assign(m_padded, 0.0f);
+    for (int i = 0; i < m_count; i++)
+    {
+        const int col = (int)lroundf(shape_vertices[i * 3]), row = (int)lroundf(shape_vertices[i * 3 + 1]);
+        m_grid[(size_t)row * (quads + 1) + col] = i;
+        m_restX[i] = m_settings.origin.x + col * m_settings.spacing;
+        m_restY[i] = m_settings.origin.y + row * m_settings.spacing;
+        m_restZ[i] = m_settings.origin.z;
+        m_w[i] = 1.0f;
+    }
+    if (m_settings.pinEvery > 0)
+        for (int col = 0; col <= quads; col++)
+            if (col % m_settings.pinEvery == 0 || col == quads)
+                Pin(Find(col, quads));
+
+    m_triangles.assign(shape_indices.begin(), shape_indices.end());
+    const int triangles = (int)m_triangles.size() / 3;
+
+    // Every edge once, with the corner across from it in each triangle it's on.
+    struct HalfEdge { uint64_t key; int across; };
+    vector<HalfEdge> halfEdges;
+    halfEdges.reserve(m_triangles.size());
+    for (int t = 0; t < triangles; t++)
+        for (int e = 0; e < 3; e++)
+        {
+            const uint32_t a = m_triangles[t * 3 + e], b = m_triangles[t * 3 + (e + 1) % 3];
+            halfEdges.push_back({ (uint64_t)min(a, b) << 32 | max(a, b), m_triangles[t * 3 + (e + 2) % 3] });
+        }
+    sort(halfEdges.begin(), halfEdges.end(), [](const HalfEdge& l, const HalfEdge& r) { return l.key < r.key; });
+    vector<pair<int, int>> edges, bends;
+    for (size_t i = 0; i < halfEdges.size(); )
+    {
+        size_t j = i + 1;
+        while (j < halfEdges.size() && halfEdges[j].key == halfEdges[i].key)
+            j++;
+        edges.push_back({ (int)(halfEdges[i].key >> 32), (int)(halfEdges[i].key & 0xFFFFFFFFu) });
+        if (j - i == 2 && halfEdges[i].across != halfEdges[i + 1].across)
+            bends.push_back({ halfEdges[i].across, halfEdges[i + 1].across });
+        i = j;
+    }
+
+    // Greedy colouring: each constraint takes the first colour neither of its particles has yet.
+    // A grid vertex is in at most 6 edges and across from 6 more, so 64 colours are plenty.
+    // Position based stiffness compounds over the iterations; k per pass gives the setting after them all.
+    const float iterations = (float)max(1, m_settings.iterations);
+    m_colorStart.assign(1, 0);
+    auto color = [&](const vector<pair<int, int>>& pairs, float stiffness)
+    {
+        const float k = 1.0f - powf(1.0f - min(max(stiffness, 0.0f), 1.0f), 1.0f / iterations);
+        vector<uint64_t> used(m_count, 0);
+        vector<vector<int>> byColor;
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            const uint64_t taken = used[pairs[i].first] | used[pairs[i].second];
+            int c = 0;
+            while (c < 63 && (taken >> c & 1))
+                c++;
+            used[pairs[i].first] |= 1ull << c;
+            used[pairs[i].second] |= 1ull << c;
+            if (c >= (int)byColor.size())
+                byColor.resize(c + 1);
+            byColor[c].push_back((int)i);
+        }
+        for (vector<int>& members : byColor)
+        {
+            // In particle order, so neighbouring lanes read neighbouring memory.
+            sort(members.begin(), members.end(), [&](int l, int r) { return pairs[l].first < pairs[r].first; });
+            for (int i : members)
+            {
+                const int a = pairs[i].first, b = pairs[i].second;
+                m_a.push_back(a);
+                m_b.push_back(b);
+                m_rest.push_back(sqrtf((m_restX[a] - m_restX[b]) * (m_restX[a] - m_restX[b]) + (m_restY[a] - m_restY[b]) * (m_restY[a] - m_restY[b])
+                    + (m_restZ[a] - m_restZ[b]) * (m_restZ[a] - m_restZ[b])));
+                m_stiffness.push_back(k);
+            }
+            while (m_a.size() % 4)
+            {
+                m_a.push_back(spare);
+                m_b.push_back(spare);
+                m_rest.push_back(0.0f);
+                m_stiffness.push_back(0.0f);
+            }
+            m_colorStart.push_back((int)m_a.size());
+        }
+    };
+    color(edges, m_settings.stretchStiffness);
+    m_edgeColors = (int)m_colorStart.size() - 1;
+    color(bends, m_settings.bendStiffness);
+    m_constraints = (int)(edges.size() + bends.size());
+
+    // The triangles around each particle, for its normal.
+    m_aroundStart.assign(m_count + 1, 0);
+    for (int corner : m_triangles)
+        m_aroundStart[corner + 1]++;
+    for (int i = 0; i < m_count; i++)
+        m_aroundStart[i + 1] += m_aroundStart[i];
+    m_around.resize(m_triangles.size());
+    vector<int> filled(m_aroundStart.begin(), m_aroundStart.end() - 1);
+    for (size_t i = 0; i < m_triangles.size(); i++)
+        m_around[filled[m_triangles[i]]++] = (int)(i / 3);
+    m_fx.assign(triangles, 0.0f);
+    m_fy.assign(triangles, 0.0f);
+    m_fz.assign(triangles, 0.0f);
+
+    Reset();
+
+    m_helpers = m_settings.workers < 0 ? 0 : m_settings.workers == 0 ? -1 : m_settings.workers;
+}
+
+Cloth::~Cloth()
+{
+    if (m_vbo)
+    {
+        for (GLsync& fence : m_fences)
+            if (fence)
+                glDeleteSync(fence);
+        if (m_mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_vbo);
+    }
+}
+
+void Cloth::Reset()
+{
+    m_x = m_px = m_restX;
+    m_y = m_py = m_restY;
+    m_z = m_pz = m_restZ;
+    m_nx.assign(m_padded, 0.0f);
+    m_ny.assign(m_padded, 0.0f);
+    m_nz.assign(m_padded, 1.0f);
+    m_unsimulated = 0.0;
+    m_written = false;
+    m_pinsChanged = true;
+}
+
+int Cloth::Find(int col, int row) const
+{
+    if (col < 0 || row < 0 || col > m_quads || row > m_quads)
+        return -1;
+    return m_grid[(size_t)row * (m_quads + 1) + col];
+}
+
+void Cloth::Pin(int particle, bool pinned)
+{
+    if (particle >= 0 && particle < m_count)
+        m_w[particle] = pinned ? 0.0f : 1.0f;
+    m_pinsChanged = true;
+}
+
+void Cloth::Run(int count, const function<void(int)>& job)
+{
+    WorkerPool::Shared().Run(count, job, m_helpers);
+}
+
+//---------------------------------------------------------------------
+//
+// Simulation
+//
+void Cloth::Integrate(int first, int last, float h)
+{
+    // Verlet: the velocity is what the last substep moved. The wind pushes along the normal by how
+    // fast it blows through the cloth there, so cloth edge on to it feels nothing.
+    const V4 damp = Set(powf(1.0f - min(max(m_settings.damping, 0.0f), 1.0f), h)), inverseH = Set(1.0f / h);
+    const V4 h2 = Set(h * h), drag = Set(m_settings.windDrag);
+    const V4 gx = Set(m_settings.gravity.x), gy = Set(m_settings.gravity.y), gz = Set(m_settings.gravity.z);
+    const V4 wx = Set(m_wind.x), wy = Set(m_wind.y), wz = Set(m_wind.z);
+    for (int i = first; i < last; i += 4)
+    {
+        const V4 x = Load(&m_x[i]), y = Load(&m_y[i]), z = Load(&m_z[i]);
+        const V4 vx = (x - Load(&m_px[i])) * damp, vy = (y - Load(&m_py[i])) * damp, vz = (z - Load(&m_pz[i])) * damp;
+        const V4 nx = Load(&m_nx[i]), ny = Load(&m_ny[i]), nz = Load(&m_nz[i]);
+        const V4 push = drag * (nx * (wx - vx * inverseH) + ny * (wy - vy * inverseH) + nz * (wz - vz * inverseH));
+        const V4 w = Load(&m_w[i]);
+        Store(&m_px[i], x);
+        Store(&m_py[i], y);
+        Store(&m_pz[i], z);
+        Store(&m_x[i], x + (vx + (gx + push * nx) * h2) * w);
+        Store(&m_y[i], y + (vy + (gy + push * ny) * h2) * w);
+        Store(&m_z[i], z + (vz + (gz + push * nz) * h2) * w);
+    }
+}
+
+void Cloth::Solve(int first, int last)
+{
+    // Each pair moves apart or together along the line between them, the lighter one more. No two
+    // constraints in a colour share a particle, so the four lanes never write over each other.
+    const float* x = m_x.data();
+    const float* y = m_y.data();
+    const float* z = m_z.data();
+    const V4 tiny = Set(1e-12f);
+    for (int c = first; c < last; c += 4)
+    {
+        const int32_t* a = &m_a[c];
+        const int32_t* b = &m_b[c];
+        const V4 ax = Gather(x, a), ay = Gather(y, a), az = Gather(z, a);
+        const V4 bx = Gather(x, b), by = Gather(y, b), bz = Gather(z, b);
+        const V4 wa = Gather(m_w.data(), a), wb = Gather(m_w.data(), b);
+        const V4 dx = bx - ax, dy = by - ay, dz = bz - az;
+        const V4 length = Sqrt(dx * dx + dy * dy + dz * dz);
+        // Padding and pairs of pinned particles have nothing to move: wa + wb is 0 and so is s.
+        const V4 s = Load(&m_stiffness[c]) * (length - Load(&m_rest[c])) / Max(length * (wa + wb), tiny);
+        const V4 sa = s * wa, sb = s * wb;
+        Scatter(m_x.data(), a, ax + dx * sa);
+        Scatter(m_y.data(), a, ay + dy * sa);
+        Scatter(m_z.data(), a, az + dz * sa);
+        Scatter(m_x.data(), b, bx - dx * sb);
+        Scatter(m_y.data(), b, by - dy * sb);
+        Scatter(m_z.data(), b, bz - dz * sb);
+    }
+}
+
+void Cloth::Tether(int first, int last)
+{
+    // No further from the nearest pin than at rest, however far the constraints have let the cloth sag.
+    const V4 tiny = Set(1e-12f);
+    for (int i = first; i < last; i += 4)
+    {
+        const V4 x = Load(&m_x[i]), y = Load(&m_y[i]), z = Load(&m_z[i]);
+        const V4 px = Load(&m_tetherX[i]), py = Load(&m_tetherY[i]), pz = Load(&m_tetherZ[i]);
+        const V4 dx = x - px, dy = y - py, dz = z - pz;
+        const V4 length = Sqrt(Max(dx * dx + dy * dy + dz * dz, tiny)), limit = Load(&m_tetherLength[i]);
+        const V4 scale = Select(Less(limit, length), limit / length, Set(1.0f));
+        Store(&m_x[i], px + dx * scale);
+        Store(&m_y[i], py + dy * scale);
+        Store(&m_z[i], pz + dz * scale);
+    }
+}
+
+void Cloth::Collide(int first, int last)
+{
+    // Out of the sphere along the line from its centre, and up off the floor.
+    const float radius = m_sphereRadius > 0.0f ? m_sphereRadius + 0.5f * m_settings.spacing : 0.0f;
+    const V4 cx = Set(m_sphereCenter.x), cy = Set(m_sphereCenter.y), cz = Set(m_sphereCenter.z);
+    const V4 r = Set(radius), r2 = Set(radius * radius), tiny = Set(1e-12f), floorHeight = Set(m_settings.floorHeight);
+    for (int i = first; i < last; i += 4)
+    {
+        const V4 w = Load(&m_w[i]);
+        V4 x = Load(&m_x[i]), y = Load(&m_y[i]), z = Load(&m_z[i]);
+        const V4 dx = x - cx, dy = y - cy, dz = z - cz;
+        const V4 d2 = dx * dx + dy * dy + dz * dz;
+        const V4 inside = Less(d2 * w, r2 * w);
+        const V4 scale = r / Sqrt(Max(d2, tiny));
+        x = Select(inside, cx + dx * scale, x);
+        y = Select(inside, cy + dy * scale, y);
+        z = Select(inside, cz + dz * scale, z);
+        Store(&m_x[i], x);
+        Store(&m_y[i], Max(y, floorHeight));
+        Store(&m_z[i], z);
+    }
+}
+
+void Cloth::Faces(int first, int last)
+{
+    for (int t = first; t < last; t++)
+    {
+        const int a = m_triangles[t * 3], b = m_triangles[t * 3 + 1], c = m_triangles[t * 3 + 2];
+        const float ux = m_x[b] - m_x[a], uy = m_y[b] - m_y[a], uz = m_z[b] - m_z[a];
+        const float vx = m_x[c] - m_x[a], vy = m_y[c] - m_y[a], vz = m_z[c] - m_z[a];
+        m_fx[t] = uy * vz - uz * vy;
+        m_fy[t] = uz * vx - ux * vz;
+        m_fz[t] = ux * vy - uy * vx;
+    }
+}
+
+void Cloth::Normals(int first, int last)
+{
+    // Summed over the triangles around, bigger ones counting more; gathered, so jobs don't share a particle.
+    for (int i = first; i < min(last, m_count); i++)
+    {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        for (int j = m_aroundStart[i]; j < m_aroundStart[i + 1]; j++)
+        {
+            x += m_fx[m_around[j]];
+            y += m_fy[m_around[j]];
+            z += m_fz[m_around[j]];
+        }
+        const float length = sqrtf(x * x + y * y + z * z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        m_nx[i] = x * scale;
+        m_ny[i] = y * scale;
+        m_nz[i] = z * scale;
+    }
+}
+
+void Cloth::Step()
+{
+    typedef chrono::high_resolution_clock Clock;
+    const auto start = Clock::now();
+    const int particleJobs = (m_padded + PARTICLE_BATCH - 1) / PARTICLE_BATCH;
+    const auto particles = [&](int job, int& first, int& last)
+    {
+        first = job * PARTICLE_BATCH;
+        last = min(first + PARTICLE_BATCH, m_padded);
+    };
+    const int substeps = max(1, m_settings.substeps);
+    const float h = m_settings.timestep / substeps;
+    if (m_pinsChanged)
+    {
+        // Pins don't move, so where they are now is where they'll be. The pinned and spare particles,
+        // and any without a pin, are held as far from the origin as they like.
+        vector<int> pins;
+        for (int i = 0; i < m_count; i++)
+            if (m_w[i] == 0.0f)
+                pins.push_back(i);
+        m_tetherX.assign(m_padded, 0.0f);
+        m_tetherY.assign(m_padded, 0.0f);
+        m_tetherZ.assign(m_padded, 0.0f);
+        m_tetherLength.assign(m_padded, 1e30f);
+        for (int i = 0; i < m_count; i++)
+        {
+            if (m_w[i] == 0.0f)
+                continue;
+            for (int pin : pins)
+            {
+                const float dx = m_restX[i] - m_restX[pin], dy = m_restY[i] - m_restY[pin], dz = m_restZ[i] - m_restZ[pin];
+                const float length = sqrtf(dx * dx + dy * dy + dz * dz);
+                if (length < m_tetherLength[i])
+                {
+                    m_tetherX[i] = m_x[pin];
+                    m_tetherY[i] = m_y[pin];
+                    m_tetherZ[i] = m_z[pin];
+                    m_tetherLength[i] = length;
+                }
+            }
+        }
+        m_pinsChanged = false;
+    }
+    double solve = 0.0;
+    for (int substep = 0; substep < substeps; substep++)
+    {
+        Run(particleJobs, [&](int job) { int first, last; particles(job, first, last); Integrate(first, last, h); });
+        const auto solveStart = Clock::now();
+        for (int iteration = 0; iteration < max(1, m_settings.iterations); iteration++)
+            for (size_t color = 0; color + 1 < m_colorStart.size(); color++)
+            {
+                const int begin = m_colorStart[color], end = m_colorStart[color + 1];
+                Run((end - begin + CONSTRAINT_BATCH - 1) / CONSTRAINT_BATCH, [&](int job)
+                {
+                    Solve(begin + job * CONSTRAINT_BATCH, min(begin + (job + 1) * CONSTRAINT_BATCH, end));
+                });
+            }
+        Run(particleJobs, [&](int job) { int first, last; particles(job, first, last); Tether(first, last); });
+        solve += chrono::duration<double, milli>(Clock::now() - solveStart).count();
+        Run(particleJobs, [&](int job) { int first, last; particles(job, first, last); Collide(first, last); });
+    }
+    const auto normalsStart = Clock::now();
+    const int triangles = (int)m_fx.size();
+    Run((triangles + PARTICLE_BATCH - 1) / PARTICLE_BATCH, [&](int job) { Faces(job * PARTICLE_BATCH, min((job + 1) * PARTICLE_BATCH, triangles)); });
+    Run(particleJobs, [&](int job) { int first, last; particles(job, first, last); Normals(first, last); });
+    const auto end = Clock::now();
+
+    m_stats.steps++;
+    m_stats.solveMilliseconds = solve;
+    m_stats.normalsMilliseconds = chrono::duration<double, milli>(end - normalsStart).count();
+    m_stats.stepMilliseconds = chrono::duration<double, milli>(end - start).count();
+    m_totalMilliseconds += m_stats.stepMilliseconds;
+    m_stats.averageStepMilliseconds = m_totalMilliseconds / m_stats.steps;
+}
+
+void Cloth::Update(float seconds)
+{
+    // Fixed steps whatever the frame rate; what's left over waits for the next frame.
+    if (m_time >= 0.0)
+        m_unsimulated += seconds - m_time;
+    m_time = seconds;
+    int steps = 0;
+    while (m_unsimulated >= m_settings.timestep && steps < m_settings.maxSteps)
+    {
+        Step();
+        m_unsimulated -= m_settings.timestep;
+        steps++;
+    }
+    if (m_unsimulated >= m_settings.timestep)
+        m_unsimulated = 0.0;
+    if (steps || !m_written)
+        Upload();
+}
+
+float Cloth::MaxStretch() const
+{
+    float stretch = 0.0f;
+    for (int c = 0; c < m_colorStart[m_edgeColors]; c++)
+    {
+        if (m_a[c] == m_count)
+            continue;
+        const float dx = m_x[m_b[c]] - m_x[m_a[c]], dy = m_y[m_b[c]] - m_y[m_a[c]], dz = m_z[m_b[c]] - m_z[m_a[c]];
+        stretch = max(stretch, sqrtf(dx * dx + dy * dy + dz * dz) / m_rest[c] - 1.0f);
+    }
+    return stretch;
+}
+
+//---------------------------------------------------------------------
+//
+// GL
+//
+void Cloth::Write(float* out, int first, int last) const
+{
+    float* normals = out + (size_t)m_count * 3;
+    for (int i = first; i < last; i++)
+    {
+        out[i * 3] = m_x[i];
+        out[i * 3 + 1] = m_y[i];
+        out[i * 3 + 2] = m_z[i];
+        normals[i * 3] = m_nx[i];
+        normals[i * 3 + 1] = m_ny[i];
+        normals[i * 3 + 2] = m_nz[i];
+    }
+}
+
+void Cloth::Upload()
+{
+    typedef chrono::high_resolution_clock Clock;
+    const auto start = Clock::now();
+    const size_t floats = (size_t)m_count * 6;
+    float* out = m_staging.data();
+    if (m_mapped)
+    {
+        // The region drawn FRAMES - 1 frames ago; its fence says when the GPU has finished with it.
+        m_frame = (m_frame + 1) % FRAMES;
+        if (m_fences[m_frame])
+        {
+            while (glClientWaitSync(m_fences[m_frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(m_fences[m_frame]);
+            m_fences[m_frame] = 0;
+        }
+        out = m_mapped + m_frame * floats;
+    }
+    const int jobs = (m_count + PARTICLE_BATCH - 1) / PARTICLE_BATCH;
+    Run(jobs, [&](int job) { Write(out, job * PARTICLE_BATCH, min((job + 1) * PARTICLE_BATCH, m_count)); });
+    if (!m_mapped)
+    {
+        // Orphaned first, so the driver hands over fresh memory rather than waiting on the last draw.
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, floats * sizeof(float), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, floats * sizeof(float), out);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    m_written = true;
+    m_stats.writeMilliseconds = chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+void Cloth::Init()
+{
+    BufferShape();
+
+    // Positions and normals from a buffer of their own, which Draw points the vertex array at.
+    const size_t bytes = (size_t)m_count * 6 * sizeof(float);
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes * FRAMES, NULL, flags);
+        m_mapped = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes * FRAMES, flags);
+        if (!m_mapped)
+        {
+            // Storage is immutable; start again with a buffer glBufferData can resize.
+            glDeleteBuffers(1, &m_vbo);
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        }
+    }
+    if (!m_mapped)
+    {
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        m_staging.resize((size_t)m_count * 6);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &points_vbo);
+    glDeleteBuffers(1, &normals_vbo);
+    points_vbo = normals_vbo = 0;
+    Upload();
+}
+
+void Cloth::Draw()
+{
+    if (!m_vbo)
+        return;
+    const size_t offset = m_mapped ? m_frame * (size_t)m_count * 6 * sizeof(float) : 0;
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, (const void*)(offset + (size_t)m_count * 3 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    DrawShape(GL_TRIANGLES);
+    if (m_mapped)
+    {
+        if (m_fences[m_frame])
+            glDeleteSync(m_fences[m_frame]);
+        m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void Cloth::PrintStats() const
+{
+    cout << "Cloth " << m_count << " particles, " << m_constraints << " constraints in " << Colors() << " colours, step "
+         << m_stats.steps << ": " << m_stats.stepMilliseconds << " ms (constraints " << m_stats.solveMilliseconds << " ms, normals "
+         << m_stats.normalsMilliseconds << " ms, " << m_stats.averageStepMilliseconds << " ms on average), written in "
+         << m_stats.writeMilliseconds << " ms" << (m_mapped ? " (mapped)" : "") << ", stretch " << MaxStretch() * 100.0f << "%, "
+         << WorkerPool::Shared().Helpers(m_helpers) + 1 << " threads" << endl;
+}
+
+void Cloth::Benchmark(std::ostream& out)
+{
+    out << "Cloth benchmark: 10 s of 60 Hz steps, hanging from its top edge in gusts and draped on a ball, "
+        << max(1u, thread::hardware_concurrency()) << " cores." << endl;
+    for (int quads : { 100, 180 })
+        for (int workers : { -1, 0 })
+        {
+            ClothSettings settings;
+            settings.spacing = 6.0f / quads;
+            settings.workers = workers;
+            Cloth cloth(quads, settings);
+            cloth.SetSphere(glm::vec3(3.0f, 2.0f, 1.5f), 1.0f);
+            const int steps = 600;
+            double solve = 0.0, normals = 0.0, worst = 0.0;
+            for (int step = 0; step < steps; step++)
+            {
+                cloth.SetWind(glm::vec3(0.0f, 0.0f, 4.0f + 3.0f * sinf(step * 0.05f)));
+                cloth.Step();
+                solve += cloth.m_stats.solveMilliseconds;
+                normals += cloth.m_stats.normalsMilliseconds;
+                worst = max(worst, cloth.m_stats.stepMilliseconds);
+            }
+            bool finite = true;
+            for (int i = 0; i < cloth.m_count; i++)
+                finite = finite && isfinite(cloth.m_x[i]) && isfinite(cloth.m_y[i]) && isfinite(cloth.m_z[i]);
+            out << cloth.m_count << " particles, " << cloth.m_constraints << " constraints in " << cloth.Colors() << " colours, "
+                << WorkerPool::Shared().Helpers(cloth.m_helpers) + 1 << " threads: " << cloth.m_stats.averageStepMilliseconds << " ms a step (constraints "
+                << solve / steps << " ms, normals " << normals / steps << " ms, slowest " << worst << " ms); stretch "
+                << cloth.MaxStretch() * 100.0f << "%" << (finite ? "" : ", blew up") << endl;
+            if (thread::hardware_concurrency() <= 1)
+                break;
+        }
+}
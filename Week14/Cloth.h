@@ -0,0 +1,139 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Shape.h"
+
+struct ClothSettings
+{
+    float spacing = 0.06f;          // World units between neighbouring grid vertices at rest.
+    glm::vec3 origin = glm::vec3(0.0f);     // Where grid vertex (0, 0) starts; the grid hangs in the xy plane.
+    int pinEvery = 10;              // Top edge vertices pinned, every nth and both corners. 0 pins nothing.
+    float timestep = 1.0f / 60.0f;  // Seconds a step simulates, whatever the frame rate.
+    int substeps = 4;               // Verlet steps a timestep is split into...
+    int iterations = 4;             // ...and passes over every constraint in each.
+    float stretchStiffness = 1.0f;  // 0..1 for the grid's edges...
+    float bendStiffness = 0.3f;     // ...and across each pair of triangles, after all the iterations.
+    float damping = 0.3f;           // Velocity lost a second, 0..1.
+    glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+    float windDrag = 1.5f;          // How hard the wind pushes on cloth facing it, see Cloth::SetWind.
+    float floorHeight = -1e9f;      // Particles stay above this y.
+    int maxSteps = 4;               // Steps an Update catches up at most, the rest of a long frame is dropped.
+    int workers = 0;                // Shared WorkerPool threads helping the solver, 0 for all of them, -1 for none.
+};
+
+/// @brief Per step cloth numbers, see Cloth::Stats.
+struct ClothStats
+{
+    unsigned steps = 0;
+    double stepMilliseconds = 0.0;          // The last step: all of it...
+    double solveMilliseconds = 0.0;         // ...the constraints...
+    double normalsMilliseconds = 0.0;       // ...and the normals.
+    double averageStepMilliseconds = 0.0;   // Over every step so far.
+    double writeMilliseconds = 0.0;         // Last Update: waiting for the buffer and writing into it.
+};
+
+/// @brief A Grid whose vertices are the particles of a piece of cloth (position based Verlet).
+/// Every edge of the grid's triangles keeps its length, every pair of triangles sharing an edge keeps
+/// the distance between their far corners (bending) and pinned particles stay put. Each substep moves
+/// the particles on by their velocity and the forces, then relaxes the constraints a few times and
+/// keeps every particle within its rest distance of the nearest pin, which a few passes alone can't
+/// do for a tall cloth: it would sag half as long again.
+/// The constraints are coloured so that none of one colour share a particle: a colour is solved
+/// four at a time with SSE2 and in batches over the shared WorkerPool with no locks, colour after colour.
+/// Particles are kept as arrays of x, y and z. The positions and normals go straight into a buffer
+/// mapped once for good (GL 4.4 or ARB_buffer_storage), three frames of it used in turn behind fences,
+/// or through glBufferSubData without it.
+/// @note: the constructor runs OptimizeShape, so vertices are in cache order rather than grid order;
+/// Find gives the particle at a grid point.
+class Cloth : public Grid
+{
+public:
+    Cloth(int quads, const ClothSettings& settings = ClothSettings());
+    ~Cloth();
+
+    //! Buffers the shape and makes the streamed vertex buffer. Call once GL is up.
+    void Init();
+    //! Runs as many whole timesteps as have passed by seconds and writes the result out.
+    void Update(float seconds);
+    //! Draws with the current program, like DrawShape(GL_TRIANGLES). Both sides face the camera,
+    //! so turn face culling off around it.
+    void Draw();
+
+    //! Back to hanging flat at rest.
+    void Reset();
+    //! Particle at grid column col and row row, -1 outside the grid.
+    int Find(int col, int row) const;
+    void Pin(int particle, bool pinned = true);
+    //! Moving air, in units a second. It pushes along each particle's normal, by how much it blows into the cloth.
+    void SetWind(const glm::vec3& wind) { m_wind = wind; }
+    //! A ball the cloth drapes over, radius 0 for none.
+    void SetSphere(const glm::vec3& center, float radius) { m_sphereCenter = center; m_sphereRadius = radius; }
+
+    int Particles() const { return m_count; }
+    int Constraints() const { return m_constraints; }
+    int Colors() const { return (int)m_colorStart.size() - 1; }
+    //! Largest stretch of any grid edge, 0.01 is 1% longer than at rest.
+    float MaxStretch() const;
+    const ClothSettings& Settings() const { return m_settings; }
+    const ClothStats& Stats() const { return m_stats; }
+    void PrintStats() const;
+
+    //! Step times for 10k and 32k particles in the wind, printed to out.
+    static void Benchmark(std::ostream& out);
+
+private:
+    void Step();
+    void Integrate(int first, int last, float h);
+    void Solve(int first, int last);
+    void Tether(int first, int last);
+    void Collide(int first, int last);
+    void Faces(int first, int last);
+    void Normals(int first, int last);
+    //! Positions then normals of [first, last), 3 floats a particle each.
+    void Write(float* out, int first, int last) const;
+    //! The particles into the next region of the buffer, once the GPU is done with it.
+    void Upload();
+    //! Runs jobs [0, count) on the shared WorkerPool, returns when all are done.
+    void Run(int count, const std::function<void(int)>& job);
+
+    ClothSettings m_settings;
+    int m_quads;
+    int m_count, m_padded;                  // Particles, then rounded up past a spare one that never moves.
+    std::vector<float> m_x, m_y, m_z;       // Positions...
+    std::vector<float> m_px, m_py, m_pz;    // ...last substep's...
+    std::vector<float> m_restX, m_restY, m_restZ;
+    std::vector<float> m_nx, m_ny, m_nz;    // ...and normals.
+    std::vector<float> m_w;                 // 1, or 0 for pinned and spare particles.
+    std::vector<float> m_tetherX, m_tetherY, m_tetherZ;    // Where the nearest pin to each particle is...
+    std::vector<float> m_tetherLength;                      // ...and how far it is at rest.
+    bool m_pinsChanged = true;
+    std::vector<int> m_grid;                // Particle at each grid point, row by row.
+    // Constraints by colour, each colour padded to fours with ones between spare particles.
+    std::vector<int32_t> m_a, m_b;
+    std::vector<float> m_rest, m_stiffness;
+    std::vector<int> m_colorStart;
+    int m_constraints;                      // Real ones, without the padding.
+    int m_edgeColors;                       // Colours of grid edges, the bending ones come after.
+    // Triangles, and for each particle the triangles around it (m_around[m_aroundStart[i]...]).
+    std::vector<int> m_triangles, m_aroundStart, m_around;
+    std::vector<float> m_fx, m_fy, m_fz;    // Each triangle's normal times twice its area.
+    glm::vec3 m_wind, m_sphereCenter;
+    float m_sphereRadius = 0.0f;
+    double m_time = -1.0, m_unsimulated = 0.0;
+    double m_totalMilliseconds = 0.0;
+    bool m_written = false;
+    ClothStats m_stats;
+
+    int m_helpers;                          // Workers of the shared pool to use, -1 for all.
+
+    static const int FRAMES = 3;
+    GLuint m_vbo = 0;
+    float* m_mapped = nullptr;              // The persistent mapping, FRAMES regions, or null.
+    std::vector<float> m_staging;           // What glBufferSubData sends without one.
+    GLsync m_fences[FRAMES] = {};
+    int m_frame = 0;
+};
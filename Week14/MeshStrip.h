@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////
+// @file MeshStrip.h
+// @brief Turns an indexed triangle list into triangle strips joined by a primitive restart index.
+//
+// A strip of n triangles takes n + 2 indices instead of 3n, plus one for the restart after it.
+// Triangles keep their winding, so back face culling and normals are unaffected. When the
+// strips wouldn't save at least minSaving of the indices, e.g. for a mesh without shared
+// vertices, the triangle list is kept and should be drawn as GL_TRIANGLES as before.
+//
+// Strips start at the first triangle not yet in one, in the order given, and follow shared
+// edges for at most maxTriangles. Run it after MeshOptimize: short strips in that order keep
+// its vertex cache use, where strips as long as possible would run along a whole row of a
+// Grid and have to transform every vertex again for the next row. With a 16 vertex cache,
+// 12 triangles (14 vertices) a strip keep the previous strip's vertices in the cache.
+//
+//	MeshStrip::Strips<GLuint> strips = MeshStrip::Stripify(indices.data(), indices.size(), vertexCount, 0xFFFFFFFFu);
+//	strips.Print(cout, "mesh");
+//	...
+//	if (strips.strips)
+//	{
+//		glEnable(GL_PRIMITIVE_RESTART);
+//		glPrimitiveRestartIndex(0xFFFFFFFFu);
+//		glDrawElements(GL_TRIANGLE_STRIP, (GLsizei)strips.indices.size(), GL_UNSIGNED_INT, 0);
+//		glDisable(GL_PRIMITIVE_RESTART);
+//	}
+///////////////////////////////////////////////////////////////////////
+
+namespace MeshStrip
+{
+	template <typename Index>
+	struct Strips
+	{
+		std::vector<Index> indices;		// Strips with restart between them, or the list if strips is false.
+		bool strips = false;
+		size_t triangles = 0, stripCount = 0;
+		size_t listIndices = 0, stripIndices = 0;	// What each would take, restarts included.
+
+		void Print(std::ostream& out, const char* name) const
+		{
+			out << name << ": " << triangles << " triangles, " << listIndices << " indices as a list, "
+				<< stripIndices << " as " << stripCount << " strips (" << (listIndices ? 100.0 - 100.0 * stripIndices / listIndices : 0.0)
+				<< "% saved), drawn as " << (strips ? "strips" : "a list") << std::endl;
+		}
+	};
+
+	// restart must not be a vertex index: for GLshort or GLuint indices use all bits set, -1 or
+	// 0xFFFFFFFF, and GL_UNSIGNED_SHORT or GL_UNSIGNED_INT to draw. maxTriangles 0 makes strips
+	// as long as they can be.
+	template <typename Index>
+	Strips<Index> Stripify(const Index* indices, size_t indexCount, size_t vertexCount, Index restart, float minSaving = 0.1f, size_t maxTriangles = 12)
+	{
+		Strips<Index> result;
+		const size_t triangleCount = indexCount / 3;
+		result.triangles = triangleCount;
+		result.listIndices = triangleCount * 3;
+		result.indices.assign(indices, indices + triangleCount * 3);
+		if (triangleCount == 0)
+			return result;
+
+		// The triangles around each vertex, first[v] to first[v + 1] in around.
+		std::vector<char> degenerate(triangleCount, 0);
+		std::vector<unsigned> first(vertexCount + 1, 0), around;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const size_t a = (size_t)indices[t * 3], b = (size_t)indices[t * 3 + 1], c = (size_t)indices[t * 3 + 2];
+			if (a == b || b == c || c == a)
+				degenerate[t] = 1;	// Draws nothing, so it is dropped.
+			else
+				for (int k = 0; k < 3; k++)
+					first[(size_t)indices[t * 3 + k] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++)
+			first[v + 1] += first[v];
+		around.resize(first[vertexCount]);
+		std::vector<unsigned> fill(first.begin(), first.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+			if (!degenerate[t])
+				for (int k = 0; k < 3; k++)
+					around[fill[(size_t)indices[t * 3 + k]]++] = (unsigned)t;
+
+		// The triangle across the edge a -> b is the one with b -> a in its winding.
+		const unsigned none = ~0u;
+		auto across = [&](size_t a, size_t b) -> unsigned
+		{
+			for (unsigned i = first[b]; i < first[b + 1]; i++)
+			{
+				const Index* t = indices + (size_t)around[i] * 3;
+				for (int k = 0; k < 3; k++)
+					if ((size_t)t[k] == b && (size_t)t[(k + 1) % 3] == a)
+						return around[i];
+			}
+			return none;
+		};
+
+		std::vector<char> used(degenerate);
+		std::vector<unsigned> stamp(triangleCount, 0);	// Which trial strip took a triangle.
+		std::vector<Index> strip, best, out;
+		out.reserve(triangleCount * 2);
+		std::vector<unsigned> taken, bestTaken;
+		unsigned trial = 0;
+		size_t stripCount = 0;
+		for (unsigned start = 0; start < triangleCount; start++)
+		{
+			if (used[start])
+				continue;
+
+			// Try each corner first and keep the longest strip.
+			best.clear();
+			bestTaken.clear();
+			for (int first = 0; first < 3; first++)
+			{
+				trial++;
+				strip.clear();
+				taken.assign(1, start);
+				stamp[start] = trial;
+				for (int k = 0; k < 3; k++)
+					strip.push_back(indices[start * 3 + (first + k) % 3]);
+				for (;;)
+				{
+					// Triangle i of a strip is (i, i + 1, i + 2), or (i + 1, i, i + 2) for odd i.
+					const size_t i = strip.size() - 2;
+					const size_t p = (size_t)strip[i], q = (size_t)strip[i + 1];
+					const unsigned next = i % 2 == 0 ? across(q, p) : across(p, q);
+					if (next == none || used[next] || stamp[next] == trial || (maxTriangles && taken.size() >= maxTriangles))
+						break;
+					size_t third = 0;
+					for (int k = 0; k < 3; k++)
+						if ((size_t)indices[next * 3 + k] != p && (size_t)indices[next * 3 + k] != q)
+							third = k;
+					strip.push_back(indices[next * 3 + third]);
+					taken.push_back(next);
+					stamp[next] = trial;
+				}
+				if (taken.size() > bestTaken.size())
+				{
+					best.swap(strip);
+					bestTaken.swap(taken);
+				}
+			}
+
+			if (stripCount++ > 0)
+				out.push_back(restart);
+			out.insert(out.end(), best.begin(), best.end());
+			for (unsigned t : bestTaken)
+				used[t] = 1;
+		}
+
+		result.stripCount = stripCount;
+		result.stripIndices = out.size();
+		if (out.size() <= result.listIndices * (1.0f - minSaving))
+		{
+			result.indices.swap(out);
+			result.strips = true;
+		}
+		return result;
+	}
+}
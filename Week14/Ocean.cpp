@@ -0,0 +1,540 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include "Ocean.h"
+#include "Shape.h"
+#include "Simd4.h"
+#include "WorkerPool.h"
+#include "prepShader.h"
+
+using namespace std;
+
+static const float GRAVITY = 9.81f;
+static const float TWO_PI = 6.28318531f;
+// Wave speeds are rounded to multiples of 2 pi / this, so the sea repeats after it and the phase
+// omega * t stays small enough for float sines however long the program runs.
+static const float REPEAT_SECONDS = 200.0f;
+// Rows or columns a job of a pass works on.
+static const int STRIP = 32;
+
+//---------------------------------------------------------------------
+//
+// sin and cos four at a time.
+//
+#if defined(SIMD4_SSE2)
+//! sin and cos of x, |x| < 2^20: x is brought into [-pi/4, pi/4] with pi/2 split in three
+//! (Cody-Waite) and the Cephes polynomials are picked by quadrant.
+static inline void SinCos(V4 x, V4& s, V4& c)
+{
+    const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x.v, _mm_set1_ps(0.636619772f)));
+    const __m128 q = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(x.v, _mm_mul_ps(q, _mm_set1_ps(1.5703125f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(4.837512969970703125e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(7.54978995489188216e-8f)));
+    const __m128 r2 = _mm_mul_ps(r, r);
+    __m128 sine = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+    sine = _mm_add_ps(_mm_mul_ps(sine, r2), _mm_set1_ps(-1.6666654611e-1f));
+    sine = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sine, r2), r), r);
+    __m128 cosine = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+    cosine = _mm_add_ps(_mm_mul_ps(cosine, r2), _mm_set1_ps(4.166664568298827e-2f));
+    cosine = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(cosine, r2), r2), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // Odd quadrants swap sine and cosine, quadrants 2 and 3 negate the sine, 1 and 2 the cosine.
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    const __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    const __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    s.v = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosine), _mm_andnot_ps(swap, sine)), sineSign);
+    c.v = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sine), _mm_andnot_ps(swap, cosine)), cosineSign);
+}
+#else
+static inline void SinCos(V4 x, V4& s, V4& c)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        s.v[i] = sinf(x.v[i]);
+        c.v[i] = cosf(x.v[i]);
+    }
+}
+#endif
+
+//---------------------------------------------------------------------
+//
+// Ocean
+//
+Ocean::Ocean(const OceanSettings& settings) : m_settings(settings)
+{
+    m_log2 = 5;
+    while ((2 << m_log2) <= settings.size && m_log2 < 12)
+        m_log2++;
+    m_size = 1 << m_log2;
+    const int n = m_size;
+    const size_t count = (size_t)n * n;
+
+    // The Phillips spectrum: waves of length about wind^2 / g and longer, mostly along the wind.
+    const float windSpeed = glm::length(m_settings.wind);
+    const glm::vec2 windDirection = windSpeed > 0.0f ? m_settings.wind / windSpeed : glm::vec2(1.0f, 0.0f);
+    const float longest = max(windSpeed * windSpeed / GRAVITY, 1e-3f);
+    const float dk = TWO_PI / m_settings.patchSize;
+    const float omegaStep = TWO_PI / REPEAT_SECONDS;
+    uint32_t state = m_settings.seed * 2654435761u + 1u;
+    auto uniform = [&state]()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return ((state >> 8) + 0.5f) * (1.0f / 16777216.0f);
+    };
+
+    m_h0Re.assign(count, 0.0f);
+    m_h0Im.assign(count, 0.0f);
+    m_h0ConjRe.assign(count, 0.0f);
+    m_h0ConjIm.assign(count, 0.0f);
+    m_omega.assign(count, 0.0f);
+    m_kx.assign(count, 0.0f);
+    m_kz.assign(count, 0.0f);
+    m_ux.assign(count, 0.0f);
+    m_uz.assign(count, 0.0f);
+    for (int z = 0; z < n; z++)
+        for (int x = 0; x < n; x++)
+        {
+            const size_t i = (size_t)z * n + x;
+            const float kx = (x - n / 2) * dk, kz = (z - n / 2) * dk;
+            const float k = sqrtf(kx * kx + kz * kz);
+            m_kx[i] = kx;
+            m_kz[i] = kz;
+            // Box-Muller, drawn for every wave so the sea doesn't change with which ones are kept.
+            const float radius = sqrtf(-2.0f * logf(uniform())), angle = TWO_PI * uniform();
+            // Row and column 0 hold the waves with no mirror image -k in the grid; leaving them
+            // out keeps every field real, so two can share an FFT without leaking into each other.
+            if (x == 0 || z == 0 || k < 1e-6f)
+                continue;
+            m_ux[i] = kx / k;
+            m_uz[i] = kz / k;
+            m_omega[i] = floorf(sqrtf(GRAVITY * k) / omegaStep) * omegaStep;
+            const float along = m_ux[i] * windDirection.x + m_uz[i] * windDirection.y;
+            const float k2 = k * k;
+            float phillips = m_settings.amplitude * expf(-1.0f / (k2 * longest * longest)) / (k2 * k2) * along * along
+                * expf(-k2 * m_settings.smallWaves * m_settings.smallWaves) * dk * dk;
+            if (along < 0.0f)
+                phillips *= 0.07f;  // Waves against the wind die down.
+            const float amplitude = sqrtf(phillips * 0.5f);
+            m_h0Re[i] = radius * cosf(angle) * amplitude;
+            m_h0Im[i] = radius * sinf(angle) * amplitude;
+        }
+    for (int z = 1; z < n; z++)
+        for (int x = 1; x < n; x++)
+        {
+            const size_t i = (size_t)z * n + x, mirror = (size_t)(n - z) * n + (n - x);
+            m_h0ConjRe[i] = m_h0Re[mirror];
+            m_h0ConjIm[i] = -m_h0Im[mirror];
+        }
+
+    m_twiddleRe.resize(n / 2);
+    m_twiddleIm.resize(n / 2);
+    for (int j = 0; j < n / 2; j++)
+    {
+        m_twiddleRe[j] = (float)cos(2.0 * 3.14159265358979324 * j / n);
+        m_twiddleIm[j] = (float)sin(2.0 * 3.14159265358979324 * j / n);
+    }
+    m_reverse.resize(n);
+    for (int r = 0; r < n; r++)
+    {
+        int reversed = 0;
+        for (int bit = 0; bit < m_log2; bit++)
+            reversed |= ((r >> bit) & 1) << (m_log2 - 1 - bit);
+        m_reverse[r] = reversed;
+    }
+    // Rows 2^k floats apart all land in the same few cache sets, which a pass down the columns
+    // thrashes; a little padding spreads them out.
+    m_pitch = n + 16;
+    for (int f = 0; f < 4; f++)
+    {
+        m_re[f].assign((size_t)n * m_pitch, 0.0f);
+        m_im[f].assign((size_t)n * m_pitch, 0.0f);
+        m_scratchRe[f].assign((size_t)n * m_pitch, 0.0f);
+        m_scratchIm[f].assign((size_t)n * m_pitch, 0.0f);
+    }
+
+    m_helpers = m_settings.workers < 0 ? 0 : m_settings.workers == 0 ? -1 : m_settings.workers;
+}
+
+Ocean::~Ocean()
+{
+    // Nothing to delete, nor any GL to delete it with, if Init never ran (the benchmark).
+    if (m_program)
+    {
+        glDeleteProgram(m_program);
+        glDeleteTextures(1, &m_displacement);
+        glDeleteTextures(1, &m_normals);
+        glDeleteBuffers(2, m_pbo);
+    }
+}
+
+void Ocean::Run(int count, const function<void(int)>& job)
+{
+    WorkerPool::Shared().Run(count, job, m_helpers);
+}
+
+//---------------------------------------------------------------------
+//
+// FFT
+//
+void Ocean::Columns(float* re, float* im, int first, int last) const
+{
+    const int n = m_size;
+    const size_t pitch = m_pitch;
+    for (int r = 0; r < n; r++)
+    {
+        const int other = m_reverse[r];
+        if (other > r)
+        {
+            swap_ranges(re + r * pitch + first, re + r * pitch + last, re + other * pitch + first);
+            swap_ranges(im + r * pitch + first, im + r * pitch + last, im + other * pitch + first);
+        }
+    }
+    // Radix-2 butterflies between whole rows, four columns at a time.
+    for (int half = 1, step = n / 2; half < n; half *= 2, step /= 2)
+        for (int start = 0; start < n; start += half * 2)
+            for (int j = 0; j < half; j++)
+            {
+                const V4 wr = Set(m_twiddleRe[j * step]), wi = Set(m_twiddleIm[j * step]);
+                float* aRe = re + (start + j) * pitch;
+                float* aIm = im + (start + j) * pitch;
+                float* bRe = aRe + half * pitch;
+                float* bIm = aIm + half * pitch;
+                for (int x = first; x < last; x += 4)
+                {
+                    const V4 br = Load(bRe + x), bi = Load(bIm + x);
+                    const V4 tr = br * wr - bi * wi, ti = br * wi + bi * wr;
+                    const V4 ar = Load(aRe + x), ai = Load(aIm + x);
+                    Store(aRe + x, ar + tr);
+                    Store(aIm + x, ai + ti);
+                    Store(bRe + x, ar - tr);
+                    Store(bIm + x, ai - ti);
+                }
+            }
+}
+
+void Ocean::Transpose(const float* in, float* out, int first, int last) const
+{
+    const int n = m_size;
+    const size_t pitch = m_pitch;
+    for (int y = first; y < last; y += 4)
+        for (int x = 0; x < n; x += 4)
+        {
+#if defined(SIMD4_SSE2)
+            __m128 r0 = _mm_loadu_ps(in + y * pitch + x), r1 = _mm_loadu_ps(in + (y + 1) * pitch + x);
+            __m128 r2 = _mm_loadu_ps(in + (y + 2) * pitch + x), r3 = _mm_loadu_ps(in + (y + 3) * pitch + x);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + x * pitch + y, r0);
+            _mm_storeu_ps(out + (x + 1) * pitch + y, r1);
+            _mm_storeu_ps(out + (x + 2) * pitch + y, r2);
+            _mm_storeu_ps(out + (x + 3) * pitch + y, r3);
+#else
+            for (int i = 0; i < 4; i++)
+                for (int j = 0; j < 4; j++)
+                    out[(x + j) * pitch + y + i] = in[(y + i) * pitch + x + j];
+#endif
+        }
+}
+
+//---------------------------------------------------------------------
+//
+// Simulation
+//
+void Ocean::Simulate(float seconds, float* displacement, unsigned char* normals)
+{
+    typedef chrono::high_resolution_clock Clock;
+    const int n = m_size;
+    const int strips = n / STRIP;
+    const float time = fmodf(seconds, REPEAT_SECONDS);
+    const auto start = Clock::now();
+
+    // The spectrum at time: h(k) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t), and from it the
+    // other seven fields, multiplied out two to a complex field (A + i B for real fields a and b).
+    Run(strips, [&](int job)
+    {
+        const V4 t = Set(time), one = Set(1.0f), zero = Set(0.0f);
+        for (int z = job * STRIP; z < (job + 1) * STRIP; z++)
+        {
+            for (int x = 0; x < n; x += 4)
+            {
+                const size_t i = (size_t)z * n + x, o = (size_t)z * m_pitch + x;
+                V4 s, c;
+                SinCos(Load(&m_omega[i]) * t, s, c);
+                const V4 h0r = Load(&m_h0Re[i]), h0i = Load(&m_h0Im[i]);
+                const V4 conjR = Load(&m_h0ConjRe[i]), conjI = Load(&m_h0ConjIm[i]);
+                const V4 hr = (h0r + conjR) * c + (conjI - h0i) * s;
+                const V4 hi = (h0r - conjR) * s + (h0i + conjI) * c;
+                const V4 kx = Load(&m_kx[i]), kz = Load(&m_kz[i]), ux = Load(&m_ux[i]), uz = Load(&m_uz[i]);
+                // Each field is h times a + i b.
+                const V4 a[4] = { one - ux, zero - kx, zero, zero - uz * kz };
+                const V4 b[4] = { zero, uz, kz - kx * ux, zero - uz * kx };
+                for (int f = 0; f < 4; f++)
+                {
+                    Store(&m_re[f][o], hr * a[f] - hi * b[f]);
+                    Store(&m_im[f][o], hr * b[f] + hi * a[f]);
+                }
+            }
+        }
+    });
+    const auto spectrum = Clock::now();
+
+    // Down the columns, across (as columns of the transpose) and back.
+    Run(4 * strips, [&](int job) { Columns(m_re[job / strips].data(), m_im[job / strips].data(), job % strips * STRIP, (job % strips + 1) * STRIP); });
+    Run(4 * strips, [&](int job)
+    {
+        const int f = job / strips, first = job % strips * STRIP;
+        Transpose(m_re[f].data(), m_scratchRe[f].data(), first, first + STRIP);
+        Transpose(m_im[f].data(), m_scratchIm[f].data(), first, first + STRIP);
+    });
+    Run(4 * strips, [&](int job) { Columns(m_scratchRe[job / strips].data(), m_scratchIm[job / strips].data(), job % strips * STRIP, (job % strips + 1) * STRIP); });
+    Run(4 * strips, [&](int job)
+    {
+        const int f = job / strips, first = job % strips * STRIP;
+        Transpose(m_scratchRe[f].data(), m_re[f].data(), first, first + STRIP);
+        Transpose(m_scratchIm[f].data(), m_im[f].data(), first, first + STRIP);
+    });
+    const auto fft = Clock::now();
+
+    // The spectrum was centred on k = 0, which flips the sign of every other sample.
+    const float chop = m_settings.choppiness;
+    Run(strips, [&](int job)
+    {
+        for (int z = job * STRIP; z < (job + 1) * STRIP; z++)
+        {
+            const float first = (z & 1) ? -1.0f : 1.0f;
+#if defined(SIMD4_SSE2)
+            const __m128 sign = _mm_setr_ps(first, -first, first, -first);
+            const __m128 lambda = _mm_set1_ps(chop), one = _mm_set1_ps(1.0f);
+            for (int x = 0; x < n; x += 4)
+            {
+                const size_t i = (size_t)z * n + x, o = (size_t)z * m_pitch + x;
+                const __m128 height = _mm_mul_ps(_mm_loadu_ps(&m_re[0][o]), sign);
+                const __m128 dx = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_im[0][o]), sign), lambda);
+                const __m128 dz = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_re[1][o]), sign), lambda);
+                const __m128 sx = _mm_mul_ps(_mm_loadu_ps(&m_im[1][o]), sign);
+                const __m128 sz = _mm_mul_ps(_mm_loadu_ps(&m_re[2][o]), sign);
+                const __m128 dxx = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_im[2][o]), sign), lambda);
+                const __m128 dzz = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_re[3][o]), sign), lambda);
+                const __m128 dxz = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(&m_im[3][o]), sign), lambda);
+
+                // x, height, z, 0 for four texels.
+                __m128 t0 = dx, t1 = height, t2 = dz, t3 = _mm_setzero_ps();
+                _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+                float* out = displacement + i * 4;
+                _mm_storeu_ps(out, t0);
+                _mm_storeu_ps(out + 4, t1);
+                _mm_storeu_ps(out + 8, t2);
+                _mm_storeu_ps(out + 12, t3);
+
+                // Normal (-sx, 1, -sz) normalized; foam where the Jacobian of the displacement drops
+                // towards 0, i.e. the surface is squeezed into a fold.
+                const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sz, sz)), one));
+                const __m128 scale = _mm_div_ps(_mm_set1_ps(127.5f), length);
+                const __m128 jacobian = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(one, dxx), _mm_add_ps(one, dzz)), _mm_mul_ps(dxz, dxz));
+                const __m128 foam = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(0.6f), jacobian), _mm_setzero_ps()), _mm_set1_ps(0.6f));
+                const __m128i r = _mm_cvtps_epi32(_mm_sub_ps(_mm_set1_ps(127.5f), _mm_mul_ps(sx, scale)));
+                const __m128i g = _mm_cvtps_epi32(_mm_add_ps(_mm_set1_ps(127.5f), scale));
+                const __m128i b = _mm_cvtps_epi32(_mm_sub_ps(_mm_set1_ps(127.5f), _mm_mul_ps(sz, scale)));
+                const __m128i a = _mm_cvtps_epi32(_mm_mul_ps(foam, _mm_set1_ps(255.0f / 0.6f)));
+                const __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+                _mm_storeu_si128((__m128i*)(normals + i * 4), rgba);
+            }
+#else
+            for (int x = 0; x < n; x++)
+            {
+                const size_t i = (size_t)z * n + x, o = (size_t)z * m_pitch + x;
+                const float sign = (x & 1) ? -first : first;
+                float* out = displacement + i * 4;
+                out[0] = m_im[0][o] * sign * chop;
+                out[1] = m_re[0][o] * sign;
+                out[2] = m_re[1][o] * sign * chop;
+                out[3] = 0.0f;
+                const float sx = m_im[1][o] * sign, sz = m_re[2][o] * sign;
+                const float dxx = m_im[2][o] * sign * chop, dzz = m_re[3][o] * sign * chop, dxz = m_im[3][o] * sign * chop;
+                const float scale = 127.5f / sqrtf(sx * sx + sz * sz + 1.0f);
+                const float jacobian = (1.0f + dxx) * (1.0f + dzz) - dxz * dxz;
+                const float foam = min(max(0.6f - jacobian, 0.0f), 0.6f);
+                unsigned char* texel = normals + i * 4;
+                texel[0] = (unsigned char)lrintf(127.5f - sx * scale);
+                texel[1] = (unsigned char)lrintf(127.5f + scale);
+                texel[2] = (unsigned char)lrintf(127.5f - sz * scale);
+                texel[3] = (unsigned char)lrintf(foam * (255.0f / 0.6f));
+            }
+#endif
+        }
+    });
+    const auto end = Clock::now();
+
+    m_stats.spectrumMilliseconds = chrono::duration<double, milli>(spectrum - start).count();
+    m_stats.fftMilliseconds = chrono::duration<double, milli>(fft - spectrum).count();
+    m_stats.outputMilliseconds = chrono::duration<double, milli>(end - fft).count();
+    const double total = chrono::duration<double, milli>(end - start).count();
+    m_stats.frame++;
+    m_stats.averageFftMilliseconds += (m_stats.fftMilliseconds - m_stats.averageFftMilliseconds) / m_stats.frame;
+    m_stats.averageTotalMilliseconds += (total - m_stats.averageTotalMilliseconds) / m_stats.frame;
+}
+
+//---------------------------------------------------------------------
+//
+// GL
+//
+bool Ocean::Init()
+{
+    GLuint shaders[4] = { (GLuint)setShader((char*)"vertex", (char*)"ocean.vert"),
+                          (GLuint)setShader((char*)"tessControl", (char*)"ocean.tesc"),
+                          (GLuint)setShader((char*)"tessEvaluation", (char*)"ocean.tese"),
+                          (GLuint)setShader((char*)"fragment", (char*)"ocean.frag") };
+    m_program = glCreateProgram();
+    for (GLuint shader : shaders)
+        glAttachShader(m_program, shader);
+    glLinkProgram(m_program);
+    GLint linked = 0;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char log[1024];
+        glGetProgramInfoLog(m_program, 1024, 0, log);
+        cerr << "Failed to link the ocean shaders:" << endl << log << endl;
+        glDeleteProgram(m_program);
+        m_program = 0;
+        return false;
+    }
+
+    // Both textures start out as the sea at time 0, the buffers take over from the first Update.
+    const int n = m_size;
+    vector<float> displacement((size_t)n * n * 4);
+    vector<unsigned char> normals((size_t)n * n * 4);
+    Simulate(0.0f, displacement.data(), normals.data());
+    glGenTextures(1, &m_displacement);
+    glBindTexture(GL_TEXTURE_2D, m_displacement);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, n, n, 0, GL_RGBA, GL_FLOAT, displacement.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenTextures(1, &m_normals);
+    glBindTexture(GL_TEXTURE_2D, m_normals);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, normals.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(2, m_pbo);
+    for (GLuint pbo : m_pbo)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (size_t)n * n * 20, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_pboIndex = 0;
+    m_pboFilled = false;
+    return true;
+}
+
+void Ocean::Update(float seconds)
+{
+    if (!m_program)
+        return;
+    const int n = m_size;
+    const size_t displacementBytes = (size_t)n * n * 16, normalBytes = (size_t)n * n * 4;
+
+    // Last frame's buffer into the textures; the copy runs on the GPU while this frame is worked out.
+    if (m_pboFilled)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[1 - m_pboIndex]);
+        glBindTexture(GL_TEXTURE_2D, m_displacement);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_FLOAT, 0);
+        glBindTexture(GL_TEXTURE_2D, m_normals);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, n, n, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)displacementBytes);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Invalidating gives a fresh buffer rather than waiting on one the GPU might still be reading.
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo[m_pboIndex]);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, displacementBytes + normalBytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        Simulate(seconds, (float*)mapped, (unsigned char*)mapped + displacementBytes);
+        m_pboFilled = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        m_pboIndex = 1 - m_pboIndex;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void Ocean::Draw(Grid& grid, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                 const glm::vec3& eye, const glm::vec3& toSun)
+{
+    if (!m_program)
+        return;
+    glUseProgram(m_program);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "model"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "projection"), 1, GL_FALSE, &projection[0][0]);
+    glUniform3f(glGetUniformLocation(m_program, "eyePosition"), eye.x, eye.y, eye.z);
+    glUniform3f(glGetUniformLocation(m_program, "toSun"), toSun.x, toSun.y, toSun.z);
+    glUniform1f(glGetUniformLocation(m_program, "uvScale"), 1.0f / m_settings.patchSize);
+    // About one triangle edge per 8 texels of the heightfield seen from a unit away.
+    glUniform1f(glGetUniformLocation(m_program, "tessellationScale"), m_size / (8.0f * m_settings.patchSize));
+    glUniform1i(glGetUniformLocation(m_program, "displacementMap"), 0);
+    glUniform1i(glGetUniformLocation(m_program, "normalMap"), 1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_normals);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_displacement);
+
+    glPatchParameteri(GL_PATCH_VERTICES, 3);
+    grid.DrawShape(GL_PATCHES);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+void Ocean::PrintStats() const
+{
+    cout << "Ocean " << m_size << "x" << m_size << ", frame " << m_stats.frame << ": spectrum " << m_stats.spectrumMilliseconds
+         << " ms, FFT " << m_stats.fftMilliseconds << " ms, maps " << m_stats.outputMilliseconds << " ms (FFT "
+         << m_stats.averageFftMilliseconds << " ms, all " << m_stats.averageTotalMilliseconds << " ms on average), "
+         << WorkerPool::Shared().Helpers(m_helpers) + 1 << " threads" << endl;
+}
+
+void Ocean::Benchmark(std::ostream& out)
+{
+    out << "Ocean benchmark: 120 frames of eight " << "inverse FFTs (as four complex ones) and the maps, "
+        << max(1u, thread::hardware_concurrency()) << " cores." << endl;
+    for (int size : { 256, 512 })
+        for (int workers : { -1, 0 })
+        {
+            OceanSettings settings;
+            settings.size = size;
+            settings.workers = workers;
+            Ocean ocean(settings);
+            vector<float> displacement((size_t)size * size * 4);
+            vector<unsigned char> normals((size_t)size * size * 4);
+            const int frames = 120;
+            double spectrum = 0.0, output = 0.0, squares = 0.0;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                ocean.Simulate(frame / 60.0f, displacement.data(), normals.data());
+                spectrum += ocean.m_stats.spectrumMilliseconds;
+                output += ocean.m_stats.outputMilliseconds;
+            }
+            for (size_t i = 1; i < displacement.size(); i += 4)
+                squares += displacement[i] * displacement[i];
+            out << size << "x" << size << ", " << WorkerPool::Shared().Helpers(ocean.m_helpers) + 1 << " threads: spectrum " << spectrum / frames
+                << " ms, FFT " << ocean.m_stats.averageFftMilliseconds << " ms, maps " << output / frames << " ms, "
+                << ocean.m_stats.averageTotalMilliseconds << " ms a frame; rms height " << sqrt(squares / ((double)size * size)) << endl;
+            if (thread::hardware_concurrency() <= 1)
+                break;
+        }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+struct Grid;
+
+struct OceanSettings
+{
+    int size = 256;                 // Samples along a side of the heightfield, a power of two (256 or 512).
+    float patchSize = 32.0f;        // World units one tile of the heightfield covers, it repeats beyond.
+    glm::vec2 wind = glm::vec2(5.0f, 2.0f);     // Units a second, along x and z. Faster wind, longer waves.
+    float amplitude = 0.004f;       // Phillips constant A. The mean square height is about A * pi / 2 * (wind^2 / g)^2.
+    float choppiness = 1.0f;        // How far the surface is pulled towards the crests, 0 for round waves.
+    float smallWaves = 0.05f;       // Waves much shorter than this are damped away.
+    int workers = 0;                // Shared WorkerPool threads helping with the FFT, 0 for all of them, -1 for none.
+    unsigned seed = 1;
+};
+
+/// @brief Per frame ocean numbers, see Ocean::Stats.
+struct OceanStats
+{
+    unsigned frame = 0;
+    double spectrumMilliseconds = 0.0;  // This frame: the spectrum at the current time...
+    double fftMilliseconds = 0.0;       // ...its inverse FFTs...
+    double outputMilliseconds = 0.0;    // ...and the displacement and normal maps written out.
+    double averageFftMilliseconds = 0.0;    // Over every frame so far.
+    double averageTotalMilliseconds = 0.0;
+};
+
+/// @brief A tiling patch of open water synthesized each frame from a Phillips wave spectrum (Tessendorf).
+/// The spectrum's random start is made once. Each frame every wave is moved on by its own speed
+/// (deep water: omega = sqrt(g k)) and eight inverse FFTs of size x size give the heights, the
+/// sideways displacements that sharpen the crests, the slopes for the normals and the Jacobian that
+/// says where the surface folds over (foam). The fields are real, so they go two to a complex FFT.
+/// The FFT is radix-2 and works on whole rows at once: a pass down the columns is four columns per
+/// SSE2 instruction, split into strips over the shared WorkerPool, the rows are transposed into columns
+/// and done the same way. Results are written straight into a mapped pixel buffer and copied from it
+/// into the textures the frame after (two buffers take turns), so neither side waits for the other.
+/// @note: the surface is drawn on a Grid whose triangles are tessellated on the GPU, closer ones
+/// finer, and displaced by the displacement map. Buffer the grid with BufferShape(false): strips can't
+/// be drawn as patches.
+class Ocean
+{
+public:
+    Ocean(const OceanSettings& settings = OceanSettings());
+    ~Ocean();
+
+    //! The surface at time seconds on the CPU, no GL calls. displacement gets x, height, z and
+    //! 0 floats, normals the normal as RGB bytes (0.5 + 0.5 * n) and foam as A, size x size each.
+    void Simulate(float seconds, float* displacement, unsigned char* normals);
+
+    //! Shaders, textures and pixel buffers. Call once GL is up. False if the shaders didn't link.
+    bool Init();
+    //! Simulates seconds into a pixel buffer and streams last frame's into the textures.
+    void Update(float seconds);
+    //! Draws grid tessellated and displaced, grid's xy plane mapped by model. toSun points at the sun.
+    //! Leaves program 0 bound.
+    void Draw(Grid& grid, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+              const glm::vec3& eye, const glm::vec3& toSun);
+
+    const OceanSettings& Settings() const { return m_settings; }
+    const OceanStats& Stats() const { return m_stats; }
+    void PrintStats() const;
+
+    //! FFT and frame time at 256 and 512, printed to out.
+    static void Benchmark(std::ostream& out);
+
+private:
+    //! Runs jobs [0, count) on the shared WorkerPool, returns when all are done.
+    void Run(int count, const std::function<void(int)>& job);
+    //! One inverse FFT down every column of [first, last) of a complex field.
+    void Columns(float* re, float* im, int first, int last) const;
+    //! out = in transposed, rows [first, last) of in.
+    void Transpose(const float* in, float* out, int first, int last) const;
+
+    OceanSettings m_settings;
+    int m_size, m_log2;
+    int m_pitch;                                    // Floats from one row of a field to the next.
+    std::vector<float> m_h0Re, m_h0Im;              // h0(k)...
+    std::vector<float> m_h0ConjRe, m_h0ConjIm;      // ...and conj(h0(-k)).
+    std::vector<float> m_omega, m_kx, m_kz;         // Per wave: angular speed, wave vector...
+    std::vector<float> m_ux, m_uz;                  // ...and its direction.
+    std::vector<float> m_twiddleRe, m_twiddleIm;    // exp(2 pi i j / size), j < size / 2.
+    std::vector<int> m_reverse;                     // Bit reversed row of each row.
+    // Four complex fields, two real ones each: height + i x, z + i slope x,
+    // slope z + i dx/dx, dz/dz + i dx/dz. Then the same transposed.
+    std::vector<float> m_re[4], m_im[4], m_scratchRe[4], m_scratchIm[4];
+    OceanStats m_stats;
+
+    int m_helpers;                                  // Workers of the shared pool to use, -1 for all.
+
+    GLuint m_program = 0, m_displacement = 0, m_normals = 0;
+    GLuint m_pbo[2] = {};
+    int m_pboIndex = 0;
+    bool m_pboFilled = false;
+};
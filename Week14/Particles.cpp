@@ -0,0 +1,590 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "Particles.h"
+#include "Simd4.h"
+#include "WorkerPool.h"
+#include "prepShader.h"
+
+using namespace std;
+
+// Particles a job works on. A multiple of 4, so only the last job's last four run past its end.
+static const int BATCH = 16384;
+static const int RADIX_BITS = 11;
+// Depth keys keep the top 22 bits of the float: its sign, exponent and 13 bits of mantissa, to 1 part
+// in 8192 of the distance, which is plenty for blending. Two passes instead of the three 32 bits take.
+static const int KEY_BITS = 2 * RADIX_BITS;
+static const int BUCKETS = 1 << RADIX_BITS;
+
+//---------------------------------------------------------------------
+//
+// Depth keys, colours and positions four at a time, and four xorshift random number generators side by side.
+//
+#if defined(SIMD4_SSE2)
+//! Keys that sort as unsigned integers the way a sorts as floats, KEY_BITS of them.
+static inline void SortKeys(uint32_t* out, V4 a)
+{
+    const __m128i bits = _mm_castps_si128(a.v);
+    const __m128i flip = _mm_or_si128(_mm_srai_epi32(bits, 31), _mm_set1_epi32((int)0x80000000));
+    _mm_storeu_si128((__m128i*)out, _mm_srli_epi32(_mm_xor_si128(bits, flip), 32 - KEY_BITS));
+}
+
+//! Four RGBA bytes from colours in 0..1.
+static inline void PackColors(uint32_t* out, V4 r, V4 g, V4 b, V4 a)
+{
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128i ri = _mm_cvtps_epi32(_mm_mul_ps(r.v, scale)), gi = _mm_cvtps_epi32(_mm_mul_ps(g.v, scale));
+    const __m128i bi = _mm_cvtps_epi32(_mm_mul_ps(b.v, scale)), ai = _mm_cvtps_epi32(_mm_mul_ps(a.v, scale));
+    const __m128i rgba = _mm_or_si128(_mm_or_si128(ri, _mm_slli_epi32(gi, 8)), _mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(ai, 24)));
+    _mm_storeu_si128((__m128i*)out, rgba);
+}
+
+//! Four particles' x, y, z and size as four vec4s.
+static inline void StoreTransposed(float* out, V4 x, V4 y, V4 z, V4 w)
+{
+    _MM_TRANSPOSE4_PS(x.v, y.v, z.v, w.v);
+    _mm_storeu_ps(out, x.v);
+    _mm_storeu_ps(out + 4, y.v);
+    _mm_storeu_ps(out + 8, z.v);
+    _mm_storeu_ps(out + 12, w.v);
+}
+
+struct Random4
+{
+    __m128i state;
+    Random4(const uint32_t seeds[4]) { state = _mm_setr_epi32((int)seeds[0], (int)seeds[1], (int)seeds[2], (int)seeds[3]); }
+    //! [0, 1) in each lane.
+    V4 Next()
+    {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+        return { _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), _mm_set1_ps(1.0f / 16777216.0f)) };
+    }
+};
+#else
+static inline void SortKeys(uint32_t* out, V4 a)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        uint32_t bits;
+        memcpy(&bits, &a.v[i], 4);
+        out[i] = (bits ^ ((bits >> 31) ? 0xFFFFFFFFu : 0x80000000u)) >> (32 - KEY_BITS);
+    }
+}
+
+static inline void PackColors(uint32_t* out, V4 r, V4 g, V4 b, V4 a)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint32_t)lrintf(r.v[i] * 255.0f) | (uint32_t)lrintf(g.v[i] * 255.0f) << 8
+            | (uint32_t)lrintf(b.v[i] * 255.0f) << 16 | (uint32_t)lrintf(a.v[i] * 255.0f) << 24;
+}
+
+static inline void StoreTransposed(float* out, V4 x, V4 y, V4 z, V4 w)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i * 4] = x.v[i];
+        out[i * 4 + 1] = y.v[i];
+        out[i * 4 + 2] = z.v[i];
+        out[i * 4 + 3] = w.v[i];
+    }
+}
+
+struct Random4
+{
+    uint32_t state[4];
+    Random4(const uint32_t seeds[4]) { for (int i = 0; i < 4; i++) state[i] = seeds[i]; }
+    V4 Next()
+    {
+        V4 result;
+        for (int i = 0; i < 4; i++)
+        {
+            state[i] ^= state[i] << 13;
+            state[i] ^= state[i] >> 17;
+            state[i] ^= state[i] << 5;
+            result.v[i] = (state[i] >> 8) * (1.0f / 16777216.0f);
+        }
+        return result;
+    }
+};
+#endif
+
+//! Spreads the bits of x over the whole word (the MurmurHash3 finalizer).
+static inline uint32_t Mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+//---------------------------------------------------------------------
+//
+// Particles
+//
+Particles::Particles(const ParticleSettings& settings) : m_settings(settings)
+{
+    m_capacity = (max(m_settings.maxParticles, 4) + 3) & ~3;
+    // Four spare at the end: a group of four that starts in range may end past it.
+    const size_t room = (size_t)m_capacity + 4;
+    for (vector<float>* array : { &m_x, &m_y, &m_z, &m_vx, &m_vy, &m_vz, &m_age, &m_inverseLife })
+        array->assign(room, 0.0f);
+    m_inverseLife.assign(room, 1.0f);
+    m_keys.assign(room, 0);
+    m_order.assign(room, 0);
+    m_keysScratch.assign(room, 0);
+    m_orderScratch.assign(room, 0);
+    m_scratch.assign(room, 0.0f);
+
+    m_helpers = m_settings.workers < 0 ? 0 : m_settings.workers == 0 ? -1 : m_settings.workers;
+}
+
+Particles::~Particles()
+{
+    // Nothing to delete, nor any GL to delete it with, if Init never ran (the benchmark).
+    if (m_vbo)
+    {
+        for (GLsync& fence : m_fences)
+            if (fence)
+                glDeleteSync(fence);
+        if (m_mapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_vbo);
+        glDeleteVertexArrays(1, &m_vao);
+    }
+    if (m_program)
+        glDeleteProgram(m_program);
+}
+
+void Particles::Run(int count, const function<void(int)>& job)
+{
+    WorkerPool::Shared().Run(count, job, m_helpers);
+}
+
+//---------------------------------------------------------------------
+//
+// Simulation
+//
+void Particles::Emit(int first, int last, float seconds, unsigned job)
+{
+    // Each job its own generators, seeded from the frame and the job, so the threads don't matter.
+    uint32_t seeds[4];
+    for (int lane = 0; lane < 4; lane++)
+        seeds[lane] = Mix(m_settings.seed * 0x9E3779B9u ^ Mix(m_stats.frame * 4 + lane) ^ Mix(job + 0x632BE5ABu)) | 1u;
+    Random4 random(seeds);
+    const ParticleSettings& s = m_settings;
+    const V4 two = Set(2.0f), one = Set(1.0f), radius = Set(s.emitterRadius), spread = Set(s.spread);
+    const V4 ex = Set(s.emitter.x), ey = Set(s.emitter.y), ez = Set(s.emitter.z);
+    const V4 vx0 = Set(s.velocity.x), vy0 = Set(s.velocity.y), vz0 = Set(s.velocity.z);
+    const V4 life = Set(s.life), frame = Set(seconds);
+    for (int i = first; i < last; i += 4)
+    {
+        const V4 vx = vx0 + spread * (random.Next() * two - one);
+        const V4 vy = vy0 + spread * (random.Next() * two - one);
+        const V4 vz = vz0 + spread * (random.Next() * two - one);
+        // Born somewhere in the last frame rather than all at its end, so they leave in a stream, not puffs.
+        const V4 age = random.Next() * frame;
+        Store(&m_x[i], ex + radius * (random.Next() * two - one) + vx * age);
+        Store(&m_y[i], ey + radius * (random.Next() * two - one) + vy * age);
+        Store(&m_z[i], ez + radius * (random.Next() * two - one) + vz * age);
+        Store(&m_vx[i], vx);
+        Store(&m_vy[i], vy);
+        Store(&m_vz[i], vz);
+        Store(&m_age[i], age);
+        Store(&m_inverseLife[i], one / (life * (Set(0.75f) + Set(0.5f) * random.Next())));
+    }
+}
+
+void Particles::Move(int first, int last, float seconds, vector<int>& dead)
+{
+    const ParticleSettings& s = m_settings;
+    const V4 dt = Set(seconds), damp = Set(powf(1.0f - min(max(s.drag, 0.0f), 1.0f), seconds)), one = Set(1.0f);
+    const V4 gx = Set(s.gravity.x * seconds), gy = Set(s.gravity.y * seconds), gz = Set(s.gravity.z * seconds);
+    dead.clear();
+    for (int i = first; i < last; i += 4)
+    {
+        const V4 vx = Load(&m_vx[i]) * damp + gx, vy = Load(&m_vy[i]) * damp + gy, vz = Load(&m_vz[i]) * damp + gz;
+        Store(&m_vx[i], vx);
+        Store(&m_vy[i], vy);
+        Store(&m_vz[i], vz);
+        Store(&m_x[i], Load(&m_x[i]) + vx * dt);
+        Store(&m_y[i], Load(&m_y[i]) + vy * dt);
+        Store(&m_z[i], Load(&m_z[i]) + vz * dt);
+        const V4 age = Load(&m_age[i]) + dt;
+        Store(&m_age[i], age);
+        // Lanes past last are spare room; whatever's there isn't a particle and can't die.
+        int mask = NotLess(age * Load(&m_inverseLife[i]), one) & ((1 << min(4, last - i)) - 1);
+        while (mask)
+        {
+            int lane = 0;
+            while (!(mask >> lane & 1))
+                lane++;
+            dead.push_back(i + lane);
+            mask &= mask - 1;
+        }
+    }
+}
+
+void Particles::Kill()
+{
+    // From the highest dead down, each is overwritten by the last live particle. Everything above
+    // the one being filled is already live, so the last one is too (or is the dead one itself).
+    int killed = 0;
+    for (int job = (int)m_dead.size() - 1; job >= 0; job--)
+        for (auto d = m_dead[job].rbegin(); d != m_dead[job].rend(); ++d)
+        {
+            const int last = --m_alive;
+            killed++;
+            if (*d == last)
+                continue;
+            for (vector<float>* array : { &m_x, &m_y, &m_z, &m_vx, &m_vy, &m_vz, &m_age, &m_inverseLife })
+                (*array)[*d] = (*array)[last];
+        }
+    m_stats.killed = killed;
+}
+
+void Particles::Sort(const glm::vec3& eye, const glm::vec3& forward)
+{
+    if (m_settings.additive || m_alive < 2)
+        return;
+    const int n = m_alive, jobs = (n + BATCH - 1) / BATCH;
+
+    // Keys from the distance along the view direction, negated so the furthest come first.
+    Run(jobs, [&](int job)
+    {
+        const V4 ex = Set(eye.x), ey = Set(eye.y), ez = Set(eye.z);
+        const V4 fx = Set(-forward.x), fy = Set(-forward.y), fz = Set(-forward.z);
+        const int first = job * BATCH, last = min(first + BATCH, n);
+        for (int i = first; i < last; i += 4)
+        {
+            SortKeys(&m_keys[i], (Load(&m_x[i]) - ex) * fx + (Load(&m_y[i]) - ey) * fy + (Load(&m_z[i]) - ez) * fz);
+            for (int lane = 0; lane < 4; lane++)
+                m_order[i + lane] = i + lane;
+        }
+    });
+
+    // Least significant digit first. Each job counts its own share, the counts are summed bucket by
+    // bucket across the jobs into where each job's share of each bucket starts, and every job moves
+    // its share there, so the sort stays stable and needs no locks.
+    m_histograms.resize((size_t)jobs * BUCKETS);
+    for (int shift = 0; shift < KEY_BITS; shift += RADIX_BITS)
+    {
+        Run(jobs, [&](int job)
+        {
+            uint32_t* counts = &m_histograms[(size_t)job * BUCKETS];
+            fill(counts, counts + BUCKETS, 0u);
+            const int first = job * BATCH, last = min(first + BATCH, n);
+            for (int i = first; i < last; i++)
+                counts[(m_keys[i] >> shift) & (BUCKETS - 1)]++;
+        });
+        uint32_t start = 0;
+        bool skip = false;
+        for (int bucket = 0; bucket < BUCKETS && !skip; bucket++)
+        {
+            uint32_t total = 0;
+            for (int job = 0; job < jobs; job++)
+            {
+                const uint32_t count = m_histograms[(size_t)job * BUCKETS + bucket];
+                m_histograms[(size_t)job * BUCKETS + bucket] = start + total;
+                total += count;
+            }
+            // All in one bucket: this digit is the same for every key and the pass wouldn't move anything.
+            skip = total == (uint32_t)n;
+            start += total;
+        }
+        if (skip)
+            continue;
+        Run(jobs, [&](int job)
+        {
+            uint32_t* offsets = &m_histograms[(size_t)job * BUCKETS];
+            const int first = job * BATCH, last = min(first + BATCH, n);
+            for (int i = first; i < last; i++)
+            {
+                const uint32_t to = offsets[(m_keys[i] >> shift) & (BUCKETS - 1)]++;
+                m_keysScratch[to] = m_keys[i];
+                m_orderScratch[to] = m_order[i];
+            }
+        });
+        m_keys.swap(m_keysScratch);
+        m_order.swap(m_orderScratch);
+    }
+
+    // The particles themselves are put in drawing order, rather than looked up through m_order when
+    // written. Next frame they've hardly moved, so the sort scatters and this gathers almost in
+    // sequence, where gathering a shuffled million through m_order every frame misses the cache on each.
+    for (vector<float>* array : { &m_x, &m_y, &m_z, &m_vx, &m_vy, &m_vz, &m_age, &m_inverseLife })
+    {
+        Run(jobs, [&](int job)
+        {
+            const float* from = array->data();
+            const int first = job * BATCH, last = min(first + BATCH, n);
+            for (int i = first; i < last; i++)
+                m_scratch[i] = from[m_order[i]];
+        });
+        array->swap(m_scratch);
+    }
+}
+
+void Particles::Simulate(float seconds, const glm::vec3& eye, const glm::vec3& forward)
+{
+    typedef chrono::high_resolution_clock Clock;
+    const auto start = Clock::now();
+    // A long frame (a breakpoint, a dragged window) is cut short rather than fired all at once.
+    const float dt = m_time < 0.0 ? 0.0f : (float)min(max(seconds - m_time, 0.0), 0.1);
+    m_time = seconds;
+
+    const int moveJobs = (m_alive + BATCH - 1) / BATCH;
+    if ((int)m_dead.size() < moveJobs)
+        m_dead.resize(moveJobs);
+    for (vector<int>& dead : m_dead)
+        dead.clear();
+    Run(moveJobs, [&](int job) { Move(job * BATCH, min((job + 1) * BATCH, m_alive), dt, m_dead[job]); });
+    Kill();
+
+    m_emitCarry += m_settings.rate * dt;
+    const int emit = (int)min(floor(m_emitCarry), (double)(m_capacity - m_alive));
+    m_emitCarry -= floor(m_emitCarry);
+    const int first = m_alive;
+    Run((emit + BATCH - 1) / BATCH, [&](int job) { Emit(first + job * BATCH, min(first + (job + 1) * BATCH, first + emit), dt, job); });
+    m_alive += emit;
+    m_stats.emitted = emit;
+    const auto simulated = Clock::now();
+
+    Sort(eye, forward);
+    const auto sorted = Clock::now();
+
+    m_stats.frame++;
+    m_stats.alive = m_alive;
+    m_stats.simulateMilliseconds = chrono::duration<double, milli>(simulated - start).count();
+    m_stats.sortMilliseconds = chrono::duration<double, milli>(sorted - simulated).count();
+    m_totalMilliseconds += chrono::duration<double, milli>(sorted - start).count();
+    m_stats.averageMilliseconds = m_totalMilliseconds / m_stats.frame;
+}
+
+void Particles::Write(float* positions, uint32_t* colors)
+{
+    typedef chrono::high_resolution_clock Clock;
+    const auto start = Clock::now();
+    const ParticleSettings& s = m_settings;
+    const int n = m_alive;
+    Run((n + BATCH - 1) / BATCH, [&](int job)
+    {
+        const V4 one = Set(1.0f);
+        const V4 size0 = Set(s.startSize), size1 = Set(s.endSize - s.startSize);
+        const V4 r0 = Set(s.startColor.r), r1 = Set(s.endColor.r - s.startColor.r);
+        const V4 g0 = Set(s.startColor.g), g1 = Set(s.endColor.g - s.startColor.g);
+        const V4 b0 = Set(s.startColor.b), b1 = Set(s.endColor.b - s.startColor.b);
+        const V4 a0 = Set(s.startColor.a), a1 = Set(s.endColor.a - s.startColor.a);
+        const int first = job * BATCH, last = min(first + BATCH, n);
+        for (int i = first; i < last; i += 4)
+        {
+            const V4 t = Min(Load(&m_age[i]) * Load(&m_inverseLife[i]), one);
+            StoreTransposed(positions + (size_t)i * 4, Load(&m_x[i]), Load(&m_y[i]), Load(&m_z[i]), size0 + size1 * t);
+            PackColors(colors + i, r0 + r1 * t, g0 + g1 * t, b0 + b1 * t, a0 + a1 * t);
+        }
+    });
+    const double milliseconds = chrono::duration<double, milli>(Clock::now() - start).count();
+    m_stats.writeMilliseconds = milliseconds;
+    m_totalMilliseconds += milliseconds;
+    m_stats.averageMilliseconds = m_totalMilliseconds / max(1u, m_stats.frame);
+}
+
+//---------------------------------------------------------------------
+//
+// GL
+//
+bool Particles::Init()
+{
+    GLuint shaders[2] = { (GLuint)setShader((char*)"vertex", (char*)"particle.vert"),
+                          (GLuint)setShader((char*)"fragment", (char*)"particle.frag") };
+    m_program = glCreateProgram();
+    for (GLuint shader : shaders)
+        glAttachShader(m_program, shader);
+    glLinkProgram(m_program);
+    GLint linked = 0;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        char log[1024];
+        glGetProgramInfoLog(m_program, 1024, 0, log);
+        cerr << "Failed to link the particle shaders:" << endl << log << endl;
+        glDeleteProgram(m_program);
+        m_program = 0;
+        return false;
+    }
+
+    // A region is every particle's position and size, then every particle's colour.
+    const size_t bytes = (size_t)m_capacity * (4 * sizeof(float) + sizeof(uint32_t));
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes * FRAMES, NULL, flags);
+        m_mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes * FRAMES, flags);
+        if (!m_mapped)
+        {
+            // Storage is immutable; start again with a buffer glBufferData can resize.
+            glDeleteBuffers(1, &m_vbo);
+            glGenBuffers(1, &m_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        }
+    }
+    if (!m_mapped)
+    {
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        m_stagingPositions.resize(((size_t)m_capacity + 4) * 4);
+        m_stagingColors.resize((size_t)m_capacity + 4);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void Particles::Update(float seconds, const glm::vec3& eye, const glm::vec3& forward)
+{
+    typedef chrono::high_resolution_clock Clock;
+    Simulate(seconds, eye, forward);
+    if (!m_vbo)
+        return;
+
+    const auto start = Clock::now();
+    const size_t positionBytes = (size_t)m_capacity * 4 * sizeof(float), colorBytes = (size_t)m_capacity * sizeof(uint32_t);
+    if (m_mapped)
+    {
+        // The region drawn FRAMES - 1 frames ago; its fence says when the GPU has finished with it.
+        m_frame = (m_frame + 1) % FRAMES;
+        if (m_fences[m_frame])
+        {
+            while (glClientWaitSync(m_fences[m_frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(m_fences[m_frame]);
+            m_fences[m_frame] = 0;
+        }
+        // Whole groups of four are written, up to 3 past the live ones, but never past the capacity.
+        char* region = (char*)m_mapped + m_frame * (positionBytes + colorBytes);
+        const double waited = chrono::duration<double, milli>(Clock::now() - start).count();
+        Write((float*)region, (uint32_t*)(region + positionBytes));
+        m_stats.writeMilliseconds += waited;
+    }
+    else
+    {
+        Write(m_stagingPositions.data(), m_stagingColors.data());
+        // Orphaned first, so the driver hands over fresh memory rather than waiting on the last draw.
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glBufferData(GL_ARRAY_BUFFER, positionBytes + colorBytes, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)m_alive * 4 * sizeof(float), m_stagingPositions.data());
+        glBufferSubData(GL_ARRAY_BUFFER, positionBytes, (size_t)m_alive * sizeof(uint32_t), m_stagingColors.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_stats.writeMilliseconds = chrono::duration<double, milli>(Clock::now() - start).count();
+    }
+    m_drawCount = m_alive;
+}
+
+void Particles::Draw(const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!m_program || !m_drawCount)
+        return;
+    const size_t positionBytes = (size_t)m_capacity * 4 * sizeof(float), colorBytes = (size_t)m_capacity * sizeof(uint32_t);
+    const size_t offset = m_mapped ? m_frame * (positionBytes + colorBytes) : 0;
+    glUseProgram(m_program);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_program, "projection"), 1, GL_FALSE, &projection[0][0]);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, (const void*)offset);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, (const void*)(offset + positionBytes));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Tested against the scene but not written, so particles never hide each other.
+    glDepthMask(GL_FALSE);
+    if (m_settings.additive)
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    else
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_drawCount);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_TRUE);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    if (m_mapped)
+    {
+        if (m_fences[m_frame])
+            glDeleteSync(m_fences[m_frame]);
+        m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void Particles::PrintStats() const
+{
+    cout << "Particles " << m_stats.alive << " alive (" << m_stats.emitted << " new, " << m_stats.killed << " died), frame "
+         << m_stats.frame << ": simulate " << m_stats.simulateMilliseconds << " ms, sort " << m_stats.sortMilliseconds
+         << " ms, write " << m_stats.writeMilliseconds << " ms (" << m_stats.averageMilliseconds << " ms on average), "
+         << (m_settings.additive ? "additive" : "sorted") << (m_mapped ? ", mapped" : "") << ", " << WorkerPool::Shared().Helpers(m_helpers) + 1
+         << " threads" << endl;
+}
+
+void Particles::Benchmark(std::ostream& out)
+{
+    out << "Particle benchmark: a million particles, emitted as fast as they die, "
+        << max(1u, thread::hardware_concurrency()) << " cores." << endl;
+    for (int workers : { -1, 0 })
+    {
+        ParticleSettings settings;
+        settings.maxParticles = 1 << 20;
+        settings.rate = 500000.0f;
+        settings.workers = workers;
+        Particles particles(settings);
+        vector<float> positions(((size_t)particles.m_capacity + 4) * 4);
+        vector<uint32_t> colors((size_t)particles.m_capacity + 4);
+        const glm::vec3 eye(0.0f, 2.0f, 15.0f), forward(0.0f, 0.0f, -1.0f);
+        const int frames = 60;
+        // Until it's full and as many die each frame as are born.
+        for (int frame = 0; frame <= 300; frame++)
+            particles.Simulate(frame / 60.0f, eye, forward);
+        for (bool additive : { false, true })
+        {
+            particles.SetAdditive(additive);
+            double simulate = 0.0, sort = 0.0, write = 0.0;
+            int emitted = 0;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                particles.Simulate(particles.m_time + 1.0 / 60.0, eye, forward);
+                particles.Write(positions.data(), colors.data());
+                simulate += particles.m_stats.simulateMilliseconds;
+                sort += particles.m_stats.sortMilliseconds;
+                write += particles.m_stats.writeMilliseconds;
+                emitted += particles.m_stats.emitted;
+            }
+            // Check the order actually came out far to near, as near as the keys can tell.
+            bool ordered = true;
+            for (int i = 1; additive == false && i < particles.m_alive; i++)
+            {
+                const float depth = positions[(size_t)i * 4 + 2] - eye.z, before = positions[(size_t)(i - 1) * 4 + 2] - eye.z;
+                ordered = ordered && depth >= before - fabs(before) / 4096.0f;
+            }
+            out << particles.m_alive << " particles, " << (additive ? "additive" : "sorted") << ", " << WorkerPool::Shared().Helpers(particles.m_helpers) + 1
+                << " threads: simulate " << simulate / frames << " ms (" << emitted / frames << " born a frame), sort " << sort / frames
+                << " ms, write " << write / frames << " ms, " << (simulate + sort + write) / frames << " ms a frame"
+                << (ordered ? "" : ", out of order") << endl;
+        }
+        if (thread::hardware_concurrency() <= 1)
+            break;
+    }
+}
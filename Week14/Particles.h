@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+struct ParticleSettings
+{
+    int maxParticles = 100000;      // Room for this many, in memory and in the vertex buffer.
+    float rate = 25000.0f;          // Emitted a second while there's room.
+    glm::vec3 emitter = glm::vec3(0.0f);
+    float emitterRadius = 0.2f;     // They start anywhere in a cube this far either side of the emitter...
+    glm::vec3 velocity = glm::vec3(0.0f, 4.0f, 0.0f);  // ...moving at this...
+    float spread = 1.2f;            // ...give or take this much along each axis.
+    float life = 3.0f;              // Seconds, give or take a quarter.
+    glm::vec3 gravity = glm::vec3(0.0f, -1.5f, 0.0f);
+    float drag = 0.4f;              // Velocity lost a second, 0..1.
+    float startSize = 0.06f, endSize = 0.4f;        // World units across, new and about to die.
+    glm::vec4 startColor = glm::vec4(1.0f, 0.85f, 0.4f, 0.9f), endColor = glm::vec4(0.35f, 0.3f, 0.3f, 0.0f);
+    bool additive = false;          // Added to what's behind in any order, or blended over it back to front.
+    int workers = 0;                // Shared WorkerPool threads helping out, 0 for all of them, -1 for none.
+    unsigned seed = 1;
+};
+
+/// @brief Per frame particle numbers, see Particles::Stats.
+struct ParticleStats
+{
+    unsigned frame = 0;
+    int alive = 0, emitted = 0, killed = 0;
+    double simulateMilliseconds = 0.0;  // This frame: emitting, moving and killing...
+    double sortMilliseconds = 0.0;      // ...ordering by depth, 0 when additive...
+    double writeMilliseconds = 0.0;     // ...and writing them out for the GPU, with any wait for the buffer.
+    double averageMilliseconds = 0.0;   // All three, over every frame so far.
+};
+
+/// @brief A particle engine: each particle's position, velocity, age and lifetime kept in arrays of
+/// their own, four particles at a time with SSE2 and in batches over the shared WorkerPool.
+/// Each frame new particles are emitted at the end of the arrays, everything moves on under gravity
+/// and drag, and the dead are swapped out for the last live ones, which touches only the dead.
+/// For alpha blending they are radix sorted far to near along the view direction (11 bits a pass,
+/// a pass skipped when every key agrees on its bits) and the arrays put in that order, which they
+/// then mostly keep to the next frame; additive blending doesn't care about order, so the sort is skipped. Colour and size come from age as they're written into a vertex buffer
+/// mapped once for good (GL 4.4 or ARB_buffer_storage), three frames of it used in turn behind
+/// fences, or orphaned and filled with glBufferSubData without it. Each is drawn as a camera facing
+/// quad, an instance of four vertices.
+class Particles
+{
+public:
+    Particles(const ParticleSettings& settings = ParticleSettings());
+    ~Particles();
+
+    //! Moves on to time seconds, the first call just starts the clock, and sorts for a camera at eye
+    //! looking along forward. No GL calls.
+    void Simulate(float seconds, const glm::vec3& eye, const glm::vec3& forward);
+    //! Positions and sizes (4 floats each) then colours (RGBA bytes) in drawing order.
+    void Write(float* positions, uint32_t* colors);
+
+    //! Shaders and the vertex buffer. Call once GL is up. False if the shaders didn't link.
+    bool Init();
+    //! Simulate, then write into the next region of the vertex buffer.
+    void Update(float seconds, const glm::vec3& eye, const glm::vec3& forward);
+    //! Draws with depth testing but no depth writes. Leaves depth writes on, the blend function at
+    //! GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA and program 0 bound.
+    void Draw(const glm::mat4& view, const glm::mat4& projection);
+
+    void SetEmitter(const glm::vec3& at) { m_settings.emitter = at; }
+    void SetAdditive(bool additive) { m_settings.additive = additive; }
+    int Alive() const { return m_alive; }
+    const ParticleSettings& Settings() const { return m_settings; }
+    const ParticleStats& Stats() const { return m_stats; }
+    void PrintStats() const;
+
+    //! A million particles, sorted and additive, printed to out.
+    static void Benchmark(std::ostream& out);
+
+private:
+    void Emit(int first, int last, float seconds, unsigned job);
+    //! Moves [first, last) on by seconds and lists the ones that died in dead.
+    void Move(int first, int last, float seconds, std::vector<int>& dead);
+    void Kill();
+    void Sort(const glm::vec3& eye, const glm::vec3& forward);
+    //! Runs jobs [0, count) on the shared WorkerPool, returns when all are done.
+    void Run(int count, const std::function<void(int)>& job);
+
+    ParticleSettings m_settings;
+    int m_capacity;                         // maxParticles rounded up to fours.
+    int m_alive = 0;
+    std::vector<float> m_x, m_y, m_z;
+    std::vector<float> m_vx, m_vy, m_vz;
+    std::vector<float> m_age, m_inverseLife;    // Seconds lived, and 1 / seconds it'll live.
+    std::vector<std::vector<int>> m_dead;   // Died this frame, a list per job.
+    std::vector<uint32_t> m_keys, m_order, m_keysScratch, m_orderScratch;
+    std::vector<uint32_t> m_histograms;     // Per job, 2048 buckets each.
+    std::vector<float> m_scratch;           // What an array is reordered into, then swapped with.
+    double m_time = -1.0, m_emitCarry = 0.0, m_totalMilliseconds = 0.0;
+    ParticleStats m_stats;
+
+    int m_helpers;                          // Workers of the shared pool to use, -1 for all.
+
+    static const int FRAMES = 3;
+    GLuint m_program = 0, m_vao = 0, m_vbo = 0;
+    void* m_mapped = nullptr;               // The persistent mapping, FRAMES regions, or null.
+    std::vector<float> m_stagingPositions;  // What glBufferSubData sends without one.
+    std::vector<uint32_t> m_stagingColors;
+    GLsync m_fences[FRAMES] = {};
+    int m_frame = 0, m_drawCount = 0;
+};
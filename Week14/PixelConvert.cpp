@@ -0,0 +1,348 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "PixelConvert.h"
+
+#if defined(__AVX2__)
+#define PIXEL_AVX2 1
+#endif
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSSE3__)
+#define PIXEL_SSSE3 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/// @note: every SIMD loop below only reads bytes that belong to the image,
+/// the last few pixels of a row always go through the scalar loop.
+
+static const unsigned char RGB_TO_RGBA_SHUFFLE[16] = { 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80 };
+static const unsigned char RGB_TO_BGRA_SHUFFLE[16] = { 2, 1, 0, 0x80, 5, 4, 3, 0x80, 8, 7, 6, 0x80, 11, 10, 9, 0x80 };
+static const unsigned char RGBA_TO_BGRA_SHUFFLE[16] = { 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 };
+
+// 3 byte -> 4 byte expansion, order picks RGBA or BGRA.
+static void ExpandRGB(const unsigned char* src, unsigned char* dst, size_t pixelCount, const unsigned char* shuffle, bool swapRB)
+{
+    size_t i = 0;
+#if defined(PIXEL_SSSE3)
+    const __m128i mask = _mm_loadu_si128((const __m128i*)shuffle);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+#if defined(PIXEL_AVX2)
+    const __m256i mask8 = _mm256_broadcastsi128_si256(mask);
+    const __m256i alpha8 = _mm256_set1_epi32((int)0xFF000000);
+    // Two 16 byte loads 12 bytes apart = 8 pixels. The second load reads 28 bytes in total.
+    for (; i + 10 <= pixelCount; i += 8)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src + i * 3 + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_or_si256(_mm256_shuffle_epi8(v, mask8), alpha8);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+    }
+#endif
+    for (; i + 6 <= pixelCount; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        v = _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), v);
+    }
+#else
+    (void)shuffle;
+#endif
+    for (; i < pixelCount; i++)
+    {
+        const unsigned char* s = src + i * 3;
+        unsigned char* d = dst + i * 4;
+        d[0] = swapRB ? s[2] : s[0];
+        d[1] = s[1];
+        d[2] = swapRB ? s[0] : s[2];
+        d[3] = 255;
+    }
+}
+
+void ConvertRGBToRGBA(const unsigned char* src, unsigned char* dst, size_t pixelCount)
+{
+    ExpandRGB(src, dst, pixelCount, RGB_TO_RGBA_SHUFFLE, false);
+}
+
+void ConvertRGBToBGRA(const unsigned char* src, unsigned char* dst, size_t pixelCount)
+{
+    ExpandRGB(src, dst, pixelCount, RGB_TO_BGRA_SHUFFLE, true);
+}
+
+void ConvertRGBAToBGRA(const unsigned char* src, unsigned char* dst, size_t pixelCount)
+{
+    size_t i = 0;
+#if defined(PIXEL_SSSE3)
+    const __m128i mask = _mm_loadu_si128((const __m128i*)RGBA_TO_BGRA_SHUFFLE);
+#if defined(PIXEL_AVX2)
+    const __m256i mask8 = _mm256_broadcastsi128_si256(mask);
+    for (; i + 8 <= pixelCount; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, mask8));
+    }
+#endif
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(v, mask));
+    }
+#endif
+    for (; i < pixelCount; i++)
+    {
+        const unsigned char* s = src + i * 4;
+        unsigned char* d = dst + i * 4;
+        unsigned char r = s[0];
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = r;
+        d[3] = s[3];
+    }
+}
+
+void ExtractChannel(const unsigned char* src, int srcChannels, PixelChannel channel, unsigned char* dst, size_t pixelCount)
+{
+    // Grayscale sources (1 or 2 bytes) answer every color channel from byte 0.
+    int offset = channel;
+    if (srcChannels <= 2 && channel != CHANNEL_ALPHA)
+        offset = 0;
+    else if (channel == CHANNEL_ALPHA)
+        offset = (srcChannels == 2) ? 1 : (srcChannels == 4 ? 3 : -1);
+
+    if (offset < 0) // No alpha stored, so it is opaque.
+    {
+        memset(dst, 255, pixelCount);
+        return;
+    }
+    if (srcChannels == 1)
+    {
+        memcpy(dst, src, pixelCount);
+        return;
+    }
+
+    size_t i = 0;
+#if defined(PIXEL_SSSE3)
+    // 16 output bytes come from srcChannels consecutive 16 byte loads.
+    // Byte p of the output lives at srcChannels * p + offset, so each load gets a mask
+    // that picks the bytes it owns and zeroes the rest, then the loads are OR'ed together.
+    unsigned char masks[4][16];
+    for (int j = 0; j < srcChannels; j++)
+    {
+        for (int p = 0; p < 16; p++)
+        {
+            int b = srcChannels * p + offset - 16 * j;
+            masks[j][p] = (b >= 0 && b < 16) ? (unsigned char)b : 0x80;
+        }
+    }
+    __m128i m[4];
+    for (int j = 0; j < srcChannels; j++)
+        m[j] = _mm_loadu_si128((const __m128i*)masks[j]);
+
+    for (; i + 16 <= pixelCount; i += 16)
+    {
+        const unsigned char* s = src + i * srcChannels;
+        __m128i out = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), m[0]);
+        for (int j = 1; j < srcChannels; j++)
+            out = _mm_or_si128(out, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + 16 * j)), m[j]));
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+#endif
+    for (; i < pixelCount; i++)
+        dst[i] = src[i * srcChannels + offset];
+}
+
+void PremultiplyAlpha(unsigned char* pixels, size_t pixelCount)
+{
+    size_t i = 0;
+#if defined(PIXEL_SSSE3)
+    // Widen to 16 bits, multiply by the broadcast alpha (255 in the alpha lane itself)
+    // and divide by 255 with rounding: t = x * a + 128; (t + (t >> 8)) >> 8.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i rgbMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    const __m128i alphaLane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+#if defined(PIXEL_AVX2)
+    const __m256i zero8 = _mm256_setzero_si256();
+    const __m256i bias8 = _mm256_set1_epi16(128);
+    const __m256i rgbMask8 = _mm256_broadcastsi128_si256(rgbMask);
+    const __m256i alphaLane8 = _mm256_broadcastsi128_si256(alphaLane);
+    for (; i + 8 <= pixelCount; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(pixels + i * 4));
+        __m256i halves[2] = { _mm256_unpacklo_epi8(v, zero8), _mm256_unpackhi_epi8(v, zero8) };
+        for (int h = 0; h < 2; h++)
+        {
+            __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(halves[h], 0xFF), 0xFF);
+            a = _mm256_or_si256(_mm256_and_si256(a, rgbMask8), alphaLane8);
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(halves[h], a), bias8);
+            halves[h] = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+        _mm256_storeu_si256((__m256i*)(pixels + i * 4), _mm256_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(pixels + i * 4));
+        __m128i halves[2] = { _mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero) };
+        for (int h = 0; h < 2; h++)
+        {
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(halves[h], 0xFF), 0xFF);
+            a = _mm_or_si128(_mm_and_si128(a, rgbMask), alphaLane);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(halves[h], a), bias);
+            halves[h] = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+        _mm_storeu_si128((__m128i*)(pixels + i * 4), _mm_packus_epi16(halves[0], halves[1]));
+    }
+#endif
+    for (; i < pixelCount; i++)
+    {
+        unsigned char* p = pixels + i * 4;
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned t = p[c] * p[3] + 128;
+            p[c] = (unsigned char)((t + (t >> 8)) >> 8);
+        }
+    }
+}
+
+void FlipRowsInPlace(unsigned char* pixels, size_t rowBytes, int height)
+{
+    vector<unsigned char> temp(rowBytes);
+    for (int top = 0, bottom = height - 1; top < bottom; top++, bottom--)
+    {
+        unsigned char* a = pixels + top * rowBytes;
+        unsigned char* b = pixels + bottom * rowBytes;
+        memcpy(&temp[0], a, rowBytes);
+        memcpy(a, b, rowBytes);
+        memcpy(b, &temp[0], rowBytes);
+    }
+}
+
+PixelUploadFormat ChooseUploadFormat(const PixelConvertDesc& desc)
+{
+    PixelUploadFormat upload;
+    if (desc.requestedFormat == GL_RED || desc.requestedFormat == GL_R8)
+    {
+        upload.internalFormat = GL_R8;
+        upload.format = GL_RED;
+        upload.type = GL_UNSIGNED_BYTE;
+        upload.bytesPerPixel = 1;
+        return upload;
+    }
+    // BGRA + 8_8_8_8_REV is the layout drivers store internally, so the upload is a plain copy.
+    // A GL_RGB request keeps an RGB8 internal format so the shader still sees alpha = 1.
+    upload.internalFormat = (desc.requestedFormat == GL_RGB || desc.requestedFormat == GL_RGB8) ? GL_RGB8 : GL_RGBA8;
+    upload.format = GL_BGRA;
+    upload.type = GL_UNSIGNED_INT_8_8_8_8_REV;
+    upload.bytesPerPixel = 4;
+    return upload;
+}
+
+size_t ConvertImage(const unsigned char* src, int width, int height, const PixelConvertDesc& desc,
+                    const PixelUploadFormat& upload, unsigned char* dst)
+{
+    const size_t srcRowBytes = (size_t)width * desc.srcChannels;
+    const size_t dstRowBytes = (size_t)width * upload.bytesPerPixel;
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* s = src + y * srcRowBytes;
+        unsigned char* d = dst + (desc.flipVertically ? height - 1 - y : y) * dstRowBytes;
+
+        if (upload.bytesPerPixel == 1)
+        {
+            ExtractChannel(s, desc.srcChannels, desc.channel, d, width);
+            continue;
+        }
+
+        switch (desc.srcChannels)
+        {
+        case 4:
+            ConvertRGBAToBGRA(s, d, width);
+            if (desc.premultiplyAlpha)
+                PremultiplyAlpha(d, width);
+            break;
+        case 3:
+            ConvertRGBToBGRA(s, d, width);
+            break;
+        default: // Gray or gray + alpha, rare enough for a scalar loop.
+            for (int x = 0; x < width; x++)
+            {
+                unsigned char g = s[x * desc.srcChannels];
+                d[x * 4 + 0] = g;
+                d[x * 4 + 1] = g;
+                d[x * 4 + 2] = g;
+                d[x * 4 + 3] = (desc.srcChannels == 2) ? s[x * 2 + 1] : 255;
+            }
+            if (desc.srcChannels == 2 && desc.premultiplyAlpha)
+                PremultiplyAlpha(d, width);
+            break;
+        }
+    }
+    return (srcRowBytes + dstRowBytes) * height;
+}
+
+const char* PixelConvertPath()
+{
+#if defined(PIXEL_AVX2)
+    return "AVX2";
+#elif defined(PIXEL_SSSE3)
+    return "SSSE3";
+#else
+    return "scalar";
+#endif
+}
+
+void PixelConvertBenchmark(ostream& out)
+{
+    struct Case
+    {
+        const char* name;
+        int srcChannels;
+        GLint requestedFormat;
+        bool premultiplyAlpha;
+    };
+    const Case cases[] = {
+        { "RGB  -> BGRA", 3, GL_RGB, false },
+        { "RGBA -> BGRA", 4, GL_RGBA, false },
+        { "RGBA -> BGRA premultiplied", 4, GL_RGBA, true },
+        { "RGB  -> R8", 3, GL_RED, false },
+        { "grey -> BGRA", 1, GL_RGB, false },
+    };
+    const int width = 2048, height = 2048;
+
+    vector<unsigned char> src((size_t)width * height * 4);
+    unsigned int seed = 1;
+    for (unsigned char& c : src)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        c = (unsigned char)(seed >> 24);
+    }
+    vector<unsigned char> dst((size_t)width * height * 4);
+
+    out << "Pixel conversion benchmark: " << width << "x" << height << ", flipped, " << PixelConvertPath() << " path." << endl;
+    for (const Case& c : cases)
+    {
+        PixelConvertDesc desc;
+        desc.srcChannels = c.srcChannels;
+        desc.requestedFormat = c.requestedFormat;
+        desc.channel = CHANNEL_RED;
+        desc.flipVertically = true;
+        desc.premultiplyAlpha = c.premultiplyAlpha;
+        PixelUploadFormat upload = ChooseUploadFormat(desc);
+
+        // At least 3 runs and 0.2 s, so small caches and timer resolution don't decide it.
+        size_t bytes = 0;
+        int runs = 0;
+        double seconds = 0.0;
+        auto start = chrono::high_resolution_clock::now();
+        while (runs < 3 || seconds < 0.2)
+        {
+            bytes += ConvertImage(&src[0], width, height, desc, upload, &dst[0]);
+            runs++;
+            seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - start).count();
+        }
+        out << "  " << c.name << ": " << seconds / runs * 1000.0 << " ms an image, " << bytes / seconds / 1.0e9 << " GB/s" << endl;
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <GL/glew.h>
+
+/// @brief Pixel-format conversion kernels that run between stbi_load and glTexImage2D.
+/// Everything is converted into a layout the driver can copy without swizzling:
+/// 4 bytes per pixel in BGRA order (uploaded as GL_BGRA + GL_UNSIGNED_INT_8_8_8_8_REV),
+/// or 1 byte per pixel for single channel maps (GL_RED, unpack alignment 1).
+/// The SSSE3 / AVX2 code paths are picked at compile time, the scalar loops handle
+/// the row tails and any build without those instruction sets.
+
+enum PixelChannel
+{
+    CHANNEL_RED = 0,
+    CHANNEL_GREEN = 1,
+    CHANNEL_BLUE = 2,
+    CHANNEL_ALPHA = 3
+};
+
+//! Expand packed RGB8 into RGBA8 with alpha = 255.
+void ConvertRGBToRGBA(const unsigned char* src, unsigned char* dst, size_t pixelCount);
+
+//! Expand packed RGB8 into BGRA8 with alpha = 255.
+void ConvertRGBToBGRA(const unsigned char* src, unsigned char* dst, size_t pixelCount);
+
+//! Swap the R and B bytes of RGBA8 pixels (RGBA <-> BGRA). src and dst may alias.
+void ConvertRGBAToBGRA(const unsigned char* src, unsigned char* dst, size_t pixelCount);
+
+//! Pull one channel out of pixels with srcChannels (1-4) bytes each, e.g. a specular map stored as a .bmp.
+void ExtractChannel(const unsigned char* src, int srcChannels, PixelChannel channel, unsigned char* dst, size_t pixelCount);
+
+//! rgb = rgb * a / 255 on 4 byte pixels, alpha in byte 3. Works in place.
+void PremultiplyAlpha(unsigned char* pixels, size_t pixelCount);
+
+//! Swap rows top <-> bottom. Replaces stbi_set_flip_vertically_on_load.
+void FlipRowsInPlace(unsigned char* pixels, size_t rowBytes, int height);
+
+struct PixelConvertDesc
+{
+    int srcChannels;            // What stbi_load reported (1-4).
+    GLint requestedFormat;      // GL_RED, GL_RGB, GL_RGBA... as passed to Texture.
+    PixelChannel channel;       // Channel kept for single channel (GL_RED) requests.
+    bool flipVertically;
+    bool premultiplyAlpha;
+};
+
+struct PixelUploadFormat
+{
+    GLint internalFormat;
+    GLenum format;
+    GLenum type;
+    int bytesPerPixel;
+};
+
+/// @brief Picks the GPU native layout for a source image and the requested format.
+/// GL_RED / GL_R8 requests become a single channel texture, everything else BGRA8.
+PixelUploadFormat ChooseUploadFormat(const PixelConvertDesc& desc);
+
+/// @brief Converts a whole image into dst (width * height * upload.bytesPerPixel bytes).
+/// Rows are written flipped when desc.flipVertically is set, so the flip costs no extra pass.
+/// @return bytes read + written, handy for GB/s reporting.
+size_t ConvertImage(const unsigned char* src, int width, int height, const PixelConvertDesc& desc,
+                    const PixelUploadFormat& upload, unsigned char* dst);
+
+//! Name of the code path compiled in ("AVX2", "SSSE3" or "scalar").
+const char* PixelConvertPath();
+
+/// @brief Times ConvertImage on a 2048 x 2048 image for each source layout Texture::Load meets
+/// and writes GB/s (bytes read + written) per case to out. Needs no GL context.
+void PixelConvertBenchmark(std::ostream& out);
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include "MeshOptimize.h"
+#include "MeshStrip.h"
 #define PI 3.14159265358979324
 using namespace std;
 
@@ -16,6 +18,11 @@ protected:
 	vector<GLfloat> shape_uvs;
 	vector<GLfloat> shape_normals;
 	GLuint vao, ibo, points_vbo, colors_vbo, uv_vbo, normals_vbo;
+	// What OptimizeShape did, nothing until it has run.
+	MeshOptimize::Report optimize_report;
+	// What StripShape did. When strips is set shape_indices are strips, not triangles.
+	MeshStrip::Strips<GLshort> strip_report;
+	static const GLshort RestartIndex = -1;	// 0xFFFF as GL_UNSIGNED_SHORT.
 
 public:
 	~Shape()
@@ -32,8 +39,15 @@ public:
 		shape_normals.shrink_to_fit();
 	}
 	GLsizei NumIndices() { return shape_indices.size(); }
-	void BufferShape()
+	// Runs OptimizeShape and StripShape first unless optimize is false, which a shape drawn as
+	// lines needs, e.g. a Grid drawn as GL_LINE_LOOP.
+	void BufferShape(bool optimize = true)
 	{
+		if (optimize)
+		{
+			OptimizeShape();
+			StripShape();
+		}
 		vao = 0;
 		glGenVertexArrays(1, &vao);
 		glBindVertexArray(vao);
@@ -77,6 +91,42 @@ public:
 
 		glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
 	}
+	// Reorders the triangles for the vertex cache and overdraw and, when every stream has one
+	// entry per vertex, the vertices for fetching, see MeshOptimize.h. Only the order changes,
+	// so this is for triangles: lines drawn through the indices would join different points.
+	const MeshOptimize::Report& OptimizeShape()
+	{
+		if (shape_indices.empty() || optimize_report.triangles || strip_report.strips)
+			return optimize_report;
+		const size_t count = shape_vertices.size() / 3;
+		const bool streams = shape_uvs.size() == count * 2 && shape_normals.size() == count * 3
+			&& (shape_colors.empty() || shape_colors.size() == count * 3);
+		vector<unsigned> remap;
+		optimize_report = MeshOptimize::Optimize(shape_indices.data(), shape_indices.size(), count, shape_vertices.data(), 3, streams ? &remap : nullptr);
+		if (streams)
+		{
+			MeshOptimize::Remap(shape_vertices, 3, remap);
+			MeshOptimize::Remap(shape_colors, 3, remap);
+			MeshOptimize::Remap(shape_uvs, 2, remap);
+			MeshOptimize::Remap(shape_normals, 3, remap);
+		}
+		return optimize_report;
+	}
+	const MeshOptimize::Report& Optimization() const { return optimize_report; }
+	// Turns the triangles into strips joined by a primitive restart, see MeshStrip.h, if that
+	// saves indices. DrawShape(GL_TRIANGLES) then draws them as GL_TRIANGLE_STRIP, other modes
+	// would draw the strips' indices as they are.
+	const MeshStrip::Strips<GLshort>& StripShape()
+	{
+		if (shape_indices.empty() || strip_report.triangles)
+			return strip_report;
+		strip_report = MeshStrip::Stripify(shape_indices.data(), shape_indices.size(), shape_vertices.size() / 3, RestartIndex);
+		shape_indices.swap(strip_report.indices);
+		strip_report.indices.clear();
+		strip_report.indices.shrink_to_fit();
+		return strip_report;
+	}
+	const MeshStrip::Strips<GLshort>& Strips() const { return strip_report; }
 	void RecolorShape(GLfloat r, GLfloat g, GLfloat b)
 	{
 		ColorShape(r, g, b);
@@ -86,7 +136,15 @@ public:
 	void DrawShape(GLchar c)
 	{
 		glBindVertexArray(vao);
-		glDrawElements(c, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
+		if (strip_report.strips && c == GL_TRIANGLES)
+		{
+			glEnable(GL_PRIMITIVE_RESTART);
+			glPrimitiveRestartIndex((GLushort)RestartIndex);
+			glDrawElements(GL_TRIANGLE_STRIP, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
+			glDisable(GL_PRIMITIVE_RESTART);
+		}
+		else
+			glDrawElements(c, this->NumIndices(), GL_UNSIGNED_SHORT, 0);
 		glBindVertexArray(0);
 	}
 	void CalcAverageNormals(vector<GLshort>& indices, unsigned indiceCount, vector<GLfloat>& vertices, unsigned verticeCount)
@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// @file Simd4.h
+/// @brief Four floats at a time, SSE2 or plain, for the Week 14 simulations (ocean, cloth, particles).
+/// Code that needs more than these operations tests SIMD4_SSE2 and uses the intrinsics directly.
+/// Masks from Less are all bits set (SSE2) or 1 (plain) and only ever go to Select.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD4_SSE2 1
+#include <emmintrin.h>
+
+struct V4 { __m128 v; };
+inline V4 Load(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void Store(float* p, V4 a) { _mm_storeu_ps(p, a.v); }
+inline V4 Set(float a) { return { _mm_set1_ps(a) }; }
+inline V4 operator+(V4 a, V4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline V4 operator-(V4 a, V4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline V4 operator*(V4 a, V4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline V4 operator/(V4 a, V4 b) { return { _mm_div_ps(a.v, b.v) }; }
+inline V4 Sqrt(V4 a) { return { _mm_sqrt_ps(a.v) }; }
+inline V4 Min(V4 a, V4 b) { return { _mm_min_ps(a.v, b.v) }; }
+inline V4 Max(V4 a, V4 b) { return { _mm_max_ps(a.v, b.v) }; }
+inline V4 Less(V4 a, V4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline V4 Select(V4 mask, V4 a, V4 b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+//! A bit for each lane whose a >= b.
+inline int NotLess(V4 a, V4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+inline V4 Gather(const float* p, const int32_t* i) { return { _mm_setr_ps(p[i[0]], p[i[1]], p[i[2]], p[i[3]]) }; }
+inline void Scatter(float* p, const int32_t* i, V4 a)
+{
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, a.v);
+    p[i[0]] = lanes[0];
+    p[i[1]] = lanes[1];
+    p[i[2]] = lanes[2];
+    p[i[3]] = lanes[3];
+}
+#else
+struct V4 { float v[4]; };
+inline V4 Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline void Store(float* p, V4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+inline V4 Set(float a) { return { { a, a, a, a } }; }
+inline V4 operator+(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+inline V4 operator-(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+inline V4 operator*(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+inline V4 operator/(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] /= b.v[i]; return a; }
+inline V4 Sqrt(V4 a) { for (int i = 0; i < 4; i++) a.v[i] = sqrtf(a.v[i]); return a; }
+inline V4 Min(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] = std::min(a.v[i], b.v[i]); return a; }
+inline V4 Max(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] = std::max(a.v[i], b.v[i]); return a; }
+inline V4 Less(V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return a; }
+inline V4 Select(V4 mask, V4 a, V4 b) { for (int i = 0; i < 4; i++) a.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i]; return a; }
+inline int NotLess(V4 a, V4 b)
+{
+    int mask = 0;
+    for (int i = 0; i < 4; i++)
+        mask |= (a.v[i] >= b.v[i]) << i;
+    return mask;
+}
+inline V4 Gather(const float* p, const int32_t* i) { return { { p[i[0]], p[i[1]], p[i[2]], p[i[3]] } }; }
+inline void Scatter(float* p, const int32_t* i, V4 a) { for (int j = 0; j < 4; j++) p[i[j]] = a.v[j]; }
+#endif
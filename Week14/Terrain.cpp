@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include "Terrain.h"
+#include "stb_image.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_SSE2 1
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+float HeightSource::HeightAt(float x, float z) const
+{
+    float height;
+    SampleRow(x, z, 0.0f, 1, &height);
+    return height;
+}
+
+//---------------------------------------------------------------------
+//
+// NoiseHeights
+//
+// The lattice value at (x, z) comes from an integer hash of x, z and the octave's seed.
+// Every step below is done in the same order by the scalar and the SSE2 code, so both give
+// bit for bit the same heights and a row's tail can't show a seam.
+
+static const unsigned HASH_X = 0x8da6b343u, HASH_Z = 0xd8163841u, HASH_SEED = 0xcb1ab31fu, HASH_MIX = 0x2c1b3c6du;
+static const float VALUE_SCALE = 2.0f / 65535.0f;
+
+static inline float LatticeValue(int x, int z, unsigned seed)
+{
+    unsigned h = (unsigned)x * HASH_X ^ (unsigned)z * HASH_Z ^ seed;
+    h = (h ^ (h >> 15)) * HASH_MIX;
+    h ^= h >> 12;
+    return (float)(h & 0xFFFF) * VALUE_SCALE - 1.0f;
+}
+
+static inline float ValueNoise(float x, float z, unsigned seed)
+{
+    const float fx = floorf(x), fz = floorf(z);
+    const int ix = (int)fx, iz = (int)fz;
+    const float tx = x - fx, tz = z - fz;
+    const float ux = tx * tx * (3.0f - 2.0f * tx), uz = tz * tz * (3.0f - 2.0f * tz);
+    const float a = LatticeValue(ix, iz, seed), b = LatticeValue(ix + 1, iz, seed);
+    const float c = LatticeValue(ix, iz + 1, seed), d = LatticeValue(ix + 1, iz + 1, seed);
+    const float top = a + (b - a) * ux, bottom = c + (d - c) * ux;
+    return top + (bottom - top) * uz;
+}
+
+#if defined(TERRAIN_SSE2)
+//! 32 bit a * b per lane, SSE2 only multiplies the even lanes into 64 bits.
+static inline __m128i MulLo(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128 LatticeValue4(__m128i x, __m128i z, __m128i seed)
+{
+    __m128i h = _mm_xor_si128(_mm_xor_si128(MulLo(x, _mm_set1_epi32((int)HASH_X)), MulLo(z, _mm_set1_epi32((int)HASH_Z))), seed);
+    h = MulLo(_mm_xor_si128(h, _mm_srli_epi32(h, 15)), _mm_set1_epi32((int)HASH_MIX));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+    const __m128 value = _mm_cvtepi32_ps(_mm_and_si128(h, _mm_set1_epi32(0xFFFF)));
+    return _mm_sub_ps(_mm_mul_ps(value, _mm_set1_ps(VALUE_SCALE)), _mm_set1_ps(1.0f));
+}
+
+//! floor for |x| < 2^31: truncate, then step down where that went up.
+static inline __m128i Floor4(__m128 x, __m128& floored)
+{
+    __m128i i = _mm_cvttps_epi32(x);
+    const __m128 above = _mm_cmpgt_ps(_mm_cvtepi32_ps(i), x);
+    i = _mm_add_epi32(i, _mm_castps_si128(above));
+    floored = _mm_cvtepi32_ps(i);
+    return i;
+}
+
+static inline __m128 ValueNoise4(__m128 x, __m128 z, __m128i seed)
+{
+    __m128 fx, fz;
+    const __m128i ix = Floor4(x, fx), iz = Floor4(z, fz);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 three = _mm_set1_ps(3.0f), two = _mm_set1_ps(2.0f);
+    const __m128 tx = _mm_sub_ps(x, fx), tz = _mm_sub_ps(z, fz);
+    const __m128 ux = _mm_mul_ps(_mm_mul_ps(tx, tx), _mm_sub_ps(three, _mm_mul_ps(two, tx)));
+    const __m128 uz = _mm_mul_ps(_mm_mul_ps(tz, tz), _mm_sub_ps(three, _mm_mul_ps(two, tz)));
+    const __m128 a = LatticeValue4(ix, iz, seed), b = LatticeValue4(_mm_add_epi32(ix, one), iz, seed);
+    const __m128 c = LatticeValue4(ix, _mm_add_epi32(iz, one), seed), d = LatticeValue4(_mm_add_epi32(ix, one), _mm_add_epi32(iz, one), seed);
+    const __m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), ux));
+    const __m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), ux));
+    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), uz));
+}
+#endif
+
+NoiseHeights::NoiseHeights(float height, float frequency, int octaves, unsigned seed)
+{
+    m_height = height;
+    m_frequency = frequency;
+    m_octaves = max(1, min(octaves, 16));
+    m_seed = seed;
+}
+
+void NoiseHeights::SampleRow(float x0, float z, float step, int count, float* heights) const
+{
+    // Each octave is shifted so the lattice points of the octaves don't all sit on the origin.
+    float frequency[16], amplitude[16], offset[16];
+    unsigned seed[16];
+    float total = 0.0f;
+    for (int o = 0; o < m_octaves; o++)
+    {
+        frequency[o] = m_frequency * (float)(1 << o);
+        amplitude[o] = 1.0f / (float)(1 << o);
+        offset[o] = 17.31f * (float)o;
+        seed[o] = (m_seed + (unsigned)o) * HASH_SEED;
+        total += amplitude[o];
+    }
+    const float scale = m_height / total;
+
+    int i = 0;
+#if defined(TERRAIN_SSE2)
+    const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x = _mm_add_ps(_mm_set1_ps(x0), _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)i), lanes), _mm_set1_ps(step)));
+        __m128 sum = _mm_setzero_ps();
+        for (int o = 0; o < m_octaves; o++)
+        {
+            const __m128 px = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(frequency[o])), _mm_set1_ps(offset[o]));
+            const __m128 pz = _mm_set1_ps(z * frequency[o] + offset[o]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(ValueNoise4(px, pz, _mm_set1_epi32((int)seed[o])), _mm_set1_ps(amplitude[o])));
+        }
+        _mm_storeu_ps(heights + i, _mm_mul_ps(sum, _mm_set1_ps(scale)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        const float x = x0 + (float)i * step;
+        float sum = 0.0f;
+        for (int o = 0; o < m_octaves; o++)
+            sum = sum + ValueNoise(x * frequency[o] + offset[o], z * frequency[o] + offset[o], seed[o]) * amplitude[o];
+        heights[i] = sum * scale;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// ImageHeights
+//
+bool ImageHeights::Load(const std::string& fileName, float unitsPerPixel, float height)
+{
+    int channels = 0;
+    m_width = m_rows = 0;
+    m_heights.clear();
+    m_unitsPerPixel = unitsPerPixel > 0.0f ? unitsPerPixel : 1.0f;
+    // 8 bit files come back scaled up to 16 bits, so both work the same.
+    stbi_us* image = stbi_load_16(fileName.c_str(), &m_width, &m_rows, &channels, 1);
+    if (!image)
+    {
+        cout << "Unable to load heightmap " << fileName << ": " << stbi_failure_reason() << endl;
+        m_width = m_rows = 0;
+        return false;
+    }
+    m_heights.resize((size_t)m_width * m_rows);
+    for (size_t i = 0; i < m_heights.size(); i++)
+        m_heights[i] = image[i] * (height / 65535.0f);
+    stbi_image_free(image);
+    return true;
+}
+
+void ImageHeights::SampleRow(float x0, float z, float step, int count, float* heights) const
+{
+    if (m_heights.empty())
+    {
+        fill(heights, heights + count, 0.0f);
+        return;
+    }
+    const float pz = min(max(z / m_unitsPerPixel + m_rows * 0.5f - 0.5f, 0.0f), (float)(m_rows - 1));
+    const int row = min((int)pz, max(m_rows - 2, 0));
+    const float tz = m_rows > 1 ? pz - row : 0.0f;
+    const float* top = &m_heights[(size_t)row * m_width];
+    const float* bottom = m_rows > 1 ? top + m_width : top;
+    for (int i = 0; i < count; i++)
+    {
+        const float px = min(max((x0 + i * step) / m_unitsPerPixel + m_width * 0.5f - 0.5f, 0.0f), (float)(m_width - 1));
+        const int col = min((int)px, max(m_width - 2, 0));
+        const int next = m_width > 1 ? col + 1 : col;
+        const float tx = m_width > 1 ? px - col : 0.0f;
+        const float a = top[col] + (top[next] - top[col]) * tx;
+        const float b = bottom[col] + (bottom[next] - bottom[col]) * tx;
+        heights[i] = a + (b - a) * tz;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Terrain
+//
+Terrain::Terrain(const HeightSource* heights, const TerrainSettings& settings)
+{
+    m_heights = heights;
+    m_settings = settings;
+    //! (n + 1)^2 vertices and 4 (n + 1) more for the skirt must fit a GLushort.
+    m_settings.chunkQuads = max(1, min(m_settings.chunkQuads, 250));
+    m_settings.levels = max(1, min(m_settings.levels, 16));
+    m_settings.chunkBudget = max(1, m_settings.chunkBudget);
+
+    // One index buffer serves every chunk: the grid, then each edge's skirt facing both ways, as
+    // a crack can be looked into from either side.
+    const int n = m_settings.chunkQuads, side = n + 1;
+    for (int j = 0; j < n; j++)
+        for (int i = 0; i < n; i++)
+        {
+            const GLushort a = (GLushort)(j * side + i), b = (GLushort)(a + side), c = (GLushort)(a + 1), d = (GLushort)(b + 1);
+            m_indices.insert(m_indices.end(), { a, b, c, c, b, d });
+        }
+    for (int edge = 0; edge < 4; edge++)
+        for (int k = 0; k < n; k++)
+        {
+            // Edge vertices in order along x at z = 0 and z = n, along z at x = 0 and x = n.
+            auto top = [&](int at) { return (GLushort)(edge == 0 ? at : edge == 1 ? n * side + at : edge == 2 ? at * side : at * side + n); };
+            const GLushort a = top(k), b = top(k + 1);
+            const GLushort c = (GLushort)(side * side + edge * side + k), d = (GLushort)(c + 1);
+            m_indices.insert(m_indices.end(), { a, c, b, b, c, d, a, b, c, b, d, c });
+        }
+    m_indexCount = (GLsizei)m_indices.size();
+    m_stats.budgetTriangles = (size_t)m_settings.chunkBudget * m_indexCount / 3;
+
+    // Chunks are streamed in the background while the shared WorkerPool already keeps every core busy
+    // with the frame's simulations, so by default only a quarter of the cores generate.
+    int workers = m_settings.workers;
+    if (workers <= 0)
+        workers = max(1, (int)thread::hardware_concurrency() / 4);
+    for (int i = 0; i < workers; i++)
+        m_workers.emplace_back(&Terrain::Work, this);
+}
+
+Terrain::~Terrain()
+{
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (thread& worker : m_workers)
+        worker.join();
+    for (auto& entry : m_chunks)
+        if (entry.second.uploaded)
+        {
+            glDeleteBuffers(1, &entry.second.vbo);
+            glDeleteVertexArrays(1, &entry.second.vao);
+        }
+    if (m_ibo)
+        glDeleteBuffers(1, &m_ibo);
+}
+
+uint64_t Terrain::Key(const Node& node)
+{
+    //! 4 bits of level and 30 of each coordinate, enough for a million chunks either way.
+    return (uint64_t)node.level << 60 | ((uint64_t)(uint32_t)node.x & 0x3FFFFFFF) << 30 | ((uint64_t)(uint32_t)node.z & 0x3FFFFFFF);
+}
+
+Terrain::Node Terrain::FromKey(uint64_t key)
+{
+    // Shifting left then right again brings back the sign of the 30 bit coordinates.
+    Node node;
+    node.level = (int)(key >> 60);
+    node.x = (int32_t)((uint32_t)(key >> 30) << 2) >> 2;
+    node.z = (int32_t)((uint32_t)key << 2) >> 2;
+    return node;
+}
+
+float Terrain::ChunkSize(int level) const
+{
+    return m_settings.chunkQuads * m_settings.quadSize * (float)(1 << level);
+}
+
+float Terrain::Priority(const Node& node, const glm::vec3& eye) const
+{
+    const float size = ChunkSize(node.level);
+    const float x0 = node.x * size, z0 = node.z * size;
+    const float dx = max(max(x0 - eye.x, eye.x - (x0 + size)), 0.0f);
+    const float dz = max(max(z0 - eye.z, eye.z - (z0 + size)), 0.0f);
+    // Heights are known once the chunk has been generated, until then assume the ground is at 0.
+    float minY = 0.0f, maxY = 0.0f;
+    auto found = m_chunks.find(Key(node));
+    if (found != m_chunks.end())
+    {
+        minY = found->second.minY;
+        maxY = found->second.maxY;
+    }
+    const float dy = max(max(minY - eye.y, eye.y - maxY), 0.0f);
+    return size / max(sqrtf(dx * dx + dy * dy + dz * dz), 1e-3f);
+}
+
+Terrain::Chunk Terrain::Generate(const Node& node) const
+{
+    const int n = m_settings.chunkQuads, side = n + 1, border = n + 3;
+    const float size = ChunkSize(node.level), spacing = size / n;
+    const float x0 = node.x * size, z0 = node.z * size;
+
+    // One sample more all round, so the edge normals match the neighbour's.
+    vector<float> heights((size_t)border * border);
+    for (int j = 0; j < border; j++)
+        m_heights->SampleRow(x0 - spacing, z0 + (j - 1) * spacing, spacing, border, &heights[(size_t)j * border]);
+
+    Chunk chunk;
+    chunk.vertices.resize(((size_t)side * side + 4 * side) * 8);
+    chunk.minY = chunk.maxY = heights[border + 1];
+    GLfloat* v = chunk.vertices.data();
+    for (int j = 0; j < side; j++)
+        for (int i = 0; i < side; i++, v += 8)
+        {
+            const float* h = &heights[(size_t)(j + 1) * border + (i + 1)];
+            const float x = x0 + i * spacing, z = z0 + j * spacing;
+            const glm::vec3 normal = glm::normalize(glm::vec3(h[-1] - h[1], 2.0f * spacing, h[-border] - h[border]));
+            v[0] = x; v[1] = h[0]; v[2] = z;
+            v[3] = normal.x; v[4] = normal.y; v[5] = normal.z;
+            v[6] = x * m_settings.uvScale; v[7] = z * m_settings.uvScale;
+            chunk.minY = min(chunk.minY, h[0]);
+            chunk.maxY = max(chunk.maxY, h[0]);
+        }
+
+    // The skirt: each edge vertex again, lowered by more than a coarser neighbour's edge can be off.
+    const float depth = chunk.maxY - chunk.minY + 2.0f * spacing;
+    const GLfloat* grid = chunk.vertices.data();
+    for (int edge = 0; edge < 4; edge++)
+        for (int k = 0; k < side; k++, v += 8)
+        {
+            const int at = edge == 0 ? k : edge == 1 ? n * side + k : edge == 2 ? k * side : k * side + n;
+            copy(grid + at * 8, grid + at * 8 + 8, v);
+            v[1] -= depth;
+        }
+    chunk.minY -= depth;
+    return chunk;
+}
+
+void Terrain::Upload(Chunk& chunk)
+{
+    glGenVertexArrays(1, &chunk.vao);
+    glBindVertexArray(chunk.vao);
+    glGenBuffers(1, &chunk.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * chunk.vertices.size(), chunk.vertices.data(), GL_STATIC_DRAW);
+    const GLsizei stride = 8 * sizeof(GLfloat);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    chunk.vertices.clear();
+    chunk.vertices.shrink_to_fit();
+    chunk.uploaded = true;
+    m_stats.uploaded++;
+}
+
+bool Terrain::Ready(const Node& node, std::vector<uint64_t>& wanted, int& uploads)
+{
+    const uint64_t key = Key(node);
+    auto found = m_chunks.find(key);
+    if (found == m_chunks.end())
+    {
+        wanted.push_back(key);
+        return false;
+    }
+    Chunk& chunk = found->second;
+    chunk.lastUsed = m_stats.frame;
+    if (!chunk.uploaded)
+    {
+        if (uploads <= 0)
+            return false;
+        Upload(chunk);
+        uploads--;
+    }
+    return true;
+}
+
+void Terrain::Update(const glm::vec3& eye)
+{
+    m_stats.frame++;
+    m_stats.uploaded = 0;
+    m_stats.evicted = 0;
+    m_stats.waiting = 0;
+    if (!m_ibo)
+    {
+        glGenBuffers(1, &m_ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    {
+        lock_guard<mutex> lock(m_mutex);
+        for (Generated& generated : m_done)
+            m_chunks.emplace(generated.key, move(generated.chunk)).first->second.lastUsed = m_stats.frame;
+        m_done.clear();
+        m_stats.generateMilliseconds = m_generatedCount ? m_generateMilliseconds / m_generatedCount : 0.0;
+    }
+
+    // The biggest chunks within sight, then the worst of them split for as long as the budget allows.
+    const int root = m_settings.levels - 1;
+    const float rootSize = ChunkSize(root), reach = m_settings.viewDistance;
+    vector<uint64_t> wanted;
+    int uploads = m_settings.uploadsPerFrame;
+    typedef pair<float, uint64_t> Candidate;
+    priority_queue<Candidate> open;
+    int used = 0;
+    for (int z = (int)floorf((eye.z - reach) / rootSize); z <= (int)floorf((eye.z + reach) / rootSize); z++)
+        for (int x = (int)floorf((eye.x - reach) / rootSize); x <= (int)floorf((eye.x + reach) / rootSize); x++)
+        {
+            const float dx = max(max(x * rootSize - eye.x, eye.x - (x + 1) * rootSize), 0.0f);
+            const float dz = max(max(z * rootSize - eye.z, eye.z - (z + 1) * rootSize), 0.0f);
+            if (dx * dx + dz * dz > reach * reach)
+                continue;
+            const Node node = { root, x, z };
+            if (used < m_settings.chunkBudget && Ready(node, wanted, uploads))
+            {
+                open.push(Candidate(Priority(node, eye), Key(node)));
+                used++;
+            }
+        }
+
+    m_selected.clear();
+    while (!open.empty())
+    {
+        const Node node = FromKey(open.top().second);
+        open.pop();
+        bool split = false;
+        if (node.level > 0 && used + 3 <= m_settings.chunkBudget)
+        {
+            split = true;
+            Node children[4];
+            for (int c = 0; c < 4; c++)
+            {
+                children[c] = { node.level - 1, node.x * 2 + (c & 1), node.z * 2 + (c >> 1) };
+                split = Ready(children[c], wanted, uploads) && split;
+            }
+            if (split)
+            {
+                for (const Node& child : children)
+                    open.push(Candidate(Priority(child, eye), Key(child)));
+                used += 3;
+            }
+            else
+                m_stats.waiting++;
+        }
+        if (!split)
+            m_selected.push_back(Key(node));
+    }
+
+    // Whatever the workers haven't started on yet is replaced by what this frame wants.
+    {
+        lock_guard<mutex> lock(m_mutex);
+        m_queue.clear();
+        for (uint64_t key : wanted)
+            if (!m_generating.count(key) && none_of(m_done.begin(), m_done.end(), [key](const Generated& g) { return g.key == key; }))
+                m_queue.push_back(key);
+        m_stats.queued = (int)m_queue.size();
+    }
+    m_wake.notify_all();
+
+    Evict();
+    m_stats.drawn = (int)m_selected.size();
+    m_stats.triangles = m_selected.size() * m_indexCount / 3;
+    fill(m_stats.levelCounts, m_stats.levelCounts + 16, 0);
+    for (uint64_t key : m_selected)
+        m_stats.levelCounts[FromKey(key).level]++;
+    m_stats.cached = m_chunks.size();
+}
+
+void Terrain::Evict()
+{
+    if (m_chunks.size() <= m_settings.cachedChunks)
+        return;
+    vector<pair<unsigned, uint64_t>> old;
+    for (auto& entry : m_chunks)
+        if (entry.second.lastUsed != m_stats.frame)
+            old.push_back(make_pair(entry.second.lastUsed, entry.first));
+    sort(old.begin(), old.end());
+    for (size_t i = 0; i < old.size() && m_chunks.size() > m_settings.cachedChunks; i++)
+    {
+        Chunk& chunk = m_chunks[old[i].second];
+        if (chunk.uploaded)
+        {
+            glDeleteBuffers(1, &chunk.vbo);
+            glDeleteVertexArrays(1, &chunk.vao);
+        }
+        m_chunks.erase(old[i].second);
+        m_stats.evicted++;
+    }
+}
+
+void Terrain::Draw() const
+{
+    for (uint64_t key : m_selected)
+    {
+        glBindVertexArray(m_chunks.at(key).vao);
+        glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+void Terrain::Work()
+{
+    for (;;)
+    {
+        uint64_t key;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop)
+                return;
+            key = m_queue.front();
+            m_queue.pop_front();
+            m_generating.insert(key);
+        }
+        const auto start = chrono::high_resolution_clock::now();
+        Generated generated = { key, Generate(FromKey(key)) };
+        const double milliseconds = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_generating.erase(key);
+            m_done.push_back(move(generated));
+            m_generateMilliseconds += milliseconds;
+            m_generatedCount++;
+        }
+    }
+}
+
+void Terrain::PrintStats() const
+{
+    cout << "Terrain frame " << m_stats.frame << ": " << m_stats.drawn << " chunks, " << m_stats.triangles << " of "
+         << m_stats.budgetTriangles << " triangles (levels";
+    for (int level = 0; level < m_settings.levels; level++)
+        cout << " " << m_stats.levelCounts[level];
+    cout << "), " << m_stats.waiting << " waiting, " << m_stats.queued << " queued, " << m_stats.uploaded << " uploaded, "
+         << m_stats.evicted << " evicted, " << m_stats.cached << " cached, " << m_stats.generateMilliseconds << " ms a chunk" << endl;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "camera.h"
+
+/// @brief Where terrain heights come from. SampleRow is called from the worker threads at the same
+/// time, so it must not change anything.
+class HeightSource
+{
+public:
+    virtual ~HeightSource() {}
+    //! heights[i] = height at x = x0 + i * step, for count samples along one z.
+    virtual void SampleRow(float x0, float z, float step, int count, float* heights) const = 0;
+    float HeightAt(float x, float z) const;
+};
+
+/// @brief Fractal value noise: octaves layers of smoothly interpolated random values on a lattice,
+/// each at twice the frequency and half the height of the one before. Four samples are worked out at
+/// once with SSE2 (the x64 baseline), the scalar loop does the row tails and builds without it and
+/// gives the same heights.
+class NoiseHeights : public HeightSource
+{
+public:
+    //! Heights in -height..height, with hills about 1 / frequency units apart.
+    NoiseHeights(float height = 6.0f, float frequency = 0.02f, int octaves = 6, unsigned seed = 1);
+    void SampleRow(float x0, float z, float step, int count, float* heights) const override;
+
+private:
+    float m_height, m_frequency;
+    int m_octaves;
+    unsigned m_seed;
+};
+
+/// @brief Heights read from an image, 8 or 16 bit grey, black at 0 and white at height, sampled
+/// bilinearly with the image centred on the origin. Outside the image the edge pixels carry on.
+class ImageHeights : public HeightSource
+{
+public:
+    //! False if the file couldn't be read, heights are then all 0.
+    bool Load(const std::string& fileName, float unitsPerPixel, float height);
+    void SampleRow(float x0, float z, float step, int count, float* heights) const override;
+
+    int Width() const { return m_width; }
+    int Height() const { return m_rows; }
+
+private:
+    std::vector<float> m_heights;
+    int m_width = 0, m_rows = 0;
+    float m_unitsPerPixel = 1.0f;
+};
+
+struct TerrainSettings
+{
+    int chunkQuads = 32;            // Quads along a chunk's side, the same at every level.
+    float quadSize = 0.25f;         // Size of one quad of a level 0 chunk, each level doubles it.
+    int levels = 6;                 // So the biggest chunks are chunkQuads * quadSize * 2^(levels - 1) across.
+    float viewDistance = 96.0f;
+    int chunkBudget = 96;           // Chunks drawn a frame, however far the camera sees.
+    float uvScale = 0.25f;          // Texture repeats per unit, in world space so chunks line up.
+    int workers = 0;                // Generating threads, 0 for a quarter of the cores (at least one).
+    int uploadsPerFrame = 4;        // Chunks copied to the GPU a frame, more wait for the next.
+    size_t cachedChunks = 512;      // Uploaded chunks kept around, least recently drawn go first.
+};
+
+/// @brief Per frame terrain numbers, see Terrain::Stats.
+struct TerrainStats
+{
+    unsigned frame = 0;
+    int drawn = 0;                  // Chunks drawn...
+    size_t triangles = 0;           // ...and their triangles, skirts included...
+    size_t budgetTriangles = 0;     // ...which never go over this.
+    int levelCounts[16] = {};       // Drawn chunks of each level.
+    int waiting = 0;                // Chunks the selection wanted but weren't ready, drawn coarser meanwhile.
+    int queued = 0;                 // Chunks waiting for a worker.
+    int uploaded = 0;               // This frame.
+    int evicted = 0;                // This frame.
+    size_t cached = 0;              // Chunks on the GPU.
+    double generateMilliseconds = 0.0;  // Average worker time per chunk so far.
+};
+
+/// @brief Ground that goes on as far as the camera sees, in place of a Grid.
+/// The world is cut into a quadtree of square chunks (geomipmapping): every chunk has the same
+/// chunkQuads x chunkQuads vertices, so a chunk twice as far can be twice as big for the same detail.
+/// Each frame the chunk with the most detail missing (its size over its distance) is split into its
+/// four children until chunkBudget chunks are in use, so the triangle count stays the same wherever the
+/// camera is and however far it sees. Neighbours of different levels don't share their edge vertices;
+/// every chunk hangs a skirt down from its edges that hides the cracks.
+/// Chunks are generated on worker threads in the order the selection wants them and copied to the
+/// GPU a few a frame. A chunk is only split once its children are all on the GPU, so there is never a hole.
+/// @note: call Update with the camera once a frame before Draw, both with the GL context current.
+/// Vertices are in world space: draw with an identity model matrix.
+class Terrain
+{
+public:
+    //! heights must outlive the Terrain.
+    Terrain(const HeightSource* heights, const TerrainSettings& settings = TerrainSettings());
+    ~Terrain();
+
+    void Update(const Camera& camera) { Update(camera.Position); }
+    void Update(const glm::vec3& eye);
+    //! Attribute 0 position, 2 uv and 3 normal, as Shape. Colour (attribute 1) is left to glVertexAttrib3f.
+    void Draw() const;
+
+    float HeightAt(float x, float z) const { return m_heights->HeightAt(x, z); }
+    const TerrainSettings& Settings() const { return m_settings; }
+    const TerrainStats& Stats() const { return m_stats; }
+    void PrintStats() const;
+
+private:
+    struct Node
+    {
+        int level, x, z;            // Chunk (x, z) of its level's grid.
+    };
+    struct Chunk
+    {
+        std::vector<GLfloat> vertices;  // Until uploaded.
+        GLuint vao = 0, vbo = 0;
+        bool uploaded = false;
+        unsigned lastUsed = 0;
+        float minY = 0.0f, maxY = 0.0f;
+    };
+    struct Generated
+    {
+        uint64_t key;
+        Chunk chunk;
+    };
+
+    static uint64_t Key(const Node& node);
+    static Node FromKey(uint64_t key);
+    float ChunkSize(int level) const;
+    //! How much detail the chunk is missing seen from eye, bigger is worse.
+    float Priority(const Node& node, const glm::vec3& eye) const;
+    //! Heights, normals and uvs of a chunk and its skirt, 8 floats a vertex. Runs on the workers.
+    Chunk Generate(const Node& node) const;
+    void Upload(Chunk& chunk);
+    //! Whether the chunk is on the GPU; if not, makes sure it is on its way.
+    bool Ready(const Node& node, std::vector<uint64_t>& wanted, int& uploads);
+    void Evict();
+    void Work();
+
+    const HeightSource* m_heights;
+    TerrainSettings m_settings;
+    GLuint m_ibo = 0;
+    GLsizei m_indexCount = 0;
+    std::vector<GLushort> m_indices;
+    std::unordered_map<uint64_t, Chunk> m_chunks;   // Main thread only.
+    std::vector<uint64_t> m_selected;
+    TerrainStats m_stats;
+
+    // Shared with the workers, under m_mutex.
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<uint64_t> m_queue;                   // Most wanted first.
+    std::unordered_set<uint64_t> m_generating;
+    std::vector<Generated> m_done;
+    double m_generateMilliseconds = 0.0;
+    int m_generatedCount = 0;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};
@@ -1,11 +1,11 @@
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #include "Texture.h"
 using namespace std;
 
-// Texture variables.
-GLuint tID;
-GLint twidth, theight, tbitDepth;
+unsigned Texture::s_currentFrame = 0;
 
 Texture::Texture(GLenum TextureTarget, const std::string& FileName, GLint Format)
 {
@@ -17,12 +17,11 @@ Texture::Texture(GLenum TextureTarget, const std::string& FileName, GLint Format
 
 bool Texture::Load()
 {
-    stbi_set_flip_vertically_on_load(true);
-
     //filename.c_str() to convert to constant char*
     //bitDepth:how many bit perpixel
     //unsigned char* image = stbi_load("Media/spheremap.png", &twidth, &theight, &tbitDepth, 0);
-    unsigned char* image = stbi_load(m_fileName.c_str(), &twidth, &theight, &tbitDepth, 0);
+    int channels = 0;
+    unsigned char* image = stbi_load(m_fileName.c_str(), &m_width, &m_height, &channels, 0);
     if (!image) {
         cout << "Unable to load file!" << stbi_failure_reason() << endl;
 
@@ -30,6 +29,20 @@ bool Texture::Load()
         // Could add a return too if you modify init.
     }
 
+    /// @note: the flip that stbi_set_flip_vertically_on_load used to do now happens
+    /// while converting, and the pixels end up BGRA8 (or R8) so the driver doesn't swizzle.
+    PixelConvertDesc desc;
+    desc.srcChannels = channels;
+    desc.requestedFormat = m_format;
+    desc.channel = CHANNEL_RED;
+    desc.flipVertically = true;
+    desc.premultiplyAlpha = m_premultiply;
+    m_upload = ChooseUploadFormat(desc);
+    m_bytesPerPixel = m_upload.bytesPerPixel;
+
+    vector<unsigned char> pixels((size_t)m_width * m_height * m_bytesPerPixel);
+    ConvertImage(image, m_width, m_height, desc, m_upload, &pixels[0]);
+    stbi_image_free(image);
 
     /// @note: all texture objects cannot be available to the shader. 
     /// That's why we have texture units sitting between texture objects and shaders.
@@ -39,17 +52,27 @@ bool Texture::Load()
     glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
     cout << "The number of my GPU texture units: " << textureUnits;
 
+    //! A reload after Demote replaces the small texture with the full chain.
+    Unload();
     //!Generate a handler for texture object
     glGenTextures(1, &m_textureObj);
     //!This tells openGL if the texture object is 1D, 2D, 3D, etc..
     glBindTexture(m_textureTarget, m_textureObj);
-    glTexImage2D(GL_TEXTURE_2D, 0, m_format, twidth, theight, 0, m_format, GL_UNSIGNED_BYTE,image);
+    //! R8 rows are not 4 byte aligned unless the width is a multiple of 4.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, m_bytesPerPixel == 4 ? 4 : 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_upload.internalFormat, m_width, m_height, 0, m_upload.format, m_upload.type, &pixels[0]);
+    //! The full mip chain is what lets TextureManager drop the big levels and keep sampling.
+    glGenerateMipmap(GL_TEXTURE_2D);
+    m_mipLevels = 1;
+    while ((m_width >> m_mipLevels) > 0 || (m_height >> m_mipLevels) > 0)
+        m_mipLevels++;
+    m_residentLevel = 0;
 
     	//! Configure the texture state
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     return true;
@@ -57,6 +80,70 @@ bool Texture::Load()
 
 void Texture::Bind(GLenum TextureUnit)
 {
+    m_lastBoundFrame = s_currentFrame;
     glActiveTexture(TextureUnit);
     glBindTexture(m_textureTarget, m_textureObj);
 }
+
+void Texture::Demote(int level)
+{
+    if (!IsLoaded() || level <= m_residentLevel || level >= m_mipLevels)
+        return;
+
+    //! Mip "level" of the full chain is mip (level - m_residentLevel) of what's resident now.
+    int w = max(1, m_width >> level);
+    int h = max(1, m_height >> level);
+    vector<unsigned char> pixels((size_t)w * h * m_bytesPerPixel);
+    glBindTexture(GL_TEXTURE_2D, m_textureObj);
+    glPixelStorei(GL_PACK_ALIGNMENT, m_bytesPerPixel == 4 ? 4 : 1);
+    glGetTexImage(GL_TEXTURE_2D, level - m_residentLevel, m_upload.format, m_upload.type, &pixels[0]);
+
+    GLuint small = 0;
+    glGenTextures(1, &small);
+    glBindTexture(GL_TEXTURE_2D, small);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, m_bytesPerPixel == 4 ? 4 : 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_upload.internalFormat, w, h, 0, m_upload.format, m_upload.type, &pixels[0]);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDeleteTextures(1, &m_textureObj);
+    m_textureObj = small;
+    m_residentLevel = level;
+}
+
+void Texture::Unload()
+{
+    if (m_textureObj != 0)
+        glDeleteTextures(1, &m_textureObj);
+    m_textureObj = 0;
+    m_residentLevel = 0;
+}
+
+size_t Texture::MipBytes(int level) const
+{
+    if (level >= m_mipLevels)
+        return 0;
+    return (size_t)max(1, m_width >> level) * max(1, m_height >> level) * m_bytesPerPixel;
+}
+
+size_t Texture::ResidentBytes() const
+{
+    if (!IsLoaded())
+        return 0;
+    size_t bytes = 0;
+    for (int level = m_residentLevel; level < m_mipLevels; level++)
+        bytes += MipBytes(level);
+    return bytes;
+}
+
+size_t Texture::FullBytes() const
+{
+    size_t bytes = 0;
+    for (int level = 0; level < m_mipLevels; level++)
+        bytes += MipBytes(level);
+    return bytes;
+}
@@ -3,6 +3,7 @@
 #include <GL/glew.h>
 //#define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "PixelConvert.h"
 
 class Texture
 {
@@ -13,10 +14,47 @@ public:
 
     void Bind(GLenum TextureUnit);
 
+    //! Multiply rgb by alpha before upload. Pair with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+    void SetPremultiplyAlpha(bool premultiply) { m_premultiply = premultiply; }
+
+    /// @brief Drops every mip above level from video memory. The remaining small mips are
+    /// read back and re-uploaded as a new, smaller texture; Load() brings the full chain back.
+    void Demote(int level);
+
+    //! Frees the GL texture object.
+    void Unload();
+
+    const std::string& FileName() const { return m_fileName; }
+    GLint Format() const { return m_format; }
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int MipLevels() const { return m_mipLevels; }
+    //! Highest resolution mip currently in video memory (0 unless demoted).
+    int ResidentLevel() const { return m_residentLevel; }
+    bool IsLoaded() const { return m_textureObj != 0; }
+    //! Bytes one mip level of the full chain takes.
+    size_t MipBytes(int level) const;
+    //! Bytes of every mip currently in video memory.
+    size_t ResidentBytes() const;
+    //! Bytes of the full chain, what Load() will bring back.
+    size_t FullBytes() const;
+    unsigned LastBoundFrame() const { return m_lastBoundFrame; }
+
+    //! Frame counter stamped into each texture by Bind. Advanced by TextureManager.
+    static unsigned s_currentFrame;
+
 private:
     std::string m_fileName;
     GLenum m_textureTarget;
-    GLuint m_textureObj;
+    GLuint m_textureObj = 0;
     GLint m_format;
+    bool m_premultiply = false;
+    int m_width = 0;
+    int m_height = 0;
+    int m_bytesPerPixel = 0;
+    int m_mipLevels = 0;
+    int m_residentLevel = 0;
+    PixelUploadFormat m_upload;
+    unsigned m_lastBoundFrame = 0;
 };
 
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "TextureManager.h"
+using namespace std;
+
+TextureManager::TextureManager(size_t budgetBytes, int minResidentSize)
+{
+    m_budget = budgetBytes;
+    m_minResidentSize = max(1, minResidentSize);
+    m_stats = TextureStats();
+    m_stats.budgetBytes = budgetBytes;
+}
+
+TextureManager::~TextureManager()
+{
+    for (auto& entry : m_textures)
+    {
+        entry.second->Unload();
+        delete entry.second;
+    }
+    m_textures.clear();
+}
+
+Texture* TextureManager::Load(GLenum TextureTarget, const std::string& FileName, GLint Format)
+{
+    //! The key includes the format: a GL_RED specular map and a GL_RGB view of the same file differ.
+    string key = FileName + "#" + to_string(Format);
+    auto found = m_textures.find(key);
+    if (found != m_textures.end())
+        return found->second;
+
+    Texture* texture = new Texture(TextureTarget, FileName, Format);
+    texture->Load();
+    m_textures[key] = texture;
+
+    //! Loading can push us over budget before the first frame.
+    size_t resident = ResidentBytes();
+    Evict(resident, m_budget);
+    return texture;
+}
+
+void TextureManager::BeginFrame()
+{
+    Texture::s_currentFrame++;
+    m_stats.evictions = 0;
+    m_stats.restores = 0;
+}
+
+void TextureManager::EndFrame()
+{
+    size_t resident = ResidentBytes();
+    Restore(resident);
+    Evict(resident, m_budget);
+
+    m_stats.frame = Texture::s_currentFrame;
+    m_stats.textures = m_textures.size();
+    m_stats.demoted = 0;
+    m_stats.fullBytes = 0;
+    for (auto& entry : m_textures)
+    {
+        m_stats.fullBytes += entry.second->FullBytes();
+        if (entry.second->ResidentLevel() > 0)
+            m_stats.demoted++;
+    }
+    m_stats.residentBytes = resident;
+    m_stats.budgetBytes = m_budget;
+}
+
+void TextureManager::PrintStats() const
+{
+    cout << "Frame " << m_stats.frame << ": " << m_stats.textures << " textures, "
+         << m_stats.residentBytes / 1024 << " KB resident of " << m_stats.budgetBytes / 1024 << " KB budget ("
+         << m_stats.fullBytes / 1024 << " KB at full res), " << m_stats.demoted << " demoted, "
+         << m_stats.evictions << " evicted, " << m_stats.restores << " restored" << endl;
+}
+
+int TextureManager::LowLevel(const Texture* texture) const
+{
+    int level = 0;
+    while (level + 1 < texture->MipLevels() &&
+           max(texture->Width() >> level, texture->Height() >> level) > m_minResidentSize)
+        level++;
+    return level;
+}
+
+size_t TextureManager::ResidentBytes() const
+{
+    size_t bytes = 0;
+    for (auto& entry : m_textures)
+        bytes += entry.second->ResidentBytes();
+    return bytes;
+}
+
+void TextureManager::Restore(size_t& resident)
+{
+    // Bound this frame but demoted: the scene needs it, so bring back the full chain.
+    // Everything here was used this frame, so the largest texture goes first, it gains the most detail.
+    vector<Texture*> wanted;
+    for (auto& entry : m_textures)
+    {
+        Texture* t = entry.second;
+        if (t->ResidentLevel() > 0 && t->LastBoundFrame() == Texture::s_currentFrame)
+            wanted.push_back(t);
+    }
+    sort(wanted.begin(), wanted.end(), [](const Texture* a, const Texture* b) {
+        return a->FullBytes() > b->FullBytes();
+    });
+
+    for (Texture* t : wanted)
+    {
+        if (m_stats.restores >= m_maxRestores)
+            break;
+        size_t growth = t->FullBytes() - t->ResidentBytes();
+        if (growth > m_budget)
+            continue;
+        // Make room from textures nobody bound this frame.
+        Evict(resident, m_budget - growth);
+        if (resident + growth > m_budget)
+            continue;
+        t->Load();
+        resident += growth;
+        m_stats.restores++;
+    }
+}
+
+void TextureManager::Evict(size_t& resident, size_t target)
+{
+    if (resident <= target)
+        return;
+
+    // Least recently bound first. Textures bound in the current frame are in use and stay.
+    vector<Texture*> candidates;
+    for (auto& entry : m_textures)
+    {
+        Texture* t = entry.second;
+        if (t->IsLoaded() && t->LastBoundFrame() != Texture::s_currentFrame && t->ResidentLevel() < LowLevel(t))
+            candidates.push_back(t);
+    }
+    sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+        return a->LastBoundFrame() < b->LastBoundFrame();
+    });
+
+    for (Texture* t : candidates)
+    {
+        if (resident <= target)
+            break;
+        size_t before = t->ResidentBytes();
+        t->Demote(LowLevel(t));
+        resident = resident - before + t->ResidentBytes();
+        m_stats.evictions++;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <GL/glew.h>
+#include "Texture.h"
+
+/// @brief Per frame residency numbers, see TextureManager::Stats.
+struct TextureStats
+{
+    unsigned frame;
+    size_t textures;        // Unique textures owned by the manager.
+    size_t demoted;         // Textures currently living at a low mip.
+    size_t residentBytes;   // What is in video memory now.
+    size_t fullBytes;       // What it would take with every texture at full resolution.
+    size_t budgetBytes;
+    int evictions;          // Demotions done this frame.
+    int restores;           // Full reloads done this frame.
+};
+
+/// @brief Owns every Texture of a scene, loads each file once and keeps video memory under a budget.
+/// Textures that have not been bound for a while are demoted to a small mip (minResidentSize pixels
+/// on the long side); a demoted texture that gets bound again is brought back to full resolution
+/// at the end of the frame if the budget allows it.
+/// @note: call BeginFrame before drawing and EndFrame after, Bind does the rest.
+class TextureManager
+{
+public:
+    TextureManager(size_t budgetBytes, int minResidentSize = 64);
+    ~TextureManager();
+
+    //! Same file and format twice returns the same Texture.
+    Texture* Load(GLenum TextureTarget, const std::string& FileName, GLint Format);
+
+    void SetBudget(size_t budgetBytes) { m_budget = budgetBytes; }
+    //! Limits how many full reloads may happen in one frame, reloads hit the disk.
+    void SetMaxRestoresPerFrame(int count) { m_maxRestores = count; }
+
+    void BeginFrame();
+    void EndFrame();
+
+    const TextureStats& Stats() const { return m_stats; }
+    void PrintStats() const;
+
+private:
+    //! Mip level at which the texture's long side is minResidentSize pixels or less.
+    int LowLevel(const Texture* texture) const;
+    size_t ResidentBytes() const;
+    void Restore(size_t& resident);
+    //! Demotes least recently bound textures until resident <= target.
+    void Evict(size_t& resident, size_t target);
+
+    std::unordered_map<std::string, Texture*> m_textures;
+    size_t m_budget;
+    int m_minResidentSize;
+    int m_maxRestores = 1;
+    TextureStats m_stats;
+};
@@ -22,6 +22,9 @@
  *  @note press WASD for tracking the camera or zooming in and out
  *  @note press arrow keys and page up and page down to move the light
  *  @note move mouse to yaw and pitch
+ *  @note press c to show or hide the cloth, x to hang it up again; the light's sphere pushes it about.
+ *  Run with --cloth-quads N for a finer or coarser one or --cloth-bench to time its steps,
+ *  or with --convert-bench to time the texture conversion Texture::Load does
  *  @attention we are using directional vertex and fragment shaders!
  *  @author Hooman Salamat
  *  @bug No known bugs.
@@ -40,6 +43,7 @@ using namespace std;
 #include "Shape.h"
 #include "Light.h"
 #include "Texture.h"
+#include "Cloth.h"
 
 #define BUFFER_OFFSET(x)  ((const void*) (x))
 #define FPS 60
@@ -112,6 +116,11 @@ Cube g_cube;
 Prism g_prism(24);
 Sphere g_sphere(5);
 Cone g_cone(100);
+// A curtain in front of the scene, hung from its top edge. Made in main, once the arguments are read.
+ClothSettings g_clothSettings;
+int g_clothQuads = 100;
+Cloth* g_cloth = NULL;
+bool g_showCloth = true;
 
 void timer(int); // Prototype.
 
@@ -168,11 +177,13 @@ void setupLights()
 void setupVAOs()
 {
 	// All VAO/VBO data now in Shape.h! But we still need to do this AFTER OpenGL is initialized.
-	g_grid.BufferShape();
+	g_grid.BufferShape(false); // Drawn as a line loop, which follows the index order.
 	g_cube.BufferShape();
 	g_prism.BufferShape();
 	g_sphere.BufferShape();
 	g_cone.BufferShape();
+	g_cloth->Init();
+	g_cloth->RecolorShape(0.8f, 0.15f, 0.2f);
 }
 
 void setupShaders()
@@ -344,6 +355,24 @@ void display(void)
 	g_grid.DrawShape(GL_LINE_LOOP);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	// Cloth. Its vertices come from the simulation each frame; both sides show, so no culling.
+	if (g_showCloth)
+	{
+		const float seconds = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+		g_cloth->SetWind(glm::vec3(0.0f, 0.0f, -2.0f - 1.5f * sinf(seconds * 0.8f)));
+		g_cloth->SetSphere(directionalLightPosition, 1.0f);
+		g_cloth->Update(seconds);
+		blankTexture->Bind(GL_TEXTURE0);
+		transformObject(glm::vec3(1.0f, 1.0f, 1.0f), X_AXIS, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+		glDisable(GL_CULL_FACE);
+		g_cloth->Draw();
+		glEnable(GL_CULL_FACE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		static int clothFrames = 0;
+		if (++clothFrames % 120 == 0)
+			g_cloth->PrintStats();
+	}
+
 	// Cube.
 	waterTexture->Bind(GL_TEXTURE0);
 	g_cube.RecolorShape(0.0, 1.0, 1.0);
@@ -445,6 +474,12 @@ void keyDown(unsigned char key, int x, int y)
 		if (!(keys & KEY_DOWN))
 			keys |= KEY_DOWN;
 		break;
+	case 'c':
+		g_showCloth = !g_showCloth;
+		break;
+	case 'x':
+		g_cloth->Reset();
+		break;
 	default:
 		break;
 	}
@@ -565,6 +600,7 @@ void clean()
 {
 	cout << "Cleaning up!" << endl;
 	glDeleteTextures(1, &blankID);
+	delete g_cloth;
 }
 
 //---------------------------------------------------------------------
@@ -575,6 +611,27 @@ int main(int argc, char** argv)
 {
 	//Before we can open a window, theremust be interaction between the windowing systemand OpenGL.In GLUT, this interaction is initiated by the following function call :
 	glutInit(&argc, argv);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (string(argv[i]) == "--cloth-bench")
+		{
+			Cloth::Benchmark(cout);
+			return 0;
+		}
+		if (string(argv[i]) == "--convert-bench")
+		{
+			PixelConvertBenchmark(cout);
+			return 0;
+		}
+		if (i + 1 < argc && string(argv[i]) == "--cloth-quads")
+			g_clothQuads = min(max(atoi(argv[i + 1]), 2), 180); // 181 x 181 vertices is as far as GLshort indices go.
+	}
+	// 6 by 6 units whatever the quads, its top edge 9 up, with the floor under it.
+	g_clothSettings.spacing = 6.0f / g_clothQuads;
+	g_clothSettings.origin = glm::vec3(5.0f, 3.0f, 1.5f);
+	g_clothSettings.floorHeight = 0.0f;
+	g_cloth = new Cloth(g_clothQuads, g_clothSettings);
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA | GLUT_MULTISAMPLE);
 	glutSetOption(GLUT_MULTISAMPLE, 8);
 
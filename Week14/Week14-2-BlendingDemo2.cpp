@@ -12,6 +12,9 @@
  *  @note press WASD for tracking the camera or zooming in and out
  *  @note press arrow keys and page up and page down to move the spot light (cone)
  *  @note move mouse to yaw and pitch
+ *  @note press t to swap the grid for the terrain, run with --heightmap file.png to read its heights from an image
+ *  @note press o to show or hide the ocean, run with --ocean-size 512 for a finer one or --ocean-bench to time its FFT
+ *  @note press p to show or hide the fountain of particles, m to blend them additively or sorted back to front, run with --particle-bench to time a million
  *  @attention we are using multi vertex and fragment shaders!
  *  @author Hooman Salamat
  *  @bug No known bugs.
@@ -30,6 +33,10 @@ using namespace std;
 #include "Shape.h"
 #include "Light.h"
 #include "Texture.h"
+#include "TextureManager.h"
+#include "Terrain.h"
+#include "Ocean.h"
+#include "Particles.h"
 
 #define BUFFER_OFFSET(x)  ((const void*) (x))
 #define FPS 60
@@ -124,8 +131,23 @@ Cube g_cube;
 Prism g_prism(7);
 Sphere g_sphere(6);
 Cone g_cone(7);
+// Ground as far as the camera sees, in place of the grid. Heights are noise, or a heightmap given on the command line.
+NoiseHeights g_noiseHeights;
+ImageHeights g_imageHeights;
+Terrain* g_terrain = NULL;
+bool g_showTerrain = false;
+// Sea around the scene: a 128 x 128 unit grid, tessellated on the GPU and displaced by an FFT heightfield.
+OceanSettings g_oceanSettings;
+Ocean* g_ocean = NULL;
+Grid g_oceanGrid(32);
+bool g_showOcean = true;
+// A fountain of sparks by the prism, blended over everything else.
+Particles* g_particles = NULL;
+bool g_showParticles = true;
 
 void timer(int); // Prototype.
+// Every texture of the scene, loaded once and kept under a 64 MB video memory budget.
+TextureManager g_textures(64 * 1024 * 1024);
 Texture* pTexture = NULL;
 Texture* gridTexture = NULL;
 Texture* blankTexture = NULL;
@@ -146,25 +168,14 @@ void loadTexture()
 {
 	glUniform1i(glGetUniformLocation(program, "texture0"), 0);
 
-	pTexture = new Texture(GL_TEXTURE_2D, "Media/bodyMetal.bmp", GL_RGB);
-	pTexture->Bind(GL_TEXTURE0);
-	pTexture->Load();
+	pTexture = g_textures.Load(GL_TEXTURE_2D, "Media/bodyMetal.bmp", GL_RGB);
 
-	blankTexture = new Texture(GL_TEXTURE_2D, "Media/blank.jpg", GL_RGB);
-	blankTexture->Bind(GL_TEXTURE0);
-	blankTexture->Load();
+	blankTexture = g_textures.Load(GL_TEXTURE_2D, "Media/blank.jpg", GL_RGB);
 
 	//! attention: water picture has alpha channel!
-	waterTexture = new Texture(GL_TEXTURE_2D, "Media/Water03.png", GL_RGBA);
-	waterTexture->Bind(GL_TEXTURE0);
-	waterTexture->Load();
+	waterTexture = g_textures.Load(GL_TEXTURE_2D, "Media/Water03.png", GL_RGBA);
 
-
-	gridTexture = new Texture(GL_TEXTURE_2D, "Media/dirt.png", GL_RGB);
-	gridTexture->Bind(GL_TEXTURE0);
-	if (!gridTexture->Load()) {
-		exit(0);
-	}
+	gridTexture = g_textures.Load(GL_TEXTURE_2D, "Media/dirt.png", GL_RGB);
 
 }
 
@@ -221,6 +232,8 @@ void setupVAOs()
 	g_prism.BufferShape();
 	g_sphere.BufferShape();
 	g_cone.BufferShape();
+	// Drawn as patches, so it must stay triangles.
+	g_oceanGrid.BufferShape(false);
 }
 
 
@@ -282,6 +295,15 @@ void init(void)
 
 	setupVAOs();
 
+	g_ocean = new Ocean(g_oceanSettings);
+	if (!g_ocean->Init())
+		g_showOcean = false;
+	ParticleSettings particleSettings;
+	particleSettings.emitter = glm::vec3(6.0f, 0.0f, 1.5f);
+	g_particles = new Particles(particleSettings);
+	if (!g_particles->Init())
+		g_showParticles = false;
+
 
 	// Enable depth testing and face culling. 
 	glEnable(GL_DEPTH_TEST);
@@ -382,14 +404,28 @@ void display(void)
 {
 	//you need this function here as light values might change
 	setupLights();
+	g_textures.BeginFrame();
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
 
 	// Grid. Note: I rendered it solid!
 	gridTexture->Bind(GL_TEXTURE0);
-	transformObject(glm::vec3(1.0f, 1.0f, 1.0f), X_AXIS, -90.0f, glm::vec3(0.0f, 0.0f, 0.0f));
-	g_grid.DrawShape(GL_TRIANGLES);
+	if (g_showTerrain)
+	{
+		// Terrain vertices are in world space. It has no colors of its own, so set one for all of them.
+		transformObject(glm::vec3(1.0f, 1.0f, 1.0f), X_AXIS, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+		glVertexAttrib3f(1, 1.0f, 1.0f, 1.0f);
+		g_terrain->Update(position);
+		g_terrain->Draw();
+		if (g_terrain->Stats().uploaded > 0 || g_terrain->Stats().evicted > 0)
+			g_terrain->PrintStats();
+	}
+	else
+	{
+		transformObject(glm::vec3(1.0f, 1.0f, 1.0f), X_AXIS, -90.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+		g_grid.DrawShape(GL_TRIANGLES);
+	}
 
 	// Cube.
 	waterTexture->Bind(GL_TEXTURE0);
@@ -428,6 +464,34 @@ void display(void)
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 
+	// Ocean, last of the opaque things. It has its own shaders, so ours go back afterwards.
+	if (g_showOcean)
+	{
+		g_ocean->Update(glutGet(GLUT_ELAPSED_TIME) / 1000.0f);
+		glm::mat4 oceanModel = glm::translate(glm::mat4(1.0f), glm::vec3(-56.0f, -0.6f, 56.0f));
+		oceanModel = glm::rotate(oceanModel, glm::radians(-90.0f), X_AXIS);
+		oceanModel = glm::scale(oceanModel, glm::vec3(4.0f, 4.0f, 4.0f));
+		g_ocean->Draw(g_oceanGrid, oceanModel, View, Projection, position, glm::normalize(directionalLightPosition));
+		glUseProgram(program);
+		if (g_ocean->Stats().frame % 120 == 0)
+			g_ocean->PrintStats();
+	}
+
+	// Particles, after everything opaque: they test depth but don't write it.
+	if (g_showParticles)
+	{
+		g_particles->Update(glutGet(GLUT_ELAPSED_TIME) / 1000.0f, position, frontVec);
+		g_particles->Draw(View, Projection);
+		glUseProgram(program);
+		if (g_particles->Stats().frame % 120 == 0)
+			g_particles->PrintStats();
+	}
+
+	// Residency only changes when something got evicted or restored, so only report then.
+	g_textures.EndFrame();
+	if (g_textures.Stats().evictions > 0 || g_textures.Stats().restores > 0)
+		g_textures.PrintStats();
+
 	glutSwapBuffers(); // Now for a potentially smoother render.
 }
 
@@ -450,6 +514,9 @@ void parseKeys()
 		position += upVec * MOVESPEED;
 	if (keys & KEY_DOWN)
 		position -= upVec * MOVESPEED;
+	// Don't go under the terrain.
+	if (g_showTerrain)
+		position.y = max(position.y, g_terrain->HeightAt(position.x, position.z) + 0.5f);
 }
 
 void timer(int) { // Tick of the frame.
@@ -496,6 +563,18 @@ void keyDown(unsigned char key, int x, int y)
 		if (!(keys & KEY_DOWN))
 			keys |= KEY_DOWN;
 		break;
+	case 't':
+		g_showTerrain = !g_showTerrain;
+		break;
+	case 'o':
+		g_showOcean = !g_showOcean;
+		break;
+	case 'p':
+		g_showParticles = !g_showParticles;
+		break;
+	case 'm':
+		g_particles->SetAdditive(!g_particles->Settings().additive);
+		break;
 	default:
 		break;
 	}
@@ -616,6 +695,9 @@ void clean()
 {
 	cout << "Cleaning up!" << endl;
 	glDeleteTextures(1, &blankID);
+	delete g_terrain;
+	delete g_ocean;
+	delete g_particles;
 }
 
 //---------------------------------------------------------------------
@@ -626,6 +708,26 @@ int main(int argc, char** argv)
 {
 	//Before we can open a window, theremust be interaction between the windowing systemand OpenGL.In GLUT, this interaction is initiated by the following function call :
 	glutInit(&argc, argv);
+
+	const HeightSource* heights = &g_noiseHeights;
+	for (int i = 1; i < argc; i++)
+	{
+		if (string(argv[i]) == "--ocean-bench")
+		{
+			Ocean::Benchmark(cout);
+			return 0;
+		}
+		if (string(argv[i]) == "--particle-bench")
+		{
+			Particles::Benchmark(cout);
+			return 0;
+		}
+		if (i + 1 < argc && string(argv[i]) == "--heightmap" && g_imageHeights.Load(argv[i + 1], 0.5f, 12.0f))
+			heights = &g_imageHeights;
+		if (i + 1 < argc && string(argv[i]) == "--ocean-size")
+			g_oceanSettings.size = atoi(argv[i + 1]);
+	}
+	g_terrain = new Terrain(heights);
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA | GLUT_MULTISAMPLE);
 	glutSetOption(GLUT_MULTISAMPLE, 8);
 
@@ -0,0 +1,33 @@
+#version 430 core
+
+in vec3 fragPos;
+in vec2 texCoord;
+out vec4 frag_color;
+
+uniform vec3 eyePosition;
+uniform vec3 toSun;
+uniform sampler2D normalMap;	// Normal as rgb, foam as a.
+
+const vec3 deepColor = vec3(0.0f, 0.08f, 0.16f);
+const vec3 scatterColor = vec3(0.0f, 0.2f, 0.18f);
+const vec3 horizonColor = vec3(0.6f, 0.72f, 0.85f);
+const vec3 zenithColor = vec3(0.18f, 0.38f, 0.72f);
+const vec3 sunColor = vec3(1.0f, 0.95f, 0.85f);
+const vec3 foamColor = vec3(0.9f, 0.93f, 0.95f);
+
+void main()
+{
+	vec4 texel = texture(normalMap, texCoord);
+	vec3 n = normalize(texel.xyz * 2.0f - 1.0f);
+	vec3 v = normalize(eyePosition - fragPos);
+	vec3 l = normalize(toSun);
+	vec3 r = reflect(-v, n);
+
+	// Schlick Fresnel for water: the sky is reflected at grazing angles, the deep water seen from above.
+	float fresnel = 0.02f + 0.98f * pow(1.0f - max(dot(n, v), 0.0f), 5.0f);
+	vec3 sky = mix(horizonColor, zenithColor, clamp(r.y, 0.0f, 1.0f));
+	vec3 water = deepColor + scatterColor * max(dot(n, l), 0.0f);
+	vec3 result = mix(water, sky, fresnel) + sunColor * pow(max(dot(r, l), 0.0f), 256.0f);
+	result = mix(result, foamColor, texel.a);
+	frag_color = vec4(result, 1.0f);
+}
\ No newline at end of file
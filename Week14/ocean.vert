@@ -0,0 +1,13 @@
+#version 430 core
+
+layout(location = 0) in vec3 vertex_position;
+
+out vec3 controlPos;
+
+uniform mat4 model;
+
+void main()
+{
+	// Tessellation and displacement work in world space.
+	controlPos = (model * vec4(vertex_position, 1.0f)).xyz;
+}
\ No newline at end of file
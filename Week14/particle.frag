@@ -0,0 +1,15 @@
+#version 430 core
+
+in vec4 color;
+in vec2 corner;
+out vec4 frag_color;
+
+void main()
+{
+	// Round and soft edged: alpha falls off from the middle and the corners are dropped.
+	float r2 = dot(corner, corner);
+	if (r2 >= 1.0f)
+		discard;
+	float fade = 1.0f - r2;
+	frag_color = vec4(color.rgb, color.a * fade * fade);
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 430 core
+
+// One instance a particle, one camera facing quad of four vertices each.
+layout(location = 0) in vec4 particle_position;	// xyz, and size in w.
+layout(location = 1) in vec4 particle_color;
+
+out vec4 color;
+out vec2 corner;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0f - 1.0f;
+	vec4 center = view * vec4(particle_position.xyz, 1.0f);
+	gl_Position = projection * (center + vec4(corner * 0.5f * particle_position.w, 0.0f, 0.0f));
+	color = particle_color;
+}
\ No newline at end of file
@@ -8,6 +8,7 @@ using namespace std;
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "IFS.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include <array>
@@ -44,43 +45,50 @@ void init(void)
 	glUseProgram(program);
 
 
-	// arbitrary initial location inside tetrahedron
-	vertices1[0][0] = 0.0;
-	vertices1[0][1] = 0.0;
-	vertices1[0][2] = 0.0;
+	//// arbitrary initial location inside tetrahedron
+	//vertices1[0][0] = 0.0;
+	//vertices1[0][1] = 0.0;
+	//vertices1[0][2] = 0.0;
 
 
-	// vertices of an arbitrary tetrahedron
-	std::array<glm::vec3, 4> points1 = { glm::vec3(-0.5, -0.5, -0.5), glm::vec3(0.5, -0.5, -0.5), glm::vec3(0.0,  0.5,  0.0), glm::vec3(0.0, -0.5,  0.5) };
+	//// vertices of an arbitrary tetrahedron
+	//std::array<glm::vec3, 4> points1 = { glm::vec3(-0.5, -0.5, -0.5), glm::vec3(0.5, -0.5, -0.5), glm::vec3(0.0,  0.5,  0.0), glm::vec3(0.0, -0.5,  0.5) };
 	//std::array<glm::vec3, 4> points1 = { glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, 0.942809, 0.333333), glm::vec3(-0.816497, -0.471405, 0.333333), glm::vec3(0.816497, -0.471405, 0.333333) };
 
 
-	//// compute and store N-1 new points
-	for (int i = 1; i < NumVertices; ++i) {
-		int j = (int)(rand() % 4);   // pick a vertex at random
-		vertices1[i] = (vertices1[i - 1] + points1[j]) / 2.0f;
+	////// compute and store N-1 new points
+	//for (int i = 1; i < NumVertices; ++i) {
+	//	int j = (int)(rand() % 4);   // pick a vertex at random
+	//	vertices1[i] = (vertices1[i - 1] + points1[j]) / 2.0f;
 
-		vertices[i][0] = vertices1[i][0];
-		vertices[i][1] = vertices1[i][1];
-		vertices[i][2] = vertices1[i][2];
-	}
+	//	vertices[i][0] = vertices1[i][0];
+	//	vertices[i][1] = vertices1[i][1];
+	//	vertices[i][2] = vertices1[i][2];
+	//}
 
 
 	//GLuint vao;
 	//glGenVertexArrays(1, &vao);
 	//glBindVertexArray(vao);
 
-	// Create and initialize a buffer object
+	// Create a buffer object and let GenerateIFS play the chaos game (same tetrahedron as above,
+	// one color per corner) straight into it, position and color interleaved
 	GLuint buffer;
 	glGenBuffers(1, &buffer);
 	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, NumVertices * 6 * sizeof(GLfloat), NULL, GL_STATIC_DRAW);
+	GLfloat* mapped = (GLfloat*)glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+	GenerateIFS(IFSTetrahedron(), 1, 0, NumVertices, IFSOutput::Interleaved(mapped, 3, true));
+	glUnmapBuffer(GL_ARRAY_BUFFER);
 
 
-	// Initialize the vertex position attribute from the vertex shader
+	// Initialize the vertex position and color attributes from the vertex shader
 	GLuint loc = glGetAttribLocation(program, "vertex_position");
 	glEnableVertexAttribArray(loc);
-	glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+	glVertexAttribPointer(loc, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), BUFFER_OFFSET(0));
+	GLuint colorLoc = glGetAttribLocation(program, "vertex_color");
+	glEnableVertexAttribArray(colorLoc);
+	glVertexAttribPointer(colorLoc, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), BUFFER_OFFSET(3 * sizeof(GLfloat)));
 
 	glEnable(GL_DEPTH_TEST);
 
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "glm\glm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <queue>
+#include <thread>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////
+// @file Parametric.h
+// @brief Tessellates parametric curves and surfaces for the Week 6 demos.
+//
+// A curve is any function glm::vec3 f(float t), a surface any glm::vec3 f(float u, float v).
+// Instead of stepping t by a fixed amount, the parameter range is split where the polyline
+// strays too far from the curve: flat parts get few vertices, tight bends many.
+// How far is too far is a Tolerance, either in world units or in pixels on screen.
+//
+// The result is cached: Tessellate() only does the work again when the parameters passed
+// to it change, and Draw() only calls glBufferData when there is something new to upload.
+//
+//	Parametric::Curve ellipse;
+//	...
+//	ellipse.Tessellate([](float t) { return glm::vec3(A * cos(t), B * sin(t), 0.0f); },
+//		0.0f, 2.0f * PI, tolerance, { A, B });		// Does nothing unless A or B changed.
+//	ellipse.Draw(GL_LINE_LOOP);						// Uploads only if it was re-tessellated.
+///////////////////////////////////////////////////////////////////////
+
+namespace Parametric
+{
+	// How closely the tessellation must follow the curve.
+	struct Tolerance
+	{
+		float error = 0.05f;			// Largest distance between the curve and its polyline.
+		bool screenSpace = false;		// error is in pixels, after projecting with mvp onto viewport.
+		glm::mat4 mvp = glm::mat4(1.0f);
+		glm::vec2 viewport = glm::vec2(1.0f);
+		int minSegments = 8;			// Uniform segments to start from, so no wiggle is stepped over.
+		int maxVertices = 500;			// Refinement stops here even if error isn't met.
+
+		float Distance(glm::vec3 a, glm::vec3 b) const
+		{
+			if (!screenSpace)
+				return glm::length(a - b);
+			const glm::vec4 pa = mvp * glm::vec4(a, 1.0f), pb = mvp * glm::vec4(b, 1.0f);
+			if (pa.w <= 0.0f || pb.w <= 0.0f)
+				return glm::length(a - b);
+			const glm::vec2 sa = glm::vec2(pa) / pa.w * 0.5f * viewport;
+			const glm::vec2 sb = glm::vec2(pb) / pb.w * 0.5f * viewport;
+			return glm::length(sa - sb);
+		}
+	};
+
+	// Splits [t0, t1] until error(a, b) <= tolerance.error for every piece, worst piece first, and
+	// returns the piece ends in order. At most maxPieces pieces.
+	template <typename Error>
+	std::vector<float> Refine(Error error, float t0, float t1, float tolerance, int minPieces, int maxPieces)
+	{
+		struct Piece
+		{
+			float a, b, error;
+			bool operator<(const Piece& other) const { return error < other.error; }
+		};
+		minPieces = std::max(1, std::min(minPieces, maxPieces));
+		std::priority_queue<Piece> pieces;
+		for (int i = 0; i < minPieces; i++)
+		{
+			const float a = t0 + (t1 - t0) * i / minPieces;
+			const float b = i + 1 == minPieces ? t1 : t0 + (t1 - t0) * (i + 1) / minPieces;
+			pieces.push({ a, b, error(a, b) });
+		}
+		while ((int)pieces.size() < maxPieces && pieces.top().error > tolerance)
+		{
+			const Piece worst = pieces.top();
+			pieces.pop();
+			const float middle = 0.5f * (worst.a + worst.b);
+			if (middle <= worst.a || middle >= worst.b)
+				break;	// Ran out of float precision.
+			pieces.push({ worst.a, middle, error(worst.a, middle) });
+			pieces.push({ middle, worst.b, error(middle, worst.b) });
+		}
+		std::vector<float> ends;
+		ends.reserve(pieces.size() + 1);
+		ends.push_back(t0);
+		for (; !pieces.empty(); pieces.pop())
+			ends.push_back(pieces.top().b);
+		std::sort(ends.begin(), ends.end());
+		return ends;
+	}
+
+	// How far the chord from f(a) to f(b) is from the curve, checked at a quarter, half and three
+	// quarters of the way so that an S bend or a symmetric bump isn't missed.
+	template <typename F>
+	float ChordError(F& f, float a, float b, const Tolerance& tolerance)
+	{
+		const glm::vec3 pa = f(a), pb = f(b);
+		float error = 0.0f;
+		for (int i = 1; i <= 3; i++)
+		{
+			const float s = i * 0.25f;
+			error = std::max(error, tolerance.Distance(f(a + (b - a) * s), pa + (pb - pa) * s));
+		}
+		return error;
+	}
+
+	// Runs body(first, last) over [0, count) split between all cores, or on this thread when
+	// count is too small for threads to pay off.
+	template <typename Body>
+	void ParallelFor(int count, Body body)
+	{
+		const int minPerThread = 4096;
+		const int threads = std::min((int)std::max(1u, std::thread::hardware_concurrency()), count / minPerThread);
+		if (threads <= 1)
+		{
+			body(0, count);
+			return;
+		}
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; i++)
+			workers.emplace_back(body, count * i / threads, count * (i + 1) / threads);
+		body(0, count / threads);
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	// Vertices and colors on the GPU, uploaded again only after they change.
+	class Mesh
+	{
+	public:
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec3> colors;	// One per vertex, fill after Tessellate() returns true.
+
+		Mesh() {}
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;	// Two meshes would share the buffers.
+
+		int Size() const { return (int)vertices.size(); }
+
+		// Marks vertices and colors as changed, for callers that edit them directly.
+		void Changed() { changed = true; }
+
+		// Binds the mesh's vertex array, creating and uploading the buffers if needed.
+		void Bind()
+		{
+			if (!vao)
+			{
+				glGenVertexArrays(1, &vao);
+				glBindVertexArray(vao);
+				glGenBuffers(1, &points_vbo);
+				glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+				glEnableVertexAttribArray(0);
+				glGenBuffers(1, &colors_vbo);
+				glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
+				glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+				glEnableVertexAttribArray(1);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				changed = true;
+			}
+			glBindVertexArray(vao);
+			if (changed)
+			{
+				colors.resize(vertices.size(), glm::vec3(0.0f));
+				glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colors.size(), colors.data(), GL_STATIC_DRAW);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				changed = false;
+			}
+		}
+
+		// Draws count vertices from first (all of them by default) and unbinds.
+		void Draw(GLenum mode, int first = 0, int count = -1)
+		{
+			Bind();
+			glDrawArrays(mode, first, count < 0 ? Size() - first : count);
+			glBindVertexArray(0);
+		}
+
+	protected:
+		// Returns true, and forgets the last key, if key differs from it.
+		bool NewKey(std::vector<float>& key)
+		{
+			if (key == last_key)
+				return false;
+			last_key.swap(key);
+			changed = true;
+			return true;
+		}
+
+		static void AddKey(std::vector<float>& key, const Tolerance& tolerance)
+		{
+			key.insert(key.end(), { tolerance.error, (float)tolerance.screenSpace,
+				(float)tolerance.minSegments, (float)tolerance.maxVertices });
+			if (tolerance.screenSpace)
+			{
+				key.insert(key.end(), &tolerance.mvp[0][0], &tolerance.mvp[0][0] + 16);
+				key.insert(key.end(), { tolerance.viewport.x, tolerance.viewport.y });
+			}
+		}
+
+	private:
+		std::vector<float> last_key;
+		GLuint vao = 0, points_vbo = 0, colors_vbo = 0;
+		bool changed = true;
+	};
+
+	// A curve drawn as a line strip / loop or triangle fan through its vertices.
+	class Curve : public Mesh
+	{
+	public:
+		std::vector<float> parameters;	// t of each vertex.
+
+		// Tessellates f over [t0, t1] unless f's params (every value f depends on), the range and
+		// the tolerance are all the same as last time. Returns true if the vertices changed.
+		template <typename F>
+		bool Tessellate(F f, float t0, float t1, const Tolerance& tolerance, std::initializer_list<float> params)
+		{
+			std::vector<float> key(params);
+			key.insert(key.end(), { t0, t1 });
+			AddKey(key, tolerance);
+			if (!NewKey(key))
+				return false;
+
+			auto error = [&](float a, float b) { return ChordError(f, a, b, tolerance); };
+			parameters = Refine(error, t0, t1, tolerance.error, tolerance.minSegments, std::max(1, tolerance.maxVertices - 1));
+			vertices.resize(parameters.size());
+			ParallelFor((int)parameters.size(), [&](int first, int last)
+			{
+				for (int i = first; i < last; i++)
+					vertices[i] = f(parameters[i]);
+			});
+			colors.clear();
+			return true;
+		}
+	};
+
+	// A surface drawn as triangle strips, one per row of the grid.
+	class Surface : public Mesh
+	{
+	public:
+		std::vector<float> us, vs;		// Grid lines, the grid is us.size() by vs.size().
+
+		// Tessellates f over [u0, u1] x [v0, v1] on a grid whose u and v lines are refined
+		// independently: a u split is made where any line of constant v needs it, and the other
+		// way around. Returns true if the vertices changed, see Curve::Tessellate.
+		// tolerance.maxVertices bounds the whole grid; minSegments applies in u, minVSegments in v.
+		template <typename F>
+		bool Tessellate(F f, float u0, float u1, float v0, float v1, const Tolerance& tolerance,
+			int minVSegments, std::initializer_list<float> params)
+		{
+			std::vector<float> key(params);
+			key.insert(key.end(), { u0, u1, v0, v1, (float)minVSegments });
+			AddKey(key, tolerance);
+			if (!NewKey(key))
+				return false;
+
+			// Each direction is checked along the lines of the other's uniform starting grid.
+			const int minU = std::max(1, tolerance.minSegments), minV = std::max(1, minVSegments);
+			const int budget = std::max(2, (int)std::sqrt((float)std::max(4, tolerance.maxVertices / 2)));
+			us = Refine([&](float a, float b)
+			{
+				float error = 0.0f;
+				for (int j = 0; j <= minV; j++)
+				{
+					const float v = v0 + (v1 - v0) * j / minV;
+					auto line = [&](float u) { return f(u, v); };
+					error = std::max(error, ChordError(line, a, b, tolerance));
+				}
+				return error;
+			}, u0, u1, tolerance.error, minU, budget - 1);
+			vs = Refine([&](float a, float b)
+			{
+				float error = 0.0f;
+				for (int i = 0; i <= minU; i++)
+				{
+					const float u = u0 + (u1 - u0) * i / minU;
+					auto line = [&](float v) { return f(u, v); };
+					error = std::max(error, ChordError(line, a, b, tolerance));
+				}
+				return error;
+			}, v0, v1, tolerance.error, minV, budget - 1);
+
+			// Row j of strips goes along u, two vertices at a time: (u, v[j + 1]) then (u, v[j]).
+			const int columns = (int)us.size(), rows = (int)vs.size() - 1;
+			vertices.resize(2 * columns * rows);
+			ParallelFor(rows * columns, [&](int first, int last)
+			{
+				for (int k = first; k < last; k++)
+				{
+					const int j = k / columns, i = k % columns;
+					vertices[2 * k] = f(us[i], vs[j + 1]);
+					vertices[2 * k + 1] = f(us[i], vs[j]);
+				}
+			});
+			colors.clear();
+			return true;
+		}
+
+		int Strips() const { return (int)vs.size() - 1; }
+		int StripSize() const { return 2 * (int)us.size(); }
+
+		// Draws each row as its own triangle strip.
+		void DrawStrips()
+		{
+			Bind();
+			for (int j = 0; j < Strips(); j++)
+				glDrawArrays(GL_TRIANGLE_STRIP, j * StripSize(), StripSize());
+			glBindVertexArray(0);
+		}
+	};
+}
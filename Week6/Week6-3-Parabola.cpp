@@ -11,9 +11,11 @@
 // and, conversively, a parabola is the graph of a quadratic function if its axis is parallel to the y-axis.
 // 
 // @attention Increasing the number of vertices makes the strip approximate the parabola.
+// Parametric.h starts from 2M even segments and then adds vertices where the parabola bends
+// until the strip is within tolerance of it.
 //
 // Interaction:
-// @note: Press +/- to increase/decrease the number of vertices of the strip.
+// @note: Press +/- to increase/decrease the number of segments the strip starts from.
 // @author Hooman Salamat
 ///////////////////////////////////////////////////////////////////// 
 
@@ -25,6 +27,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -38,7 +41,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 float rotAngle = 0.0f;
 int deltaTime, currentTime, lastTime = 0;
 
@@ -54,15 +57,8 @@ fragmentShaderId;
 
 // Globals.
 const int MaxNumVertices = 500; // Number of vertices on circle.
-int numVertices = 0;
 
-
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
-GLint shape_indices[MaxNumVertices] = { 0 };
+Parametric::Curve parabola;
 
 // Globals.
 static int isWire = 0; // Is wireframe?
@@ -77,28 +73,15 @@ static float b = 255.0f;
 
 void createModel()
 {
-	numVertices = 0;
-	for (int i = -M; i <= M; ++i)
-	{
-		vertices[numVertices] = glm::vec3(C + B * (float)i / M, A * (float)(i * i) / (M * M), 0.0);
-		//colors[numVertices] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		colors[numVertices] = glm::vec3(r/255.0f, g/255.0f, b/255.0f);
-
-		numVertices++;
-	}
-
-	for (int i = 0; i < numVertices; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
-
-		shape_indices[i] = i;
-	}
+	// x = C + B * s, y = A * s^2 for -1 <= s <= 1. Within an eighth of a pixel (800 pixels show 100 units).
+	Parametric::Tolerance tolerance;
+	tolerance.error = 0.125f * 100.0f / 800.0f;
+	tolerance.minSegments = 2 * M;
+	tolerance.maxVertices = MaxNumVertices;
+
+	// Only does any work when A, B, C, M or the color changed since the last call.
+	if (parabola.Tessellate([](float s) { return glm::vec3(C + B * s, A * s * s, 0.0f); }, -1.0f, 1.0f, tolerance, { A, B, C, r, g, b }))
+		parabola.colors.assign(parabola.Size(), glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f));
 }
 
 
@@ -124,36 +107,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	glGenBuffers(1, &ibo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	//glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(shape_indices), shape_indices, GL_STATIC_DRAW);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	//// Number of vertices on one half of the parabola.
+	// The parabola's vertex array and buffers are made by Parametric::Curve the first time it is drawn.
 	createModel();
 
 	// Enable depth test.
@@ -201,33 +155,21 @@ void display(void)
 	//Comment this out if you are not interested in changing colors randomly
 	//createModel();
 
-	glBindVertexArray(1);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(shape_indices), shape_indices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, rotAngle = 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
 
+	// Uploads the vertices only if createModel() changed them.
 	if (isWire)
 	{
-		glDrawArrays(GL_LINE_STRIP, 0, numVertices);
-		//glDrawElements(GL_LINE_LOOP, numVertices, GL_UNSIGNED_INT, NULL);
+		parabola.Draw(GL_LINE_STRIP);
 	}
 	else
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
-		//glDrawElements(GL_TRIANGLE_FAN, numVertices, GL_UNSIGNED_INT, NULL);
+		parabola.Draw(GL_TRIANGLE_FAN);
 	}
 
 
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
 	glutSwapBuffers(); // Instead of double buffering.
 }
 
@@ -27,6 +27,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -40,7 +41,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 float rotAngle = 0.0f;
 int deltaTime, currentTime, lastTime = 0;
 
@@ -79,11 +80,9 @@ void writeBitmapString(void* font, char* string)
 
 
 
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
+// Each shape keeps its own vertex array, so nothing is uploaded again from one frame to the next.
+Parametric::Curve discs[4];
+Parametric::Surface annulus;
 
 std::array<glm::vec3, 8> unique_colors = {
 	glm::vec3(1.0f, 0.0f, 0.0f),
@@ -111,80 +110,48 @@ void transformObject(float scale, glm::vec3 rotationAxis, float rotationAngle, g
 	glUniformMatrix4fv(modelID, 1, GL_FALSE, &mvp[0][0]);
 }
 
-void drawDisc(float R, float X, float Y, float Z, int colorIndex)
+// Boundary vertices start numVertices apart and are added until the edge is within a quarter pixel.
+Parametric::Tolerance screenTolerance()
 {
-	float t=0.0f;
-	int i;
-	for ( i = 0; i < numVertices; ++i)
-	{
-
-		vertices[i]= glm::vec3(X + R * cos(t), Y + R * sin(t), Z);
-		//colors[i] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		colors[i] = unique_colors[colorIndex];
-
-		t += 2 * PI / numVertices;
-	}
-
-	for ( i = 0; i < numVertices; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
+	Parametric::Tolerance tolerance;
+	tolerance.screenSpace = true;
+	tolerance.error = 0.25f;
+	tolerance.mvp = projection * view;
+	tolerance.viewport = glm::vec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+	tolerance.minSegments = numVertices;
+	tolerance.maxVertices = MaxNumVertices;
+	return tolerance;
+}
 
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
+void drawDisc(Parametric::Curve& disc, float R, float X, float Y, float Z, int colorIndex)
+{
+	// Only tessellated on the first frame, or after the window is resized.
+	if (disc.Tessellate([=](float t) { return glm::vec3(X + R * cos(t), Y + R * sin(t), Z); },
+		0.0f, 2.0f * PI, screenTolerance(), { R, X, Y, Z, (float)colorIndex }))
+	{
+		disc.colors.assign(disc.Size(), unique_colors[colorIndex]);
 	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, rotAngle += 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
-	glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
+	disc.Draw(GL_TRIANGLE_FAN);
 }
 
-
 void drawAnnulus(float R, float X, float Y, float Z, int colorIndex)
 {
-	float t=0.0f;
-	int i;
-	for (i = 0; i < numVertices*2; i=i+2)
+	// u goes around, v = 1 is the inner circle of radius R and v = 0 the outer one of radius R + 10,
+	// so each pair of strip vertices is inner then outer.
+	if (annulus.Tessellate([=](float u, float v) { return glm::vec3(X + (R + 10 * (1 - v)) * cos(u), Y + (R + 10 * (1 - v)) * sin(u), Z); },
+		0.0f, 2.0f * PI, 0.0f, 1.0f, screenTolerance(), 1, { R, X, Y, Z, (float)colorIndex }))
 	{
-		vertices[i] = glm::vec3(X + R * cos(t), Y + R * sin(t), Z);
-		//colors[i] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		colors[i] = unique_colors[colorIndex];
-
-		vertices[i + 1] = glm::vec3(X + (R + 10) * cos(t), Y + (R + 10) * sin(t), Z);
-		//colors[i+1] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		colors[i+1] = unique_colors[colorIndex];
-
-		t = PI * i / numVertices * 2;	
+		annulus.colors.assign(annulus.Size(), unique_colors[colorIndex]);
 	}
 
-	for (i = 0; i < numVertices*2; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
-	}
-
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
 	transformObject(1.0f, X_AXIS, rotAngle += 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, numVertices * 2);  //numVertices * 2
+	annulus.Draw(GL_TRIANGLE_STRIP);
 }
 
-
 void init(void)
 {
 	vertexShaderId = setShader((char*)"vertex", (char*)"cubeProjection.vert");
@@ -208,30 +175,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// Every shape makes its own vertex array and buffers the first time it is drawn.
 
 	
 // Enable depth test.
@@ -270,18 +214,16 @@ void display(void)
 	// Update the ortho projection.
 	projection = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, 0.0f, 100.0f);
 
-	glBindVertexArray(1);
-
 	//Upper-left: There is not a real hole. The white disc overwrites the green disc
 	glDisable(GL_DEPTH_TEST);
-	drawDisc(20.0, 25.0, 75.0, 0.0, 1);
-	drawDisc(10.0, 25.0, 75.0, 0.0, 7);
+	drawDisc(discs[0], 20.0, 25.0, 75.0, 0.0, 1);
+	drawDisc(discs[1], 10.0, 25.0, 75.0, 0.0, 7);
 	
 	//Upper-right: There is not a real hole either. A white disc is drawn closer to the
 	//viewer than the blue disc blocking it out :
 	glEnable(GL_DEPTH_TEST);
-	drawDisc(20.0, 75.0, 75.0, 0.0, 2);
-	drawDisc(10.0, 75.0, 75.0, 0.5, 7);
+	drawDisc(discs[2], 20.0, 75.0, 75.0, 0.0, 2);
+	drawDisc(discs[3], 10.0, 75.0, 75.0, 0.5, 7);
 	glDisable(GL_DEPTH_TEST);
 
 	
@@ -32,6 +32,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -45,7 +46,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 float rotAngle = 0.0f;
 int deltaTime, currentTime, lastTime = 0;
 
@@ -64,17 +65,12 @@ static float R = 2.0; // Radius of circle.
 static float X = 0.0; // X-coordinate of center of circle.
 static float Y = 0.0; // Y-coordinate of center of circle.
 const int MaxNumVertices = 500; // Number of vertices on circle.
-static int numVertices = 3;
 #define PI 3.14159265358979324
 
 float theta = 0.0f;
 
 
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
+Parametric::Curve helix;
 
 // Globals.
 static int isWire = 1; // Is wireframe?
@@ -93,27 +89,25 @@ void writeBitmapString(void* font, char* string)
 void createModel()
 {
 	float R = 20.0; // Radius of helix.
-	float t; // Angle parameter.
 
-	int i = 0;
-	for ( t = -10 * PI; t <=  10 * PI; t += PI / 20.0)
+	// Within a quarter pixel on screen, starting from 4 segments a turn. Called every frame, but
+	// the helix is only tessellated again when the projection or the window size changes.
+	Parametric::Tolerance tolerance;
+	tolerance.screenSpace = true;
+	tolerance.error = 0.25f;
+	tolerance.mvp = projection * view;
+	tolerance.viewport = glm::vec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+	tolerance.minSegments = 40;
+	tolerance.maxVertices = MaxNumVertices;
+
+	// Upright, coiling around the y-axis: glm::vec3(R * cos(t), t, R * sin(t) - 60.0f).
+	if (helix.Tessellate([=](float t) { return glm::vec3(R * cos(t), R * sin(t), t - 60.0f); },
+		-10 * PI, 10 * PI, tolerance, { R }))
 	{
-		vertices[i] = glm::vec3(R * cos(t), R * sin(t), t - 60.0);
-		//vertices[i] = glm::vec3(R * cos(t), t, R * sin(t) - 60.0);
-		colors[i] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		numVertices = i;
-		i++;
-	}
-
-	for (int i = 0; i < numVertices; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
+		// New random colors only along with new vertices.
+		helix.colors.resize(helix.Size());
+		for (glm::vec3& color : helix.colors)
+			color = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
 	}
 }
 
@@ -140,30 +134,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// The helix makes its own vertex array and buffers the first time it is drawn.
 
 
 	// Enable depth test.
@@ -218,23 +189,18 @@ void display(void)
 
 	createModel();
 
-	glBindVertexArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, rotAngle += 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
 
+	// Uploads the vertices only if createModel() changed them.
 	if (isWire)
 	{
-		glDrawArrays(GL_LINE_STRIP, 0, numVertices);
+		helix.Draw(GL_LINE_STRIP);
 	}
 	else
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
+		helix.Draw(GL_TRIANGLE_FAN);
 	}
 
 	glColor3f(0.0, 0.0, 0.0);
@@ -242,8 +208,6 @@ void display(void)
 	glRasterPos3f(-0.0, -15.0, -15.0);
 	writeBitmapString((void*)font, (char*)"Helix!");
 
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
 	glutSwapBuffers(); // Instead of double buffering.
 }
 
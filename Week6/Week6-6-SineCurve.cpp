@@ -15,6 +15,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -28,7 +29,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 int deltaTime, currentTime, lastTime = 0;
 
 glm::mat4 mvp, view, projection;
@@ -41,17 +42,12 @@ fragmentShaderId;
 // Globals.
 static float N = 10.0; // # of 2pi curves
 const int MaxNumVertices = 500; // Number of vertices on circle.
-static int numVertices = 3;
 #define PI 3.14159265358979324
 
 float theta = 0.0f;
 
 
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
+Parametric::Curve sine;
 
 // Globals.
 static int isWire = 1; // Is wireframe?
@@ -71,26 +67,22 @@ void writeBitmapString(void* font, char* string)
 
 void createModel()
 {
-	float t; // Angle parameter.
-
-	int i = 0;
-	for (t = -N* PI; t <= N * PI; t += PI / (2.0 * N))
+	// x is squeezed 8 times more than y on screen, so the error is measured in pixels: within a
+	// quarter of one, starting from a segment per half wave so no wave is skipped.
+	Parametric::Tolerance tolerance;
+	tolerance.screenSpace = true;
+	tolerance.error = 0.25f;
+	tolerance.mvp = projection * view;
+	tolerance.viewport = glm::vec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+	tolerance.minSegments = (int)(2 * N);
+	tolerance.maxVertices = MaxNumVertices;
+
+	// Called every frame, but only does any work after N changes.
+	if (sine.Tessellate([](float t) { return glm::vec3(t, sin(t), 0.0f); }, -N * PI, N * PI, tolerance, { N }))
 	{
-		vertices[i] = glm::vec3(t, sin(t), 0);
-		colors[i] = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
-		numVertices = i;
-		i++;
-	}
-
-	for (int i = 0; i < numVertices; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
+		sine.colors.resize(sine.Size());
+		for (glm::vec3& color : sine.colors)
+			color = glm::vec3((float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX, (float)rand() / (float)RAND_MAX);
 	}
 }
 
@@ -119,30 +111,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// The curve makes its own vertex array and buffers the first time it is drawn.
 
 
 	// Enable depth test.
@@ -190,25 +159,18 @@ void display(void)
 
 	createModel();
 
-	glBindVertexArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
 
+	// Uploads the vertices only if createModel() changed them.
 	if (isWire)
 	{
-		glDrawArrays(GL_LINE_STRIP, 0, numVertices);
-		//glDrawElements(GL_LINE_LOOP, numVertices, GL_UNSIGNED_INT, NULL);
+		sine.Draw(GL_LINE_STRIP);
 	}
 	else
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
-		//glDrawElements(GL_TRIANGLE_FAN, numVertices, GL_UNSIGNED_INT, NULL);
+		sine.Draw(GL_TRIANGLE_FAN);
 	}
 
 
@@ -217,8 +179,6 @@ void display(void)
 	glRasterPos3f(15.0, 15.0, 0.0);
 	writeBitmapString((void*)font, (char*)"Sine Curve");
 
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
 	glutSwapBuffers(); // Instead of double buffering.
 }
 
@@ -19,6 +19,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -32,7 +33,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 float rotAngle = 0.0f;
 int deltaTime, currentTime, lastTime = 0;
 
@@ -53,17 +54,13 @@ static float Y = 0.0; // Y-coordinate of center of circle.
 static float A = 5;
 static float B = 10;
 const int MaxNumVertices = 500; // Number of vertices on circle.
-static int numVertices = 3;
+static int numVertices = 3; // Segments the tessellation starts from, +/- to change.
 #define PI 3.14159265358979324
 
 float theta = 0.0f;
 
 
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
+Parametric::Curve ellipse;
 
 // Globals.
 static int isWire = 1; // Is wireframe?
@@ -94,28 +91,21 @@ void writeBitmapString(void* font, char* string)
 
 void createModel(int n)
 {
-	float R = 20.0; // Radius of helix.
-	float t; // Angle parameter.	
-
-	int i = 0;
-	for (t = 0; t <= 2* PI; t += PI / 20.0)
+	// Starts from n segments and adds vertices where the ellipse bends most, until it is within a
+	// quarter pixel on screen. Only does any work when A, B, n or the projection changed.
+	Parametric::Tolerance tolerance;
+	tolerance.screenSpace = true;
+	tolerance.error = 0.25f;
+	tolerance.mvp = projection * view;
+	tolerance.viewport = glm::vec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+	tolerance.minSegments = std::max(n, 3);
+	tolerance.maxVertices = MaxNumVertices;
+
+	//centered at (X,Y), with semi-major axis of length A and semi - minor axis of length B
+	if (ellipse.Tessellate([](float t) { return glm::vec3(X + A * cos(t), Y + B * sin(t), 0.0f); },
+		0.0f, 2.0f * PI, tolerance, { X, Y, A, B }))
 	{
-		//centered at (X,Y), with semi-major axis of length A and semi - minor axis of length B
-		vertices[i] = glm::vec3(X + A * cos(t), Y + B * sin(t), 0.0);
-		colors[i] = unique_colors[0];
-		numVertices = i;
-		i++;
-	}
-
-	for (int i = 0; i < n; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
+		ellipse.colors.assign(ellipse.Size(), unique_colors[0]);
 	}
 }
 
@@ -144,30 +134,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// The ellipse makes its own vertex array and buffers the first time it is drawn.
 
 
 	// Enable depth test.
@@ -214,23 +181,18 @@ void display(void)
 
 	createModel(numVertices);
 
-	glBindVertexArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, rotAngle += 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
 
+	// Uploads the vertices only if createModel() changed them.
 	if (isWire)
 	{
-		glDrawArrays(GL_LINE_LOOP, 0, numVertices);
+		ellipse.Draw(GL_LINE_LOOP);
 	}
 	else
 	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
+		ellipse.Draw(GL_TRIANGLE_FAN);
 	}
 
 	// Write labels.
@@ -238,8 +200,6 @@ void display(void)
 	glRasterPos3f(15.0, 15.0, 0.0);
 	writeBitmapString((void*)font, (char*)"Ellipse");
 
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
 	glutSwapBuffers(); // Instead of double buffering.
 }
 
@@ -5,6 +5,7 @@
 // 
 // Interaction: 
 // @note Press the space bar to toggle between wirefrime and polygon.
+// @note Press +/- to change the number of slices the tessellation starts from.
 // 
 // @author Hooman Salamat
 ///////////////////////////////////////////////////////////////////// 
@@ -16,6 +17,7 @@
 #include <GL/glew.h>
 #include <GL/freeglut.h> 
 #include "prepShader.h"
+#include "Parametric.h"
 #include "glm\glm.hpp"
 #include "glm\gtc\matrix_transform.hpp"
 #include "glm\gtc\type_ptr.hpp"
@@ -29,7 +31,7 @@ using namespace std;
 #define YZ_AXIS glm::vec3(0,1,1)
 #define XZ_AXIS glm::vec3(1,0,1)
 
-GLuint vao, ibo, points_vbo, colors_vbo, modelID, colorID;
+GLuint modelID, colorID;
 float rotAngle = 0.0f;
 int deltaTime, currentTime, lastTime = 0;
 
@@ -47,17 +49,12 @@ fragmentShaderId;
 static float X = 0.0; // X-coordinate of center of circle.
 static float Y = 0.0; // Y-coordinate of center of circle.
 const int MaxNumVertices = 500; // Number of vertices on circle.
-static int numVertices = 0;
 #define PI 3.14159265358979324
 
 float theta = 0.0f;
 
 
-std::array<glm::vec3, MaxNumVertices> vertices = {};
-std::array<glm::vec3, MaxNumVertices> colors = {};
-
-GLfloat shape_vertices[MaxNumVertices][3] = { 0 };
-GLfloat shape_colors[MaxNumVertices][3] = { 0 };
+Parametric::Surface hemisphere;
 
 // Globals.
 static int isWire = 1; // Is wireframe?
@@ -90,40 +87,28 @@ static int p = 10; // Number of longitudinal slices.
 static int q = 10; // Number of latitudinal slices.
 static float Xangle = 0.0, Yangle = 0.0, Zangle = 0.0; // Angles to rotate hemisphere.
 
-void createModel(int n)
+void createModel()
 {
 	// Array of latitudinal triangle strips, each parallel to the equator, stacked one
-	// above the other from the equator to the north pole.
-	for (int j = 0; j < q; j++)
+	// above the other from the equator to the north pole. u goes around the equator and v from
+	// the equator (0) to the pole (1). Starting from p by q slices, more are added where the
+	// outline or the rows stray more than a quarter pixel from the sphere.
+	Parametric::Tolerance tolerance;
+	tolerance.screenSpace = true;
+	tolerance.error = 0.25f;
+	tolerance.mvp = projection * view;
+	tolerance.viewport = glm::vec2(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
+	tolerance.minSegments = p;
+	tolerance.maxVertices = MaxNumVertices;
+
+	// Called every frame, but only does any work after R, p, q or the projection changed.
+	if (hemisphere.Tessellate([](float u, float v) {
+			return glm::vec3(R * cos(v * PI / 2.0) * cos(2.0 * u * PI),
+				R * sin(v * PI / 2.0),
+				-R * cos(v * PI / 2.0) * sin(2.0 * u * PI)); },
+		0.0f, 1.0f, 0.0f, 1.0f, tolerance, q, { R }))
 	{
-		// One latitudinal triangle strip.
-		for (int i = 0; i <= p; i++)
-		{
-			vertices[numVertices] = glm::vec3(R * cos((float)(j + 1) / q * PI / 2.0) * cos(2.0 * (float)i / p * PI),
-				R * sin((float)(j + 1) / q * PI / 2.0),
-				-R * cos((float)(j + 1) / q * PI / 2.0) * sin(2.0 * (float)i / p * PI));
-			colors[numVertices] = unique_colors[0];
-			numVertices++;
-
-			vertices[numVertices] = glm::vec3(R * cos((float)j / q * PI / 2.0) * cos(2.0 * (float)i / p * PI),
-				R * sin((float)j / q * PI / 2.0),
-				-R * cos((float)j / q * PI / 2.0) * sin(2.0 * (float)i / p * PI));
-			colors[numVertices] = unique_colors[0];
-
-			numVertices++;
-		}
-	}
-
-
-	for (int i = 0; i < numVertices; ++i) {
-
-		shape_vertices[i][0] = vertices[i][0];
-		shape_vertices[i][1] = vertices[i][1];
-		shape_vertices[i][2] = vertices[i][2];
-
-		shape_colors[i][0] = colors[i][0];
-		shape_colors[i][1] = colors[i][1];
-		shape_colors[i][2] = colors[i][2];
+		hemisphere.colors.assign(hemisphere.Size(), unique_colors[0]);
 	}
 }
 
@@ -142,8 +127,6 @@ void init(void)
 	modelID = glGetUniformLocation(program, "mvp");
 	colorID = glGetAttribLocation(program, "vertex_color");
 
-	createModel(numVertices);
-
 	//projection = glm::ortho(-2.0f, 2.0f, -2.0f, 2.0f, 0.0f, 4.0f); // In world coordinates
 
 	// Camera matrix
@@ -154,30 +137,7 @@ void init(void)
 	);
 
 
-	vao = 0;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-
-	points_vbo = 0;
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(0);
-
-	colors_vbo = 0;
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	//glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, 0); // Can optionally unbind the buffer to avoid modification.
-
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	// The hemisphere makes its own vertex array and buffers the first time it is drawn.
 
 
 	// Enable depth test.
@@ -222,32 +182,22 @@ void display(void)
 	// Update the ortho projection.
 	projection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, -4.0f, 4.0f);
 
-	glBindVertexArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_vertices), shape_vertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(shape_colors), shape_colors, GL_STATIC_DRAW);
+	createModel();
 
 	//transformObject(0.4f, YZ_AXIS, rotAngle+=((float)45 / (float)1000 * deltaTime), glm::vec3(0.0f, 0.0f, 0.0f));
 	transformObject(1.0f, X_AXIS, rotAngle += 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
 	//Ordering the GPU to start the pipeline
 
-	if (isWire)
-	{
-		glDrawArrays(GL_LINE_LOOP, 0, numVertices);
-	}
-	else
-	{
-		glDrawArrays(GL_TRIANGLE_FAN, 0, numVertices);
-	}
+	// Uploads the vertices only if createModel() changed them.
+	glPolygonMode(GL_FRONT_AND_BACK, isWire ? GL_LINE : GL_FILL);
+	hemisphere.DrawStrips();
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
 	// Write labels.
 	//glColor3f(1.0, 0.0, 0.0);
 	glRasterPos3f(15.0, 15.0, 0.0);
 	writeBitmapString((void*)font, (char*)"Hemisphere");
 
-	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
-
 	glutSwapBuffers(); // Instead of double buffering.
 }
 
@@ -268,12 +218,14 @@ void keyDown(unsigned char key, int x, int y)
 	switch (key)
 	{
 	case '+':
-		numVertices++;
+		p++;
+		q++;
 		// glutPostRedisplay marks the current window as needing to be redisplayed.
 		//glutPostRedisplay();
 		break;
 	case '-':
-		numVertices--;
+		if (p > 3) p--;
+		if (q > 1) q--;
 		//glutPostRedisplay();
 		break;
 	case ' ':
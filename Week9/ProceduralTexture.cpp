@@ -0,0 +1,587 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include "ProceduralTexture.h"
+#include "WorkerPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PROC_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(PROC_SSE2) && (defined(__SSE4_1__) || defined(__AVX__))
+#define PROC_SSE41 1
+#include <smmintrin.h>
+#endif
+
+using namespace std;
+
+static const int TILE_SIZE = 64;
+
+//---------------------------------------------------------------------
+//
+// 4 wide float / int / mask types. The noise functions below are written once against these.
+//
+#if defined(PROC_SSE2)
+struct F4 { __m128 v; };
+struct I4 { __m128i v; };
+struct M4 { __m128 v; };
+
+static inline F4 Set(float a) { return { _mm_set1_ps(a) }; }
+static inline F4 Lanes(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+static inline I4 SetI(uint32_t a) { return { _mm_set1_epi32((int)a) }; }
+static inline F4 operator+(F4 a, F4 b) { return { _mm_add_ps(a.v, b.v) }; }
+static inline F4 operator-(F4 a, F4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+static inline F4 operator*(F4 a, F4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+static inline F4 Min(F4 a, F4 b) { return { _mm_min_ps(a.v, b.v) }; }
+static inline F4 Max(F4 a, F4 b) { return { _mm_max_ps(a.v, b.v) }; }
+static inline F4 Sqrt(F4 a) { return { _mm_sqrt_ps(a.v) }; }
+static inline M4 Greater(F4 a, F4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+static inline F4 Select(M4 m, F4 a, F4 b) { return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; }
+static inline F4 Floor(F4 a)
+{
+#if defined(PROC_SSE41)
+    return { _mm_floor_ps(a.v) };
+#else
+    // Truncate, then step down where truncation rounded a negative value up.
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    return { _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))) };
+#endif
+}
+static inline I4 ToInt(F4 a) { return { _mm_cvttps_epi32(a.v) }; }
+static inline F4 ToFloat(I4 a) { return { _mm_cvtepi32_ps(a.v) }; }
+static inline I4 operator+(I4 a, I4 b) { return { _mm_add_epi32(a.v, b.v) }; }
+static inline I4 operator^(I4 a, I4 b) { return { _mm_xor_si128(a.v, b.v) }; }
+static inline I4 operator&(I4 a, I4 b) { return { _mm_and_si128(a.v, b.v) }; }
+static inline I4 operator|(I4 a, I4 b) { return { _mm_or_si128(a.v, b.v) }; }
+static inline I4 operator>>(I4 a, int n) { return { _mm_srli_epi32(a.v, n) }; }
+static inline I4 operator<<(I4 a, int n) { return { _mm_slli_epi32(a.v, n) }; }
+static inline I4 operator*(I4 a, I4 b)
+{
+#if defined(PROC_SSE41)
+    return { _mm_mullo_epi32(a.v, b.v) };
+#else
+    // SSE2 only multiplies lanes 0 and 2, do the odd lanes shifted down and interleave.
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a.v, 4), _mm_srli_si128(b.v, 4));
+    return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+#endif
+}
+static inline void Store(I4 a, uint32_t* dst) { _mm_storeu_si128((__m128i*)dst, a.v); }
+#else
+struct F4 { float v[4]; };
+struct I4 { uint32_t v[4]; };
+struct M4 { bool v[4]; };
+
+#define PROC_LANES(expr) for (int k = 0; k < 4; k++) r.v[k] = expr; return r
+static inline F4 Set(float a) { return { { a, a, a, a } }; }
+static inline F4 Lanes(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+static inline I4 SetI(uint32_t a) { return { { a, a, a, a } }; }
+static inline F4 operator+(F4 a, F4 b) { F4 r; PROC_LANES(a.v[k] + b.v[k]); }
+static inline F4 operator-(F4 a, F4 b) { F4 r; PROC_LANES(a.v[k] - b.v[k]); }
+static inline F4 operator*(F4 a, F4 b) { F4 r; PROC_LANES(a.v[k] * b.v[k]); }
+static inline F4 Min(F4 a, F4 b) { F4 r; PROC_LANES(min(a.v[k], b.v[k])); }
+static inline F4 Max(F4 a, F4 b) { F4 r; PROC_LANES(max(a.v[k], b.v[k])); }
+static inline F4 Sqrt(F4 a) { F4 r; PROC_LANES(sqrt(a.v[k])); }
+static inline M4 Greater(F4 a, F4 b) { M4 r; PROC_LANES(a.v[k] > b.v[k]); }
+static inline F4 Select(M4 m, F4 a, F4 b) { F4 r; PROC_LANES(m.v[k] ? a.v[k] : b.v[k]); }
+static inline F4 Floor(F4 a) { F4 r; PROC_LANES(floor(a.v[k])); }
+static inline I4 ToInt(F4 a) { I4 r; PROC_LANES((uint32_t)(int32_t)a.v[k]); }
+static inline F4 ToFloat(I4 a) { F4 r; PROC_LANES((float)(int32_t)a.v[k]); }
+static inline I4 operator+(I4 a, I4 b) { I4 r; PROC_LANES(a.v[k] + b.v[k]); }
+static inline I4 operator^(I4 a, I4 b) { I4 r; PROC_LANES(a.v[k] ^ b.v[k]); }
+static inline I4 operator&(I4 a, I4 b) { I4 r; PROC_LANES(a.v[k] & b.v[k]); }
+static inline I4 operator|(I4 a, I4 b) { I4 r; PROC_LANES(a.v[k] | b.v[k]); }
+static inline I4 operator>>(I4 a, int n) { I4 r; PROC_LANES(a.v[k] >> n); }
+static inline I4 operator<<(I4 a, int n) { I4 r; PROC_LANES(a.v[k] << n); }
+static inline I4 operator*(I4 a, I4 b) { I4 r; PROC_LANES(a.v[k] * b.v[k]); }
+static inline void Store(I4 a, uint32_t* dst) { memcpy(dst, a.v, 16); }
+#undef PROC_LANES
+#endif
+
+static inline F4 Clamp01(F4 a) { return Min(Max(a, Set(0.0f)), Set(1.0f)); }
+
+//---------------------------------------------------------------------
+//
+// Noise. Lattice values come from an integer hash instead of a permutation table,
+// so there is nothing to gather and every lane runs the same instructions.
+//
+static const uint32_t HASH_X = 0x8da6b343u, HASH_Y = 0xd8163841u;
+
+//! x and y come premultiplied by HASH_X / HASH_Y, so neighbouring cells are one add away.
+static inline I4 Hash(I4 xm, I4 ym, I4 seed)
+{
+    I4 h = xm + ym + seed;
+    h = h ^ (h >> 15);
+    h = h * SetI(0x2c1b3c6du);
+    h = h ^ (h >> 12);
+    h = h * SetI(0x297a2d39u);
+    return h ^ (h >> 15);
+}
+
+//! Top 24 bits as [0, 1).
+static inline F4 HashToUnit(I4 h) { return ToFloat(h >> 8) * Set(1.0f / 16777216.0f); }
+//! Low and high 16 bits as [-1, 1].
+static inline F4 HashLowSigned(I4 h) { return ToFloat(h & SetI(0xFFFF)) * Set(2.0f / 65535.0f) - Set(1.0f); }
+static inline F4 HashHighSigned(I4 h) { return ToFloat(h >> 16) * Set(2.0f / 65535.0f) - Set(1.0f); }
+
+static F4 ValueNoise(F4 x, F4 y, I4 seed)
+{
+    F4 fx = Floor(x), fy = Floor(y);
+    I4 ix = ToInt(fx) * SetI(HASH_X), iy = ToInt(fy) * SetI(HASH_Y);
+    I4 ix1 = ix + SetI(HASH_X), iy1 = iy + SetI(HASH_Y);
+    F4 tx = x - fx, ty = y - fy;
+    F4 ux = tx * tx * (Set(3.0f) - tx - tx);
+    F4 uy = ty * ty * (Set(3.0f) - ty - ty);
+    F4 a = HashToUnit(Hash(ix, iy, seed));
+    F4 b = HashToUnit(Hash(ix1, iy, seed));
+    F4 c = HashToUnit(Hash(ix, iy1, seed));
+    F4 d = HashToUnit(Hash(ix1, iy1, seed));
+    F4 bottom = a + (b - a) * ux;
+    F4 top = c + (d - c) * ux;
+    return bottom + (top - bottom) * uy;
+}
+
+static inline F4 SimplexCorner(F4 x, F4 y, I4 h)
+{
+    F4 t = Max(Set(0.5f) - x * x - y * y, Set(0.0f));
+    t = t * t;
+    return t * t * (HashLowSigned(h) * x + HashHighSigned(h) * y);
+}
+
+static F4 SimplexNoise(F4 x, F4 y, I4 seed)
+{
+    const float F2 = 0.36602540378f, G2 = 0.21132486540f;
+    F4 s = (x + y) * Set(F2);
+    F4 i = Floor(x + s), j = Floor(y + s);
+    F4 t = (i + j) * Set(G2);
+    F4 x0 = x - (i - t), y0 = y - (j - t);
+    // Lower or upper triangle of the skewed cell.
+    F4 i1 = Select(Greater(x0, y0), Set(1.0f), Set(0.0f));
+    F4 j1 = Set(1.0f) - i1;
+    F4 x1 = x0 - i1 + Set(G2), y1 = y0 - j1 + Set(G2);
+    F4 x2 = x0 - Set(1.0f - 2.0f * G2), y2 = y0 - Set(1.0f - 2.0f * G2);
+
+    I4 ii = ToInt(i) * SetI(HASH_X), jj = ToInt(j) * SetI(HASH_Y);
+    I4 di = ToInt(i1) * SetI(HASH_X), dj = ToInt(j1) * SetI(HASH_Y);
+    F4 n = SimplexCorner(x0, y0, Hash(ii, jj, seed)) +
+           SimplexCorner(x1, y1, Hash(ii + di, jj + dj, seed)) +
+           SimplexCorner(x2, y2, Hash(ii + SetI(HASH_X), jj + SetI(HASH_Y), seed));
+    // Gradients are random in [-1, 1]^2 rather than unit length; this scale spans [0, 1] with little clipping.
+    return Clamp01(Set(0.5f) + n * Set(45.0f));
+}
+
+static F4 VoronoiNoise(F4 x, F4 y, I4 seed)
+{
+    F4 fx = Floor(x), fy = Floor(y);
+    I4 ix = ToInt(fx) * SetI(HASH_X), iy = ToInt(fy) * SetI(HASH_Y);
+    F4 tx = x - fx, ty = y - fy;
+    F4 best = Set(8.0f);
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            I4 h = Hash(ix + SetI((uint32_t)dx * HASH_X), iy + SetI((uint32_t)dy * HASH_Y), seed);
+            // Feature point anywhere in the neighbouring cell.
+            F4 px = Set((float)dx) + (HashLowSigned(h) * Set(0.5f) + Set(0.5f)) - tx;
+            F4 py = Set((float)dy) + (HashHighSigned(h) * Set(0.5f) + Set(0.5f)) - ty;
+            best = Min(best, px * px + py * py);
+        }
+    }
+    return Clamp01(Sqrt(best));
+}
+
+struct ValueBasis { F4 operator()(F4 x, F4 y, I4 seed) const { return ValueNoise(x, y, seed); } };
+struct SimplexBasis { F4 operator()(F4 x, F4 y, I4 seed) const { return SimplexNoise(x, y, seed); } };
+struct VoronoiBasis { F4 operator()(F4 x, F4 y, I4 seed) const { return VoronoiNoise(x, y, seed); } };
+
+//! How much of a pattern with `periodsPerTexel` survives at this level: all of it up to 1/4, none at 1/2 (Nyquist).
+static inline float BandLimit(float periodsPerTexel)
+{
+    return min(max(2.0f - 4.0f * periodsPerTexel, 0.0f), 1.0f);
+}
+
+//! Integral of a 0/1 square wave with period 2 (0 on [0, 1), 1 on [1, 2)).
+static inline F4 SquareIntegral(F4 x)
+{
+    F4 h = x * Set(0.5f);
+    F4 f = Floor(h);
+    return f + Max(h - f - Set(0.5f), Set(0.0f)) * Set(2.0f);
+}
+
+//---------------------------------------------------------------------
+//
+// Patterns. Each one is set up once per tile for a level and then called per 4 pixels,
+// so the pattern switch and the per level constants stay out of the pixel loop.
+//
+struct CheckerPattern
+{
+    F4 frequency, hx, hy, invWx, invWy;
+
+    CheckerPattern(const ProceduralDesc& desc, float texelU, float texelV)
+    {
+        float wx = texelU * desc.frequency, wy = texelV * desc.frequency;
+        frequency = Set(desc.frequency);
+        hx = Set(0.5f * wx);
+        hy = Set(0.5f * wy);
+        invWx = Set(1.0f / wx);
+        invWy = Set(1.0f / wy);
+    }
+
+    // Box filtered over the texel, so every level is the exact average of level 0 and edges don't crawl.
+    F4 operator()(F4 u, F4 v) const
+    {
+        F4 x = u * frequency, y = v * frequency;
+        F4 cx = (SquareIntegral(x + hx) - SquareIntegral(x - hx)) * invWx;
+        F4 cy = (SquareIntegral(y + hy) - SquareIntegral(y - hy)) * invWy;
+        // XOR of the two square waves, in averages.
+        return cx + cy - cx * cy * Set(2.0f);
+    }
+};
+
+struct GradientPattern
+{
+    F4 operator()(F4 u, F4) const { return Clamp01(u); }
+};
+
+// Past Nyquist a single octave fades to its average instead of aliasing.
+template <class Basis>
+struct NoisePattern
+{
+    F4 frequency, keep;
+    I4 seed;
+
+    NoisePattern(const ProceduralDesc& desc, float texel, I4 levelSeed)
+    {
+        frequency = Set(desc.frequency);
+        keep = Set(BandLimit(desc.frequency * texel));
+        seed = levelSeed;
+    }
+
+    F4 operator()(F4 u, F4 v) const
+    {
+        return Set(0.5f) + (Basis()(u * frequency, v * frequency, seed) - Set(0.5f)) * keep;
+    }
+};
+
+// Octaves the level can't show are dropped, the rest fade out towards Nyquist.
+template <class Basis>
+struct FbmPattern
+{
+    enum { MAX_OCTAVES = 16 };
+    F4 frequency[MAX_OCTAVES], weight[MAX_OCTAVES];
+    I4 seed[MAX_OCTAVES];
+    int octaves = 0;
+    float total = 0.0f;
+
+    FbmPattern(const ProceduralDesc& desc, float texel, I4 levelSeed)
+    {
+        float f = desc.frequency, amplitude = 1.0f;
+        for (int octave = 0; octave < min(desc.octaves, (int)MAX_OCTAVES); octave++)
+        {
+            total += amplitude;
+            float keep = BandLimit(f * texel);
+            if (keep > 0.0f)
+            {
+                frequency[octaves] = Set(f);
+                weight[octaves] = Set(amplitude * keep);
+                seed[octaves] = levelSeed + SetI((uint32_t)octave * 0x9E3779B9u);
+                octaves++;
+            }
+            f *= desc.lacunarity;
+            amplitude *= desc.gain;
+        }
+        total = total > 0.0f ? 2.0f / total : 0.0f;
+    }
+
+    F4 operator()(F4 u, F4 v) const
+    {
+        F4 sum = Set(0.0f);
+        for (int i = 0; i < octaves; i++)
+            sum = sum + (Basis()(u * frequency[i], v * frequency[i], seed[i]) - Set(0.5f)) * weight[i];
+        return Clamp01(Set(0.5f) + sum * Set(total));
+    }
+};
+
+//---------------------------------------------------------------------
+//
+// Tile evaluation
+//
+template <class Pattern>
+static void FillTile(const Pattern& pattern, const ProceduralDesc& desc, float texelU, float texelV,
+                     int x0, int y0, int w, int h, unsigned char* dst, size_t dstPitch)
+{
+    F4 a[4], d[4];
+    for (int c = 0; c < 4; c++)
+    {
+        a[c] = Set(desc.colorA[c] + 0.5f); // + 0.5 rounds on conversion.
+        d[c] = Set((float)desc.colorB[c] - desc.colorA[c]);
+    }
+    const F4 step = Lanes(0.0f, texelU, 2.0f * texelU, 3.0f * texelU);
+
+    for (int y = 0; y < h; y++)
+    {
+        F4 v = Set((y0 + y + 0.5f) * texelV);
+        unsigned char* row = dst + (size_t)y * dstPitch;
+        for (int x = 0; x < w; x += 4)
+        {
+            F4 u = Set((x0 + x + 0.5f) * texelU) + step;
+            F4 t = pattern(u, v);
+
+            // Blend and pack RGBA into one 32 bit word per pixel.
+            I4 packed = ToInt(a[0] + d[0] * t) | (ToInt(a[1] + d[1] * t) << 8) |
+                        (ToInt(a[2] + d[2] * t) << 16) | (ToInt(a[3] + d[3] * t) << 24);
+            if (x + 4 <= w)
+                Store(packed, (uint32_t*)(row + (size_t)x * 4));
+            else
+            {
+                uint32_t out[4];
+                Store(packed, out);
+                memcpy(row + (size_t)x * 4, out, (size_t)(w - x) * 4);
+            }
+        }
+    }
+}
+
+template <template <class> class Pattern>
+static void FillNoiseTile(ProceduralPattern basis, const ProceduralDesc& desc, float texelU, float texelV, I4 seed,
+                          int x0, int y0, int w, int h, unsigned char* dst, size_t dstPitch)
+{
+    float texel = max(texelU, texelV);
+    switch (basis)
+    {
+    case PROC_VALUE_NOISE:
+        FillTile(Pattern<ValueBasis>(desc, texel, seed), desc, texelU, texelV, x0, y0, w, h, dst, dstPitch);
+        break;
+    case PROC_VORONOI:
+        FillTile(Pattern<VoronoiBasis>(desc, texel, seed), desc, texelU, texelV, x0, y0, w, h, dst, dstPitch);
+        break;
+    default:
+        FillTile(Pattern<SimplexBasis>(desc, texel, seed), desc, texelU, texelV, x0, y0, w, h, dst, dstPitch);
+        break;
+    }
+}
+
+void GenerateProceduralTile(const ProceduralDesc& desc, int level, int x0, int y0, int w, int h,
+                            unsigned char* dst, size_t dstPitch)
+{
+    int levelW = max(1, desc.width >> level), levelH = max(1, desc.height >> level);
+    float texelU = 1.0f / levelW, texelV = 1.0f / levelH;
+    I4 seed = SetI(desc.seed * 0x632BE5ABu);
+
+    switch (desc.pattern)
+    {
+    case PROC_CHECKER:
+        FillTile(CheckerPattern(desc, texelU, texelV), desc, texelU, texelV, x0, y0, w, h, dst, dstPitch);
+        break;
+    case PROC_GRADIENT:
+        FillTile(GradientPattern(), desc, texelU, texelV, x0, y0, w, h, dst, dstPitch);
+        break;
+    case PROC_FBM:
+        FillNoiseTile<FbmPattern>(desc.basis, desc, texelU, texelV, seed, x0, y0, w, h, dst, dstPitch);
+        break;
+    default:
+        FillNoiseTile<NoisePattern>(desc.pattern, desc, texelU, texelV, seed, x0, y0, w, h, dst, dstPitch);
+        break;
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Whole images
+//
+size_t ProceduralImage::Bytes() const
+{
+    size_t bytes = 0;
+    for (const vector<unsigned char>& level : levels)
+        bytes += level.size();
+    return bytes;
+}
+
+int ProceduralMipLevels(int width, int height)
+{
+    int levels = 1;
+    while ((width >> levels) > 0 || (height >> levels) > 0)
+        levels++;
+    return levels;
+}
+
+ProceduralImage GenerateProceduralTexture(const ProceduralDesc& desc, int levels)
+{
+    ProceduralImage image;
+    image.width = desc.width;
+    image.height = desc.height;
+    int fullChain = ProceduralMipLevels(desc.width, desc.height);
+    levels = levels <= 0 ? fullChain : min(levels, fullChain);
+    image.levels.resize(levels);
+
+    struct Tile { int level, x, y; };
+    vector<Tile> tiles;
+    for (int level = 0; level < levels; level++)
+    {
+        int w = image.LevelWidth(level), h = image.LevelHeight(level);
+        image.levels[level].resize((size_t)w * h * 4);
+        for (int y = 0; y < h; y += TILE_SIZE)
+            for (int x = 0; x < w; x += TILE_SIZE)
+                tiles.push_back({ level, x, y });
+    }
+
+    function<void(int)> job = [&](int i) {
+        const Tile& tile = tiles[i];
+        int w = image.LevelWidth(tile.level), h = image.LevelHeight(tile.level);
+        size_t pitch = (size_t)w * 4;
+        GenerateProceduralTile(desc, tile.level, tile.x, tile.y, min(TILE_SIZE, w - tile.x), min(TILE_SIZE, h - tile.y),
+                               &image.levels[tile.level][tile.y * pitch + (size_t)tile.x * 4], pitch);
+    };
+    WorkerPool::Shared().Run((int)tiles.size(), job);
+    return image;
+}
+
+const char* ProceduralPath()
+{
+#if defined(PROC_SSE41)
+    return "SSE4.1";
+#elif defined(PROC_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+//---------------------------------------------------------------------
+//
+// ProceduralTextureCache
+//
+bool ProceduralDesc::operator==(const ProceduralDesc& o) const
+{
+    return pattern == o.pattern && width == o.width && height == o.height && frequency == o.frequency &&
+           seed == o.seed && basis == o.basis && octaves == o.octaves && lacunarity == o.lacunarity &&
+           gain == o.gain && memcmp(colorA, o.colorA, 4) == 0 && memcmp(colorB, o.colorB, 4) == 0;
+}
+
+// FNV-1a over each field, never over the struct bytes (padding is garbage).
+static void HashBytes(uint64_t& h, const void* data, size_t size)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+        h = (h ^ p[i]) * 0x100000001b3ull;
+}
+
+uint64_t ProceduralTextureCache::Hash(const ProceduralDesc& d, int levels)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    int pattern = d.pattern, basis = d.basis;
+    HashBytes(h, &pattern, sizeof(pattern));
+    HashBytes(h, &d.width, sizeof(d.width));
+    HashBytes(h, &d.height, sizeof(d.height));
+    HashBytes(h, &d.frequency, sizeof(d.frequency));
+    HashBytes(h, &d.seed, sizeof(d.seed));
+    HashBytes(h, &basis, sizeof(basis));
+    HashBytes(h, &d.octaves, sizeof(d.octaves));
+    HashBytes(h, &d.lacunarity, sizeof(d.lacunarity));
+    HashBytes(h, &d.gain, sizeof(d.gain));
+    HashBytes(h, d.colorA, 4);
+    HashBytes(h, d.colorB, 4);
+    HashBytes(h, &levels, sizeof(levels));
+    return h;
+}
+
+ProceduralTextureCache::ProceduralTextureCache(size_t budgetBytes)
+{
+    m_budget = budgetBytes;
+}
+
+const ProceduralImage* ProceduralTextureCache::Get(const ProceduralDesc& desc, int levels)
+{
+    uint64_t key = Hash(desc, levels);
+    auto found = m_entries.find(key);
+    if (found != m_entries.end() && found->second.desc == desc && found->second.levels == levels)
+    {
+        found->second.lastUsed = ++m_clock;
+        m_hits++;
+        return &found->second.image;
+    }
+    m_misses++;
+
+    // A different desc with the same hash just gets replaced.
+    if (found != m_entries.end())
+    {
+        m_bytes -= found->second.image.Bytes();
+        m_entries.erase(found);
+    }
+
+    Entry entry;
+    entry.desc = desc;
+    entry.levels = levels;
+    entry.image = GenerateProceduralTexture(desc, levels);
+    entry.lastUsed = ++m_clock;
+    Evict(entry.image.Bytes());
+    m_bytes += entry.image.Bytes();
+    return &(m_entries[key] = std::move(entry)).image;
+}
+
+void ProceduralTextureCache::Clear()
+{
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+void ProceduralTextureCache::Evict(size_t incoming)
+{
+    while (!m_entries.empty() && m_bytes + incoming > m_budget)
+    {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+            if (it->second.lastUsed < oldest->second.lastUsed)
+                oldest = it;
+        m_bytes -= oldest->second.image.Bytes();
+        m_entries.erase(oldest);
+    }
+}
+
+//---------------------------------------------------------------------
+//
+// Benchmark
+//
+void ProceduralBenchmark(std::ostream& out)
+{
+    typedef chrono::high_resolution_clock Clock;
+    const int size = 8192;
+    const int threads = WorkerPool::Shared().Workers() + 1;
+    out << "Procedural texture benchmark: " << size << " x " << size << " RGBA8, " << ProceduralPath() << ", "
+        << threads << (threads == 1 ? " thread." : " threads.") << endl;
+
+    // The floor: new memory the size of the image, written once. Generating can't beat that.
+    for (int levels : { 1, 0 })
+    {
+        ProceduralImage image;
+        image.width = image.height = size;
+        const int count = levels == 0 ? ProceduralMipLevels(size, size) : 1;
+        const auto start = Clock::now();
+        for (int level = 0; level < count; level++)
+            image.levels.emplace_back((size_t)image.LevelWidth(level) * image.LevelHeight(level) * 4, (unsigned char)0xFF);
+        out << "  allocate and fill" << (levels == 0 ? ", mips" : "") << ": "
+            << chrono::duration<double, milli>(Clock::now() - start).count() << " ms" << endl;
+    }
+
+    const char* names[] = { "checker", "gradient", "value noise", "simplex", "fBm (5 simplex octaves)", "Voronoi" };
+    for (ProceduralPattern pattern : { PROC_CHECKER, PROC_GRADIENT, PROC_VALUE_NOISE, PROC_SIMPLEX, PROC_FBM, PROC_VORONOI })
+    {
+        ProceduralDesc desc;
+        desc.pattern = pattern;
+        desc.width = desc.height = size;
+        desc.frequency = 32.0f;
+        double milliseconds[2];
+        for (int levels : { 1, 0 })
+        {
+            const auto start = Clock::now();
+            ProceduralImage image = GenerateProceduralTexture(desc, levels);
+            milliseconds[levels == 0] = chrono::duration<double, milli>(Clock::now() - start).count();
+        }
+        out << "  " << names[pattern] << ": " << milliseconds[0] << " ms, " << milliseconds[1] << " ms with mips, "
+            << (double)size * size / milliseconds[0] / 1000.0 << " Mpixels/s ("
+            << (double)size * size / milliseconds[0] / 1000.0 / threads << " a thread)" << endl;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include <unordered_map>
+
+/// @file ProceduralTexture.h
+/// @brief Procedural RGBA8 images: checker, gradient, value noise, simplex noise, fBm and Voronoi.
+/// Images are cut into 64x64 tiles that are spread over the shared WorkerPool, and every tile is
+/// evaluated 4 pixels at a time with SSE2 (scalar loops when SSE2 isn't available).
+/// Mip levels are evaluated directly at their own size with the pattern band-limited to what the
+/// level can show, so there is no glGenerateMipmap pass and no aliasing from point sampling noise.
+
+enum ProceduralPattern
+{
+    PROC_CHECKER,
+    PROC_GRADIENT,       // Left to right, colorA to colorB.
+    PROC_VALUE_NOISE,
+    PROC_SIMPLEX,
+    PROC_FBM,            // Octaves of `basis`.
+    PROC_VORONOI         // Distance to the nearest feature point.
+};
+
+struct ProceduralDesc
+{
+    ProceduralPattern pattern = PROC_CHECKER;
+    int width = 64, height = 64;
+    float frequency = 8.0f;             // Checks, cells or noise periods across the texture.
+    unsigned seed = 1;
+    // fBm.
+    ProceduralPattern basis = PROC_SIMPLEX;
+    int octaves = 5;
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+    // The pattern value (0 - 1) blends between these two colors.
+    unsigned char colorA[4] = { 0xFF, 0x00, 0x00, 0xFF };
+    unsigned char colorB[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    bool operator==(const ProceduralDesc& other) const;
+};
+
+/// @brief Generated pixels, level 0 first. Level i is max(1, width >> i) by max(1, height >> i),
+/// rows bottom to top like everything else handed to glTexImage2D.
+struct ProceduralImage
+{
+    int width = 0, height = 0;
+    std::vector<std::vector<unsigned char>> levels;
+
+    int LevelWidth(int level) const { return width >> level > 0 ? width >> level : 1; }
+    int LevelHeight(int level) const { return height >> level > 0 ? height >> level : 1; }
+    size_t Bytes() const;
+};
+
+//! Levels of a full mip chain for a width x height image.
+int ProceduralMipLevels(int width, int height);
+
+/// @brief Generates levels mip levels (0 = full chain) on all cores.
+ProceduralImage GenerateProceduralTexture(const ProceduralDesc& desc, int levels = 1);
+
+/// @brief Evaluates one rectangle of one level on the calling thread.
+/// dst points at pixel (x0, y0) of the level, dstPitch is the level's row size in bytes.
+void GenerateProceduralTile(const ProceduralDesc& desc, int level, int x0, int y0, int w, int h,
+                            unsigned char* dst, size_t dstPitch);
+
+//! Name of the code path compiled in ("SSE4.1", "SSE2" or "scalar").
+const char* ProceduralPath();
+
+/// @brief Times every pattern at 8192 x 8192 with and without its mip chain, next to the time it takes
+/// just to allocate and fill that many bytes, and prints the lot to out.
+void ProceduralBenchmark(std::ostream& out);
+
+/// @brief Keeps generated images by a hash of their parameters so scenes that ask for the same
+/// pattern twice (or a demo that rebuilds on a key press) don't pay for it again.
+/// @note: a returned pointer stays valid until the entry gets evicted by a later Get or Clear.
+class ProceduralTextureCache
+{
+public:
+    explicit ProceduralTextureCache(size_t budgetBytes = 256 * 1024 * 1024);
+
+    const ProceduralImage* Get(const ProceduralDesc& desc, int levels = 1);
+    void Clear();
+
+    size_t Bytes() const { return m_bytes; }
+    int Hits() const { return m_hits; }
+    int Misses() const { return m_misses; }
+
+    static uint64_t Hash(const ProceduralDesc& desc, int levels);
+
+private:
+    struct Entry
+    {
+        ProceduralDesc desc;
+        int levels;
+        ProceduralImage image;
+        unsigned lastUsed;
+    };
+    //! Drops least recently used entries until m_bytes + incoming fits the budget.
+    void Evict(size_t incoming);
+
+    std::unordered_map<uint64_t, Entry> m_entries;
+    size_t m_budget;
+    size_t m_bytes = 0;
+    unsigned m_clock = 0;
+    int m_hits = 0, m_misses = 0;
+};
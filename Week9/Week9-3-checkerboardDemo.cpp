@@ -2,6 +2,7 @@
 /////////////////////////////////////////////////////////////////////         
 // @file Week9-3-checkerboardDemo.cpp
 // @brief checkerboard
+// @note Run with --procedural-bench to time the procedural texture generator at 8192 x 8192 without a window.
 // 
 // @author: Hooman Salamat
 ///////////////////////////////////////////////////////////////////// 
@@ -85,6 +86,7 @@
 #include "glm\gtc\type_ptr.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "ProceduralTexture.h"
 #include <array>
 using namespace std;
 
@@ -178,7 +180,7 @@ program,
 vertexShaderId,
 fragmentShaderId;
 
-static unsigned char chessboard[64][64][4]; // Storage for chessboard image.
+static ProceduralImage chessboard; // Chessboard image, every mip level.
 
 
 // Globals.
@@ -194,26 +196,15 @@ void resetView()
 }
 
 // Create 64 x 64 RGBA image of a chessboard.
-//j=0-7 black, j=8-15 white, j=16-23 black, j=24-31 white
+//j=0-7 red, j=8-15 white, j=16-23 red, j=24-31 white
+//The generator box filters each level itself, so the whole mip chain comes out of one call.
 void createChessboard(void)
 {
-	int i, j;
-	for (i = 0; i < 64; i++)
-		for (j = 0; j < 64; j++)
-			if ((((i / 8) % 2) && ((j / 8) % 2)) || (!((i / 8) % 2) && !((j / 8) % 2)))
-			{
-				chessboard[i][j][0] = 0xFF;
-				chessboard[i][j][1] = 0x00;
-				chessboard[i][j][2] = 0x00;
-				chessboard[i][j][3] = 0xFF;
-			}
-			else
-			{
-				chessboard[i][j][0] = 0xFF;
-				chessboard[i][j][1] = 0xFF;
-				chessboard[i][j][2] = 0xFF;
-				chessboard[i][j][3] = 0xFF;
-			}
+	ProceduralDesc desc;
+	desc.pattern = PROC_CHECKER;
+	desc.width = desc.height = 64;
+	desc.frequency = 8.0f; // 8 squares per side, 8 x 8 pixels each.
+	chessboard = GenerateProceduralTexture(desc, 0);
 }
 
 void loadTexture()
@@ -237,9 +228,10 @@ void loadTexture()
 	// Generate internal texture.
 	createChessboard();
 
-	// Specify image data for currently active texture object.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 
-		64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, chessboard);
+	// Specify image data for currently active texture object, one call per mip level.
+	for (int level = 0; level < (int)chessboard.levels.size(); level++)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, chessboard.LevelWidth(level), chessboard.LevelHeight(level),
+			0, GL_RGBA, GL_UNSIGNED_BYTE, &chessboard.levels[level][0]);
 
 	// Set texture parameters for wrapping.
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -257,7 +249,6 @@ void loadTexture()
 
 
 	glUniform1i(glGetUniformLocation(program, "texture0"), 0);
-	glGenerateMipmap(GL_TEXTURE_2D);
 
 	// Clean up. But we don't want to unbind the texture or we cannot use it.
 	//stbi_image_free(image);
@@ -476,6 +467,11 @@ void clean()
 int main(int argc, char** argv)
 {
 	glutInit(&argc, argv);
+	if (argc > 1 && string(argv[1]) == "--procedural-bench")
+	{
+		ProceduralBenchmark(cout);
+		return 0;
+	}
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
 	glutInitWindowSize(1024, 768);
 	glutCreateWindow("Texture Demo 1");
@@ -5,6 +5,8 @@
 // 
 // Interaction:
 // Press the up and down arrow keys to move the viewpoint over the field.
+// Press + and - to double and halve the number of trees, v to show or hide them.
+// Run with --vegetation-bench to time culling against tree count without a window.
 // @author: Hooman Salamat
 /////////////////////////////////////////////////////////////////////
  
@@ -20,6 +22,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include <array>
+#include <algorithm>
+#include "Vegetation.h"
 using namespace std;
 
 #define X_AXIS glm::vec3(1,0,0)
@@ -60,6 +64,12 @@ GLint width, height, bitDepth;
 
 static float d = 0.0; // Distance parameter in gluLookAt().
 
+// Trees scattered over the field, which is 80 x 80 once scaled.
+Vegetation vegetation;
+VegetationDesc vegetationDesc;
+bool showVegetation = true;
+int statsTime = 0;
+
 
 GLshort cube_indices[] = {
 	// Front.
@@ -250,6 +260,11 @@ void init(void)
 
 	createBuffer();
 
+	vegetation.Scatter(vegetationDesc);
+	vegetation.Init("Media/trees.bmp");
+	vegetation.Stats().Print(cout);
+	cout << "Scattered in " << vegetation.Stats().scatterMilliseconds << " ms." << endl;
+
 	// Enable depth test.
 	glEnable(GL_DEPTH_TEST);
 
@@ -323,7 +338,24 @@ void display(void)
 
 	glBindVertexArray(0); // Can optionally unbind the vertex array to avoid modification.
 
-
+	if (showVegetation)
+	{
+		const glm::vec3 eye(0.0f, 10.0f, 15.0f + d);
+		vegetation.Cull(projection * view, eye);
+		vegetation.Draw(projection * view, eye);
+		glUseProgram(program);
+
+		// Numbers once a second.
+		vegetation.Stats().frameMilliseconds = deltaTime;
+		if (currentTime - statsTime > 1000)
+		{
+			vegetation.Stats().Print(cout);
+			statsTime = currentTime;
+		}
+		// Keep drawing until every visible cell is in the instance buffer.
+		if (vegetation.Stats().pendingCells > vegetation.Stats().uploadedCells)
+			glutPostRedisplay();
+	}
 
 	glutSwapBuffers(); // Now for a potentially smoother render.
 }
@@ -336,6 +368,17 @@ void keyInput(unsigned char key, int x, int y)
 	case 27:
 		exit(0);
 		break;
+	case '+':
+	case '-':
+		vegetationDesc.count = key == '+' ? min(vegetationDesc.count * 2, (size_t)4000000) : max(vegetationDesc.count / 2, (size_t)1000);
+		vegetation.Scatter(vegetationDesc);
+		cout << "Scattered " << vegetation.Stats().instances << " trees in " << vegetation.Stats().scatterMilliseconds << " ms." << endl;
+		glutPostRedisplay();
+		break;
+	case 'v':
+		showVegetation = !showVegetation;
+		glutPostRedisplay();
+		break;
 	default:
 		break;
 	}
@@ -354,11 +397,17 @@ void printInteraction(void)
 {
 	std::cout << "Interaction:" << std::endl;
 	std::cout << "Press the up and down arrow keys to move the viewpoint over the field." << std::endl;
+	std::cout << "Press + and - to double and halve the number of trees, v to show or hide them." << std::endl;
 }
 
 // Main routine.
 int main(int argc, char** argv)
 {
+	if (argc > 1 && string(argv[1]) == "--vegetation-bench")
+	{
+		Vegetation::Benchmark(cout);
+		return 0;
+	}
 	printInteraction();
 	glutInit(&argc, argv);
 
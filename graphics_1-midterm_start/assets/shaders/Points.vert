@@ -0,0 +1,16 @@
+#version 330 core
+// One float per stream of a Vertices block, see Vertices.h
+layout (location = 0) in float aX;
+layout (location = 1) in float aY;
+layout (location = 2) in float aZ;
+layout (location = 3) in float aR;
+layout (location = 4) in float aG;
+layout (location = 5) in float aB;
+
+out vec3 color;
+
+void main()
+{
+   color = vec3(aR, aG, aB);
+   gl_Position = vec4(aX, aY, aZ, 1.0);
+}
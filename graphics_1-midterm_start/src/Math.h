@@ -1,6 +1,11 @@
 #pragma once
-#include <corecrt_math.h>
+#include <cmath>
 #include <cstdlib>
+#include "MathSimd.h"
+#include "Random.h"
+
+// No FMA contraction, so the batch functions match the scalar ones bit for bit (see MathSimd.h).
+MATH_CONTRACT_OFF
 
 //----------------------------------------------------------------------------------
 // Defines and Macros
@@ -96,10 +101,10 @@ typedef struct float16 {
 // Module Functions Definition - Utils math
 //----------------------------------------------------------------------------------
 
-// Random value between min and max (can be negative)
+// Random value between min and max (can be negative), from this thread's stream (see Random.h)
 RMAPI float Random(float min, float max)
 {
-    return min + (rand() / ((float)RAND_MAX / (max - min)));
+    return ThreadRandom().NextFloat(min, max);
 }
 
 // Clamp float value
@@ -1267,6 +1272,23 @@ RMAPI Matrix Multiply(Matrix left, Matrix right)
 {
     Matrix result = { 0 };
 
+#if defined(MATH_SIMD)
+    // Memory rows of the result are rows of right times the memory rows of left,
+    // summed in the same order as the scalar code below so results match bit for bit.
+    using namespace mathsimd;
+    const float* l = &left.m0;
+    const float* r = &right.m0;
+    float4 l0 = Load(l), l1 = Load(l + 4), l2 = Load(l + 8), l3 = Load(l + 12);
+    for (int row = 0; row < 4; row++)
+    {
+        float4 rr = Load(r + 4 * row);
+        float4 sum = MulLane<0>(l0, rr);
+        sum = MulLaneAdd<1>(l1, rr, sum);
+        sum = MulLaneAdd<2>(l2, rr, sum);
+        sum = MulLaneAdd<3>(l3, rr, sum);
+        Store(&result.m0 + 4 * row, sum);
+    }
+#else
     result.m0 = left.m0 * right.m0 + left.m1 * right.m4 + left.m2 * right.m8 + left.m3 * right.m12;
     result.m1 = left.m0 * right.m1 + left.m1 * right.m5 + left.m2 * right.m9 + left.m3 * right.m13;
     result.m2 = left.m0 * right.m2 + left.m1 * right.m6 + left.m2 * right.m10 + left.m3 * right.m14;
@@ -1283,6 +1305,7 @@ RMAPI Matrix Multiply(Matrix left, Matrix right)
     result.m13 = left.m12 * right.m1 + left.m13 * right.m5 + left.m14 * right.m9 + left.m15 * right.m13;
     result.m14 = left.m12 * right.m2 + left.m13 * right.m6 + left.m14 * right.m10 + left.m15 * right.m14;
     result.m15 = left.m12 * right.m3 + left.m13 * right.m7 + left.m14 * right.m11 + left.m15 * right.m15;
+#endif
 
     return result;
 }
@@ -2138,6 +2161,220 @@ RMAPI int Equals(Quaternion p, Quaternion q)
     return result;
 }
 
+//----------------------------------------------------------------------------------
+// Module Functions Definition - Batch math
+//----------------------------------------------------------------------------------
+// Transform whole arrays in one call. Each group of mathsimd::LANES elements is loaded
+// into one-lane-per-element registers and runs the same formulas as the scalar functions;
+// the remaining few elements go through the scalar functions. out may be the same array as the input.
+
+// Transforms count Vector3 by a given Matrix, see Multiply(Vector3, Matrix)
+RMAPI void Multiply(const Vector3* v, size_t count, Matrix mat, Vector3* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    const vfloat m0 = Splat(mat.m0), m1 = Splat(mat.m1), m2 = Splat(mat.m2);
+    const vfloat m4 = Splat(mat.m4), m5 = Splat(mat.m5), m6 = Splat(mat.m6);
+    const vfloat m8 = Splat(mat.m8), m9 = Splat(mat.m9), m10 = Splat(mat.m10);
+    const vfloat m12 = Splat(mat.m12), m13 = Splat(mat.m13), m14 = Splat(mat.m14);
+    for (; i + LANES <= count; i += LANES)
+    {
+        vfloat x, y, z;
+        Load3(&v[i].x, x, y, z);
+        Store3(&out[i].x,
+            m0 * x + m4 * y + m8 * z + m12,
+            m1 * x + m5 * y + m9 * z + m13,
+            m2 * x + m6 * y + m10 * z + m14);
+    }
+#endif
+    for (; i < count; i++) out[i] = Multiply(v[i], mat);
+}
+
+// Multiplies every matrix of left by right, see Multiply(Matrix, Matrix)
+RMAPI void Multiply(const Matrix* left, size_t count, Matrix right, Matrix* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    // Same sums as Multiply(Matrix, Matrix), with right's memory rows loaded once for all of them
+    using namespace mathsimd;
+    const float* r = &right.m0;
+    const float4 r0 = Load(r), r1 = Load(r + 4), r2 = Load(r + 8), r3 = Load(r + 12);
+    for (; i < count; i++)
+    {
+        const float* l = &left[i].m0;
+        const float4 l0 = Load(l), l1 = Load(l + 4), l2 = Load(l + 8), l3 = Load(l + 12);
+        const float4 s0 = MulLaneAdd<3>(l3, r0, MulLaneAdd<2>(l2, r0, MulLaneAdd<1>(l1, r0, MulLane<0>(l0, r0))));
+        const float4 s1 = MulLaneAdd<3>(l3, r1, MulLaneAdd<2>(l2, r1, MulLaneAdd<1>(l1, r1, MulLane<0>(l0, r1))));
+        const float4 s2 = MulLaneAdd<3>(l3, r2, MulLaneAdd<2>(l2, r2, MulLaneAdd<1>(l1, r2, MulLane<0>(l0, r2))));
+        const float4 s3 = MulLaneAdd<3>(l3, r3, MulLaneAdd<2>(l2, r3, MulLaneAdd<1>(l1, r3, MulLane<0>(l0, r3))));
+        float* o = &out[i].m0;
+        Store(o, s0); Store(o + 4, s1); Store(o + 8, s2); Store(o + 12, s3);
+    }
+#endif
+    for (; i < count; i++) out[i] = Multiply(left[i], right);
+}
+
+// Multiplies left[i] by right[i]
+RMAPI void Multiply(const Matrix* left, const Matrix* right, size_t count, Matrix* out)
+{
+    for (size_t i = 0; i < count; i++) out[i] = Multiply(left[i], right[i]);
+}
+
+// Inverts count matrices, see Invert(Matrix)
+RMAPI void Invert(const Matrix* mat, size_t count, Matrix* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    for (; i + LANES <= count; i += LANES)
+    {
+        // Memory row r of a Matrix holds m(r), m(r + 4), m(r + 8), m(r + 12)
+        const float* src = &mat[i].m0;
+        vfloat a00, a10, a20, a30, a01, a11, a21, a31, a02, a12, a22, a32, a03, a13, a23, a33;
+        Load4(src, 16, a00, a10, a20, a30);
+        Load4(src + 4, 16, a01, a11, a21, a31);
+        Load4(src + 8, 16, a02, a12, a22, a32);
+        Load4(src + 12, 16, a03, a13, a23, a33);
+
+        vfloat b00 = a00 * a11 - a01 * a10;
+        vfloat b01 = a00 * a12 - a02 * a10;
+        vfloat b02 = a00 * a13 - a03 * a10;
+        vfloat b03 = a01 * a12 - a02 * a11;
+        vfloat b04 = a01 * a13 - a03 * a11;
+        vfloat b05 = a02 * a13 - a03 * a12;
+        vfloat b06 = a20 * a31 - a21 * a30;
+        vfloat b07 = a20 * a32 - a22 * a30;
+        vfloat b08 = a20 * a33 - a23 * a30;
+        vfloat b09 = a21 * a32 - a22 * a31;
+        vfloat b10 = a21 * a33 - a23 * a31;
+        vfloat b11 = a22 * a33 - a23 * a32;
+
+        vfloat invDet = Splat(1.0f) / (b00 * b11 - b01 * b10 + b02 * b09 + b03 * b08 - b04 * b07 + b05 * b06);
+
+        float* dst = &out[i].m0;
+        Store4(dst, 16,
+            (a11 * b11 - a12 * b10 + a13 * b09) * invDet,
+            (-a10 * b11 + a12 * b08 - a13 * b07) * invDet,
+            (a10 * b10 - a11 * b08 + a13 * b06) * invDet,
+            (-a10 * b09 + a11 * b07 - a12 * b06) * invDet);
+        Store4(dst + 4, 16,
+            (-a01 * b11 + a02 * b10 - a03 * b09) * invDet,
+            (a00 * b11 - a02 * b08 + a03 * b07) * invDet,
+            (-a00 * b10 + a01 * b08 - a03 * b06) * invDet,
+            (a00 * b09 - a01 * b07 + a02 * b06) * invDet);
+        Store4(dst + 8, 16,
+            (a31 * b05 - a32 * b04 + a33 * b03) * invDet,
+            (-a30 * b05 + a32 * b02 - a33 * b01) * invDet,
+            (a30 * b04 - a31 * b02 + a33 * b00) * invDet,
+            (-a30 * b03 + a31 * b01 - a32 * b00) * invDet);
+        Store4(dst + 12, 16,
+            (-a21 * b05 + a22 * b04 - a23 * b03) * invDet,
+            (a20 * b05 - a22 * b02 + a23 * b01) * invDet,
+            (-a20 * b04 + a21 * b02 - a23 * b00) * invDet,
+            (a20 * b03 - a21 * b01 + a22 * b00) * invDet);
+    }
+#endif
+    for (; i < count; i++) out[i] = Invert(mat[i]);
+}
+
+// Rotates count vectors by the same quaternion, see Rotate(Vector3, Quaternion)
+RMAPI void Rotate(const Vector3* v, size_t count, Quaternion q, Vector3* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    // The rotation matrix of q, same terms as the scalar version
+    const vfloat r00 = Splat(q.x * q.x + q.w * q.w - q.y * q.y - q.z * q.z);
+    const vfloat r01 = Splat(2 * q.x * q.y - 2 * q.w * q.z);
+    const vfloat r02 = Splat(2 * q.x * q.z + 2 * q.w * q.y);
+    const vfloat r10 = Splat(2 * q.w * q.z + 2 * q.x * q.y);
+    const vfloat r11 = Splat(q.w * q.w - q.x * q.x + q.y * q.y - q.z * q.z);
+    const vfloat r12 = Splat(-2 * q.w * q.x + 2 * q.y * q.z);
+    const vfloat r20 = Splat(-2 * q.w * q.y + 2 * q.x * q.z);
+    const vfloat r21 = Splat(2 * q.w * q.x + 2 * q.y * q.z);
+    const vfloat r22 = Splat(q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z);
+    for (; i + LANES <= count; i += LANES)
+    {
+        vfloat x, y, z;
+        Load3(&v[i].x, x, y, z);
+        Store3(&out[i].x,
+            x * r00 + y * r01 + z * r02,
+            x * r10 + y * r11 + z * r12,
+            x * r20 + y * r21 + z * r22);
+    }
+#endif
+    for (; i < count; i++) out[i] = Rotate(v[i], q);
+}
+
+// Rotates v[i] by q[i]
+RMAPI void Rotate(const Vector3* v, const Quaternion* q, size_t count, Vector3* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    for (; i + LANES <= count; i += LANES)
+    {
+        vfloat x, y, z, qx, qy, qz, qw;
+        Load3(&v[i].x, x, y, z);
+        Load4(&q[i].x, 4, qx, qy, qz, qw);
+        vfloat xx = qx * qx, yy = qy * qy, zz = qz * qz, ww = qw * qw;
+        vfloat xy2 = qx * qy * 2.0f, xz2 = qx * qz * 2.0f, yz2 = qy * qz * 2.0f;
+        vfloat wx2 = qw * qx * 2.0f, wy2 = qw * qy * 2.0f, wz2 = qw * qz * 2.0f;
+        Store3(&out[i].x,
+            x * (xx + ww - yy - zz) + y * (xy2 - wz2) + z * (xz2 + wy2),
+            x * (wz2 + xy2) + y * (ww - xx + yy - zz) + z * (yz2 - wx2),
+            x * (xz2 - wy2) + y * (wx2 + yz2) + z * (ww - xx - yy + zz));
+    }
+#endif
+    for (; i < count; i++) out[i] = Rotate(v[i], q[i]);
+}
+
+// Slerps q1[i] towards q2[i] by the same amount, see Slerp(Quaternion, Quaternion, float)
+// NOTE: acos and sin are polynomial approximations here, results differ from Slerp() by about 1e-7
+RMAPI void Slerp(const Quaternion* q1, const Quaternion* q2, size_t count, float amount, Quaternion* out)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    const vfloat one = Splat(1.0f), zero = Splat(0.0f), t = Splat(amount), s = Splat(1.0f - amount);
+    for (; i + LANES <= count; i += LANES)
+    {
+        vfloat ax, ay, az, aw, bx, by, bz, bw;
+        Load4(&q1[i].x, 4, ax, ay, az, aw);
+        Load4(&q2[i].x, 4, bx, by, bz, bw);
+
+        // Take the short way round
+        vfloat cosHalfTheta = ax * bx + ay * by + az * bz + aw * bw;
+        vmask flip = cosHalfTheta < zero;
+        bx = Select(flip, -bx, bx); by = Select(flip, -by, by);
+        bz = Select(flip, -bz, bz); bw = Select(flip, -bw, bw);
+        cosHalfTheta = Abs(cosHalfTheta);
+
+        // Nlerp for nearly equal rotations
+        vfloat nx = ax + t * (bx - ax), ny = ay + t * (by - ay), nz = az + t * (bz - az), nw = aw + t * (bw - aw);
+        vfloat length = Sqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+        vfloat ilength = one / Select(length == zero, one, length);
+
+        // Slerp. cosHalfTheta <= 0.95 here, so sinHalfTheta >= 0.31 and the scalar
+        // version's tiny sinHalfTheta case can't happen.
+        vfloat halfTheta = AcosPositive(Select(cosHalfTheta > one, one, cosHalfTheta));
+        vfloat invSin = one / Sqrt(Select(cosHalfTheta > Splat(0.95f), one, one - cosHalfTheta * cosHalfTheta));
+        vfloat ratioA = SinQuarter(s * halfTheta) * invSin;
+        vfloat ratioB = SinQuarter(t * halfTheta) * invSin;
+
+        vmask same = cosHalfTheta >= one;
+        vmask near = cosHalfTheta > Splat(0.95f);
+        Store4(&out[i].x, 4,
+            Select(same, ax, Select(near, nx * ilength, ax * ratioA + bx * ratioB)),
+            Select(same, ay, Select(near, ny * ilength, ay * ratioA + by * ratioB)),
+            Select(same, az, Select(near, nz * ilength, az * ratioA + bz * ratioB)),
+            Select(same, aw, Select(near, nw * ilength, aw * ratioA + bw * ratioB)));
+    }
+#endif
+    for (; i < count; i++) out[i] = Slerp(q1[i], q2[i], amount);
+}
+
 //----------------------------------------------------------------------------------
 // Module Functions Definition - Global operator overloads
 //----------------------------------------------------------------------------------
@@ -2276,3 +2513,4 @@ RMAPI Matrix operator*(const Matrix& a, const Matrix& b)
 {
     return Multiply(a, b);
 }
+MATH_CONTRACT_DEFAULT
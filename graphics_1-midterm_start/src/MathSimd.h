@@ -0,0 +1,397 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------
+// SIMD lanes for the batch functions in Math.h
+//----------------------------------------------------------------------------------
+// The instruction set is picked at compile time:
+//   AVX2       8 lanes  (/arch:AVX2, -mavx2)
+//   SSE        4 lanes  (any x64 build, SSE4.1 builds just get better instruction selection)
+//   NEON       4 lanes  (ARMv7 with NEON, AArch64)
+// Without any of them MATH_SIMD stays undefined and Math.h loops over the scalar functions.
+// Kernels are written once against vfloat / vmask and the Load / Store helpers,
+// which move arrays of structs in and out of one-lane-per-element form.
+// LoadLanes / StoreLanes move LANES consecutive floats and need them aligned to LANES * 4 bytes.
+
+#if defined(__AVX2__)
+#define MATH_AVX2 1
+#endif
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSE4_1__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define MATH_NEON 1
+#include <arm_neon.h>
+#endif
+#if defined(MATH_SSE) || defined(MATH_NEON)
+#define MATH_SIMD 1
+#endif
+
+// Name of the code path compiled in
+inline const char* MathSimdPath(void)
+{
+#if defined(MATH_AVX2)
+    return "AVX2";
+#elif defined(MATH_SSE) && defined(__SSE4_1__)
+    return "SSE4.1";
+#elif defined(MATH_SSE)
+    return "SSE2";
+#elif defined(MATH_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+// a * b + c fused into one FMA is rounded once instead of twice, so a kernel only matches the
+// scalar function it mirrors bit for bit if neither is fused. GCC and Clang fuse on their own once
+// FMA is enabled (-mavx2 -mfma, -march=native), so MATH_CONTRACT_OFF turns it off here, in Math.h
+// and in Random.h, and MATH_CONTRACT_DEFAULT turns it back on at the end of each.
+// GCC ignores the standard pragma, and its optimize pragma also keeps the functions under it from
+// being inlined into code built without it, so GCC only gets it when the target has FMA at all.
+// Visual Studio 2022 only fuses with /fp:contract.
+#if defined(__clang__)
+#define MATH_CONTRACT_OFF _Pragma("STDC FP_CONTRACT OFF")
+#define MATH_CONTRACT_DEFAULT _Pragma("STDC FP_CONTRACT DEFAULT")
+#elif defined(__GNUC__) && defined(__FP_FAST_FMAF)
+#define MATH_CONTRACT_OFF _Pragma("GCC push_options") _Pragma("GCC optimize(\"fp-contract=off\")")
+#define MATH_CONTRACT_DEFAULT _Pragma("GCC pop_options")
+#else
+#define MATH_CONTRACT_OFF
+#define MATH_CONTRACT_DEFAULT
+#endif
+MATH_CONTRACT_OFF
+#if defined(MATH_SIMD)
+namespace mathsimd
+{
+//----------------------------------------------------------------------------------
+// 4 wide helpers, also used by the single matrix multiply on every path
+//----------------------------------------------------------------------------------
+#if defined(MATH_SSE)
+typedef __m128 float4;
+inline float4 Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, float4 a) { _mm_storeu_ps(p, a); }
+// a * b[lane] + c, lane picked at compile time
+template <int lane> inline float4 MulLaneAdd(float4 a, float4 b, float4 c)
+{
+    return _mm_add_ps(c, _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(lane, lane, lane, lane))));
+}
+template <int lane> inline float4 MulLane(float4 a, float4 b)
+{
+    return _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(lane, lane, lane, lane)));
+}
+
+// 4 rows of 4 floats (p, p + stride, ...) -> 4 vectors of one column each
+inline void Load4x4(const float* p, size_t stride, float4& a, float4& b, float4& c, float4& d)
+{
+    a = _mm_loadu_ps(p);
+    b = _mm_loadu_ps(p + stride);
+    c = _mm_loadu_ps(p + 2 * stride);
+    d = _mm_loadu_ps(p + 3 * stride);
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+}
+inline void Store4x4(float* p, size_t stride, float4 a, float4 b, float4 c, float4 d)
+{
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(p, a);
+    _mm_storeu_ps(p + stride, b);
+    _mm_storeu_ps(p + 2 * stride, c);
+    _mm_storeu_ps(p + 3 * stride, d);
+}
+
+// 4 packed Vector3 (12 floats) <-> x, y, z vectors
+inline void Load4x3(const float* p, float4& x, float4& y, float4& z)
+{
+    float4 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+    float4 t = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));   // x2 y2 x3 y3
+    float4 u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));   // y0 z0 y1 z1
+    x = _mm_shuffle_ps(a, t, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(u, t, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(u, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+inline void Store4x3(float* p, float4 x, float4 y, float4 z)
+{
+    float4 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 0, 1, 0));  // x0 x1 y0 y1
+    float4 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 0, 1, 0));  // z0 z1 x0 x1
+    float4 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(2, 1, 2, 1));  // y1 y2 z1 z2
+    float4 xy2 = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)); // x2 x2 y2 y2
+    float4 zx3 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)); // z2 z2 x3 x3
+    float4 yz3 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)); // y3 y3 z3 z3
+    _mm_storeu_ps(p, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(3, 0, 2, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy2, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(zx3, yz3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+#else
+typedef float32x4_t float4;
+inline float4 Load(const float* p) { return vld1q_f32(p); }
+inline void Store(float* p, float4 a) { vst1q_f32(p, a); }
+template <int lane> inline float4 MulLaneAdd(float4 a, float4 b, float4 c)
+{
+    return lane < 2 ? vmlaq_lane_f32(c, a, vget_low_f32(b), lane & 1) : vmlaq_lane_f32(c, a, vget_high_f32(b), lane & 1);
+}
+template <int lane> inline float4 MulLane(float4 a, float4 b)
+{
+    return lane < 2 ? vmulq_lane_f32(a, vget_low_f32(b), lane & 1) : vmulq_lane_f32(a, vget_high_f32(b), lane & 1);
+}
+
+inline void Transpose(float4& a, float4& b, float4& c, float4& d)
+{
+    float32x4x2_t ab = vtrnq_f32(a, b);
+    float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+inline void Load4x4(const float* p, size_t stride, float4& a, float4& b, float4& c, float4& d)
+{
+    if (stride == 4)
+    {
+        float32x4x4_t v = vld4q_f32(p);
+        a = v.val[0]; b = v.val[1]; c = v.val[2]; d = v.val[3];
+        return;
+    }
+    a = vld1q_f32(p);
+    b = vld1q_f32(p + stride);
+    c = vld1q_f32(p + 2 * stride);
+    d = vld1q_f32(p + 3 * stride);
+    Transpose(a, b, c, d);
+}
+inline void Store4x4(float* p, size_t stride, float4 a, float4 b, float4 c, float4 d)
+{
+    if (stride == 4)
+    {
+        float32x4x4_t v = { { a, b, c, d } };
+        vst4q_f32(p, v);
+        return;
+    }
+    Transpose(a, b, c, d);
+    vst1q_f32(p, a);
+    vst1q_f32(p + stride, b);
+    vst1q_f32(p + 2 * stride, c);
+    vst1q_f32(p + 3 * stride, d);
+}
+inline void Load4x3(const float* p, float4& x, float4& y, float4& z)
+{
+    float32x4x3_t v = vld3q_f32(p);
+    x = v.val[0]; y = v.val[1]; z = v.val[2];
+}
+inline void Store4x3(float* p, float4 x, float4 y, float4 z)
+{
+    float32x4x3_t v = { { x, y, z } };
+    vst3q_f32(p, v);
+}
+#endif
+
+//----------------------------------------------------------------------------------
+// Lanes used by the batch kernels: 8 with AVX2, 4 otherwise
+//----------------------------------------------------------------------------------
+#if defined(MATH_AVX2)
+const int LANES = 8;
+struct vfloat { __m256 v; };
+struct vmask { __m256 v; };
+inline vfloat Splat(float a) { return { _mm256_set1_ps(a) }; }
+inline vfloat LoadLanes(const float* p) { return { _mm256_load_ps(p) }; }
+inline void StoreLanes(float* p, vfloat a) { _mm256_store_ps(p, a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a, vfloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline vfloat operator*(vfloat a, vfloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline vfloat operator/(vfloat a, vfloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a) { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+inline vfloat Sqrt(vfloat a) { return { _mm256_sqrt_ps(a.v) }; }
+inline vfloat Abs(vfloat a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+inline vmask operator<(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline vmask operator>(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline vmask operator>=(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline vmask operator==(vfloat a, vfloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+inline vfloat Select(vmask m, vfloat a, vfloat b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+
+// Two 4 wide groups side by side
+inline __m256 Join(float4 lo, float4 hi) { return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1); }
+inline void Load4(const float* p, size_t stride, vfloat& a, vfloat& b, vfloat& c, vfloat& d)
+{
+    float4 a0, b0, c0, d0, a1, b1, c1, d1;
+    Load4x4(p, stride, a0, b0, c0, d0);
+    Load4x4(p + 4 * stride, stride, a1, b1, c1, d1);
+    a.v = Join(a0, a1); b.v = Join(b0, b1); c.v = Join(c0, c1); d.v = Join(d0, d1);
+}
+inline void Store4(float* p, size_t stride, vfloat a, vfloat b, vfloat c, vfloat d)
+{
+    Store4x4(p, stride, _mm256_castps256_ps128(a.v), _mm256_castps256_ps128(b.v), _mm256_castps256_ps128(c.v), _mm256_castps256_ps128(d.v));
+    Store4x4(p + 4 * stride, stride, _mm256_extractf128_ps(a.v, 1), _mm256_extractf128_ps(b.v, 1), _mm256_extractf128_ps(c.v, 1), _mm256_extractf128_ps(d.v, 1));
+}
+inline void Load3(const float* p, vfloat& x, vfloat& y, vfloat& z)
+{
+    float4 x0, y0, z0, x1, y1, z1;
+    Load4x3(p, x0, y0, z0);
+    Load4x3(p + 12, x1, y1, z1);
+    x.v = Join(x0, x1); y.v = Join(y0, y1); z.v = Join(z0, z1);
+}
+inline void Store3(float* p, vfloat x, vfloat y, vfloat z)
+{
+    Store4x3(p, _mm256_castps256_ps128(x.v), _mm256_castps256_ps128(y.v), _mm256_castps256_ps128(z.v));
+    Store4x3(p + 12, _mm256_extractf128_ps(x.v, 1), _mm256_extractf128_ps(y.v, 1), _mm256_extractf128_ps(z.v, 1));
+}
+// 32-bit unsigned lanes, for the counter based generator in Random.h
+struct vuint { __m256i v; };
+inline vuint SplatU(uint32_t a) { return { _mm256_set1_epi32((int)a) }; }
+inline vuint IndexLanes() { return { _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) }; }
+inline vuint operator+(vuint a, vuint b) { return { _mm256_add_epi32(a.v, b.v) }; }
+inline vuint operator^(vuint a, vuint b) { return { _mm256_xor_si256(a.v, b.v) }; }
+inline vuint operator&(vuint a, vuint b) { return { _mm256_and_si256(a.v, b.v) }; }
+inline vuint operator>>(vuint a, int n) { return { _mm256_srli_epi32(a.v, n) }; }
+// Full 64-bit products of 32-bit lanes, split into high and low halves
+inline void MulHiLo(vuint a, vuint b, vuint& hi, vuint& lo)
+{
+    __m256i even = _mm256_mul_epu32(a.v, b.v);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a.v, 32), _mm256_srli_epi64(b.v, 32));
+    lo.v = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi.v = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+// Exact for lanes below 2^31
+inline vfloat ToFloat(vuint a) { return { _mm256_cvtepi32_ps(a.v) }; }
+// Same bits, for storing through the float helpers
+inline vfloat AsFloat(vuint a) { return { _mm256_castsi256_ps(a.v) }; }
+#elif defined(MATH_SSE)
+const int LANES = 4;
+struct vfloat { __m128 v; };
+struct vmask { __m128 v; };
+inline vfloat Splat(float a) { return { _mm_set1_ps(a) }; }
+inline vfloat LoadLanes(const float* p) { return { _mm_load_ps(p) }; }
+inline void StoreLanes(float* p, vfloat a) { _mm_store_ps(p, a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { return { _mm_add_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a, vfloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline vfloat operator*(vfloat a, vfloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline vfloat operator/(vfloat a, vfloat b) { return { _mm_div_ps(a.v, b.v) }; }
+inline vfloat operator-(vfloat a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+inline vfloat Sqrt(vfloat a) { return { _mm_sqrt_ps(a.v) }; }
+inline vfloat Abs(vfloat a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+inline vmask operator<(vfloat a, vfloat b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline vmask operator>(vfloat a, vfloat b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline vmask operator>=(vfloat a, vfloat b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline vmask operator==(vfloat a, vfloat b) { return { _mm_cmpeq_ps(a.v, b.v) }; }
+inline vfloat Select(vmask m, vfloat a, vfloat b) { return { _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)) }; }
+
+inline void Load4(const float* p, size_t stride, vfloat& a, vfloat& b, vfloat& c, vfloat& d) { Load4x4(p, stride, a.v, b.v, c.v, d.v); }
+inline void Store4(float* p, size_t stride, vfloat a, vfloat b, vfloat c, vfloat d) { Store4x4(p, stride, a.v, b.v, c.v, d.v); }
+inline void Load3(const float* p, vfloat& x, vfloat& y, vfloat& z) { Load4x3(p, x.v, y.v, z.v); }
+inline void Store3(float* p, vfloat x, vfloat y, vfloat z) { Store4x3(p, x.v, y.v, z.v); }
+// 32-bit unsigned lanes, for the counter based generator in Random.h
+struct vuint { __m128i v; };
+inline vuint SplatU(uint32_t a) { return { _mm_set1_epi32((int)a) }; }
+inline vuint IndexLanes() { return { _mm_setr_epi32(0, 1, 2, 3) }; }
+inline vuint operator+(vuint a, vuint b) { return { _mm_add_epi32(a.v, b.v) }; }
+inline vuint operator^(vuint a, vuint b) { return { _mm_xor_si128(a.v, b.v) }; }
+inline vuint operator&(vuint a, vuint b) { return { _mm_and_si128(a.v, b.v) }; }
+inline vuint operator>>(vuint a, int n) { return { _mm_srli_epi32(a.v, n) }; }
+// Full 64-bit products of 32-bit lanes, split into high and low halves
+inline void MulHiLo(vuint a, vuint b, vuint& hi, vuint& lo)
+{
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    lo.v = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    hi.v = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+}
+// Exact for lanes below 2^31
+inline vfloat ToFloat(vuint a) { return { _mm_cvtepi32_ps(a.v) }; }
+// Same bits, for storing through the float helpers
+inline vfloat AsFloat(vuint a) { return { _mm_castsi128_ps(a.v) }; }
+#else
+const int LANES = 4;
+struct vfloat { float32x4_t v; };
+struct vmask { uint32x4_t v; };
+inline vfloat Splat(float a) { return { vdupq_n_f32(a) }; }
+inline vfloat LoadLanes(const float* p) { return { vld1q_f32(p) }; }
+inline void StoreLanes(float* p, vfloat a) { vst1q_f32(p, a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { return { vaddq_f32(a.v, b.v) }; }
+inline vfloat operator-(vfloat a, vfloat b) { return { vsubq_f32(a.v, b.v) }; }
+inline vfloat operator*(vfloat a, vfloat b) { return { vmulq_f32(a.v, b.v) }; }
+inline vfloat operator-(vfloat a) { return { vnegq_f32(a.v) }; }
+inline vfloat Abs(vfloat a) { return { vabsq_f32(a.v) }; }
+#if defined(__aarch64__) || defined(_M_ARM64)
+inline vfloat operator/(vfloat a, vfloat b) { return { vdivq_f32(a.v, b.v) }; }
+inline vfloat Sqrt(vfloat a) { return { vsqrtq_f32(a.v) }; }
+#else
+// ARMv7 has no divide or square root, refine the estimates twice.
+inline vfloat operator/(vfloat a, vfloat b)
+{
+    float32x4_t r = vrecpeq_f32(b.v);
+    r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+    r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+    return { vmulq_f32(a.v, r) };
+}
+inline vfloat Sqrt(vfloat a)
+{
+    float32x4_t r = vrsqrteq_f32(a.v);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a.v, r), r));
+    // sqrt(0) would be 0 * inf
+    return { vbslq_f32(vceqq_f32(a.v, vdupq_n_f32(0.0f)), a.v, vmulq_f32(a.v, r)) };
+}
+#endif
+inline vmask operator<(vfloat a, vfloat b) { return { vcltq_f32(a.v, b.v) }; }
+inline vmask operator>(vfloat a, vfloat b) { return { vcgtq_f32(a.v, b.v) }; }
+inline vmask operator>=(vfloat a, vfloat b) { return { vcgeq_f32(a.v, b.v) }; }
+inline vmask operator==(vfloat a, vfloat b) { return { vceqq_f32(a.v, b.v) }; }
+inline vfloat Select(vmask m, vfloat a, vfloat b) { return { vbslq_f32(m.v, a.v, b.v) }; }
+
+inline void Load4(const float* p, size_t stride, vfloat& a, vfloat& b, vfloat& c, vfloat& d) { Load4x4(p, stride, a.v, b.v, c.v, d.v); }
+inline void Store4(float* p, size_t stride, vfloat a, vfloat b, vfloat c, vfloat d) { Store4x4(p, stride, a.v, b.v, c.v, d.v); }
+inline void Load3(const float* p, vfloat& x, vfloat& y, vfloat& z) { Load4x3(p, x.v, y.v, z.v); }
+inline void Store3(float* p, vfloat x, vfloat y, vfloat z) { Store4x3(p, x.v, y.v, z.v); }
+// 32-bit unsigned lanes, for the counter based generator in Random.h
+struct vuint { uint32x4_t v; };
+inline vuint SplatU(uint32_t a) { return { vdupq_n_u32(a) }; }
+inline vuint IndexLanes() { const uint32_t index[4] = { 0, 1, 2, 3 }; return { vld1q_u32(index) }; }
+inline vuint operator+(vuint a, vuint b) { return { vaddq_u32(a.v, b.v) }; }
+inline vuint operator^(vuint a, vuint b) { return { veorq_u32(a.v, b.v) }; }
+inline vuint operator&(vuint a, vuint b) { return { vandq_u32(a.v, b.v) }; }
+inline vuint operator>>(vuint a, int n) { return { vshlq_u32(a.v, vdupq_n_s32(-n)) }; }
+// Full 64-bit products of 32-bit lanes, split into high and low halves
+inline void MulHiLo(vuint a, vuint b, vuint& hi, vuint& lo)
+{
+    uint64x2_t p0 = vmull_u32(vget_low_u32(a.v), vget_low_u32(b.v));
+    uint64x2_t p1 = vmull_u32(vget_high_u32(a.v), vget_high_u32(b.v));
+    lo.v = vcombine_u32(vmovn_u64(p0), vmovn_u64(p1));
+    hi.v = vcombine_u32(vshrn_n_u64(p0, 32), vshrn_n_u64(p1, 32));
+}
+// Exact for lanes below 2^31
+inline vfloat ToFloat(vuint a) { return { vcvtq_f32_u32(a.v) }; }
+// Same bits, for storing through the float helpers
+inline vfloat AsFloat(vuint a) { return { vreinterpretq_f32_u32(a.v) }; }
+#endif
+
+inline vfloat operator*(vfloat a, float b) { return a * Splat(b); }
+inline vfloat operator+(vfloat a, float b) { return a + Splat(b); }
+inline vfloat operator-(float a, vfloat b) { return Splat(a) - b; }
+
+// sin(x) for x in [0, PI/2], Taylor series to x^11 (error below 6e-8 on that range)
+inline vfloat SinQuarter(vfloat x)
+{
+    vfloat x2 = x * x;
+    vfloat p = Splat(-2.5052108e-8f);
+    p = p * x2 + 2.7557319e-6f;
+    p = p * x2 + -1.9841270e-4f;
+    p = p * x2 + 8.3333333e-3f;
+    p = p * x2 + -1.6666667e-1f;
+    p = p * x2 + 1.0f;
+    return p * x;
+}
+
+// acos(x) for x in [0, 1], Abramowitz & Stegun 4.4.46 (error below 2e-8)
+inline vfloat AcosPositive(vfloat x)
+{
+    vfloat p = Splat(-0.0012624911f);
+    p = p * x + 0.0066700901f;
+    p = p * x + -0.0170881256f;
+    p = p * x + 0.0308918810f;
+    p = p * x + -0.0501743046f;
+    p = p * x + 0.0889789874f;
+    p = p * x + -0.2145988016f;
+    p = p * x + 1.5707963050f;
+    return p * Sqrt(1.0f - x);
+}
+}
+#endif
+MATH_CONTRACT_DEFAULT
@@ -0,0 +1,400 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include "MathSimd.h"
+
+// No FMA contraction, so the batch functions match the one at a time ones (see MathSimd.h).
+MATH_CONTRACT_OFF
+
+//----------------------------------------------------------------------------------
+// Random numbers
+//----------------------------------------------------------------------------------
+// Two generators. Both give the same numbers for the same seed on every platform and compiler.
+//   Xoshiro256   xoshiro256++ (Blackman & Vigna), a fast sequential generator with a 2^256 period.
+//                Jump() moves 2^128 numbers ahead, so one seed splits into non-overlapping thread streams.
+//   Philox4x32   Philox4x32-10 (Salmon et al., Random123), counter based: number i depends only on
+//                the key and i, so the batch functions fill arrays LANES blocks at a time (see MathSimd.h)
+//                and any part of a sequence can be made on any thread.
+// ThreadRandom() is a Xoshiro256 per thread and is what Random(min, max) in Math.h draws from.
+// The thread streams start from std::random_device unless SetRandomSeed() fixed the seed,
+// which is the deterministic mode for benchmarks and reproducible scenes.
+
+class Xoshiro256
+{
+public:
+    explicit Xoshiro256(uint64_t seed = 0) { Seed(seed); }
+
+    // Expands seed into the 256-bit state with SplitMix64, so nearby seeds give unrelated streams
+    void Seed(uint64_t seed)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            s[i] = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t Next()
+    {
+        const uint64_t result = Rotl(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+
+    uint32_t NextU32() { return (uint32_t)(Next() >> 32); }
+
+    // Uniform in [0, 1), 24 bits
+    float NextFloat() { return (float)(Next() >> 40) * (1.0f / 16777216.0f); }
+
+    // Uniform in [min, max)
+    float NextFloat(float min, float max) { return min + (max - min) * NextFloat(); }
+
+    // Uniform in [min, max] without the modulo bias of rand() % n (Lemire's multiply and reject)
+    int NextInt(int min, int max)
+    {
+        const uint32_t range = (uint32_t)max - (uint32_t)min + 1;
+        if (range == 0) return (int)NextU32();
+        uint64_t m = (uint64_t)NextU32() * range;
+        if ((uint32_t)m < range)
+        {
+            const uint32_t threshold = (0u - range) % range;
+            while ((uint32_t)m < threshold) m = (uint64_t)NextU32() * range;
+        }
+        return (int)((uint32_t)min + (uint32_t)(m >> 32));
+    }
+
+    // Same as 2^128 calls to Next()
+    void Jump()
+    {
+        static const uint64_t jump[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+        Advance(jump);
+    }
+
+    // Same as 2^192 calls to Next(), for splitting a stream that is itself split with Jump()
+    void LongJump()
+    {
+        static const uint64_t jump[4] = { 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull };
+        Advance(jump);
+    }
+
+    uint64_t s[4];
+
+private:
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    void Advance(const uint64_t (&polynomial)[4])
+    {
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; i++)
+        {
+            for (int b = 0; b < 64; b++)
+            {
+                if (polynomial[i] & (1ull << b))
+                    for (int k = 0; k < 4; k++) t[k] ^= s[k];
+                Next();
+            }
+        }
+        for (int k = 0; k < 4; k++) s[k] = t[k];
+    }
+};
+
+class Philox4x32
+{
+public:
+    // Every stream of a seed is a separate sequence of 2^66 numbers (e.g. one per particle system)
+    explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+    {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        counterHigh[0] = (uint32_t)stream;
+        counterHigh[1] = (uint32_t)(stream >> 32);
+    }
+
+    // The four numbers of block b, which are numbers 4b to 4b + 3 of the sequence
+    void Block(uint64_t b, uint32_t out[4]) const
+    {
+        uint32_t c0 = (uint32_t)b, c1 = (uint32_t)(b >> 32), c2 = counterHigh[0], c3 = counterHigh[1];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            const uint64_t p0 = (uint64_t)M0 * c0;
+            const uint64_t p1 = (uint64_t)M1 * c2;
+            const uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+            c1 = (uint32_t)p1;
+            c3 = (uint32_t)p0;
+            c0 = n0;
+            c2 = n2;
+            k0 += W0;
+            k1 += W1;
+        }
+        out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+    }
+
+    uint32_t U32(uint64_t i) const
+    {
+        uint32_t block[4];
+        Block(i >> 2, block);
+        return block[i & 3];
+    }
+
+    // Number i as a float in [0, 1), 24 bits
+    float Float(uint64_t i) const { return (float)(U32(i) >> 8) * (1.0f / 16777216.0f); }
+
+    static const int ROUNDS = 10;
+    static const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    static const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+
+    uint32_t key[2];
+    uint32_t counterHigh[2];
+};
+
+//----------------------------------------------------------------------------------
+// Batch generation from a Philox4x32
+//----------------------------------------------------------------------------------
+// out[i] comes from number first + i of the sequence, bit for bit the same as the one at a time
+// helpers below whichever lanes are compiled in. Blocks are made LANES at a time with the counter
+// in one lane each; the head and tail that don't fill a whole group go through Block().
+
+// Numbers for uniform floats and ints
+inline float RandomUnitFloat(uint32_t x) { return (float)(x >> 8) * (1.0f / 16777216.0f); }
+// Bias below range / 2^32, far too small to show, and the same in every lane
+inline int RandomRangeInt(uint32_t x, int min, uint32_t range)
+{
+    return range == 0 ? (int)x : (int)((uint32_t)min + (uint32_t)(((uint64_t)x * range) >> 32));
+}
+
+// sin(x) for x in [0, PI/2], the same polynomial as mathsimd::SinQuarter
+inline float RandomSinQuarter(float x)
+{
+    float x2 = x * x;
+    float p = -2.5052108e-8f;
+    p = p * x2 + 2.7557319e-6f;
+    p = p * x2 + -1.9841270e-4f;
+    p = p * x2 + 8.3333333e-3f;
+    p = p * x2 + -1.6666667e-1f;
+    p = p * x2 + 1.0f;
+    return p * x;
+}
+
+// Direction from two numbers: z uniform in (-1, 1], angle around z uniform (so uniform on the sphere).
+// The top 2 bits of b pick the quadrant and the next 24 the angle inside it.
+inline void RandomUnitVector(uint32_t a, uint32_t b, float* xyz)
+{
+    const float halfPi = 1.57079632679f;
+    float z = 1.0f - 2.0f * RandomUnitFloat(a);
+    float r = sqrtf(fmaxf(1.0f - z * z, 0.0f));
+    float angle = (float)((b >> 6) & 0xFFFFFF) * (1.0f / 16777216.0f) * halfPi;
+    float s = RandomSinQuarter(angle), c = RandomSinQuarter(halfPi - angle);
+    float x = c, y = s;
+    if (b & 0x40000000u) { x = -s; y = c; }
+    if (b & 0x80000000u) { x = -x; y = -y; }
+    xyz[0] = x * r;
+    xyz[1] = y * r;
+    xyz[2] = z;
+}
+
+#if defined(MATH_SIMD)
+// Philox4x32-10 on LANES blocks, starting at block first
+inline void PhiloxLanes(const Philox4x32& gen, uint64_t first, mathsimd::vuint out[4])
+{
+    using namespace mathsimd;
+    // The low counter word doesn't carry into the high one within a group, the callers make sure
+    vuint c0 = SplatU((uint32_t)first) + IndexLanes(), c1 = SplatU((uint32_t)(first >> 32));
+    vuint c2 = SplatU(gen.counterHigh[0]), c3 = SplatU(gen.counterHigh[1]);
+    const vuint m0 = SplatU(Philox4x32::M0), m1 = SplatU(Philox4x32::M1);
+    uint32_t k0 = gen.key[0], k1 = gen.key[1];
+    for (int round = 0; round < Philox4x32::ROUNDS; round++)
+    {
+        vuint hi0, lo0, hi1, lo1;
+        MulHiLo(c0, m0, hi0, lo0);
+        MulHiLo(c2, m1, hi1, lo1);
+        c0 = hi1 ^ c1 ^ SplatU(k0);
+        c2 = hi0 ^ c3 ^ SplatU(k1);
+        c1 = lo1;
+        c3 = lo0;
+        k0 += Philox4x32::W0;
+        k1 += Philox4x32::W1;
+    }
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// First block of a whole group at or after block b that doesn't wrap the low counter word
+inline bool PhiloxGroupFits(uint64_t b)
+{
+    return (uint32_t)b <= 0xFFFFFFFFu - (uint32_t)(mathsimd::LANES - 1);
+}
+#endif
+
+// Fills out[0, count) with uniform floats in [min, max) from numbers first, first + 1, ...
+inline void RandomFloats(const Philox4x32& gen, uint64_t first, size_t count, float* out, float min = 0.0f, float max = 1.0f)
+{
+    size_t i = 0;
+    const float scale = max - min;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    const size_t group = 4 * LANES;
+    // Head, up to the first whole block
+    for (; i < count && ((first + i) & 3) != 0; i++)
+        out[i] = min + scale * RandomUnitFloat(gen.U32(first + i));
+    const vfloat unit = Splat(1.0f / 16777216.0f), vscale = Splat(scale), vmin = Splat(min);
+    for (; i + group <= count && PhiloxGroupFits((first + i) >> 2); i += group)
+    {
+        vuint block[4];
+        PhiloxLanes(gen, (first + i) >> 2, block);
+        vfloat f[4];
+        for (int w = 0; w < 4; w++)
+            f[w] = vmin + vscale * (ToFloat(block[w] >> 8) * unit);
+        // Lane j holds block j, whose 4 numbers are out[4j] to out[4j + 3]
+        Store4(out + i, 4, f[0], f[1], f[2], f[3]);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        uint32_t block[4];
+        if (((first + i) & 3) == 0 && i + 4 <= count)
+        {
+            gen.Block((first + i) >> 2, block);
+            for (int w = 0; w < 4; w++) out[i + w] = min + scale * RandomUnitFloat(block[w]);
+            i += 3;
+        }
+        else
+            out[i] = min + scale * RandomUnitFloat(gen.U32(first + i));
+    }
+}
+
+// Fills out[0, count) with uniform ints in [min, max] from numbers first, first + 1, ...
+inline void RandomInts(const Philox4x32& gen, uint64_t first, size_t count, int* out, int min, int max)
+{
+    size_t i = 0;
+    const uint32_t range = (uint32_t)max - (uint32_t)min + 1;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    const size_t group = 4 * LANES;
+    for (; i < count && ((first + i) & 3) != 0; i++)
+        out[i] = RandomRangeInt(gen.U32(first + i), min, range);
+    const vuint vrange = SplatU(range), vmin = SplatU((uint32_t)min);
+    for (; range != 0 && i + group <= count && PhiloxGroupFits((first + i) >> 2); i += group)
+    {
+        vuint block[4];
+        PhiloxLanes(gen, (first + i) >> 2, block);
+        vfloat bits[4];
+        for (int w = 0; w < 4; w++)
+        {
+            vuint hi, lo;
+            MulHiLo(block[w], vrange, hi, lo);
+            bits[w] = AsFloat(vmin + hi);
+        }
+        Store4((float*)(out + i), 4, bits[0], bits[1], bits[2], bits[3]);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        uint32_t block[4];
+        if (((first + i) & 3) == 0 && i + 4 <= count)
+        {
+            gen.Block((first + i) >> 2, block);
+            for (int w = 0; w < 4; w++) out[i + w] = RandomRangeInt(block[w], min, range);
+            i += 3;
+        }
+        else
+            out[i] = RandomRangeInt(gen.U32(first + i), min, range);
+    }
+}
+
+// Fills xyz[0, 3 * count) with directions uniform on the unit sphere.
+// Vector i is made from the first two numbers of block first + i.
+inline void RandomUnitVectors(const Philox4x32& gen, uint64_t first, size_t count, float* xyz)
+{
+    size_t i = 0;
+#if defined(MATH_SIMD)
+    using namespace mathsimd;
+    const vfloat unit = Splat(1.0f / 16777216.0f), halfPi = Splat(1.57079632679f);
+    const vfloat one = Splat(1.0f), two = Splat(2.0f), zero = Splat(0.0f);
+    for (; i + LANES <= count && PhiloxGroupFits(first + i); i += LANES)
+    {
+        vuint block[4];
+        PhiloxLanes(gen, first + i, block);
+        vfloat z = one - two * (ToFloat(block[0] >> 8) * unit);
+        vfloat r = Sqrt(Select(one - z * z > zero, one - z * z, zero));
+        vfloat angle = ToFloat((block[1] >> 6) & SplatU(0xFFFFFF)) * unit * halfPi;
+        vfloat s = SinQuarter(angle), c = SinQuarter(halfPi - angle);
+        vmask odd = ToFloat((block[1] >> 30) & SplatU(1)) == one;
+        vmask flip = ToFloat(block[1] >> 31) == one;
+        vfloat x = Select(odd, -s, c), y = Select(odd, c, s);
+        x = Select(flip, -x, x);
+        y = Select(flip, -y, y);
+        Store3(xyz + 3 * i, x * r, y * r, z);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        uint32_t block[4];
+        gen.Block(first + i, block);
+        RandomUnitVector(block[0], block[1], xyz + 3 * i);
+    }
+}
+
+//----------------------------------------------------------------------------------
+// Per thread streams
+//----------------------------------------------------------------------------------
+inline std::atomic<uint64_t>& RandomSeedState() { static std::atomic<uint64_t> seed(0); return seed; }
+inline std::atomic<bool>& RandomSeedSet() { static std::atomic<bool> set(false); return set; }
+inline std::atomic<unsigned>& RandomThreadCount() { static std::atomic<unsigned> count(0); return count; }
+
+// The seed thread streams start from. Picked from std::random_device on first use unless set.
+// call_once makes threads racing for the first seed wait until it is stored.
+inline uint64_t RandomSeed()
+{
+    static std::once_flag picked;
+    std::call_once(picked, []
+    {
+        if (RandomSeedSet().load())
+            return;
+        std::random_device device;
+        RandomSeedState().store(((uint64_t)device() << 32) | device());
+        RandomSeedSet().store(true);
+    });
+    return RandomSeedState().load();
+}
+
+// Thread n (in order of first use) gets the seed's stream jumped n times, 2^128 numbers apart
+inline Xoshiro256 MakeThreadRandom()
+{
+    Xoshiro256 generator(RandomSeed());
+    for (unsigned n = RandomThreadCount()++; n > 0; n--) generator.Jump();
+    return generator;
+}
+
+inline Xoshiro256& ThreadRandom()
+{
+    thread_local Xoshiro256 generator = MakeThreadRandom();
+    return generator;
+}
+
+// Deterministic mode: the calling thread restarts as stream 0 of seed and threads that
+// use ThreadRandom() for the first time afterwards get streams 1, 2, ... in that order.
+// Threads that already had a stream keep it, so call this before starting workers.
+inline void SetRandomSeed(uint64_t seed)
+{
+    // This thread's stream is made first, or a thread that never drew a number would count itself after the reset
+    Xoshiro256& generator = ThreadRandom();
+    RandomSeedState().store(seed);
+    RandomSeedSet().store(true);
+    RandomThreadCount().store(1);
+    generator = Xoshiro256(seed);
+}
+MATH_CONTRACT_DEFAULT
@@ -0,0 +1,316 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include "Math.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Vertices - a growable point / vertex stream stored as a structure of arrays
+//----------------------------------------------------------------------------------
+// Position x, y, z and color r, g, b each live in their own float array, so bulk functions only
+// touch the components they need and run LANES vertices at a time (see MathSimd.h).
+// All six arrays share one heap block. Each array starts on a 64-byte boundary and is
+// Pitch() floats long, so the whole block can go to the GPU as is:
+//
+//     glBufferData(GL_ARRAY_BUFFER, vertices.Bytes(), vertices.Data(), GL_STATIC_DRAW);
+//     for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+//     {
+//         glVertexAttribPointer(s, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)vertices.StreamOffset((VertexStream)s));
+//         glEnableVertexAttribArray(s);
+//     }
+//
+// with one float input per stream in the vertex shader (assets/shaders/Points.vert).
+// Interleave writes x y z r g b per vertex instead, for shaders that want vec3 inputs.
+
+// Streams in the order they sit in the block
+typedef enum VertexStream {
+    VERTEX_X,
+    VERTEX_Y,
+    VERTEX_Z,
+    VERTEX_R,
+    VERTEX_G,
+    VERTEX_B,
+    VERTEX_STREAM_COUNT
+} VertexStream;
+
+class Vertices
+{
+public:
+    // Alignment of every stream in bytes (one cache line, also enough for AVX)
+    static const size_t ALIGNMENT = 64;
+
+    Vertices() {}
+
+    // count vertices at the origin, black
+    explicit Vertices(size_t count)
+    {
+        resize(count);
+    }
+
+    Vertices(const Vertices& other)
+    {
+        Reallocate(other.m_size);
+        m_size = other.m_size;
+        for (int s = 0; m_size && s < VERTEX_STREAM_COUNT; s++)
+            memcpy(Stream((VertexStream)s), other.Stream((VertexStream)s), m_size * sizeof(float));
+    }
+
+    Vertices(Vertices&& other) noexcept
+    {
+        Swap(other);
+    }
+
+    Vertices& operator=(Vertices other) noexcept
+    {
+        Swap(other);
+        return *this;
+    }
+
+    ~Vertices()
+    {
+        Free(m_data);
+    }
+
+    void Swap(Vertices& other) noexcept
+    {
+        float* data = m_data; m_data = other.m_data; other.m_data = data;
+        size_t size = m_size; m_size = other.m_size; other.m_size = size;
+        size_t pitch = m_pitch; m_pitch = other.m_pitch; other.m_pitch = pitch;
+    }
+
+    //------------------------------------------------------------------------------
+    // Container
+    //------------------------------------------------------------------------------
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_pitch; }
+    bool empty() const { return m_size == 0; }
+
+    // Grows the block to hold at least count vertices, keeping the current ones
+    void reserve(size_t count)
+    {
+        if (count > m_pitch)
+            Reallocate(count);
+    }
+
+    // New vertices are at the origin, black
+    void resize(size_t count)
+    {
+        reserve(count);
+        for (int s = 0; count > m_size && s < VERTEX_STREAM_COUNT; s++)
+            memset(Stream((VertexStream)s) + m_size, 0, (count - m_size) * sizeof(float));
+        m_size = count;
+    }
+
+    void push_back(Vector3 position, Vector3 color)
+    {
+        if (m_size == m_pitch)
+            Reallocate(m_pitch + m_pitch / 2 + 1);
+        Set(m_size++, position, color);
+    }
+
+    void clear() { m_size = 0; }
+
+    //------------------------------------------------------------------------------
+    // Element access
+    //------------------------------------------------------------------------------
+    float* Stream(VertexStream s) { return m_data + s * m_pitch; }
+    const float* Stream(VertexStream s) const { return m_data + s * m_pitch; }
+
+    Vector3 Position(size_t i) const
+    {
+        const float* p = m_data + i;
+        return { p[VERTEX_X * m_pitch], p[VERTEX_Y * m_pitch], p[VERTEX_Z * m_pitch] };
+    }
+
+    Vector3 Color(size_t i) const
+    {
+        const float* p = m_data + i;
+        return { p[VERTEX_R * m_pitch], p[VERTEX_G * m_pitch], p[VERTEX_B * m_pitch] };
+    }
+
+    void SetPosition(size_t i, Vector3 position)
+    {
+        float* p = m_data + i;
+        p[VERTEX_X * m_pitch] = position.x;
+        p[VERTEX_Y * m_pitch] = position.y;
+        p[VERTEX_Z * m_pitch] = position.z;
+    }
+
+    void SetColor(size_t i, Vector3 color)
+    {
+        float* p = m_data + i;
+        p[VERTEX_R * m_pitch] = color.x;
+        p[VERTEX_G * m_pitch] = color.y;
+        p[VERTEX_B * m_pitch] = color.z;
+    }
+
+    void Set(size_t i, Vector3 position, Vector3 color)
+    {
+        SetPosition(i, position);
+        SetColor(i, color);
+    }
+
+    //------------------------------------------------------------------------------
+    // GPU upload
+    //------------------------------------------------------------------------------
+    // The whole block, VERTEX_STREAM_COUNT streams of Pitch() floats. Only the first size() of each are used.
+    const void* Data() const { return m_data; }
+    size_t Bytes() const { return VERTEX_STREAM_COUNT * m_pitch * sizeof(float); }
+    size_t Pitch() const { return m_pitch; }
+
+    // Byte offset of a stream inside Data(), for glVertexAttribPointer
+    size_t StreamOffset(VertexStream s) const { return s * m_pitch * sizeof(float); }
+
+    // Writes x y z r g b of vertices [first, first + count) to dst, which is usually a mapped buffer
+    void Interleave(float* dst, size_t first, size_t count) const
+    {
+        assert(first + count <= m_size);
+        const float* x = Stream(VERTEX_X) + first;
+        const float* y = Stream(VERTEX_Y) + first;
+        const float* z = Stream(VERTEX_Z) + first;
+        const float* r = Stream(VERTEX_R) + first;
+        const float* g = Stream(VERTEX_G) + first;
+        const float* b = Stream(VERTEX_B) + first;
+        for (size_t i = 0; i < count; i++, dst += 6)
+        {
+            dst[0] = x[i];
+            dst[1] = y[i];
+            dst[2] = z[i];
+            dst[3] = r[i];
+            dst[4] = g[i];
+            dst[5] = b[i];
+        }
+    }
+
+    //------------------------------------------------------------------------------
+    // Bulk operations over all size() vertices
+    //------------------------------------------------------------------------------
+    // Sets every vertex to the same position and color
+    void Fill(Vector3 position, Vector3 color)
+    {
+        const float values[VERTEX_STREAM_COUNT] = { position.x, position.y, position.z, color.x, color.y, color.z };
+        for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+        {
+            float* p = Stream((VertexStream)s);
+            size_t i = 0;
+#if defined(MATH_SIMD)
+            const mathsimd::vfloat v = mathsimd::Splat(values[s]);
+            for (; i + mathsimd::LANES <= m_size; i += mathsimd::LANES)
+                mathsimd::StoreLanes(p + i, v);
+#endif
+            for (; i < m_size; i++) p[i] = values[s];
+        }
+    }
+
+    // Transforms every position by mat, see Multiply(Vector3, Matrix)
+    void Transform(Matrix mat)
+    {
+        float* x = Stream(VERTEX_X);
+        float* y = Stream(VERTEX_Y);
+        float* z = Stream(VERTEX_Z);
+        size_t i = 0;
+#if defined(MATH_SIMD)
+        using namespace mathsimd;
+        const vfloat m0 = Splat(mat.m0), m1 = Splat(mat.m1), m2 = Splat(mat.m2);
+        const vfloat m4 = Splat(mat.m4), m5 = Splat(mat.m5), m6 = Splat(mat.m6);
+        const vfloat m8 = Splat(mat.m8), m9 = Splat(mat.m9), m10 = Splat(mat.m10);
+        const vfloat m12 = Splat(mat.m12), m13 = Splat(mat.m13), m14 = Splat(mat.m14);
+        for (; i + LANES <= m_size; i += LANES)
+        {
+            vfloat vx = LoadLanes(x + i), vy = LoadLanes(y + i), vz = LoadLanes(z + i);
+            StoreLanes(x + i, m0 * vx + m4 * vy + m8 * vz + m12);
+            StoreLanes(y + i, m1 * vx + m5 * vy + m9 * vz + m13);
+            StoreLanes(z + i, m2 * vx + m6 * vy + m10 * vz + m14);
+        }
+#endif
+        for (; i < m_size; i++)
+        {
+            Vector3 p = Multiply(Vector3{ x[i], y[i], z[i] }, mat);
+            x[i] = p.x;
+            y[i] = p.y;
+            z[i] = p.z;
+        }
+    }
+
+    // Moves every position amount of the way to target, see Lerp(Vector3, Vector3, float)
+    void Lerp(Vector3 target, float amount)
+    {
+        const float values[3] = { target.x, target.y, target.z };
+        for (int s = VERTEX_X; s <= VERTEX_Z; s++)
+            LerpStream(Stream((VertexStream)s), nullptr, values[s], amount);
+    }
+
+    // Moves every position and color amount of the way to the same vertex of target, which must be as large
+    void Lerp(const Vertices& target, float amount)
+    {
+        assert(target.m_size >= m_size);
+        for (int s = 0; s < VERTEX_STREAM_COUNT; s++)
+            LerpStream(Stream((VertexStream)s), target.Stream((VertexStream)s), 0.0f, amount);
+    }
+
+private:
+    // p[i] += amount * ((to ? to[i] : value) - p[i])
+    void LerpStream(float* p, const float* to, float value, float amount)
+    {
+        size_t i = 0;
+#if defined(MATH_SIMD)
+        using namespace mathsimd;
+        const vfloat t = Splat(amount);
+        const vfloat v = Splat(value);
+        for (; i + LANES <= m_size; i += LANES)
+        {
+            vfloat a = LoadLanes(p + i);
+            StoreLanes(p + i, a + t * ((to ? LoadLanes(to + i) : v) - a));
+        }
+#endif
+        for (; i < m_size; i++) p[i] = p[i] + amount * ((to ? to[i] : value) - p[i]);
+    }
+
+    // Moves the vertices to a block with room for at least count of them
+    void Reallocate(size_t count)
+    {
+        // Round each stream up to whole cache lines so the next one starts aligned
+        const size_t lineFloats = ALIGNMENT / sizeof(float);
+        size_t pitch = (count + lineFloats - 1) / lineFloats * lineFloats;
+        float* data = Allocate(VERTEX_STREAM_COUNT * pitch * sizeof(float));
+        for (int s = 0; m_size && s < VERTEX_STREAM_COUNT; s++)
+            memcpy(data + s * pitch, Stream((VertexStream)s), m_size * sizeof(float));
+        Free(m_data);
+        m_data = data;
+        m_pitch = pitch;
+    }
+
+    static float* Allocate(size_t bytes)
+    {
+        if (bytes == 0)
+            return nullptr;
+        void* p = nullptr;
+#if defined(_WIN32)
+        p = _aligned_malloc(bytes, ALIGNMENT);
+#else
+        if (posix_memalign(&p, ALIGNMENT, bytes) != 0)
+            p = nullptr;
+#endif
+        if (!p)
+            throw std::bad_alloc();
+        return (float*)p;
+    }
+
+    static void Free(float* p)
+    {
+#if defined(_WIN32)
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+
+    float* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pitch = 0;
+};
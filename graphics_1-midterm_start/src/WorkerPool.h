@@ -0,0 +1,141 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @file WorkerPool.h
+/// @brief Worker threads shared by every module that splits its work into numbered jobs.
+/// Workers sleep between calls and hand out jobs through one atomic counter; the calling thread
+/// works too, and Run returns when every job is done. Modules use WorkerPool::Shared() rather than
+/// starting cores - 1 threads of their own each, which would put several busy threads on every core.
+class WorkerPool
+{
+public:
+    //! The program's pool, started on first use with one thread less than there are cores.
+    static WorkerPool& Shared()
+    {
+        static WorkerPool pool((int)std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    explicit WorkerPool(int workers)
+    {
+        for (int i = 0; i < workers; i++)
+            m_workers.emplace_back(&WorkerPool::Worker, this, i);
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers)
+            worker.join();
+    }
+
+    int Workers() const { return (int)m_workers.size(); }
+    //! Workers a Run given this helpers argument gets to use.
+    int Helpers(int helpers) const { return helpers < 0 || helpers > Workers() ? Workers() : helpers; }
+
+    /// @brief Runs job(0) to job(count - 1) on the calling thread and at most helpers workers (every
+    /// worker if helpers is negative) and returns when all of them are done.
+    /// Calls from inside a job, or with nothing to share out, just loop on the calling thread;
+    /// calls from two threads at once take turns.
+    void Run(int count, const std::function<void(int)>& job, int helpers = -1)
+    {
+        helpers = Helpers(helpers);
+        if (count <= 1 || helpers == 0 || InJob())
+        {
+            for (int i = 0; i < count; i++)
+                job(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> turn(m_turn);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_count = count;
+            m_helpers = helpers;
+            m_next = 0;
+            m_done = 0;
+            m_generation++;
+        }
+        m_wake.notify_all();
+        InJob() = true;
+        Work(job, count);
+        InJob() = false;
+
+        // Wait for the last job and for every worker to let go of `job`.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_done == m_count && m_active == 0; });
+        m_job = nullptr;
+    }
+
+private:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    //! Set on threads running jobs, so a job that calls Run doesn't wait on the workers it is holding up.
+    static bool& InJob()
+    {
+        static thread_local bool inJob = false;
+        return inJob;
+    }
+
+    void Work(const std::function<void(int)>& job, int count)
+    {
+        for (int i = m_next++; i < count; i = m_next++)
+        {
+            job(i);
+            if (++m_done == count)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_finished.notify_all();
+            }
+        }
+    }
+
+    void Worker(int index)
+    {
+        InJob() = true;
+        unsigned seen = 0;
+        for (;;)
+        {
+            const std::function<void(int)>* job;
+            int count;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_quit || (m_job && m_generation != seen); });
+                if (m_quit)
+                    return;
+                seen = m_generation;
+                if (index >= m_helpers)
+                    continue;
+                job = m_job;
+                count = m_count;
+                m_active++;
+            }
+            Work(*job, count);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_active == 0)
+                m_finished.notify_all();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_turn;                      // Held by the thread whose jobs are being run.
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_finished;
+    const std::function<void(int)>* m_job = nullptr;
+    int m_count = 0, m_helpers = 0, m_active = 0;
+    std::atomic<int> m_next{ 0 }, m_done{ 0 };
+    unsigned m_generation = 0;
+    bool m_quit = false;
+};
@@ -1,6 +1,7 @@
 //#include <glad/glad.h>
 //#include <GLFW/glfw3.h>
 //#include "Math.h"
+//#include "Vertices.h"
 //
 //#include <iostream>
 //#include <fstream>
@@ -90,14 +91,6 @@
 //    return shaderProgram;
 //}
 //
-//struct Vertex
-//{
-//    Vector3 position;
-//    Vector3 color;
-//};
-//
-//using Vertices = std::vector<Vertex>;
-//
 //int main()
 //{
 //    glfwInit();
@@ -1,6 +1,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "Math.h"
+#include "Vertices.h"
+#include "IFS.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -11,6 +13,9 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
 
 #define NUM_VERTICES 30000
 
@@ -25,24 +30,28 @@ Vertex triangle[3] = {
     {0.0f, 1.0f, 0.0f, 0.0f, 1.0f}
 };
 
-Vertex vertices[NUM_VERTICES];
+Vertices vertices(NUM_VERTICES);
 
 void generateSierpinskiTriangle() {
-    srand(time(NULL));
-
-    vertices[0] = triangle[rand() % 3];
-
-    for (int i = 1; i < NUM_VERTICES; i++) {
-        int n = rand() % 3;
-        Vertex prev = vertices[i - 1];
-        Vertex current = triangle[n];
-
-        vertices[i].x = (prev.x + current.x) / 2.0f;
-        vertices[i].y = (prev.y + current.y) / 2.0f;
-        vertices[i].r = current.r;
-        vertices[i].g = current.g;
-        vertices[i].b = current.b;
+    // Move halfway to a random corner and take its color, on many chains at once
+    float corners[3][3], colors[3][3];
+    for (int i = 0; i < 3; i++) {
+        corners[i][0] = triangle[i].x;
+        corners[i][1] = triangle[i].y;
+        corners[i][2] = 0.0f;
+        colors[i][0] = triangle[i].r;
+        colors[i][1] = triangle[i].g;
+        colors[i][2] = triangle[i].b;
     }
+
+    IFSOutput out;
+    out.x = vertices.Stream(VERTEX_X);
+    out.y = vertices.Stream(VERTEX_Y);
+    out.z = vertices.Stream(VERTEX_Z);
+    out.r = vertices.Stream(VERTEX_R);
+    out.g = vertices.Stream(VERTEX_G);
+    out.b = vertices.Stream(VERTEX_B);
+    GenerateIFS(IFSCorners(corners, colors, 3), (unsigned)time(NULL), 0, vertices.size(), out);
 }
 
 GLuint CreateShader(GLint type, const char* path)
@@ -120,7 +129,130 @@ GLuint CreateProgram(GLuint vs, GLuint fs)
     return shaderProgram;
 }
 
-int main() {
+// Seconds per call of work, called until at least a fifth of a second has gone by.
+template <class Work>
+double secondsPerRun(Work work) {
+    typedef std::chrono::high_resolution_clock Clock;
+    int runs = 0;
+    double seconds = 0.0;
+    const Clock::time_point start = Clock::now();
+    do {
+        work();
+        runs++;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < 0.2 || runs < 3);
+    return seconds / runs;
+}
+
+// Largest difference between two arrays of floats, 0 only if they are the same bits.
+float largestDifference(const float* a, const float* b, size_t count) {
+    if (memcmp(a, b, count * sizeof(float)) == 0)
+        return 0.0f;
+    float largest = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        largest = fmaxf(largest, fabsf(a[i] - b[i]));
+    return largest > 0.0f ? largest : FLT_MIN;
+}
+
+// Times the batch functions of Math.h against loops over the scalar ones on the same random
+// inputs and compares the results. Multiply and Invert must match bit for bit. Run with --math-bench.
+int mathBenchmark() {
+    const size_t count = 4099;  // Not a multiple of any lane count, so the scalar tails run too.
+    SetRandomSeed(1);
+    std::vector<Vector3> v(count), vScalar(count), vBatch(count);
+    std::vector<Quaternion> q1(count), q2(count), qScalar(count), qBatch(count);
+    std::vector<Matrix> m(count), mScalar(count), mBatch(count);
+    for (size_t i = 0; i < count; i++) {
+        v[i] = { Random(-10.0f, 10.0f), Random(-10.0f, 10.0f), Random(-10.0f, 10.0f) };
+        q1[i] = Normalize(Quaternion{ Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f) });
+        q2[i] = Normalize(Quaternion{ Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f) });
+        float* f = &m[i].m0;
+        for (int k = 0; k < 16; k++)
+            f[k] = Random(-2.0f, 2.0f);
+    }
+    const Matrix transform = m[0];
+    const Quaternion rotation = q1[0];
+
+    printf("Math.h batch functions, %s, %d elements, ns per element, scalar loop vs batch\n", MathSimdPath(), (int)count);
+    bool exact = true;
+    auto report = [&](const char* name, double scalar, double batch, const float* a, const float* b, size_t floats, bool mustMatch) {
+        const float difference = largestDifference(a, b, floats);
+        if (scalar > 0.0)
+            printf("  %-14s %7.2f %7.2f  %5.2fx  ", name, scalar * 1e9 / count, batch * 1e9 / count, scalar / batch);
+        else
+            printf("  %-14s %7s %7s  %6s  ", name, "", "", "");
+        if (difference == 0.0f)
+            printf("same\n");
+        else
+            printf("differ by up to %g%s\n", difference, mustMatch ? "  FAILED" : "");
+        exact = exact && (!mustMatch || difference == 0.0f);
+    };
+
+    double scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) vScalar[i] = Multiply(v[i], transform); });
+    double batch = secondsPerRun([&] { Multiply(v.data(), count, transform, vBatch.data()); });
+    report("Vec3 * Mat", scalar, batch, &vScalar[0].x, &vBatch[0].x, count * 3, true);
+
+    vBatch = v;
+    Multiply(vBatch.data(), count, transform, vBatch.data());
+    report("  in place", 0.0, 0.0, &vScalar[0].x, &vBatch[0].x, count * 3, true);
+
+    scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) mScalar[i] = Multiply(m[i], transform); });
+    batch = secondsPerRun([&] { Multiply(m.data(), count, transform, mBatch.data()); });
+    report("Mat * Mat", scalar, batch, &mScalar[0].m0, &mBatch[0].m0, count * 16, true);
+
+    scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) mScalar[i] = Invert(m[i]); });
+    batch = secondsPerRun([&] { Invert(m.data(), count, mBatch.data()); });
+    report("Invert", scalar, batch, &mScalar[0].m0, &mBatch[0].m0, count * 16, true);
+
+    scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) vScalar[i] = Rotate(v[i], rotation); });
+    batch = secondsPerRun([&] { Rotate(v.data(), count, rotation, vBatch.data()); });
+    report("Rotate(q)", scalar, batch, &vScalar[0].x, &vBatch[0].x, count * 3, false);
+
+    scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) vScalar[i] = Rotate(v[i], q1[i]); });
+    batch = secondsPerRun([&] { Rotate(v.data(), q1.data(), count, vBatch.data()); });
+    report("Rotate(q[i])", scalar, batch, &vScalar[0].x, &vBatch[0].x, count * 3, false);
+
+    scalar = secondsPerRun([&] { for (size_t i = 0; i < count; i++) qScalar[i] = Slerp(q1[i], q2[i], 0.3f); });
+    batch = secondsPerRun([&] { Slerp(q1.data(), q2.data(), count, 0.3f, qBatch.data()); });
+    report("Slerp", scalar, batch, &qScalar[0].x, &qBatch[0].x, count * 4, false);
+    return exact ? 0 : 1;
+}
+
+// Times Random.h against rand() filling the same arrays, in millions of numbers per second.
+// Run with --random-bench.
+int randomBenchmark() {
+    const size_t count = 1 << 16;
+    std::vector<float> floats(count);
+    std::vector<int> ints(count);
+    SetRandomSeed(1);
+    srand(1);
+    Xoshiro256& xoshiro = ThreadRandom();
+    const Philox4x32 philox(1);
+    uint64_t first = 0, block = 0;     // Next unused number and block of philox's sequence.
+
+    printf("Random numbers, %s, %d at a time, millions per second\n", MathSimdPath(), (int)count);
+    auto report = [&](const char* name, double seconds) {
+        printf("  %-36s %8.1f\n", name, count / seconds * 1e-6);
+    };
+    report("rand() / RAND_MAX", secondsPerRun([&] { for (size_t i = 0; i < count; i++) floats[i] = (float)rand() / RAND_MAX; }));
+    report("Xoshiro256::NextFloat", secondsPerRun([&] { for (size_t i = 0; i < count; i++) floats[i] = xoshiro.NextFloat(); }));
+    report("Random(-1, 1)", secondsPerRun([&] { for (size_t i = 0; i < count; i++) floats[i] = Random(-1.0f, 1.0f); }));
+    report("Philox4x32 one at a time", secondsPerRun([&] { for (size_t i = 0; i < count; i++) floats[i] = philox.Float(first + i); first += count; }));
+    report("RandomFloats", secondsPerRun([&] { RandomFloats(philox, first, count, floats.data()); first += count; }));
+    report("rand() % 100", secondsPerRun([&] { for (size_t i = 0; i < count; i++) ints[i] = rand() % 100; }));
+    report("Xoshiro256::NextInt(0, 99)", secondsPerRun([&] { for (size_t i = 0; i < count; i++) ints[i] = xoshiro.NextInt(0, 99); }));
+    report("RandomInts(0, 99)", secondsPerRun([&] { RandomInts(philox, first, count, ints.data(), 0, 99); first += count; }));
+    std::vector<float> xyz(count * 3);
+    report("RandomUnitVectors (vectors)", secondsPerRun([&] { RandomUnitVectors(philox, block, count, xyz.data()); block += count; }));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--random-bench") == 0)
+        return randomBenchmark();
+    if (argc > 1 && strcmp(argv[1], "--math-bench") == 0)
+        return mathBenchmark();
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
         return -1;
@@ -140,7 +272,7 @@ int main() {
         return -1;
     }
 
-    GLuint vsDefault = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/Default.vert");
+    GLuint vsDefault = CreateShader(GL_VERTEX_SHADER, "./assets/shaders/Points.vert");
     GLuint fsDefault = CreateShader(GL_FRAGMENT_SHADER, "./assets/shaders/Default.frag");
     GLuint shaderDefault = CreateProgram(vsDefault, fsDefault);
     glUseProgram(shaderDefault);
@@ -166,19 +298,19 @@ int main() {
 
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // Upload the SoA block as is, one float attribute per stream
+    glBufferData(GL_ARRAY_BUFFER, vertices.Bytes(), vertices.Data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    for (int s = 0; s < VERTEX_STREAM_COUNT; s++) {
+        glVertexAttribPointer(s, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)vertices.StreamOffset((VertexStream)s));
+        glEnableVertexAttribArray(s);
+    }
 
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT);
 
         glBindVertexArray(vao);
-        glDrawArrays(GL_POINTS, 0, NUM_VERTICES);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)vertices.size());
 
         glfwSwapBuffers(window);
         glfwPollEvents();